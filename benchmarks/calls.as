@@ -0,0 +1,35 @@
+; Benchmark: recursive subroutine calls and returns
+; SUM adds r1, r1 - 1, ..., 1 into r2 with one call per term,
+; and calls the leaf MIX at every level
+; 80 x 1000 sums of 40 terms, about 32 million instructions
+
+MAIN: clr r6
+ clr r7
+REP: clr r5
+PASS: mov #40, r1
+ clr r2
+ jsr SUM
+ add r2, r6
+ inc r5
+ cmp r5, #-24
+ bne PASS
+ inc r7
+ cmp r7, #80
+ bne REP
+ prn r2
+ prn r3
+ prn r6
+ stop
+
+SUM: add r1, r2
+ jsr MIX
+ dec r1
+ cmp r1, #0
+ bne MORE
+ rts
+MORE: jsr SUM
+ rts
+
+MIX: not r3
+ add r1, r3
+ rts
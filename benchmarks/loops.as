@@ -0,0 +1,22 @@
+; Benchmark: nested counting loops with register arithmetic
+; 100 x 1000 x 64 iterations of the inner loop, about 32 million instructions
+
+MAIN: clr r3
+ clr r4
+ clr r5
+OUT: clr r1
+MID: clr r2
+IN: add r1, r4
+ sub r4, r5
+ inc r2
+ cmp r2, #64
+ bne IN
+ inc r1
+ cmp r1, #-24
+ bne MID
+ inc r3
+ cmp r3, #100
+ bne OUT
+ prn r4
+ prn r5
+ stop
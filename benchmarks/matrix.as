@@ -0,0 +1,42 @@
+; Benchmark: matrix addition and transposition through M[rX][rY] addressing
+; A row of a 3x3 matrix is 3 words, so r1 holds the row offset i*3
+; and r4 holds j*3 for the transposed matrix
+; 100 x 1000 passes over the matrices, about 10 million instructions
+
+MAIN: clr r0
+ clr r6
+REP: clr r5
+PASS: clr r1
+ clr r7
+ROW: clr r2
+ clr r4
+COL: mov A[r1][r2], r3
+ add B[r1][r2], r3
+ mov r3, C[r1][r2]
+ add r5, A[r1][r2]
+ mov C[r1][r2], T[r4][r7]
+ inc r2
+ add #3, r4
+ cmp r2, #3
+ bne COL
+ add #3, r1
+ inc r7
+ cmp r7, #3
+ bne ROW
+ inc r5
+ cmp r5, #-24
+ bne PASS
+ inc r6
+ cmp r6, #100
+ bne REP
+ clr r1
+PRINT: prn T[r1][r0]
+ inc r1
+ cmp r1, #9
+ bne PRINT
+ stop
+
+A: .mat [3][3] 1, 2, 3, 4, 5, 6, 7, 8, 9
+B: .mat [3][3] 9, 8, 7, 6, 5, 4, 3, 2, 1
+C: .mat [3][3]
+T: .mat [3][3]
@@ -0,0 +1,44 @@
+; Benchmark: string scanning, reversing and comparing through .string data
+; Characters are read through matrix operands with r0 = 0,
+; STR[rX][r0] is the character at index rX
+; 100 x 1000 passes over the string, about 26 million instructions
+
+MAIN: clr r0
+ clr r6
+ clr r7
+REP: clr r5
+PASS: mov #-1, r1
+LEN: inc r1
+ cmp STR[r1][r0], #0
+ bne LEN
+ mov r1, r2
+ clr r3
+REV: dec r2
+ mov STR[r2][r0], BUF[r3][r0]
+ inc r3
+ cmp r2, #0
+ bne REV
+ clr r4
+SAME: cmp STR[r4][r0], BUF[r4][r0]
+ bne NEXT
+ inc r6
+NEXT: inc r4
+ cmp r4, r1
+ bne SAME
+ inc r5
+ cmp r5, #-24
+ bne PASS
+ inc r7
+ cmp r7, #100
+ bne REP
+ prn r1
+ prn r6
+ clr r4
+PRINT: prn BUF[r4][r0]
+ inc r4
+ cmp r4, r1
+ bne PRINT
+ stop
+
+STR: .string "abracadabra racecar"
+BUF: .string "..................."
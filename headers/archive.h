@@ -0,0 +1,104 @@
+/**
+ * This is the static archive header file.
+ * An archive (.lib) bundles assembled modules together with an index of the symbols they export.
+ * The file is laid out so it can be mapped into memory and searched in place:
+ *   - A header with the number of members and symbols and the offsets of their tables.
+ *   - The symbol index: fixed size records sorted by name, searched with a binary search.
+ *   - The member table: fixed size records with the sizes of each member and the offset of its contents.
+ *   - The member contents: the words of the module followed by its entry and external use records.
+ * All numbers are stored in the byte order of the host that created the archive.
+ * Linking against an archive only reads the index and the members that are actually needed.
+ */
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+#include "object_reader.h"
+#include "definitions.h"
+
+/* Archive constants */
+#define ARCHIVE_MAGIC "ASMLIB1"
+#define ARCHIVE_MAGIC_LENGTH 8
+#define ARCHIVE_MEMBER_NAME_LENGTH 63
+
+/* Archive header struct definition */
+typedef struct Archive_Header {
+    char magic[ARCHIVE_MAGIC_LENGTH];
+    unsigned int members_count;
+    unsigned int symbols_count;
+    unsigned int symbols_offset;  /* Offset of the symbol index */
+    unsigned int members_offset;  /* Offset of the member table */
+} Archive_Header;
+
+/* Archive symbol struct definition - a record of the symbol index */
+typedef struct Archive_Symbol {
+    char name[MAX_LABEL_NAME_LENGTH + 1];
+    unsigned int member;   /* Index of the member that exports the symbol */
+    unsigned int address;  /* Address of the symbol inside the member */
+} Archive_Symbol;
+
+/* Archive member struct definition - a record of the member table */
+typedef struct Archive_Member {
+    char name[ARCHIVE_MEMBER_NAME_LENGTH + 1];
+    unsigned int offset;             /* Offset of the member contents */
+    unsigned int code_size;
+    unsigned int data_size;
+    unsigned int entries_count;
+    unsigned int extern_uses_count;
+} Archive_Member;
+
+/* Open archive struct definition */
+typedef struct Archive {
+    char *name;
+    unsigned char *contents;   /* The whole archive file */
+    unsigned long size;
+    int is_mapped;             /* 1 if the contents are mapped into memory, 0 if they were read */
+    Archive_Header *header;
+    Archive_Symbol *symbols;
+    Archive_Member *members;
+    int *is_extracted;         /* Marks the members that were already extracted */
+} Archive;
+
+/**
+ * Creates an archive file from assembled modules.
+ * Symbols exported by more than one module are reported and no archive is created.
+ * @archive_name: The name of the archive file to create.
+ * @modules: The modules to bundle.
+ * @modules_count: The number of modules.
+ * return 0 if successful, 1 if errors were detected.
+ */
+int create_archive(char *archive_name, Object_Module **modules, int modules_count);
+
+
+/**
+ * Opens an archive file, mapping it into memory where possible, and validates its tables.
+ * @archive_name: The name of the archive file to open.
+ * return Pointer to the open archive, or NULL if an error was detected.
+ */
+Archive *open_archive(char *archive_name);
+
+
+/**
+ * Finds the member that exports a symbol, using a binary search over the symbol index.
+ * @archive: Pointer to the open archive.
+ * @name: The name of the symbol.
+ * return The index of the member, or -1 if no member exports the symbol.
+ */
+int find_archive_symbol(Archive *archive, char *name);
+
+
+/**
+ * Extracts a member of an archive as an object module and marks it as extracted.
+ * @archive: Pointer to the open archive.
+ * @member: The index of the member to extract.
+ * return Pointer to the new module, or NULL if an error was detected.
+ */
+Object_Module *extract_archive_member(Archive *archive, int member);
+
+
+/**
+ * Closes an archive and frees its memory.
+ * @archive: Pointer to the archive to close.
+ */
+void close_archive(Archive *archive);
+
+
+#endif
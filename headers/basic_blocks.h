@@ -0,0 +1,71 @@
+/**
+ * This is the basic blocks header file.
+ * A basic block is a sequence of instructions that is entered at its first instruction only and ends with a control
+ * transfer ("jmp", "bne", "jsr", "rts" or "stop") or right before the first instruction of another block.
+ * Inside a block, common instruction sequences are fused into superinstructions, executed by a single handler:
+ *   - "cmp" + "bne" (the loop test)
+ *   - "inc" + "cmp" + "bne" (the counting loop tail)
+ *   - "mov" + "add"
+ * Only the sequences whose operands are registers or immediate values, and whose "bne" jumps to an address in the
+ * memory, are fused. Their handler reads the operands of the whole sequence straight from the registers, without
+ * the checks of memory operands (a matrix element outside of the memory, a write into decoded code), and dispatches
+ * once for the sequence.
+ * The record of the first instruction of the sequence gets the superinstruction handler, the records of the other
+ * instructions stay as they are, so jumps into the middle of a sequence still run it one instruction at a time.
+ * A superinstruction depends on all of the words of its sequence, so a write to any of them turns it back into a
+ * plain instruction.
+ * The execution counts of the blocks are computed after a run from the control transfers counted by the interpreter,
+ * and entries by falling through from the previous block.
+ */
+#ifndef BASIC_BLOCKS_H
+#define BASIC_BLOCKS_H
+#include "machine.h"
+
+/* Superinstruction patterns, in the order of their handlers */
+#define TOTAL_SUPERINSTRUCTIONS (HANDLER_MOV_ADD - HANDLER_CMP_BNE + 1)
+
+/* Basic block struct definition */
+typedef struct Basic_Block {
+    int start;                  /* Address of the first instruction */
+    int end;                    /* Address after the last instruction */
+    int instructions_count;
+    unsigned long executions;
+} Basic_Block;
+
+/**
+ * Fuses the instruction sequences of the loaded program into superinstructions.
+ * @machine: Pointer to the loaded machine.
+ * @fused_counts: Set to the number of superinstructions formed for each pattern.
+ * return The total number of superinstructions formed.
+ */
+int fuse_superinstructions(Machine *machine, int *fused_counts);
+
+
+/**
+ * Retrieves the names of the instructions a superinstruction fuses.
+ * @handler: The handler of the superinstruction.
+ * return The names, separated by '+'.
+ */
+char *superinstruction_name(int handler);
+
+
+/**
+ * Finds the basic blocks of the code section and their execution counts.
+ * The targets of direct jumps and the addresses that control was transferred to during the run start new blocks.
+ * @machine: Pointer to the machine, after a run.
+ * @blocks: Array of at least MACHINE_MEMORY_SIZE blocks to fill.
+ * return The number of blocks.
+ */
+int find_basic_blocks(Machine *machine, Basic_Block *blocks);
+
+
+/**
+ * Adds the number of times every instruction of the code section ran to counters, from the execution counts of the
+ * basic blocks. The block the run stopped in is counted up to the instruction it stopped at.
+ * @machine: Pointer to the machine, after a run.
+ * @runs: Counters indexed by the address of the instruction.
+ */
+void count_instruction_runs(Machine *machine, unsigned long *runs);
+
+
+#endif
@@ -0,0 +1,94 @@
+/**
+ * This is the batch header file.
+ * A batch runs many instances of the same program in lockstep, each instance (lane) with its own input and output.
+ * The state of the lanes is kept as a structure of arrays: every cell (memory word or register), the zero flag, the
+ * pc and every level of the call stack is a row holding one value per lane. An instruction runs on all of its lanes
+ * with loops over contiguous rows, which the compiler turns into vector instructions (SSE2, or AVX2 when enabled).
+ * The running lanes that share the lowest pc form the active group and a mask row selects them: results are blended
+ * into the rows under the mask, so the other lanes keep their values. A branch that splits the group leaves its lanes
+ * at different addresses, the lanes that are behind run first and the group merges again once they meet.
+ * All of the lanes share the decoded instructions of a single loaded machine. A lane that would write into a decoded
+ * instruction, or reach a word that was not decoded at load time, leaves the batch and finishes with the interpreter.
+ */
+#ifndef BATCH_H
+#define BATCH_H
+#include "machine.h"
+
+/* Lanes of a 256-bit vector of 16-bit values, the rows are padded to a multiple of it */
+#define BATCH_VECTOR_LANES 16
+
+/* Lane output struct definition */
+typedef struct Lane_Output {
+    char *text;
+    unsigned long length;
+    unsigned long capacity;
+} Lane_Output;
+
+/* Batch struct definition */
+typedef struct Batch {
+    Machine *program;                /* The loaded program, its decoded instructions are shared by the lanes */
+    Machine *machine;                /* Machine that finishes the lanes leaving the batch */
+    int lanes_count;
+    int width;                       /* Length of a row, the number of lanes rounded up to whole vectors */
+    unsigned short *cells;           /* Cell c of lane l is cells[c * width + l] */
+    unsigned short *stack;           /* Return address d of lane l is stack[d * width + l] */
+    unsigned short *pc;
+    unsigned short *zero_flag;
+    unsigned short *sp;
+    unsigned short *status;
+    unsigned short *fault;
+    unsigned short *mask;            /* All bits set for the lanes of the active group */
+    unsigned short *scratch;         /* Rows of operand values, addresses and results */
+    unsigned long *executed;
+    const unsigned char **inputs;
+    unsigned long *input_sizes;
+    unsigned long *input_positions;
+    Lane_Output *outputs;
+    unsigned long max_steps;         /* Step limit of each lane, 0 for no limit */
+    unsigned long pending_steps;     /* Steps of the active group not added to the executed counts of its lanes yet */
+    unsigned long steps;             /* Instructions run for a group of lanes */
+    unsigned long lane_steps;        /* Lanes in the groups, summed over the steps */
+    unsigned long departures;        /* Lanes that stopped or left the batch */
+    int ejected_count;               /* Lanes finished by the interpreter */
+    unsigned long code_writes;       /* Writes into decoded instructions by the lanes finished by the interpreter */
+    unsigned long instruction_runs[MACHINE_MEMORY_SIZE + 1]; /* Lanes that ran the instruction at each address */
+} Batch;
+
+/**
+ * Creates a batch of lanes that run a loaded program, all of them at the state of the program after loading and
+ * without input.
+ * @program: Pointer to the machine the program was loaded into, without superinstructions. It is not modified.
+ * @lanes_count: The number of lanes.
+ * return Pointer to the batch, or NULL if memory allocation failed.
+ */
+Batch *create_batch(Machine *program, int lanes_count);
+
+
+/**
+ * Sets the input that "red" reads in a lane.
+ * @batch: Pointer to the batch.
+ * @lane: The index of the lane.
+ * @input: The characters of the input, kept by the caller during the run.
+ * @size: The number of characters.
+ */
+void set_lane_input(Batch *batch, int lane, const unsigned char *input, unsigned long size);
+
+
+/**
+ * Runs the lanes until all of them stop, fault or reach the step limit.
+ * A lane that faults reports its runtime error with the index of the lane.
+ * @batch: Pointer to the batch.
+ * @max_steps: The maximum number of instructions to execute in each lane, 0 for no limit.
+ * return The number of lanes that reached "stop".
+ */
+int run_batch(Batch *batch, unsigned long max_steps);
+
+
+/**
+ * Frees a batch and the outputs of its lanes.
+ * @batch: Pointer to the batch.
+ */
+void free_batch(Batch *batch);
+
+
+#endif
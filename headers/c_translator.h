@@ -0,0 +1,38 @@
+/**
+ * This is the C translator header file.
+ * The translator turns a loaded program into a C translation unit that runs it natively, ahead of time:
+ * every instruction becomes a labeled statement, direct jumps become a goto and indirect ones ("rts", register and
+ * matrix targets) go through a switch on the address. The registers and the zero flag are local variables, so the
+ * host compiler keeps them in registers.
+ * The instructions come from the predecoded records of the emulator, so both agree on the decoding. The translated
+ * instructions are the ones of the code section and the ones reachable from it by direct jumps.
+ * A translated program cannot decode instructions again, so a write into its code stops it with a runtime error
+ * (Error_405), and a jump to an address that was not translated stops it as an invalid instruction.
+ * The translated program takes two optional arguments: the name of a file to write its final state to, in the format
+ * of write_machine_state(), and a step limit. Like the interpreter, it checks the limit on every control transfer
+ * and stops there once the executed instructions reached it.
+ */
+#ifndef C_TRANSLATOR_H
+#define C_TRANSLATOR_H
+#include <stdio.h>
+#include "machine.h"
+
+/**
+ * Writes the C translation of a loaded program.
+ * @machine: Pointer to the machine the program was loaded into, without superinstructions.
+ * @program_name: The name of the program, for the comment at the top of the translation.
+ * @file: The file to write the translation to.
+ * return The number of translated instructions.
+ */
+int translate_program(Machine *machine, char *program_name, FILE *file);
+
+
+/**
+ * Writes the state of a machine after a run, in the format the translated programs write it.
+ * @machine: Pointer to the machine.
+ * @file: The file to write the state to.
+ */
+void write_machine_state(Machine *machine, FILE *file);
+
+
+#endif
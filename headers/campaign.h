@@ -0,0 +1,28 @@
+/**
+ * This is the campaign header file.
+ * A campaign runs the jobs of a manifest, each job a program, an input file and the file of its expected output, on
+ * all of the cores of the host in a single process.
+ * Every program of the manifest is read and predecoded once, and its loaded machine is shared read-only by the
+ * workers: a job starts from a copy of it, so no job pays for starting a process or decoding its program.
+ * Every worker owns a range of the jobs, runs them from the front, and steals half of the jobs left at the back of
+ * another worker when its own range is empty. The output of a job goes to a buffer of its worker and is compared with
+ * the expected output, and the results are printed as a summary that lists the failed jobs only.
+ * Hosts without POSIX threads run the jobs on a single worker.
+ */
+#ifndef CAMPAIGN_H
+#define CAMPAIGN_H
+
+/**
+ * Runs the jobs of a manifest and prints the summary of their results.
+ * Every non-empty line of the manifest names a program (without an extension), an input file and an expected output
+ * file. A job passes if its program reaches "stop" and writes exactly the expected output.
+ * @manifest_name: The name of the manifest file.
+ * @workers_count: The number of workers, 0 for one per online processor.
+ * @max_steps: The maximum number of instructions to execute in each job, 0 for no limit.
+ * @show_statistics: 1 to print the jobs run and stolen by each worker.
+ * return 0 if all of the jobs passed, 1 otherwise.
+ */
+int run_campaign(char *manifest_name, int workers_count, unsigned long max_steps, int show_statistics);
+
+
+#endif
@@ -0,0 +1,51 @@
+/**
+ * This is the coverage header file.
+ * The coverage of a program keeps one bit per memory word, set when an instruction that holds the word ran (the
+ * bitmap of the whole memory is 32 bytes), and the number of times every instruction ran.
+ * Nothing is counted per instruction while the program runs: the interpreter and the JIT already count the control
+ * transfers into every address, and the runs of the instructions are computed from the execution counts of the basic
+ * blocks after the run. A batch counts the lanes of each instruction it runs for a group instead, so its coverage is
+ * the coverage of all of its instances merged.
+ * The instructions are decoded from the memory after the run, so the coverage of a run that wrote into its own code
+ * would count the runs of instructions that replaced the ones that ran; such runs are rejected by the emulator.
+ * Coverage is merged by adding the runs and OR-ing the bitmaps. The report maps the instructions to the lines of the
+ * macro-expanded source file (.am) through the line map of the symbol file (.sym) that the assembler writes with
+ * "--symbols".
+ */
+#ifndef COVERAGE_H
+#define COVERAGE_H
+#include "machine.h"
+
+#define COVERAGE_BYTES (MACHINE_MEMORY_SIZE / 8)
+
+/* Marker of the lines of instructions that never ran in the coverage report */
+#define COVERAGE_NOT_RUN "#####"
+
+/* Coverage struct definition */
+typedef struct Coverage {
+    unsigned char words[COVERAGE_BYTES];         /* Bit w % 8 of byte w / 8 is set if the instruction of word w ran */
+    unsigned long runs[MACHINE_MEMORY_SIZE + 1]; /* Times the instruction at each address ran */
+} Coverage;
+
+/**
+ * Merges the runs of the instructions of a program into a coverage.
+ * @coverage: Pointer to the coverage, zeroed before the first merge.
+ * @machine: Pointer to the machine of the program, its memory gives the words of the instructions.
+ * @runs: Times the instruction at each address ran.
+ */
+void add_coverage(Coverage *coverage, Machine *machine, const unsigned long *runs);
+
+
+/**
+ * Prints the summary of a coverage (code words, instructions and basic blocks that ran) and writes its report, the
+ * .am file with the runs of every instruction in front of its line, to the program name with ".cov" added.
+ * Without a symbol file, the report lists the runs of the instructions by address.
+ * @coverage: Pointer to the coverage.
+ * @machine: Pointer to the machine of the program.
+ * @base_name: The name of the program without an extension.
+ * return 0 if successful, 1 if an error was detected.
+ */
+int write_coverage(Coverage *coverage, Machine *machine, char *base_name);
+
+
+#endif
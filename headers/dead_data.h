@@ -0,0 +1,23 @@
+/**
+ * This is the dead data header file.
+ * With "--dead-data" the assembler removes the data that no instruction can reach before the second pass codes the
+ * data addresses. The data is divided into blocks, each one starts at a data label and holds the words up to the next
+ * data label, so the unlabeled data that follows a label stays with it. A block is removed when its label is neither
+ * an operand of an instruction (directly or as the base of a matrix operand) nor an ".entry" label. The data before
+ * the first data label is always kept. The remaining data is moved together and the removed labels are dropped, so
+ * the second pass gives the data labels their addresses after the code as usual.
+ * A program that reaches a block through the address of another block (past the end of a matrix, for example)
+ * should not be assembled with "--dead-data".
+ */
+#ifndef DEAD_DATA_H
+#define DEAD_DATA_H
+
+/**
+ * Removes the data blocks whose labels are not used, and moves the data labels with the remaining data.
+ * @data: Array containing the data code.
+ * @DC: Pointer to the data counter, set to the number of words that remain.
+ */
+void remove_dead_data(unsigned short *data, int *DC);
+
+
+#endif
@@ -14,7 +14,7 @@
 /* Counts and capacities */
 #define TOTAL_OPCODES 16
 #define TOTAL_REGISTERS 8
-#define TOTAL_INSTRUCTION_TYPES 5
+#define TOTAL_INSTRUCTION_TYPES 7
 #define MAX_ARRAY_CAPACITY 256
 
 /* Address and numeric constants */
@@ -0,0 +1,30 @@
+/**
+ * This is the differential testing header file.
+ * A differential run runs a program on two machines: the reference, which runs plain instructions with the
+ * interpreter, and the engine under test (superinstructions or the JIT). The engine runs a slice of the program and
+ * the reference runs up to the same instruction count, and then their whole states are compared: the status, the pc,
+ * the executed instructions, the zero flag, the call stack, every memory word and register, and the output written
+ * during the slice. Both stop at a control transfer once a slice is done, so the checkpoints fall on basic blocks.
+ * When a checkpoint differs, both machines go back to the previous checkpoint and run again one basic block at a
+ * time, which is the finest step the engines can stop at, and the first block whose states differ is reported with
+ * the full state of both machines.
+ */
+#ifndef DIFFERENTIAL_H
+#define DIFFERENTIAL_H
+#include "machine.h"
+
+/**
+ * Runs a program on a reference machine and an engine machine in lockstep, comparing their states at checkpoints.
+ * The outputs of both machines must be files that can be read back (tmpfile), they are compared as they grow.
+ * @reference: Pointer to the loaded machine that runs plain instructions.
+ * @engine: Pointer to the loaded machine that runs the engine under test.
+ * @is_jit: 1 if the engine is the JIT, 0 if it is the interpreter with superinstructions.
+ * @interval: The number of instructions between checkpoints, 1 to compare after every basic block.
+ * @max_steps: The maximum number of instructions to execute, 0 for no limit.
+ * return The number of checkpoints that were compared, or -1 if the machines diverged or an error was detected.
+ */
+long run_differential(Machine *reference, Machine *engine, int is_jit, unsigned long interval,
+                      unsigned long max_steps);
+
+
+#endif
@@ -0,0 +1,32 @@
+/**
+ * This is the disassembler header file.
+ * The disassembler turns a loaded module back into source in the layout of the .am file:
+ * - The words of the code are decoded with the field layout of the assembler (process_one_operand and
+ *   process_two_operands): the opcode and both addressing methods in the first word, then one word per operand,
+ *   one word shared by two register operands, and two words (base address, then the row and column registers) for
+ *   a matrix operand. A word that does not start a valid instruction is written as ".data".
+ * - Labels come from the entry file, the symbol file (.sym) when there is one and the external file, which names the
+ *   external symbol of every word that uses one. Targets of relocatable words that have no name get a generated
+ *   label ("L" and the address).
+ * - The data is split at its labels, a part that holds printable characters ending with 0 is written as ".string" and
+ *   any other part as ".data" (the dimensions of ".mat" are not kept in the object file).
+ * A module whose labels are all known assembles back into the same object file.
+ */
+#ifndef DISASSEMBLER_H
+#define DISASSEMBLER_H
+#include <stdio.h>
+#include "object_reader.h"
+#include "symbol_file.h"
+
+/**
+ * Writes the source of a module.
+ * @module: The module to disassemble.
+ * @symbols: The symbols of the symbol file of the module, NULL if it has none.
+ * @symbols_count: The number of symbols.
+ * @output: The file to write the source to.
+ * return The number of code words that do not start a valid instruction, or -1 if memory allocation failed.
+ */
+int disassemble_module(Object_Module *module, Program_Symbol *symbols, int symbols_count, FILE *output);
+
+
+#endif
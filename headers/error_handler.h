@@ -14,6 +14,8 @@ typedef struct Error {
 typedef enum ERROR_CODES {
     /* 100-199: System errors */
     Error_100 = 100, Error_101, Error_102, Error_103, Error_104, Error_105,
+    Error_106, Error_107, Error_108, Error_109, Error_110, Error_111,
+    Error_112,
     /* 200-299: Syntax/semantic errors */
     Error_200 = 200, Error_201, Error_202, Error_203, Error_204, Error_205,
     Error_206, Error_207, Error_208, Error_209, Error_210, Error_211,
@@ -25,7 +27,14 @@ typedef enum ERROR_CODES {
     Error_242, Error_243, Error_244, Error_245, Error_246, Error_247,
     Error_248, Error_249, Error_250, Error_251, Error_252, Error_253,
     Error_254, Error_255, Error_256, Error_257, Error_258, Error_259,
-    Error_260, Error_261, Error_262, Error_263
+    Error_260, Error_261, Error_262, Error_263, Error_264, Error_265,
+    Error_266,
+    /* 300-399: Link errors */
+    Error_300 = 300, Error_301, Error_302, Error_303, Error_304,
+    Error_305, Error_306, Error_307, Error_308,
+    /* 400-499: Runtime errors */
+    Error_400 = 400, Error_401, Error_402, Error_403, Error_404,
+    Error_405, Error_406
 } ERROR_CODES;
 
 /**
@@ -0,0 +1,25 @@
+/**
+ * This is the interpreter header file.
+ * The interpreter runs the predecoded instructions of a machine with direct threading: every decoded record holds
+ * the address of its handler, and every handler jumps straight to the handler of the next instruction
+ * (computed goto, where the compiler supports it, or a switch otherwise).
+ * Superinstructions run the instructions they fuse in a single handler, and count each of them as executed.
+ * The step limit is checked on control transfers only, so straight-line code runs without checks and a program
+ * may run a few instructions past the limit.
+ */
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+#include "machine.h"
+
+/**
+ * Runs the machine until it stops, faults or reaches the step limit.
+ * "red" reads a character from the input of the machine (-1 at its end) and "prn" writes a signed decimal number and
+ * a newline to the output of the machine.
+ * @machine: Pointer to the loaded machine.
+ * @max_steps: The maximum number of instructions to execute, 0 for no limit.
+ * return The status of the machine.
+ */
+int run_machine(Machine *machine, unsigned long max_steps);
+
+
+#endif
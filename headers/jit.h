@@ -0,0 +1,57 @@
+/**
+ * This is the jit header file.
+ * The JIT translates the basic blocks of a machine into x86-64 code, in an executable buffer mapped with mmap.
+ * Translated code keeps the registers r0-r7 in the host registers r8d-r15d and the machine state behind rbp, and
+ * checks the step limit and counts block entries on control transfers, like the interpreter.
+ * A jump to a block that was not translated yet leaves to the JIT, which translates the block and patches the jump
+ * to go straight to it (block chaining). Indirect targets ("rts", register and matrix operands) are looked up in a
+ * table of translated blocks.
+ * Anything the translated code does not handle ("red", "prn", invalid instructions, runtime errors and writes into
+ * decoded instructions) leaves to the interpreter, which runs until the next control transfer. Writes into decoded
+ * instructions flush all of the translated code.
+ * The JIT is available on x86-64 Linux only, elsewhere the interpreter runs the whole program.
+ */
+#ifndef JIT_H
+#define JIT_H
+#include "machine.h"
+
+/* JIT statistics struct definition */
+typedef struct Jit_Statistics {
+    unsigned long blocks;          /* Number of translated blocks */
+    unsigned long code_size;       /* Number of bytes of translated code */
+    unsigned long chained;         /* Number of jumps patched to go straight to their target block */
+    unsigned long fallbacks;       /* Number of times the interpreter ran instead of translated code */
+    unsigned long flushes;         /* Number of times all of the translated code was discarded */
+} Jit_Statistics;
+
+/**
+ * Checks if the JIT is available on this host.
+ * return 1 if it is available, 0 otherwise.
+ */
+int is_jit_supported(void);
+
+
+/**
+ * Runs the machine with translated code until it stops, faults or reaches the step limit.
+ * The machine runs the same as with the interpreter, see run_machine().
+ * @machine: Pointer to the loaded machine.
+ * @max_steps: The maximum number of instructions to execute, 0 for no limit.
+ * return The status of the machine.
+ */
+int run_jit(Machine *machine, unsigned long max_steps);
+
+
+/**
+ * Retrieves the statistics of the JIT since the program started.
+ * return Pointer to the statistics.
+ */
+Jit_Statistics *retrieve_jit_statistics(void);
+
+
+/**
+ * Unmaps the buffer of the translated code.
+ */
+void release_jit(void);
+
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ * This is the line table header file.
+ * This file maps the addresses of the instructions of the assembled module to the lines of the macro-expanded
+ * source file (.am) they were assembled from, so tools that run the object code can report by source line.
+ * The map is written, sorted by address, to the symbol file (.sym) next to the object file when the assembler is run
+ * with "--symbols", together with every label of the module (see symbol_file.h).
+ */
+#ifndef LINE_TABLE_H
+#define LINE_TABLE_H
+
+/* Source line struct definition */
+typedef struct Source_Line {
+    int address;           /* Address of the first word of the instruction */
+    int line_num;          /* Line number in the .am file */
+} Source_Line;
+
+/**
+ * Adds the source line of an instruction, the instructions are added in the order of their addresses.
+ * @address: The address of the first word of the instruction.
+ * @line_num: The line number in the .am file.
+ * return 0 for a successful operation, 1 if the table is full.
+ */
+int add_source_line(int address, int line_num);
+
+
+/**
+ * Retrieves the source lines of the instructions.
+ * @count: Set to the number of instructions.
+ * return Pointer to the first source line.
+ */
+Source_Line *retrieve_source_lines(int *count);
+
+
+/**
+ * Creates a symbol file (.sym) with every label of the module (its name, address, location and type, external
+ * labels with address 0) and the source lines of the instructions.
+ * @file_sym_name: The name of the symbol file to create.
+ */
+void create_sym_file(char *file_sym_name);
+
+
+/**
+ * Moves the source lines with the instructions of the module, after the optimizer removed some of them.
+ * @positions: The new position of each word of the code, -1 for the removed words.
+ */
+void move_source_lines(int *positions);
+
+
+/**
+ * Removes all of the source lines, so the table can be used for the next file.
+ */
+void reset_source_lines();
+
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * This is the link map header file.
+ * A link map (.map) is written next to every linked image and records how the image was built:
+ *   - The load offsets and sizes of every module, and a checksum of its contents.
+ *   - The final addresses of the symbols every module exports.
+ *   - The final addresses of the relocatable words of every module (from its relocation table).
+ *   - The final addresses of the external uses of every module and the symbols they refer to.
+ * An incremental relink compares the modules against the map, so it only has to patch the words of
+ * the modules that changed and the words that refer to symbols that moved.
+ * The map is a text file with one record per line:
+ *   <modules count> <code size> <data size>
+ *   M <name> <code base> <data base> <code size> <data size> <checksum> <entries> <relocations> <external uses>
+ *   E <name> <address>    (one line per entry of the module above)
+ *   R <address>           (one line per relocatable word of the module above)
+ *   X <name> <address>    (one line per external use of the module above)
+ */
+#ifndef LINK_MAP_H
+#define LINK_MAP_H
+#include "object_reader.h"
+#include "module_linker.h"
+
+/* Map module struct definition - the record of a module in the link map */
+typedef struct Map_Module {
+    char *name;
+    int code_base;
+    int data_base;
+    int code_size;
+    int data_size;
+    unsigned long checksum;
+    Symbol *entries;         /* Exported symbols with their final addresses */
+    int entries_count;
+    int *relocations;        /* Final addresses of the relocatable words */
+    int relocations_count;
+    Symbol *extern_uses;     /* External uses with their final addresses */
+    int extern_uses_count;
+} Map_Module;
+
+/* Link map struct definition */
+typedef struct Link_Map {
+    int modules_count;
+    int code_size;
+    int data_size;
+    Map_Module *modules;
+} Link_Map;
+
+/**
+ * Computes the checksum of the contents of a module: its words, entries and external uses.
+ * @module: Pointer to the module.
+ * return The checksum of the module.
+ */
+unsigned long module_checksum(Object_Module *module);
+
+
+/**
+ * Creates the link map file of a linked image.
+ * @output_name: The name of the output files without an extension.
+ * @modules: The linked modules, in load order.
+ * @modules_count: The number of modules.
+ * @layout: The layout of the linked image.
+ * return 0 if successful, 1 if the file could not be created.
+ */
+int write_link_map(char *output_name, Object_Module **modules, int modules_count, Link_Layout *layout);
+
+
+/**
+ * Loads the link map of a linked image.
+ * @output_name: The name of the output files without an extension.
+ * return Pointer to the loaded map, or NULL if the map does not exist, is malformed or places a module or an external
+ *        use outside of the image.
+ */
+Link_Map *read_link_map(char *output_name);
+
+
+/**
+ * Frees a link map and all of its tables.
+ * @map: Pointer to the map to free.
+ */
+void free_link_map(Link_Map *map);
+
+
+#endif
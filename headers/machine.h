@@ -0,0 +1,230 @@
+/**
+ * This is the machine header file.
+ * This file holds the state of the machine that runs assembled programs and the predecoded form of its instructions.
+ * Machine model:
+ *   - 256 memory words of 10 bits (addresses 0-255), the program is loaded at the memory start address.
+ *   - 8 registers of 10 bits (r0-r7) and a zero flag (Z) in the status word, set by "cmp" only.
+ *   - A hidden call stack used by "jsr" and "rts", separated from the memory.
+ * Values are 10-bit two's complement numbers, every result wraps around to 10 bits.
+ * The registers are kept right after the memory words in a single cells array, so register and memory operands are
+ * both a cell index once decoded.
+ * Instructions are decoded once, when the program is loaded, into records holding their handler and their operands.
+ * A write to a memory word that belongs to a decoded instruction invalidates that instruction, so self modifying
+ * programs are decoded again when they reach the modified code.
+ * Control transfers ("jmp", "bne", "jsr", "rts") count the entries into their target address, so the execution counts
+ * of basic blocks cost one increment per block instead of one per instruction.
+ * The object code does not record the dimensions of a matrix, so "M[rX][rY]" addresses the word at the base address
+ * of M plus the values of rX and rY.
+ */
+#ifndef MACHINE_H
+#define MACHINE_H
+#include <stdio.h>
+#include "object_reader.h"
+#include "definitions.h"
+
+/* Machine constants */
+#define MACHINE_MEMORY_SIZE 256
+#define MACHINE_CELLS_COUNT (MACHINE_MEMORY_SIZE + TOTAL_REGISTERS)
+#define MACHINE_STACK_DEPTH 256
+#define MAX_INSTRUCTION_LENGTH 5       /* Opcode word and two matrix operands */
+#define MAX_FUSED_INSTRUCTIONS 3       /* Instructions executed by the longest superinstruction */
+#define MAX_RECORD_SPAN (MAX_FUSED_INSTRUCTIONS * MAX_INSTRUCTION_LENGTH)
+#define REGISTER_CELL(reg) (MACHINE_MEMORY_SIZE + (reg))
+#define SIGN_EXTEND_10_BITS(value) ((int)(((value) & MASK_10_BITS) ^ 0x200) - 0x200)
+#define INPUT_CHUNK_SIZE 4096          /* Size of the chunks the input of a program is read in */
+#define MACHINE_OUTPUT_BUFFER_SIZE 4096 /* Output of "prn" kept before it is written */
+#define MAX_PRINTED_LENGTH 5           /* Characters "prn" writes for the lowest value, "-512\n" */
+#define SIGN_EXTEND_8_BITS(value) ((int)(((value) & MASK_8_BITS) ^ 0x80) - 0x80)
+
+/* Opcodes, as numbered in the opcodes table */
+#define MOV_OPCODE 0
+#define CMP_OPCODE 1
+#define ADD_OPCODE 2
+#define SUB_OPCODE 3
+#define LEA_OPCODE 4
+#define CLR_OPCODE 5
+#define NOT_OPCODE 6
+#define INC_OPCODE 7
+#define DEC_OPCODE 8
+#define JMP_OPCODE 9
+#define BNE_OPCODE 10
+#define JSR_OPCODE 11
+#define RED_OPCODE 12
+#define PRN_OPCODE 13
+#define RTS_OPCODE 14
+#define STOP_OPCODE 15
+
+/* Operand kind enum definition */
+typedef enum Operand_Kind {
+    OPERAND_NONE,
+    OPERAND_IMMEDIATE,  /* The value is the operand */
+    OPERAND_CELL,       /* A memory word or a register, the location is its cell index */
+    OPERAND_MATRIX      /* The location is the base address, row and column are the index registers */
+} Operand_Kind;
+
+/* Handlers of the predecoded instructions beyond the opcodes */
+typedef enum Handler {
+    HANDLER_DECODE = TOTAL_OPCODES,  /* The word was not decoded yet, or was modified since */
+    HANDLER_INVALID,                 /* The word is not a valid instruction */
+    HANDLER_CMP_BNE,                 /* Superinstructions, see basic_blocks.h */
+    HANDLER_INC_CMP_BNE,
+    HANDLER_MOV_ADD,
+    HANDLER_BREAK,                   /* Stops the machine before the instruction, see snapshot.h */
+    TOTAL_HANDLERS
+} Handler;
+
+/* Machine status enum definition */
+typedef enum Machine_Status {
+    MACHINE_RUNNING,
+    MACHINE_HALTED,     /* Reached "stop" */
+    MACHINE_FAULTED,    /* Stopped by a runtime error */
+    MACHINE_STEP_LIMIT, /* Stopped after the maximum number of steps */
+    MACHINE_BREAK       /* Stopped at a breakpoint, before the instruction at the pc */
+} Machine_Status;
+
+/* Decoded operand struct definition */
+typedef struct Operand {
+    unsigned char kind;
+    unsigned char row;             /* Matrix row register */
+    unsigned char column;          /* Matrix column register */
+    unsigned short location;       /* Cell index, or base address of a matrix */
+    unsigned short value;          /* Value of an immediate operand */
+} Operand;
+
+/* Decoded instruction struct definition */
+typedef struct Decoded_Instruction {
+    const void *code;              /* Address of the handler, bound by the interpreter */
+    unsigned char handler;         /* Opcode, or one of the extra handlers */
+    unsigned char length;          /* Number of words */
+    unsigned char span;            /* Number of words the handler depends on, longer than length for superinstructions */
+    unsigned short next;           /* Address of the following instruction */
+    Operand source;
+    Operand destination;
+} Decoded_Instruction;
+
+/* Word write struct definition - a write of a cell, logged for the trace of a run */
+typedef struct Word_Write {
+    unsigned long executed;        /* Instructions executed when the write happened, the writing one included */
+    unsigned short cell;
+    unsigned short value;
+} Word_Write;
+
+/* Machine struct definition */
+typedef struct Machine {
+    unsigned short cells[MACHINE_CELLS_COUNT];           /* Memory words followed by the registers */
+    int pc;
+    int zero_flag;
+    int sp;                                              /* Number of return addresses on the stack */
+    unsigned short stack[MACHINE_STACK_DEPTH];
+    int status;
+    int fault;                                           /* Error code of the runtime error */
+    int is_quiet;                                        /* Runtime errors are left for the caller to report */
+    unsigned long executed;                              /* Number of executed instructions */
+    unsigned long block_entries[MACHINE_MEMORY_SIZE + 1]; /* Number of control transfers into each address */
+    unsigned long code_writes;                           /* Number of writes into decoded instructions */
+    FILE *output;                                        /* Output of "prn" */
+    const unsigned char *input;                          /* Input of "red", the standard input when NULL */
+    unsigned long input_size;
+    unsigned long input_position;
+    const unsigned char *expected;                       /* Output to compare with instead of writing, or NULL */
+    unsigned long expected_size;
+    unsigned long expected_position;                     /* Characters of the expected output matched so far */
+    int is_unexpected;                                   /* The output differs from the expected output */
+    unsigned long output_length;                         /* Characters waiting in the output buffer */
+    Word_Write *write_log;                               /* Logs the writes of the instructions when it is not NULL */
+    int write_log_count;
+    int code_start;
+    int code_end;                                        /* Address after the last instruction word */
+    unsigned char is_decoded_word[MACHINE_MEMORY_SIZE];  /* Marks the words that belong to a decoded instruction */
+    Decoded_Instruction decoded[MACHINE_MEMORY_SIZE + 1]; /* The last record stops a program that runs off the memory */
+    const void *const *handler_codes;                    /* Handler addresses of the interpreter, bound by its first run */
+    char output_buffer[MACHINE_OUTPUT_BUFFER_SIZE];      /* Written when it is full and whenever the interpreter stops */
+} Machine;
+
+/**
+ * Decodes the instruction at an address, using the operand counts and legal addressing modes of the opcodes table.
+ * @cells: The cells of the machine.
+ * @address: The address of the instruction.
+ * @instruction: Pointer to the record to fill, its handler is HANDLER_INVALID if the word is not a valid instruction.
+ */
+void decode_instruction(unsigned short *cells, int address, Decoded_Instruction *instruction);
+
+
+/**
+ * Loads a module into a reset machine and predecodes all of its instructions.
+ * The module must not have unresolved external uses.
+ * @machine: Pointer to the machine.
+ * @module: The module to load.
+ * return 0 if successful, 1 if errors were detected.
+ */
+int load_machine(Machine *machine, Object_Module *module);
+
+
+/**
+ * Decodes the instruction at an address again and marks its words.
+ * @machine: Pointer to the machine.
+ * @address: The address of the instruction.
+ */
+void predecode_address(Machine *machine, int address);
+
+
+/**
+ * Invalidates the decoded instructions that contain a memory word, after the word was written.
+ * @machine: Pointer to the machine.
+ * @address: The address of the written word.
+ */
+void invalidate_decoded(Machine *machine, int address);
+
+
+/**
+ * Computes the address of a memory operand (direct or matrix), or the value of a register operand.
+ * @machine: Pointer to the machine.
+ * @operand: The decoded operand.
+ * return The address, or -1 if a matrix element is outside of the memory.
+ */
+int operand_address(Machine *machine, Operand *operand);
+
+
+/**
+ * Reads the whole input of a program, so it can be given to more than one run.
+ * @file: The file to read.
+ * @size: Set to the number of characters read.
+ * return Pointer to the characters, or NULL if memory allocation failed.
+ */
+unsigned char *read_program_input(FILE *file, unsigned long *size);
+
+
+/**
+ * Checks if two runs wrote the same output.
+ * @first: The output file of the first run.
+ * @second: The output file of the second run.
+ * return 1 if the contents are the same, 0 otherwise.
+ */
+int is_same_output(FILE *first, FILE *second);
+
+
+/**
+ * Writes characters to the output of a machine, or compares them with its expected output when it has one.
+ * @machine: Pointer to the machine.
+ * @text: The characters.
+ * @length: The number of characters.
+ */
+void write_output(Machine *machine, const char *text, unsigned long length);
+
+
+/**
+ * Writes the output buffer of a machine (see write_output) and empties it.
+ * @machine: Pointer to the machine.
+ */
+void flush_output(Machine *machine);
+
+
+/**
+ * Stops the machine with a runtime error at the current instruction and reports it, unless the machine is quiet.
+ * @machine: Pointer to the machine.
+ * @error_code: The code of the runtime error.
+ */
+void fault_machine(Machine *machine, int error_code);
+
+
+#endif
@@ -0,0 +1,45 @@
+/**
+ * This is the mapped file header file.
+ * A mapped file is the whole contents of a file in memory: on hosts with mmap a regular file is mapped instead of
+ * being copied, so a program that reads a large input (or an output compared with a large expected file) does not
+ * pay for a copy of it, and the machine reads it with a cursor. Pipes, terminals and hosts without mmap fall back to
+ * reading the file into an allocated buffer.
+ */
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+#include <stdio.h>
+
+/* Mapped file struct definition */
+typedef struct Mapped_File {
+    unsigned char *data;             /* The contents of the file from its position when it was mapped */
+    unsigned long size;
+    void *mapping;                   /* Start of the mapping, or NULL when the contents were read */
+    unsigned long mapping_size;
+} Mapped_File;
+
+/**
+ * Maps the rest of an open file into memory, from its current position.
+ * @file: The file.
+ * @mapped: Set to the contents of the file.
+ * return 0 if the file was mapped, 1 if it is not a regular file (or the host has no mmap) and must be read.
+ */
+int map_file(FILE *file, Mapped_File *mapped);
+
+
+/**
+ * Loads the contents of an open file: maps it when possible, reads it otherwise.
+ * @file: The file.
+ * @mapped: Set to the contents of the file.
+ * return 0 if successful, 1 if an error was detected.
+ */
+int load_mapped_file(FILE *file, Mapped_File *mapped);
+
+
+/**
+ * Unmaps (or frees) the contents of a file.
+ * @mapped: Pointer to the contents, it is left empty.
+ */
+void unmap_file(Mapped_File *mapped);
+
+
+#endif
@@ -0,0 +1,77 @@
+/**
+ * This is the module linker header file.
+ * Explanation of the process:
+ * The instruction words of all of the modules are placed one after the other, followed by all of their data words,
+ * so the linked image keeps the object file layout of a single module.
+ * Every symbol listed in the entry files is relocated to its final address and stored in a global symbol table.
+ * The instruction words listed in the relocation table of a module are moved by the load offset of their module
+ * (code or data offset, depending on the section the address points to), and every external use listed in the
+ * external files is resolved through the global symbol table.
+ * Each word and each symbol is visited once, so linking is linear in the total number of words and symbols.
+ * Archives are searched only for the symbols that are still undefined, and only the members that export them
+ * are extracted and linked.
+ * Every link also writes a link map (see link_map.h), and an incremental relink uses it to patch the previous
+ * image: when all of the modules keep their sizes and exported symbols the load offsets stay the same, so only
+ * the words of the changed modules and the external uses of symbols that moved have to be written again.
+ */
+#ifndef MODULE_LINKER_H
+#define MODULE_LINKER_H
+#include "object_reader.h"
+#include "archive.h"
+
+/* Link layout struct definition */
+typedef struct Link_Layout {
+    int *code_bases;  /* Offset of each module in the linked instruction words */
+    int *data_bases;  /* Offset of each module in the linked data words */
+    int code_size;    /* Total number of instruction words */
+    int data_size;    /* Total number of data words */
+} Link_Layout;
+
+/**
+ * Computes the final address of an address that belongs to a module.
+ * @module: The module the address belongs to.
+ * @layout: The layout of the linked image.
+ * @index: The index of the module in the layout.
+ * @address: The address as assembled in the module.
+ * return The final address, or -1 if the address is outside of the module.
+ */
+int relocate_address(Object_Module *module, Link_Layout *layout, int index, int address);
+
+
+/**
+ * Adds the archive members that export symbols used but not defined by the modules.
+ * Extracted members may use more external symbols, so the search goes on until no undefined symbol
+ * can be found in the archives. The archives are searched in order and the first one that exports a symbol wins.
+ * Symbols that stay undefined are reported later by link_modules.
+ * @modules: Pointer to the array of modules, reallocated as members are added.
+ * @modules_count: Pointer to the number of modules.
+ * @archives: The archives to search.
+ * @archives_count: The number of archives.
+ * return 0 if successful, 1 if errors were detected.
+ */
+int add_archive_members(Object_Module ***modules, int *modules_count, Archive **archives, int archives_count);
+
+
+/**
+ * Links the modules into a single image and creates its output files (.ob and .ent).
+ * Duplicate and undefined symbols are reported, and no output is created if errors were detected.
+ * @modules: The modules to link, in load order.
+ * @modules_count: The number of modules.
+ * @output_name: The name of the output files without an extension.
+ * return 0 if successful, 1 if errors were detected.
+ */
+int link_modules(Object_Module **modules, int modules_count, char *output_name);
+
+
+/**
+ * Relinks the modules into an existing image using its link map.
+ * If there is no usable map, or a module changed its size or exported symbols, all of the modules are linked again.
+ * @modules: The modules to link, in load order.
+ * @modules_count: The number of modules.
+ * @output_name: The name of the output files without an extension.
+ * return 0 if successful, 1 if errors were detected.
+ */
+int relink_modules(Object_Module **modules, int modules_count, char *output_name);
+
+
+#endif
@@ -0,0 +1,64 @@
+/**
+ * This is the object reader header file.
+ * This file handles the loading of an assembled module back from its output files:
+ * the object file (.ob) and, when they exist, the entry (.ent), external (.ext) and relocation (.rel) files.
+ * Modules assembled without a relocation file get their relocatable words from the ARE bits of the instruction words.
+ * It is shared by the tools that consume the assembler output.
+ */
+#ifndef OBJECT_READER_H
+#define OBJECT_READER_H
+#include "definitions.h"
+
+/* Symbol struct definition - an entry of the module or a use of an external symbol */
+typedef struct Symbol {
+    char name[MAX_LABEL_NAME_LENGTH + 1];
+    int address;
+} Symbol;
+
+/* Object module struct definition */
+typedef struct Object_Module {
+    char *name;              /* Base name of the module files */
+    int code_size;           /* Number of instruction words (IC) */
+    int data_size;           /* Number of data words (DC) */
+    unsigned short *words;   /* Instruction words followed by data words */
+    Symbol *entries;         /* Symbols listed in the .ent file */
+    int entries_count;
+    Symbol *extern_uses;     /* Uses of external symbols listed in the .ext file */
+    int extern_uses_count;
+    int *relocations;        /* Sorted addresses of the relocatable instruction words */
+    int relocations_count;
+} Object_Module;
+
+/**
+ * Converts a base 4 string representation using letters (a=0, b=1, c=2, d=3) to a decimal number.
+ * @digits: The base 4 string to convert.
+ * return The decimal number, or -1 if the string is empty or contains an invalid letter.
+ */
+int base4_to_decimal(char *digits);
+
+
+/**
+ * Builds the relocation table of a module from the ARE bits of its instruction words.
+ * @module: Pointer to the module.
+ * return 0 if successful, 1 if memory allocation failed.
+ */
+int derive_relocations(Object_Module *module);
+
+
+/**
+ * Loads an assembled module from its output files.
+ * The object file must exist, the entry and external files are optional.
+ * @base_name: The name of the module without an extension.
+ * return Pointer to the loaded module, or NULL if an error was detected.
+ */
+Object_Module *read_object_module(char *base_name);
+
+
+/**
+ * Frees an object module and all of its tables.
+ * @module: Pointer to the module to free.
+ */
+void free_object_module(Object_Module *module);
+
+
+#endif
@@ -0,0 +1,43 @@
+/**
+ * This is the command-line options header file.
+ * This file handles the optional switches that can be passed to the assembler next to the file names.
+ * Options start with '-' and may appear anywhere on the command line, they apply to all of the files.
+ */
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+/* Options struct definition */
+typedef struct Options {
+    int hw_counters;  /* "--hwcounters": measures every assembler phase with performance counters */
+    int symbols;      /* "--symbols" (or "--lines"): writes a symbol file (.sym) with every label and source line */
+    int optimize_size;  /* "-Os": outlines the macros that are called several times into subroutines */
+    int optimize;       /* "-O": runs the peephole optimizer between the first and the second pass */
+    int dead_data;      /* "--dead-data": removes the data blocks whose labels are not used */
+    int size_report;    /* "--size-report": writes the words and operands of every label (.size.json) */
+    int run_length;     /* "--rle": writes the runs of equal words of the object file as single lines */
+} Options;
+
+/**
+ * Checks if a command-line argument is an option (starts with '-').
+ * @argument: The command-line argument to check.
+ * return 1 if the argument is an option, 0 otherwise.
+ */
+int is_option(char *argument);
+
+
+/**
+ * Parses a single command-line option and updates the options accordingly.
+ * @argument: The command-line option to parse.
+ * return 0 if the option was recognized, 1 otherwise.
+ */
+int parse_option(char *argument);
+
+
+/**
+ * Retrieves the options that were set on the command line.
+ * return Pointer to the static options struct.
+ */
+Options *retrieve_options();
+
+
+#endif
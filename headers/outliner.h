@@ -0,0 +1,76 @@
+/**
+ * This is the outliner header file.
+ * With "-Os" the pre-processor replaces the calls of a macro with a "jsr" to a single copy of its expansion that ends
+ * with "rts", when this takes fewer words than expanding every call:
+ *   calls * words > calls * 2 + words + 1   (each call is a "jsr" word and the address of the copy)
+ * Only the calls written in the source file itself are outlined, a macro called from the body of another macro is
+ * expanded there. A macro is outlined only when its expansion holds nothing but instructions without labels that do
+ * not transfer control themselves (no jmp, bne, jsr or rts), so it runs the same from the copy: "jsr" and "rts"
+ * keep the registers and the flag. The copies are added at the end of the .am file, after the code of the source, so
+ * macros are outlined only when the last instruction of the source is a "stop", "jmp" or "rts" that does not run on
+ * into them. A call of a copy also takes a stack entry while the copy runs, so macros are outlined only in a file
+ * without a "jsr" of its own: the calls of the copies are then the only entries of the stack, one at a time.
+ */
+#ifndef OUTLINER_H
+#define OUTLINER_H
+#include <stdio.h>
+#include "definitions.h"
+
+/* Outlined macro struct definition - a macro called in the source file */
+typedef struct Outlined_Macro {
+    char *name;
+    int calls;              /* Calls written in the source file */
+    int words;              /* Words of one expansion, 0 if it can not be outlined */
+    int is_decided;         /* 1 once the expansion was measured */
+    int is_outlined;
+    char label[MAX_LABEL_NAME_LENGTH + 1];
+    char *body;             /* The expansion, when the macro is outlined */
+    struct Outlined_Macro *next;
+} Outlined_Macro;
+
+/**
+ * Counts the calls of every macro written in a source file, and picks a prefix for the labels of the copies that
+ * appears nowhere in the file.
+ * @file_name: The name of the source file.
+ * return 0 if successful, 1 if an error was detected.
+ */
+int count_macro_calls(char *file_name);
+
+
+/**
+ * Finds the calls of a macro in the source file.
+ * @name: The name of the macro.
+ * return Pointer to the outlined macro, or NULL if the source file does not call it.
+ */
+Outlined_Macro *find_outlined_macro(char *name);
+
+
+/**
+ * Measures the expansion of a macro and outlines it if this saves words.
+ * @macro: Pointer to the outlined macro.
+ * @expansion: The expansion of the macro, read from its start.
+ * return 0 if successful, 1 if memory allocation failed.
+ */
+int decide_outline(Outlined_Macro *macro, FILE *expansion);
+
+
+/**
+ * Writes the copies of the outlined macros, each one with its label and followed by "rts".
+ * @file_am: The .am file.
+ */
+void write_outlined_macros(FILE *file_am);
+
+
+/**
+ * Prints the outlined macros and the words they saved.
+ */
+void report_outlined_macros();
+
+
+/**
+ * Frees the outlined macros, so the outliner can be used for the next file.
+ */
+void free_outlined_macros();
+
+
+#endif
@@ -0,0 +1,26 @@
+/**
+ * This is the peephole optimizer header file.
+ * With "-O" the assembler rewrites the instructions of the first pass before the second pass codes the labels.
+ * The code words are decoded into a list of instructions (opcode, addressing modes, length and the operand label of
+ * jumps), the rules below are applied until none of them matches, and the remaining words are moved together:
+ *   - "mov rX, rX" is removed.
+ *   - A "jmp" to the instruction that follows it is removed.
+ *   - A "jmp", "bne" or "jsr" to a "jmp" is given the target of that "jmp" (jump threading).
+ *   - The instructions after "stop", "rts" or "jmp" are removed up to the next label, nothing can reach them.
+ * The code labels, the operand labels the second pass codes and the source lines are moved with the words, so the
+ * output files describe the optimized code. A program that jumps to computed addresses instead of labels should not
+ * be assembled with "-O". The number of times each rule was applied is printed.
+ */
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+/**
+ * Optimizes the instructions of the first pass and moves the labels and the source lines with them.
+ * @code: Array containing the instruction code.
+ * @IC: Pointer to the instruction counter, set to the number of words that remain.
+ * return 0 if successful, 1 if memory allocation failed.
+ */
+int optimize_code(unsigned short *code, int *IC);
+
+
+#endif
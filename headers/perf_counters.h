@@ -0,0 +1,68 @@
+/**
+ * This is the performance counters header file.
+ * This file handles the optional measurement of the assembler phases ("--hwcounters" option).
+ * On Linux the counters are opened with perf_event_open: cycles, instructions, cache-misses and branch-misses.
+ * When the hardware events are not available (common inside containers and virtual machines), the software
+ * events of the kernel are used instead, and if those are not available either only the elapsed time is measured.
+ * All of the functions do nothing when the option was not given.
+ */
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+/* Phase enum definition */
+typedef enum Phase {
+    PRE_PROCESSING_PHASE,
+    FIRST_PASS_PHASE,
+    SECOND_PASS_PHASE,
+    TOTAL_PHASES
+} Phase;
+
+/* Counter mode enum definition */
+typedef enum Counter_Mode {
+    HARDWARE_COUNTERS,  /* cycles, instructions, cache-misses, branch-misses */
+    SOFTWARE_COUNTERS,  /* task-clock, page-faults, context-switches, cpu-migrations */
+    CLOCK_ONLY          /* elapsed time only */
+} Counter_Mode;
+
+/**
+ * Opens the counters, choosing the best mode that is available on the system.
+ * A warning is printed if the hardware counters could not be opened.
+ */
+void open_perf_counters();
+
+
+/**
+ * Starts measuring a phase of the assembler.
+ * @phase: The phase that is about to start.
+ */
+void begin_phase(Phase phase);
+
+
+/**
+ * Stops measuring a phase of the assembler and accumulates the measured values.
+ * @phase: The phase that has just ended.
+ */
+void end_phase(Phase phase);
+
+
+/**
+ * Sets the number of source lines of the current file, used for the per line ratios.
+ * @line_count: The number of lines in the file.
+ */
+void set_measured_lines(int line_count);
+
+
+/**
+ * Prints the measured values of every phase for the current file and resets them for the next file.
+ * @file_name: The name of the measured file.
+ */
+void report_perf_counters(char *file_name);
+
+
+/**
+ * Closes the counters.
+ */
+void close_perf_counters();
+
+
+#endif
@@ -0,0 +1,96 @@
+/**
+ * This is the profiler header file.
+ * The profiler runs a program one basic block at a time (the interpreter stops at the first control transfer once
+ * its step limit is reached, so a limit of one step runs exactly one block) and attributes the instructions of each
+ * block to the labels of the program. The counters are updated once per block, the instructions of a block are
+ * attributed to their labels after the run, from the number of times the block ran.
+ * The labels come from the symbol file (.sym) that the assembler writes with "--symbols", or from the entry file
+ * (.ent) when the program has no symbol file. Code before the first label is attributed to "(start)".
+ * The cycles of an instruction are the number of its words, the machine fetches one word per cycle.
+ * A "jsr" (the stack grows) enters the label of its target and a "rts" (the stack shrinks) returns to the caller,
+ * so the profiler keeps the call stacks that the instructions ran in, for the call graph and the folded stacks.
+ */
+#ifndef PROFILER_H
+#define PROFILER_H
+#include "machine.h"
+#include "object_reader.h"
+
+#define MAX_PROFILE_LABELS (MACHINE_MEMORY_SIZE + 2)
+#define MAX_CALL_NODES 65536       /* Distinct call stacks kept, deeper calls are attributed to their caller */
+
+/* Profile label struct definition */
+typedef struct Profile_Label {
+    char name[MAX_LABEL_NAME_LENGTH + 1];
+    int address;
+    unsigned long instructions;
+    unsigned long cycles;
+    unsigned long calls;             /* Number of times "jsr" entered the label */
+} Profile_Label;
+
+/* Call node struct definition - a call stack, its label is the innermost one */
+typedef struct Call_Node {
+    int label;
+    int parent;                      /* -1 for the root */
+    int first_child;
+    int next_sibling;
+    unsigned long instructions;      /* Instructions that ran in this call stack, not counting the calls it made */
+    unsigned long calls;
+} Call_Node;
+
+/* Profile struct definition */
+typedef struct Profile {
+    Profile_Label labels[MAX_PROFILE_LABELS];  /* Sorted by address */
+    int labels_count;
+    unsigned long block_runs[MACHINE_MEMORY_SIZE + 1];         /* Runs of the block that starts at each address */
+    unsigned long block_instructions[MACHINE_MEMORY_SIZE + 1]; /* Instructions of these runs */
+    Call_Node *nodes;
+    int nodes_count;
+    int nodes_capacity;
+    int current;                     /* Node of the running call stack */
+    int untracked_depth;             /* Calls made after the nodes ran out, attributed to the current node */
+} Profile;
+
+/**
+ * Creates a profile for a program and loads the labels of its code.
+ * @module: The program.
+ * @machine: Pointer to the machine the program was loaded into.
+ * return Pointer to the profile, or NULL if an error was detected.
+ */
+Profile *create_profile(Object_Module *module, Machine *machine);
+
+
+/**
+ * Runs a machine until it stops, faults or reaches the step limit, profiling the run.
+ * @machine: Pointer to the loaded machine, without superinstructions.
+ * @profile: Pointer to the profile.
+ * @max_steps: The maximum number of instructions to execute, 0 for no limit.
+ * return The status of the machine.
+ */
+int run_profiled(Machine *machine, Profile *profile, unsigned long max_steps);
+
+
+/**
+ * Prints the flat profile of the labels and the call graph.
+ * @profile: Pointer to the profile after the run.
+ */
+void print_profile(Profile *profile);
+
+
+/**
+ * Writes the call stacks of the run in the folded format of flame graph tools: one line per call stack, the labels
+ * separated by ';' and followed by the number of instructions that ran in it.
+ * @profile: Pointer to the profile after the run.
+ * @file_name: The name of the file to write.
+ * return 0 if successful, 1 if the file could not be written.
+ */
+int write_folded_stacks(Profile *profile, char *file_name);
+
+
+/**
+ * Frees a profile.
+ * @profile: Pointer to the profile.
+ */
+void free_profile(Profile *profile);
+
+
+#endif
@@ -0,0 +1,29 @@
+/**
+ * This is the program generator header file.
+ * The generator writes random assembly programs that assemble without errors, for fuzzing the execution engines of
+ * the emulator against each other (see the "-d" option of the emulator).
+ * Every operand gets an addressing method that the instruction table allows for it, and the program is shaped so that
+ * it runs to "stop" instead of faulting right away:
+ * - r6 and r7 hold 0 and 1 and are never written, they index the matrix, so matrix operands stay inside it.
+ * - r5 counts the iterations of the loops and is only written by them, so every loop ends.
+ * - Jumps go forward to a label of the main code, and "jsr" calls subroutines that end with "rts".
+ * - Written direct operands are data labels, unless self-modifying writes are enabled, which may also write into
+ *   the code that already ran (a write may turn an instruction into a word that does not decode).
+ * The program fits in the memory of the machine with its data, the generator stops adding code when it would not.
+ */
+#ifndef PROGRAM_GENERATOR_H
+#define PROGRAM_GENERATOR_H
+#include <stdio.h>
+
+/**
+ * Writes a random program.
+ * @file: The file to write the program (.as) to.
+ * @seed: The seed of the random numbers, the same seed writes the same program.
+ * @instructions_count: The number of instructions of the main code to aim for.
+ * @is_self_modifying: 1 to let the program write into its code, 0 otherwise.
+ * return The number of memory words of the program.
+ */
+int generate_program(FILE *file, unsigned long seed, int instructions_count, int is_self_modifying);
+
+
+#endif
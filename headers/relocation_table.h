@@ -0,0 +1,78 @@
+/**
+ * This is the relocation table header file.
+ * This file handles the relocation records of the assembled module: one record for every instruction word that
+ * holds the address of a label, relocatable (ARE = 10) when the label is defined in the module and
+ * external (ARE = 01) when it is declared with ".extern".
+ * The records are written, sorted by address, to the relocation file (.rel) next to the object file:
+ *   - Header line: number of records and number of symbols in base 4.
+ *   - One line per symbol the records refer to, in the order of their indexes.
+ *   - One line per record: address in base 4, kind letter (R or E) and symbol index in base 4.
+ * Loaders and linkers can apply the relocations of a module without scanning all of its words,
+ * and the external file (.ext) is created from the external records.
+ */
+#ifndef RELOCATION_TABLE_H
+#define RELOCATION_TABLE_H
+
+/* Letters of the relocation kinds in the relocation file */
+#define RELOCATION_KIND_RELOCATABLE 'R'
+#define RELOCATION_KIND_EXTERNAL 'E'
+
+/* Relocation kind enum definition */
+typedef enum Relocation_Kind {
+    RELOCATABLE,
+    EXTERNAL
+} Relocation_Kind;
+
+/* Relocation struct definition */
+typedef struct Relocation {
+    int address;           /* Address of the word that holds the label address */
+    Relocation_Kind kind;
+    int symbol;            /* Index of the label in the symbols of the relocation table */
+} Relocation;
+
+/**
+ * Adds a relocation record for a word that holds the address of a label.
+ * @address: The address of the word.
+ * @kind: The kind of the relocation.
+ * @symbol_name: The name of the label.
+ * return 0 for a successful operation, 1 if the table is full.
+ */
+int add_relocation(int address, Relocation_Kind kind, char *symbol_name);
+
+
+/**
+ * Sorts the relocation records by address.
+ */
+void sort_relocations();
+
+
+/**
+ * Retrieves the relocation records.
+ * @count: Set to the number of records.
+ * return Pointer to the first record.
+ */
+Relocation *retrieve_relocations(int *count);
+
+
+/**
+ * Retrieves the name of a symbol of the relocation table.
+ * @symbol: The index of the symbol.
+ * return The name of the symbol.
+ */
+char *retrieve_relocation_symbol(int symbol);
+
+
+/**
+ * Creates a relocation file (.rel) with the relocation records.
+ * @file_rel_name: The name of the relocation file to create.
+ */
+void create_rel_file(char *file_rel_name);
+
+
+/**
+ * Removes all of the relocation records, so the table can be used for the next file.
+ */
+void reset_relocations();
+
+
+#endif
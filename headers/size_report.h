@@ -0,0 +1,70 @@
+/**
+ * This is the size report header file.
+ * The first pass measures every instruction and data line of the module by the label it belongs to: a code label
+ * starts a region that holds the instructions up to the next code label, and a data label holds the data up to the
+ * next data label. With "--size-report" the assembler writes the regions to "file.size.json":
+ *   - For each code region: its address in the object file and in the source (they differ when "-O" moved the
+ *     code), words and instructions, the operands of each addressing method, the pairs of register operands that
+ *     share one word, and the words spent on matrix operands.
+ *   - For each data label: its data words.
+ *   - The words of the source and the words of the object file, they differ when "-O" or "--dead-data" removed some.
+ * The words before the first label of their kind are reported under the label null.
+ */
+#ifndef SIZE_REPORT_H
+#define SIZE_REPORT_H
+#include "labels_handler.h"
+#include "definitions.h"
+
+/* Code region struct definition - the instructions from a code label to the next one */
+typedef struct Code_Region {
+    char label[MAX_LABEL_NAME_LENGTH + 1];  /* Empty for the instructions before the first code label */
+    int address;              /* Address in the source, before "-O" */
+    int words;
+    int instructions;
+    int immediate_operands;
+    int direct_operands;
+    int matrix_operands;
+    int register_operands;
+    int register_pairs;       /* Instructions whose two register operands share one word */
+} Code_Region;
+
+/* Data region struct definition - the data from a data label to the next one */
+typedef struct Data_Region {
+    char label[MAX_LABEL_NAME_LENGTH + 1];  /* Empty for the data before the first data label */
+    int words;
+} Data_Region;
+
+/**
+ * Adds an instruction to the code region of its label.
+ * @label: The label defined on the line of the instruction, NULL if there is none.
+ * @code: The words of the instruction.
+ * @address: The address of the first word of the instruction.
+ * @words: The number of words of the instruction.
+ */
+void add_code_size(Label *label, unsigned short *code, int address, int words);
+
+
+/**
+ * Adds the words of a data line to the data region of its label.
+ * @label: The label defined on the data line, NULL if there is none.
+ * @words: The number of data words of the line.
+ */
+void add_data_size(Label *label, int words);
+
+
+/**
+ * Creates the size report (.size.json) of the module.
+ * @file_size_name: The name of the size report to create.
+ * @IC: The number of code words of the object file.
+ * @DC: The number of data words of the object file.
+ */
+void create_size_file(char *file_size_name, int IC, int DC);
+
+
+/**
+ * Removes all of the regions, so the report can be used for the next file.
+ */
+void reset_size_report();
+
+
+#endif
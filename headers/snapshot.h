@@ -0,0 +1,100 @@
+/**
+ * This is the snapshot header file.
+ * A snapshot is the state of a machine at a label of its program: the memory words and the registers, the zero flag,
+ * the pc, the call stack, the number of executed instructions, the input cursor and the output written so far.
+ * Runs that share a long prefix (the initialization of the program) take a snapshot once, at the label where they
+ * start to depend on their input, and later runs restore it instead of running the prefix again.
+ * The machine reaches the label through a breakpoint: the decoded record of the label gets the HANDLER_BREAK handler,
+ * which stops the interpreter before the instruction, and the record is put back once the machine stopped there.
+ * The snapshot file (.snap) is written in the byte order of the host, with a hash of the object code of the program
+ * so a snapshot of another program (or of an older build of it) is rejected.
+ * The fork server warms a machine up to the label once and runs every test in a clone of its process (a copy of the
+ * warmed-up machine on hosts without fork).
+ */
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include "machine.h"
+#include "object_reader.h"
+
+/* Identifies snapshot files, the last character is the version of the layout */
+#define SNAPSHOT_MAGIC "SNP1"
+#define SNAPSHOT_MAGIC_LENGTH 4
+
+/* Snapshot header struct definition, followed by the cells, the call stack and the output in the file */
+typedef struct Snapshot_Header {
+    char magic[SNAPSHOT_MAGIC_LENGTH];
+    unsigned long program_hash;
+    int pc;
+    int zero_flag;
+    int sp;
+    unsigned long executed;
+    unsigned long input_position;
+    unsigned long output_length;
+} Snapshot_Header;
+
+/**
+ * Finds the address of a code label of a program, in its symbol file (.sym) or its entry file (.ent).
+ * @module: The program.
+ * @label: The name of the label.
+ * return The address of the label, or -1 if it is not a code label of the program.
+ */
+int find_code_label(Object_Module *module, char *label);
+
+
+/**
+ * Runs a machine with the interpreter until it reaches an address, stops, faults or reaches the step limit.
+ * The machine must run plain instructions, a superinstruction would run past a breakpoint inside it.
+ * @machine: Pointer to the loaded machine.
+ * @address: The address of the instruction to stop before.
+ * @max_steps: The maximum number of instructions to execute, 0 for no limit.
+ * return 1 if the machine stopped at the address (it is left running), 0 otherwise.
+ */
+int run_to_address(Machine *machine, int address, unsigned long max_steps);
+
+
+/**
+ * Writes a snapshot of a machine.
+ * @machine: Pointer to the machine.
+ * @module: The program that the machine runs.
+ * @output: The output that the program wrote so far.
+ * @output_length: The number of characters of the output.
+ * @file_name: The name of the snapshot file.
+ * return 0 if successful, 1 if an error was detected.
+ */
+int save_snapshot(Machine *machine, Object_Module *module, const unsigned char *output, unsigned long output_length,
+                  char *file_name);
+
+
+/**
+ * Restores a snapshot into a machine that its program was loaded into. The words that the program wrote before the
+ * snapshot are decoded again. A machine that reads the standard input skips the characters read before the snapshot.
+ * @machine: Pointer to the loaded machine.
+ * @module: The program that the machine runs.
+ * @file_name: The name of the snapshot file.
+ * @output: Set to the output that the program wrote before the snapshot (allocated, freed by the caller).
+ * @output_length: Set to the number of characters of the output.
+ * return 0 if successful, 1 if an error was detected.
+ */
+int restore_snapshot(Machine *machine, Object_Module *module, char *file_name, unsigned char **output,
+                     unsigned long *output_length);
+
+
+/**
+ * Runs one test per input from a warmed-up machine, each test in a clone of the process, as many at a time as there
+ * are online processors. The output of a test is its prefix followed by what the test writes, and it is written to
+ * the name of its input with ".out" added.
+ * @machine: Pointer to the warmed-up machine, it is not modified.
+ * @prefix: The output that the program wrote while it warmed up.
+ * @prefix_length: The number of characters of the prefix.
+ * @names: The names of the input files.
+ * @inputs: The contents of the input files.
+ * @sizes: The sizes of the input files.
+ * @count: The number of tests.
+ * @max_steps: The maximum number of instructions of each test (the warm up included), 0 for no limit.
+ * return The number of tests that reached "stop", or -1 if the tests could not run.
+ */
+int run_forked_tests(Machine *machine, const unsigned char *prefix, unsigned long prefix_length, char **names,
+                     unsigned char **inputs, unsigned long *sizes, int count, unsigned long max_steps);
+
+
+#endif
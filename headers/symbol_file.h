@@ -0,0 +1,128 @@
+/**
+ * This is the symbol file header file.
+ * The symbol file (.sym) is written by the assembler with "--symbols", for the tools that report by label or by
+ * source line. It lists every label of the module, not only the entries and the used externals, together with the
+ * map from the instructions to the lines of the macro-expanded source file (.am).
+ * The file is laid out so it can be mapped into memory and searched in place:
+ *   - A header with the number of symbols and lines and the offsets of their tables.
+ *   - The symbols: fixed size records sorted by address (the external labels first, with address 0).
+ *   - The name index: the positions of the symbols sorted by their names, searched with a binary search.
+ *   - The line map: fixed size records of the first word of every instruction and its .am line, sorted by address.
+ * All numbers are stored in the byte order of the host that created the file.
+ */
+#ifndef SYMBOL_FILE_H
+#define SYMBOL_FILE_H
+#include "definitions.h"
+
+/* Symbol file constants */
+#define SYMBOL_FILE_MAGIC "ASMSYM1"
+#define SYMBOL_FILE_MAGIC_LENGTH 8
+
+/* Flags of a symbol record */
+#define SYMBOL_IS_DATA 1
+#define SYMBOL_IS_ENTRY 2
+#define SYMBOL_IS_EXTERN 4
+
+/* Symbol file header struct definition */
+typedef struct Symbol_File_Header {
+    char magic[SYMBOL_FILE_MAGIC_LENGTH];
+    unsigned int symbols_count;
+    unsigned int lines_count;
+    unsigned int symbols_offset;  /* Offset of the symbols */
+    unsigned int names_offset;    /* Offset of the name index */
+    unsigned int lines_offset;    /* Offset of the line map */
+} Symbol_File_Header;
+
+/* Symbol record struct definition - a label of the module */
+typedef struct Symbol_Record {
+    char name[MAX_LABEL_NAME_LENGTH + 1];
+    unsigned int address;         /* 0 for external labels */
+    unsigned int flags;           /* SYMBOL_IS_DATA, SYMBOL_IS_ENTRY and SYMBOL_IS_EXTERN */
+} Symbol_Record;
+
+/* Line record struct definition - an instruction of the module */
+typedef struct Line_Record {
+    unsigned int address;         /* Address of the first word of the instruction */
+    unsigned int line_num;        /* Line number in the .am file */
+} Line_Record;
+
+/* Open symbol file struct definition */
+typedef struct Symbol_File {
+    char *name;
+    unsigned char *contents;      /* The whole symbol file */
+    unsigned long size;
+    int is_mapped;                /* 1 if the contents are mapped into memory, 0 if they were read */
+    Symbol_File_Header *header;
+    Symbol_Record *symbols;
+    unsigned int *names;
+    Line_Record *lines;
+} Symbol_File;
+
+/* Program symbol struct definition - a label listed in the symbol file */
+typedef struct Program_Symbol {
+    char name[MAX_LABEL_NAME_LENGTH + 1];
+    int address;                  /* 0 for external labels */
+    int is_data;                  /* 1 for data labels, 0 for code labels */
+    int is_entry;
+    int is_extern;
+} Program_Symbol;
+
+/**
+ * Creates a symbol file, sorting the symbols by address and building the name index and the line map.
+ * @file_sym_name: The name of the symbol file to create.
+ * @symbols: The symbols of the module, they are sorted in place.
+ * @symbols_count: The number of symbols.
+ * @lines: The lines of the instructions, sorted by address.
+ * @lines_count: The number of lines.
+ * return 0 if successful, 1 if an error was detected.
+ */
+int create_symbol_file(char *file_sym_name, Symbol_Record *symbols, int symbols_count, Line_Record *lines,
+                       int lines_count);
+
+
+/**
+ * Opens the symbol file of a module, mapping it into memory where possible, and validates its tables.
+ * @base_name: The name of the module without an extension.
+ * @symbol_file: Set to the open symbol file, NULL if the module has none.
+ * return 0 if successful (or if the file does not exist), 1 if an error was detected.
+ */
+int open_symbol_file(char *base_name, Symbol_File **symbol_file);
+
+
+/**
+ * Finds a symbol by its name, using a binary search over the name index.
+ * @symbol_file: Pointer to the open symbol file.
+ * @name: The name of the symbol.
+ * return Pointer to the symbol record, or NULL if the module has no such label.
+ */
+Symbol_Record *find_symbol_record(Symbol_File *symbol_file, char *name);
+
+
+/**
+ * Closes a symbol file and frees its memory.
+ * @symbol_file: Pointer to the symbol file to close.
+ */
+void close_symbol_file(Symbol_File *symbol_file);
+
+
+/**
+ * Reads the symbols of the symbol file of a module.
+ * @base_name: The name of the module without an extension.
+ * @symbols: Set to the symbols sorted by address (allocated, freed by the caller), NULL if there are none.
+ * @count: Set to the number of symbols, 0 if the file does not exist.
+ * return 0 if successful (or if the file does not exist), 1 if an error was detected.
+ */
+int read_symbol_file(char *base_name, Program_Symbol **symbols, int *count);
+
+
+/**
+ * Reads the line map of the symbol file of a module.
+ * @base_name: The name of the module without an extension.
+ * @lines: Set to the .am line number of the instruction at each address, 0 for the other addresses.
+ * @addresses_count: The number of addresses in the lines array.
+ * return The number of instructions read (0 if the file does not exist), or -1 if an error was detected.
+ */
+int read_line_map(char *base_name, int *lines, int addresses_count);
+
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * This is the global symbol table header file.
+ * This file handles a hash table of the symbols that modules export to each other,
+ * so resolving a symbol takes a constant time no matter how many modules are linked.
+ */
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+#include "definitions.h"
+
+/* Global symbol struct definition */
+typedef struct Global_Symbol {
+    char name[MAX_LABEL_NAME_LENGTH + 1];  /* Empty name marks a free slot */
+    int address;                           /* Final address of the symbol */
+    int module;                            /* Index of the defining module */
+} Global_Symbol;
+
+/* Symbol table struct definition (open addressing with linear probing) */
+typedef struct Symbol_Table {
+    Global_Symbol *slots;
+    int capacity;  /* Always a power of two */
+    int count;
+} Symbol_Table;
+
+/**
+ * Creates an empty symbol table large enough for the expected number of symbols.
+ * @expected_count: The number of symbols that are expected to be inserted.
+ * return Pointer to the new table, or NULL if memory allocation failed.
+ */
+Symbol_Table *create_symbol_table(int expected_count);
+
+
+/**
+ * Inserts a symbol into the table, growing the table if needed.
+ * If a symbol with the same name already exists, the table is not changed.
+ * @table: Pointer to the symbol table.
+ * @name: The name of the symbol.
+ * @address: The final address of the symbol.
+ * @module: The index of the module that defines the symbol.
+ * @is_duplicate: Set to 1 if the name already existed, 0 otherwise.
+ * return Pointer to the new or already existing symbol, or NULL if memory allocation failed.
+ */
+Global_Symbol *insert_symbol(Symbol_Table *table, char *name, int address, int module, int *is_duplicate);
+
+
+/**
+ * Finds a symbol in the table.
+ * @table: Pointer to the symbol table.
+ * @name: The name of the symbol to find.
+ * return Pointer to the symbol if found, NULL otherwise.
+ */
+Global_Symbol *find_symbol(Symbol_Table *table, char *name);
+
+
+/**
+ * Frees the symbol table.
+ * @table: Pointer to the symbol table to free.
+ */
+void free_symbol_table(Symbol_Table *table);
+
+
+#endif
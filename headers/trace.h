@@ -0,0 +1,138 @@
+/**
+ * This is the trace header file.
+ * A trace records every instruction of a run: its address, the cell (memory word or register) it wrote and the value
+ * it wrote, and so the outcome of every branch. The run goes one basic block at a time (see the profiler) and the
+ * interpreter logs the writes of the block, so the trace costs one record per block:
+ * - The number of instructions of the block and the number of its writes.
+ * - The address of the block, as the difference from the address of the previous block.
+ * - For every write: the instruction of the block that wrote, as the difference from the previous write, the cell, as
+ *   the difference from the previous written cell, and the value, as the difference from the old value of the cell.
+ * Differences are signed, zigzag-encoded (0, -1, 1, -2... become 0, 1, 2, 3...) and written as varints: 7 bits per
+ * byte, the high bit set on every byte but the last. Loops, increments and neighbouring cells take a byte each.
+ * The addresses of the instructions inside a block, and the branch outcomes, are decoded back from the memory words
+ * that the reader rebuilds, starting from the memory of the machine at the start of the trace.
+ * The records are encoded into one of two buffers, and a full buffer is written by a background thread while the run
+ * goes on into the other (hosts without POSIX threads write it at once).
+ * Every interval instructions the recorder adds an index point: the instruction count, the offset of the next record
+ * and the cells and pc of the machine there, and the differences start again from 0. The index points are written
+ * after the records, so a reader seeks to any instruction by decoding from the index point before it.
+ * The trace file (.trace) is in the byte order of the host.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+#include <stdio.h>
+#include "machine.h"
+
+/* Identifies trace files, the last character is the version of the layout */
+#define TRACE_MAGIC "TRC1"
+#define TRACE_MAGIC_LENGTH 4
+#define TRACE_INDEX_INTERVAL 65536       /* Instructions between index points when no interval is given */
+#define TRACE_BUFFER_SIZE (1 << 20)
+
+/* Trace header struct definition, followed by the cells of the machine and the records */
+typedef struct Trace_Header {
+    char magic[TRACE_MAGIC_LENGTH];
+    unsigned long interval;
+    unsigned long executed;          /* Instructions executed before the trace started */
+    int pc;
+} Trace_Header;
+
+/* Trace index point struct definition */
+typedef struct Trace_Index_Point {
+    unsigned long executed;
+    unsigned long offset;            /* Offset of the next record from the end of the header and cells */
+    int pc;
+    unsigned short cells[MACHINE_CELLS_COUNT];
+} Trace_Index_Point;
+
+/* Trace footer struct definition, at the end of the file after the index points */
+typedef struct Trace_Footer {
+    unsigned long records_size;      /* The index points start after the records */
+    unsigned long points_count;
+    unsigned long executed;
+    int status;                      /* Status of the machine at the end of the run */
+    int pc;
+    int fault;
+    char magic[TRACE_MAGIC_LENGTH];
+} Trace_Footer;
+
+/* Trace entry struct definition - an instruction of the trace */
+typedef struct Trace_Entry {
+    unsigned long executed;          /* Instructions executed before it, from the start of the run */
+    int pc;
+    int handler;                     /* The opcode of the instruction, or HANDLER_INVALID */
+    int length;                      /* Number of words of the instruction */
+    int cell;                        /* The cell that it wrote, -1 if it did not write */
+    int value;
+    int is_last;                     /* It is the last instruction of its block */
+    int next_pc;                     /* Address of the next instruction that ran, -1 after the last one */
+} Trace_Entry;
+
+typedef struct Trace_Recorder Trace_Recorder;
+typedef struct Trace_Reader Trace_Reader;
+
+/**
+ * Creates a trace file and starts recording the run of a machine.
+ * @file_name: The name of the trace file.
+ * @machine: Pointer to the loaded machine, it runs plain instructions.
+ * @interval: The number of instructions between index points, 0 for TRACE_INDEX_INTERVAL.
+ * return Pointer to the recorder, or NULL if an error was detected.
+ */
+Trace_Recorder *create_trace(char *file_name, Machine *machine, unsigned long interval);
+
+
+/**
+ * Runs a machine until it stops, faults or reaches the step limit, recording its trace.
+ * @machine: Pointer to the machine of the recorder.
+ * @trace: Pointer to the recorder.
+ * @max_steps: The maximum number of instructions to execute, 0 for no limit.
+ * return The status of the machine.
+ */
+int run_traced(Machine *machine, Trace_Recorder *trace, unsigned long max_steps);
+
+
+/**
+ * Finishes a trace: writes the last records, the index points and the footer, and frees the recorder.
+ * @trace: Pointer to the recorder.
+ * @machine: Pointer to the machine of the recorder, its final state goes into the footer.
+ * @size: Set to the number of bytes of the records.
+ * return 0 if successful, 1 if the file could not be written.
+ */
+int close_trace(Trace_Recorder *trace, Machine *machine, unsigned long *size);
+
+
+/**
+ * Opens a trace file for reading, at its first instruction.
+ * @file_name: The name of the trace file.
+ * @footer: Set to the footer of the trace.
+ * return Pointer to the reader, or NULL if an error was detected.
+ */
+Trace_Reader *open_trace(char *file_name, Trace_Footer *footer);
+
+
+/**
+ * Moves a reader to an instruction, from the last index point before it.
+ * @reader: Pointer to the reader.
+ * @executed: The number of instructions executed before the instruction.
+ * return 0 if successful, 1 if the trace is malformed.
+ */
+int seek_trace(Trace_Reader *reader, unsigned long executed);
+
+
+/**
+ * Reads the next instruction of a trace.
+ * @reader: Pointer to the reader.
+ * @entry: Set to the instruction.
+ * return 1 if an instruction was read, 0 at the end of the trace, -1 if the trace is malformed.
+ */
+int read_trace_entry(Trace_Reader *reader, Trace_Entry *entry);
+
+
+/**
+ * Closes a reader.
+ * @reader: Pointer to the reader.
+ */
+void close_trace_reader(Trace_Reader *reader);
+
+
+#endif
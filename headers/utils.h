@@ -107,9 +107,10 @@ int contains_whitespace(char *str);
  * @ptr: The current position in the line.
  * @num_count: Pointer to an integer to store the count of numbers found.
  * @errors_found: Pointer to the error counter.
+ * @range_error: The error code to report for a number out of range, which names the directive.
  * return Pointer to an array of integers containing the parsed numbers.
  */
-int *get_numbers(Line *line,char *ptr,int *num_count,int *errors_found);
+int *get_numbers(Line *line,char *ptr,int *num_count,int *errors_found,int range_error);
 
 
 /**
@@ -176,6 +177,18 @@ void convert_to_base4_5digits(int decimal_num, char *output);
 void create_ob_file(char *file_ob_name,unsigned short *code,unsigned short *data,int *IC,int *DC);
 
 
+/**
+ * Creates a run-length object file (.ob): a run of equal words is written as the line of its first word
+ * followed by '*' and the length of the run in base 4, the other words as in create_ob_file.
+ * @file_ob_name: The name of the object file to create.
+ * @code: Array containing the instruction code.
+ * @data: Array containing the data code.
+ * @ic: Pointer to the instruction counter.
+ * @dc: Pointer to the data counter.
+ */
+void create_run_length_ob_file(char *file_ob_name,unsigned short *code,unsigned short *data,int *IC,int *DC);
+
+
 /**
  * Creates an entry file (.ent) with entry labels.
  * @file_ent_name: The name of the entry file to create.
@@ -184,7 +197,7 @@ void create_ent_file(char *file_ent_name);
 
 
 /**
- * Creates an external file (.ext) with external labels.
+ * Creates an external file (.ext) from the external records of the relocation table.
  * @file_ext_name: The name of the external file to create.
  */
 void create_ext_file(char *file_ext_name);
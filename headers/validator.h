@@ -43,6 +43,15 @@ typedef enum Addressing_Method {
  */
 InstructionDefinition *retrieve_instruction_set();
 
+/**
+ * Check if an addressing method is legal for an operand, according to the modes of the instruction table.
+ *
+ * @modes: The supported addressing modes of the operand
+ * @method: The addressing method
+ * return 1 if the method is legal, 0 otherwise
+ */
+int is_addressing_mode_supported(SupportedAddressingModes modes, int method);
+
 /**
  * Validate macro identifier naming conventions.
  * Ensures the macro name meets length requirements, uses valid characters,
@@ -236,6 +245,22 @@ void process_extern_directive(Line *context, char *symbol_list, int *error_count
  */
 void process_matrix_directive(unsigned short *data_segment, int *memory_usage, int *data_counter, Line *context, char *matrix_definition, int *error_counter);
 
+
+/**
+ * Process .zero and .fill directives for repeated data.
+ * ".zero N" reserves N words holding 0, ".fill N, value" reserves N words holding the value,
+ * without writing every value on the line.
+ *
+ * @data_segment: Data segment array for the words
+ * @memory_usage: Memory usage tracking counter
+ * @data_counter: Current position in data segment
+ * @context: Line context information for error reporting
+ * @fill_definition: The count, and the value for .fill
+ * @values_count: The number of values the directive takes (1 for .zero, 2 for .fill)
+ * @error_counter: Error counter for tracking validation failures
+ */
+void process_fill_directive(unsigned short *data_segment, int *memory_usage, int *data_counter, Line *context, char *fill_definition, int values_count, int *error_counter);
+
 /**
  * Generate machine code for assembly instructions.
  * Translates assembly language instructions into executable machine code
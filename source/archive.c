@@ -0,0 +1,396 @@
+/**
+ * This file handles static archives of assembled modules.
+ * It creates the archive file with its sorted symbol index, and opens existing archives
+ * by mapping them into memory, so symbols are found and members are extracted without reading the whole file.
+ */
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L /* mmap() is not part of ANSI C */
+#define ARCHIVE_USE_MMAP
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "archive.h"
+#include "error_handler.h"
+#include "definitions.h"
+
+#ifdef ARCHIVE_USE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* Rounds a number of bytes up to a multiple of 4, keeping the records of the contents aligned */
+#define ALIGN_4(bytes) (((bytes) + 3) & ~3UL)
+
+/* Compares two archive symbols by name, for sorting the symbol index */
+static int compare_symbols(const void *first, const void *second)
+{
+    return strcmp(((Archive_Symbol *)first)->name, ((Archive_Symbol *)second)->name);
+}
+
+/* Compares a name to an archive symbol, for searching the symbol index */
+static int compare_name_to_symbol(const void *name, const void *symbol)
+{
+    return strcmp((char *)name, ((Archive_Symbol *)symbol)->name);
+}
+
+/* Checks if a name of a record ends inside its field, returns 1 if it does */
+static int is_name_terminated(const char *name, unsigned long field_length)
+{
+    return memchr(name, '\0', field_length) != NULL;
+}
+
+/* Checks that the names of the symbol index and the member table end inside their records, returns 1 if they do */
+static int are_names_terminated(Archive *archive)
+{
+    unsigned int i;
+
+    for (i = 0; i < archive->header->symbols_count; i++)
+    {
+        if (!is_name_terminated(archive->symbols[i].name, sizeof(archive->symbols[i].name)))
+            return 0;
+    }
+    for (i = 0; i < archive->header->members_count; i++)
+    {
+        if (!is_name_terminated(archive->members[i].name, sizeof(archive->members[i].name)))
+            return 0;
+    }
+    return 1;
+}
+
+/* Returns the size of the contents of a member */
+static unsigned long member_contents_size(unsigned long words_count, unsigned long symbols_count)
+{
+    return ALIGN_4(words_count * sizeof(unsigned short)) + symbols_count * sizeof(Archive_Symbol);
+}
+
+/* Writes a table of symbols of a module as archive symbol records */
+static void write_symbol_records(FILE *file, Symbol *symbols, int count, int member)
+{
+    Archive_Symbol record;
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        memset(&record, 0, sizeof(record));
+        strcpy(record.name, symbols[i].name);
+        record.member = member;
+        record.address = symbols[i].address;
+        fwrite(&record, sizeof(record), 1, file);
+    }
+}
+
+/* Builds the sorted symbol index of the modules, returns NULL if errors were detected */
+static Archive_Symbol *build_symbol_index(Object_Module **modules, int modules_count, int *symbols_count)
+{
+    int i, j, errors_found = 0;
+    Archive_Symbol *symbols;
+
+    *symbols_count = 0;
+    for (i = 0; i < modules_count; i++)
+        *symbols_count += modules[i]->entries_count;
+    symbols = (Archive_Symbol *)calloc(*symbols_count > 0 ? *symbols_count : 1, sizeof(Archive_Symbol));
+    if (symbols == NULL)
+    {
+        log_system_error(Error_101);
+        return NULL; /* Indicates failure */
+    }
+    *symbols_count = 0;
+    for (i = 0; i < modules_count; i++)
+    {
+        for (j = 0; j < modules[i]->entries_count; j++)
+        {
+            strcpy(symbols[*symbols_count].name, modules[i]->entries[j].name);
+            symbols[*symbols_count].member = i;
+            symbols[*symbols_count].address = modules[i]->entries[j].address;
+            (*symbols_count)++;
+        }
+    }
+    qsort(symbols, *symbols_count, sizeof(Archive_Symbol), compare_symbols);
+
+    /* Sorting places duplicate names next to each other */
+    for (i = 1; i < *symbols_count; i++)
+    {
+        if (strcmp(symbols[i - 1].name, symbols[i].name) == 0)
+        {
+            printf(" Modules \"%s\" and \"%s\" - Label \"%s\"", modules[symbols[i - 1].member]->name,
+                   modules[symbols[i].member]->name, symbols[i].name);
+            log_system_error(Error_301);
+            errors_found = 1;
+        }
+    }
+    if (errors_found)
+    {
+        free(symbols);
+        return NULL; /* Indicates failure */
+    }
+    return symbols;
+}
+
+int create_archive(char *archive_name, Object_Module **modules, int modules_count)
+{
+    Archive_Header header;
+    Archive_Member member;
+    Archive_Symbol *symbols;
+    unsigned long offset, words_bytes;
+    int i, symbols_count;
+    char *base_name;
+    FILE *file;
+
+    symbols = build_symbol_index(modules, modules_count, &symbols_count);
+    if (symbols == NULL)
+        return 1; /* Indicates failure */
+
+    file = fopen(archive_name, "wb");
+    if (file == NULL)
+    {
+        log_system_error(Error_104);
+        free(symbols);
+        return 1; /* Indicates failure */
+    }
+    memset(&header, 0, sizeof(header));
+    strcpy(header.magic, ARCHIVE_MAGIC);
+    header.members_count = modules_count;
+    header.symbols_count = symbols_count;
+    header.symbols_offset = sizeof(Archive_Header);
+    header.members_offset = header.symbols_offset + symbols_count * sizeof(Archive_Symbol);
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(symbols, sizeof(Archive_Symbol), symbols_count, file);
+
+    /* Member table, the contents are placed one after the other after it */
+    offset = header.members_offset + modules_count * sizeof(Archive_Member);
+    for (i = 0; i < modules_count; i++)
+    {
+        memset(&member, 0, sizeof(member));
+        base_name = strrchr(modules[i]->name, '/'); /* Members are named without their directory */
+        strncpy(member.name, base_name != NULL ? base_name + 1 : modules[i]->name, ARCHIVE_MEMBER_NAME_LENGTH);
+        member.offset = offset;
+        member.code_size = modules[i]->code_size;
+        member.data_size = modules[i]->data_size;
+        member.entries_count = modules[i]->entries_count;
+        member.extern_uses_count = modules[i]->extern_uses_count;
+        fwrite(&member, sizeof(member), 1, file);
+        offset += member_contents_size(member.code_size + member.data_size,
+                                       member.entries_count + member.extern_uses_count);
+    }
+    /* Member contents */
+    for (i = 0; i < modules_count; i++)
+    {
+        words_bytes = (modules[i]->code_size + modules[i]->data_size) * sizeof(unsigned short);
+        fwrite(modules[i]->words, 1, words_bytes, file);
+        fwrite("\0\0\0", 1, ALIGN_4(words_bytes) - words_bytes, file); /* Padding */
+        write_symbol_records(file, modules[i]->entries, modules[i]->entries_count, i);
+        write_symbol_records(file, modules[i]->extern_uses, modules[i]->extern_uses_count, i);
+    }
+    free(symbols);
+    if (ferror(file))
+    {
+        log_system_error(Error_104);
+        fclose(file);
+        return 1; /* Indicates failure */
+    }
+    fclose(file);
+    return 0; /* Indicates success */
+}
+
+/* Loads the contents of the archive file, mapping them into memory where possible */
+static int load_contents(Archive *archive)
+{
+#ifdef ARCHIVE_USE_MMAP
+    struct stat status;
+    void *mapped;
+    int fd = open(archive->name, O_RDONLY);
+
+    if (fd != -1 && fstat(fd, &status) == 0 && status.st_size > 0)
+    {
+        mapped = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED)
+        {
+            close(fd);
+            archive->contents = (unsigned char *)mapped;
+            archive->size = status.st_size;
+            archive->is_mapped = 1;
+            return 0; /* Indicates success */
+        }
+    }
+    if (fd != -1)
+        close(fd);
+#endif
+    {
+        /* Reading the whole file when it can not be mapped */
+        FILE *file = fopen(archive->name, "rb");
+        long size;
+
+        if (file == NULL)
+        {
+            printf(" File \"%s\"", archive->name);
+            log_system_error(Error_103);
+            return 1; /* Indicates failure */
+        }
+        fseek(file, 0, SEEK_END);
+        size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        archive->contents = (unsigned char *)malloc(size > 0 ? size : 1);
+        if (archive->contents == NULL)
+        {
+            log_system_error(Error_101);
+            fclose(file);
+            return 1; /* Indicates failure */
+        }
+        archive->size = fread(archive->contents, 1, size, file);
+        fclose(file);
+        return 0; /* Indicates success */
+    }
+}
+
+Archive *open_archive(char *archive_name)
+{
+    Archive *archive = (Archive *)calloc(1, sizeof(Archive));
+    Archive_Header *header;
+
+    if (archive == NULL)
+    {
+        log_system_error(Error_101);
+        return NULL; /* Indicates failure */
+    }
+    archive->name = (char *)malloc(strlen(archive_name) + 1); /* +1 to accommodate '\0' */
+    if (archive->name == NULL)
+    {
+        log_system_error(Error_101);
+        free(archive);
+        return NULL; /* Indicates failure */
+    }
+    strcpy(archive->name, archive_name);
+    if (load_contents(archive) != 0)
+    {
+        close_archive(archive);
+        return NULL; /* Indicates failure */
+    }
+    /* Validating the header and the bounds of the tables */
+    header = (Archive_Header *)archive->contents;
+    if (archive->size < sizeof(Archive_Header) || memcmp(header->magic, ARCHIVE_MAGIC, ARCHIVE_MAGIC_LENGTH) != 0 ||
+        header->symbols_offset + (unsigned long)header->symbols_count * sizeof(Archive_Symbol) > archive->size ||
+        header->members_offset + (unsigned long)header->members_count * sizeof(Archive_Member) > archive->size)
+    {
+        printf(" File \"%s\"", archive_name);
+        log_system_error(Error_305);
+        close_archive(archive);
+        return NULL; /* Indicates failure */
+    }
+    archive->header = header;
+    archive->symbols = (Archive_Symbol *)(archive->contents + header->symbols_offset);
+    archive->members = (Archive_Member *)(archive->contents + header->members_offset);
+    /* The names are compared and printed as strings, so they must end inside the mapped file */
+    if (!are_names_terminated(archive))
+    {
+        printf(" File \"%s\"", archive_name);
+        log_system_error(Error_305);
+        close_archive(archive);
+        return NULL; /* Indicates failure */
+    }
+    archive->is_extracted = (int *)calloc(header->members_count > 0 ? header->members_count : 1, sizeof(int));
+    if (archive->is_extracted == NULL)
+    {
+        log_system_error(Error_101);
+        close_archive(archive);
+        return NULL; /* Indicates failure */
+    }
+    return archive;
+}
+
+int find_archive_symbol(Archive *archive, char *name)
+{
+    Archive_Symbol *symbol = (Archive_Symbol *)bsearch(name, archive->symbols, archive->header->symbols_count,
+                                                       sizeof(Archive_Symbol), compare_name_to_symbol);
+
+    if (symbol == NULL || symbol->member >= archive->header->members_count)
+        return -1; /* Indicates no member exports the symbol */
+    return symbol->member;
+}
+
+/* Copies symbol records of a member into a symbols table of a module */
+static Symbol *copy_symbol_records(Archive_Symbol *records, int count)
+{
+    Symbol *symbols = (Symbol *)calloc(count > 0 ? count : 1, sizeof(Symbol));
+    int i;
+
+    if (symbols == NULL)
+    {
+        log_system_error(Error_101);
+        return NULL; /* Indicates failure */
+    }
+    for (i = 0; i < count; i++)
+    {
+        strncpy(symbols[i].name, records[i].name, MAX_LABEL_NAME_LENGTH);
+        symbols[i].address = records[i].address;
+    }
+    return symbols;
+}
+
+Object_Module *extract_archive_member(Archive *archive, int member)
+{
+    Archive_Member *record = &archive->members[member];
+    unsigned long words_count = (unsigned long)record->code_size + record->data_size;
+    unsigned long words_bytes = ALIGN_4(words_count * sizeof(unsigned short));
+    Archive_Symbol *records = (Archive_Symbol *)(archive->contents + record->offset + words_bytes);
+    Object_Module *module;
+
+    /* Validating the member before using its contents */
+    if (words_count > MAX_ARRAY_CAPACITY || record->offset % 4 != 0 ||
+        record->offset + member_contents_size(words_count, (unsigned long)record->entries_count +
+                                                               record->extern_uses_count) > archive->size)
+    {
+        printf(" Member \"%.*s\" of File \"%s\"", ARCHIVE_MEMBER_NAME_LENGTH, record->name, archive->name);
+        log_system_error(Error_305);
+        return NULL; /* Indicates failure */
+    }
+    module = (Object_Module *)calloc(1, sizeof(Object_Module));
+    if (module == NULL)
+    {
+        log_system_error(Error_101);
+        return NULL; /* Indicates failure */
+    }
+    module->name = (char *)calloc(ARCHIVE_MEMBER_NAME_LENGTH + 1, 1);
+    module->words = (unsigned short *)malloc(words_count > 0 ? words_count * sizeof(unsigned short) : 1);
+    module->entries = copy_symbol_records(records, record->entries_count);
+    module->extern_uses = copy_symbol_records(records + record->entries_count, record->extern_uses_count);
+    if (module->name == NULL || module->words == NULL || module->entries == NULL || module->extern_uses == NULL)
+    {
+        log_system_error(Error_101);
+        free_object_module(module);
+        return NULL; /* Indicates failure */
+    }
+    strncpy(module->name, record->name, ARCHIVE_MEMBER_NAME_LENGTH);
+    memcpy(module->words, archive->contents + record->offset, words_count * sizeof(unsigned short));
+    module->code_size = record->code_size;
+    module->data_size = record->data_size;
+    module->entries_count = record->entries_count;
+    module->extern_uses_count = record->extern_uses_count;
+    if (derive_relocations(module) != 0)
+    {
+        free_object_module(module);
+        return NULL; /* Indicates failure */
+    }
+    archive->is_extracted[member] = 1;
+    return module;
+}
+
+void close_archive(Archive *archive)
+{
+    if (archive == NULL)
+        return;
+    if (archive->contents != NULL)
+    {
+#ifdef ARCHIVE_USE_MMAP
+        if (archive->is_mapped)
+            munmap(archive->contents, archive->size);
+        else
+#endif
+            free(archive->contents);
+    }
+    free(archive->is_extracted);
+    free(archive->name);
+    free(archive);
+}
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "error_handler.h"
+#include "object_reader.h"
+#include "archive.h"
+#include "utils.h"
+#include "definitions.h"
+
+/**
+ * Prints the members and the symbol index of an archive.
+ * @archive_name: The name of the archive file.
+ * return 0 if successful, 1 if errors were detected.
+ */
+static int list_archive(char *archive_name)
+{
+    unsigned int i;
+    Archive *archive = open_archive(archive_name);
+
+    if (archive == NULL)
+        return 1;  /* Indicates faliure */
+    printf("Archive \"%s\": %u members, %u symbols\n", archive_name,
+           archive->header->members_count, archive->header->symbols_count);
+    for (i = 0; i < archive->header->members_count; i++)
+        printf("  member %-20.*s code %3u data %3u entries %3u externals %3u\n", ARCHIVE_MEMBER_NAME_LENGTH,
+               archive->members[i].name, archive->members[i].code_size, archive->members[i].data_size,
+               archive->members[i].entries_count, archive->members[i].extern_uses_count);
+    for (i = 0; i < archive->header->symbols_count; i++)
+        printf("  symbol %-31s member %u address %u\n", archive->symbols[i].name,
+               archive->symbols[i].member, archive->symbols[i].address);
+    close_archive(archive);
+    return 0;  /* Success */
+}
+
+/**
+ * This is the main function of the archiver, it bundles assembled modules (names without an extension,
+ * read from their .ob, .ent and .ext files) into a static archive with a symbol index for the linker.
+ * Usage: "archiver library.lib module1 module2 ..." creates an archive,
+ *        "archiver -t library.lib" lists the contents of an archive.
+ * argc: The number of command-line arguments.
+ * argv: An array of strings containing the command-line arguments.
+ * return Returns 0 on successful completion, 1 otherwise.
+ */
+
+int main(int argc, char *argv[]) {
+    int i, modules_count = 0, errors_found = 0;
+    Object_Module **modules;
+
+    if (argc == 3 && strcmp(argv[1], "-t") == 0)
+        return list_archive(argv[2]);
+    if (argc < 3) {  /* Checking if no modules were entered */
+        log_system_error(Error_100);
+        return 1;  /* Indicates faliure */
+    }
+    modules = (Object_Module **)calloc(argc, sizeof(Object_Module *));
+    if (modules == NULL) {
+        log_system_error(Error_101);
+        return 1;  /* Indicates faliure */
+    }
+    for (i = 2; i < argc; i++) {
+        modules[modules_count] = read_object_module(argv[i]);
+        if (modules[modules_count] == NULL)
+            errors_found = 1;
+        else
+            modules_count++;
+    }
+    if (errors_found == 0) {
+        errors_found = create_archive(argv[1], modules, modules_count);
+        if (errors_found == 0)
+            printf("Archive \"%s\" created with %d members\n", argv[1], modules_count);
+    }
+    for (i = 0; i < modules_count; i++)
+        free_object_module(modules[i]);
+    free(modules);
+    free_all_memory();
+    return errors_found;
+}
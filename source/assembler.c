@@ -3,27 +3,43 @@
 #include "utils.h"
 #include "pre_processor.h"
 #include "assembler_first_pass.h"
+#include "options.h"
+#include "perf_counters.h"
 #include "definitions.h"
 
 /**
  * This is the main function that receives assembly input files (written in a specific language defined by the project's requirements).
  * The function then passes them over to the analysis of the "Three Steps Assembler".
+ * Arguments starting with '-' are options (see options.h) and apply to all of the files.
  * argc: The number of command-line arguments.
  * argv: An array of strings containing the command-line arguments.
  * return Returns 0 on successful completion.
  */
 
 int main(int argc, char *argv[]) {
-    int i = 1;
+    int i = 1, files_count = 0;
     FILE *file;
     char *file_name;
 
-    if (argc < BINARY_BASE) {  /* Checking if no files were entered */
+    /* Scanning options */
+    for (; i < argc; i++) {
+        if (is_option(argv[i])) {
+            if (parse_option(argv[i]) != 0)
+                return 1;  /* Indicates faliure */
+        } else {
+            files_count++;
+        }
+    }
+    if (files_count == 0) {  /* Checking if no files were entered */
         log_system_error(Error_100);
         return 1;  /* Indicates faliure */
     }
+    open_perf_counters();
+
     /* Scanning files */
-    for (; i < argc; i++) {
+    for (i = 1; i < argc; i++) {
+        if (is_option(argv[i]))
+            continue;  /* Options were already handled */
         file_name = valid_file_name(argv[i]);  /* Validating the input file name */
         if (file_name == NULL)
             continue;  /* Next file */
@@ -35,17 +51,24 @@ int main(int argc, char *argv[]) {
         printf("\nInitializing assembly process for: \"%s\"\n",file_name);
 
         /* Starting run_pre_processing */
+        begin_phase(PRE_PROCESSING_PHASE);
         if (run_pre_processing(file_name) != 0) {
+            end_phase(PRE_PROCESSING_PHASE);
             printf("Assembly operation halted due to preprocessing issues\n");
+            report_perf_counters(argv[i]);
             continue;  /* Skipping to the next file */
         }
+        end_phase(PRE_PROCESSING_PHASE);
         /* Starting first pass */
         if (run_first_pass(file_name) != 0) {
             printf("Assembly compilation aborted\n");
+            report_perf_counters(argv[i]);
             continue;  /* Skipping to the next file */
         }
         printf("Assembly compilation completed successfully \n");
+        report_perf_counters(argv[i]);
         free_all_memory();
     }
+    close_perf_counters();
     return 0;  /* Success */
 }
@@ -16,6 +16,12 @@
 #include "labels_handler.h"
 #include "utils.h"
 #include "assembler_second_pass.h"
+#include "perf_counters.h"
+#include "line_table.h"
+#include "peephole.h"
+#include "dead_data.h"
+#include "size_report.h"
+#include "options.h"
 #include "definitions.h"
 
 int run_first_pass(char *file_name)
@@ -27,24 +33,41 @@ int run_first_pass(char *file_name)
     char *file_am_name = change_extension(file_name, ".am");
 
     /* Scanning the file */
+    begin_phase(FIRST_PASS_PHASE);
     if (examine_code(file_am_name, code, data, &IC, &DC) != 0)
     {
+        end_phase(FIRST_PASS_PHASE);
         free_labels();
         free_macros();
         free_all_memory();
         return 1; /*  faliure */
     }
+    end_phase(FIRST_PASS_PHASE);
     free_macros(); /* Macros are no longer needed therefor they can be freed*/
 
     printf("First parsing phase completed successfully\n");
 
+    /* Optimizing the instructions before their labels are coded */
+    if (retrieve_options()->optimize && optimize_code(code, &IC) != 0)
+    {
+        free_labels();
+        free_all_memory();
+        return 1; /* faliure */
+    }
+    /* Removing the unused data after the optimizer, so the operands it removed do not keep data */
+    if (retrieve_options()->dead_data)
+        remove_dead_data(data, &DC);
+
     /* Starting second pass */
+    begin_phase(SECOND_PASS_PHASE);
     if (run_second_pass(file_am_name, code, data, &IC, &DC) != 0)
     {
+        end_phase(SECOND_PASS_PHASE);
         free_labels();
         free_all_memory();
         return 1; /* faliure */
     }
+    end_phase(SECOND_PASS_PHASE);
     clean_memory(file_am_name);
     return 0; /*  success */
 }
@@ -52,7 +75,7 @@ int run_first_pass(char *file_name)
 int examine_code(char *file_am_name, unsigned short *code, unsigned short *data, int *IC, int *DC)
 {
     char temp[MAX_SOURCE_LINE_LENGTH + 1]; /* +1 to accommodate '\0' */
-    int Usage = 0, errors_found = 0, line_count = 0;
+    int Usage = 0, errors_found = 0, line_count = 0, previous_IC, previous_DC;
     char *trimmed_line;
     Line *line;
 
@@ -64,6 +87,8 @@ int examine_code(char *file_am_name, unsigned short *code, unsigned short *data,
         free_all_memory();
         exit(1); /* Exiting program */
     }
+    reset_source_lines();
+    reset_size_report();
     /* Reading line by line */
     while (fgets(temp, MAX_SOURCE_LINE_LENGTH + 1, file_am))
     {
@@ -89,10 +114,20 @@ int examine_code(char *file_am_name, unsigned short *code, unsigned short *data,
             free_all_memory();
             exit(1); /* Exiting program */
         }
+        previous_IC = *IC;
+        previous_DC = *DC;
         examine_code_word(code, data, &Usage, IC, DC, line, &errors_found);
+        if (*IC > previous_IC) /* The line was an instruction */
+        {
+            add_source_line(previous_IC + MEMORY_START_ADDRESS, line_count);
+            add_code_size(line->label, code + previous_IC, previous_IC + MEMORY_START_ADDRESS, *IC - previous_IC);
+        }
+        else if (*DC > previous_DC) /* The line was data */
+            add_data_size(line->label, *DC - previous_DC);
         free_line(line);
     }
     fclose(file_am);
+    set_measured_lines(line_count);
     return errors_found;
 }
 
@@ -190,7 +225,9 @@ void examine_code_word(unsigned short *code, unsigned short *data, int *Usage, i
 
             if (identify_assembler_directive(current_word) == 0 || /* .data */
                 identify_assembler_directive(current_word) == 1 || /* .string */
-                identify_assembler_directive(current_word) == 4)   /* .mat */
+                identify_assembler_directive(current_word) == 4 || /* .mat */
+                identify_assembler_directive(current_word) == 5 || /* .zero */
+                identify_assembler_directive(current_word) == 6)   /* .fill */
             {
                 line->label->address = *DC;
                 line->label->location = DATA;
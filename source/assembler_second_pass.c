@@ -1,7 +1,7 @@
 /**
  * This is the second pass file, which is the last step in the assembler process.
  * This file processes and updates uncoded label addresses, creates the relevant
- * output files (.ob, .ent, .ext), and manages potential errors.
+ * output files (.ob, .ent, .ext, .rel, and .sym and .size.json when requested), and manages potential errors.
  */
 #include <string.h>
 #include <ctype.h>
@@ -12,12 +12,16 @@
 #include "validator.h"
 #include "definitions.h"
 #include "labels_handler.h"
+#include "relocation_table.h"
+#include "line_table.h"
+#include "size_report.h"
+#include "options.h"
 #include "utils.h"
 
 int run_second_pass(char *file_am_name, unsigned short *code, unsigned short *data, int *IC, int *DC)
 {
-    char *file_ob_name, *file_ent_name, *file_ext_name;
-    int errors_found = 0;
+    char *file_ob_name, *file_ent_name, *file_ext_name, *file_rel_name, *file_sym_name, *file_size_name;
+    int relocations_count, errors_found = 0;
 
     /* Checking if all "entry" labels were defined */
     if (is_all_entry_labels_exist(file_am_name) != 0)
@@ -25,17 +29,22 @@ int run_second_pass(char *file_am_name, unsigned short *code, unsigned short *da
     
     /* Handling uncoded label addresses */
     update_data_label(IC);
+    reset_relocations();
     if (code_operands(file_am_name, code, IC) != 0)
     {
         free_labels();
         free_all_memory();
         return 1; 
     }
+    sort_relocations();
     /* Getting the object file name */
     file_ob_name = change_extension(file_am_name, ".ob");
 
-    /* Creating the object file */
-    create_ob_file(file_ob_name, code, data, IC, DC);
+    /* Creating the object file, with the runs of equal words as single lines if it was requested */
+    if (retrieve_options()->run_length)
+        create_run_length_ob_file(file_ob_name, code, data, IC, DC);
+    else
+        create_ob_file(file_ob_name, code, data, IC, DC);
 
     /* Creating "file.ent" if there are "entry" labels */
     if (is_entry_exist() != 0)
@@ -51,6 +60,28 @@ int run_second_pass(char *file_am_name, unsigned short *code, unsigned short *da
         create_ext_file(file_ext_name);
         clean_memory(file_ext_name);
     }
+    /* Creating "file.sym" with every label and source line if it was requested */
+    if (retrieve_options()->symbols)
+    {
+        file_sym_name = change_extension(file_am_name, ".sym");
+        create_sym_file(file_sym_name);
+        clean_memory(file_sym_name);
+    }
+    /* Creating "file.size.json" with the size of every label if it was requested */
+    if (retrieve_options()->size_report)
+    {
+        file_size_name = change_extension(file_am_name, ".size.json");
+        create_size_file(file_size_name, *IC, *DC);
+        clean_memory(file_size_name);
+    }
+    /* Creating "file.rel" if there are words holding label addresses */
+    retrieve_relocations(&relocations_count);
+    if (relocations_count > 0)
+    {
+        file_rel_name = change_extension(file_am_name, ".rel");
+        create_rel_file(file_rel_name);
+        clean_memory(file_rel_name);
+    }
     clean_memory(file_ob_name);
     free_labels();
     printf("Second parsing phase completed successfully \n");
@@ -154,23 +185,19 @@ int code_operands(char *file_am_name, unsigned short *code, int *IC)
                 if (label != NULL)
                 {
                     /* First word: base address */
-                    /* Use the updated address for DATA labels */
+                    /* CODE labels hold their final address since the first pass, DATA labels since update_data_label */
                     int final_address = label->address;
-                    if (label->location == DATA)
-                    {
-                        final_address = label->address; /* Already updated by update_data_label */
-                    }
-                    else
-                    {
-                        final_address = label->address + MEMORY_START_ADDRESS;
-                    }
-                    
 
-                    
                     word = (unsigned short)(final_address & MASK_8_BITS); /* 8-bit address */
                     word <<= IMMEDIATE_VALUE_SHIFT_POSITION; /* bits 9-2 = address */
                     word |= ARE_RELOCATABLE; /* ARE = 10 */
                     code[j] = word;
+                    if (add_relocation(operand_label->address + MEMORY_START_ADDRESS, RELOCATABLE, label->name) != 0)
+                    {
+                        free_labels();
+                        free_all_memory();
+                        exit(1);
+                    }
 
                     /* Validate and encode row register */
                     if ((row_reg_str[0] == 'r' || row_reg_str[0] == 'R') &&
@@ -230,33 +257,24 @@ int code_operands(char *file_am_name, unsigned short *code, int *IC)
                     /* For external labels, put zeros in bits 2-9 since we don't know the address yet */
                     word = 0; /* Bits 9-2 = 0 */
                     word |= ARE_EXTERNAL; /* ARE = 01 */
-                    if (add_label(label->name,
-                                  operand_label->address + MEMORY_START_ADDRESS,
-                                  EXTERN, CODE) == NULL)
-                    {
-                        free_labels();
-                        free_all_memory();
-                        exit(1);
-                    }
                 }
                 else
                 {
-                    /* Use the updated address for DATA labels */
+                    /* CODE labels hold their final address since the first pass, DATA labels since update_data_label */
                     int final_address = label->address;
-                    if (label->location == DATA)
-                    {
-                        final_address = label->address; /* Already updated by update_data_label */
-                    }
-                    else
-                    {
-                        final_address = label->address + MEMORY_START_ADDRESS;
-                    }
-                    
+
                     word = (unsigned short)(final_address & MASK_8_BITS); /* 8-bit address */
                     word <<= IMMEDIATE_VALUE_SHIFT_POSITION; /* Bits 9-2 contain the memory address */
                     word |= ARE_RELOCATABLE; 
                 }
                 code[j] = word;
+                if (add_relocation(operand_label->address + MEMORY_START_ADDRESS,
+                                   label->type == EXTERN ? EXTERNAL : RELOCATABLE, label->name) != 0)
+                {
+                    free_labels();
+                    free_all_memory();
+                    exit(1);
+                }
             }
             else
             {
@@ -0,0 +1,164 @@
+/**
+ * This file handles the basic blocks of a loaded program: fusing superinstructions before a run,
+ * and finding the blocks and their execution counts after it.
+ */
+#include <string.h>
+#include "basic_blocks.h"
+#include "machine.h"
+#include "definitions.h"
+
+static char *SUPERINSTRUCTION_NAMES[] = {"cmp+bne", "inc+cmp+bne", "mov+add"};
+
+/* Returns the handler of the instruction at an address, or -1 if it is outside of the memory */
+static int handler_at(Machine *machine, int address)
+{
+    return address < MACHINE_MEMORY_SIZE ? machine->decoded[address].handler : -1;
+}
+
+/* Checks if an operand is a register */
+static int is_register(Operand *operand)
+{
+    return operand->kind == OPERAND_CELL && operand->location >= MACHINE_MEMORY_SIZE;
+}
+
+/* Checks if an operand is a register or an immediate value */
+static int is_register_or_value(Operand *operand)
+{
+    return operand->kind == OPERAND_IMMEDIATE || is_register(operand);
+}
+
+/* Checks if the record at an address is a "bne" to an address in the memory */
+static int is_direct_bne(Machine *machine, int address)
+{
+    Operand *target = &machine->decoded[address].destination;
+
+    return handler_at(machine, address) == BNE_OPCODE && target->kind == OPERAND_CELL &&
+           target->location < MACHINE_MEMORY_SIZE;
+}
+
+/* Turns the record at an address into a superinstruction that ends with the instruction at the last address */
+static void fuse(Machine *machine, int address, int last_address, int handler, int *fused_counts)
+{
+    Decoded_Instruction *instruction = &machine->decoded[address];
+
+    instruction->handler = (unsigned char)handler;
+    instruction->span = (unsigned char)(machine->decoded[last_address].next - address);
+    if (machine->handler_codes != NULL)
+        instruction->code = machine->handler_codes[handler];
+    fused_counts[handler - HANDLER_CMP_BNE]++;
+}
+
+int fuse_superinstructions(Machine *machine, int *fused_counts)
+{
+    int address, second, third, total = 0;
+
+    memset(fused_counts, 0, TOTAL_SUPERINSTRUCTIONS * sizeof(int));
+    /* A record is fused before the records that follow it are, so a sequence can also start inside a longer one */
+    for (address = machine->code_start; address < machine->code_end; address = machine->decoded[address].next)
+    {
+        second = machine->decoded[address].next;
+        third = second < MACHINE_MEMORY_SIZE ? machine->decoded[second].next : MACHINE_MEMORY_SIZE;
+        switch (handler_at(machine, address))
+        {
+        case INC_OPCODE:
+            if (is_register(&machine->decoded[address].destination) && handler_at(machine, second) == CMP_OPCODE &&
+                is_register_or_value(&machine->decoded[second].source) &&
+                is_register_or_value(&machine->decoded[second].destination) && is_direct_bne(machine, third))
+                fuse(machine, address, third, HANDLER_INC_CMP_BNE, fused_counts);
+            break;
+        case CMP_OPCODE:
+            if (is_register_or_value(&machine->decoded[address].source) &&
+                is_register_or_value(&machine->decoded[address].destination) && is_direct_bne(machine, second))
+                fuse(machine, address, second, HANDLER_CMP_BNE, fused_counts);
+            break;
+        case MOV_OPCODE:
+            if (is_register_or_value(&machine->decoded[address].source) &&
+                is_register(&machine->decoded[address].destination) && handler_at(machine, second) == ADD_OPCODE &&
+                is_register_or_value(&machine->decoded[second].source) &&
+                is_register(&machine->decoded[second].destination))
+                fuse(machine, address, second, HANDLER_MOV_ADD, fused_counts);
+            break;
+        default:
+            continue; /* Not the start of a sequence */
+        }
+    }
+    for (address = 0; address < TOTAL_SUPERINSTRUCTIONS; address++)
+        total += fused_counts[address];
+    return total;
+}
+
+char *superinstruction_name(int handler)
+{
+    return SUPERINSTRUCTION_NAMES[handler - HANDLER_CMP_BNE];
+}
+
+/* Checks if an instruction ends a basic block */
+static int is_block_end(int opcode)
+{
+    return opcode == JMP_OPCODE || opcode == BNE_OPCODE || opcode == JSR_OPCODE ||
+           opcode == RTS_OPCODE || opcode == STOP_OPCODE;
+}
+
+int find_basic_blocks(Machine *machine, Basic_Block *blocks)
+{
+    unsigned char is_leader[MACHINE_MEMORY_SIZE + 1] = {0};
+    int address, opcode, count = 0, previous_ends = 1;
+    Decoded_Instruction instruction;
+
+    /* Finding the leaders, the instructions are decoded from the memory as it is after the run */
+    is_leader[machine->code_start] = 1;
+    for (address = machine->code_start; address < machine->code_end; address = instruction.next)
+    {
+        decode_instruction(machine->cells, address, &instruction);
+        if (machine->block_entries[address] > 0)
+            is_leader[address] = 1;
+        opcode = instruction.handler;
+        if (!is_block_end(opcode))
+            continue;
+        is_leader[instruction.next] = 1;
+        if (opcode != RTS_OPCODE && opcode != STOP_OPCODE && instruction.destination.kind == OPERAND_CELL &&
+            instruction.destination.location < MACHINE_MEMORY_SIZE)
+            is_leader[instruction.destination.location] = 1;
+    }
+    /* Splitting the code into blocks, a block that does not end with a transfer falls through into the next one */
+    for (address = machine->code_start; address < machine->code_end; address = instruction.next)
+    {
+        decode_instruction(machine->cells, address, &instruction);
+        if (is_leader[address] || previous_ends)
+        {
+            blocks[count].start = address;
+            blocks[count].instructions_count = 0;
+            blocks[count].executions = machine->block_entries[address];
+            if (!previous_ends && count > 0)
+                blocks[count].executions += blocks[count - 1].executions;
+            count++;
+        }
+        blocks[count - 1].instructions_count++;
+        blocks[count - 1].end = instruction.next;
+        previous_ends = is_block_end(instruction.handler);
+    }
+    return count;
+}
+
+void count_instruction_runs(Machine *machine, unsigned long *runs)
+{
+    Basic_Block blocks[MACHINE_MEMORY_SIZE];
+    Decoded_Instruction instruction;
+    unsigned long executions;
+    int i, address, count = find_basic_blocks(machine, blocks);
+
+    for (i = 0; i < count; i++)
+    {
+        for (address = blocks[i].start; address < blocks[i].end; address = instruction.next)
+        {
+            decode_instruction(machine->cells, address, &instruction);
+            executions = blocks[i].executions;
+            /* The run left the block of the pc early: at its entry on the step limit, or at the faulting instruction */
+            if (executions > 0 && machine->pc >= blocks[i].start && machine->pc < blocks[i].end &&
+                ((machine->status == MACHINE_STEP_LIMIT && address >= machine->pc) ||
+                 (machine->status == MACHINE_FAULTED && address > machine->pc)))
+                executions--;
+            runs[address] += executions;
+        }
+    }
+}
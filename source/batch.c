@@ -0,0 +1,649 @@
+/**
+ * This file runs batches of lanes in lockstep.
+ * The row loops are written without branches where they can be (the mask selects the lanes), so the compiler can
+ * vectorize them. Matrix operands, the call stack and the input and output of the lanes are handled lane by lane.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "batch.h"
+#include "interpreter.h"
+#include "basic_blocks.h"
+#include "machine.h"
+#include "error_handler.h"
+#include "definitions.h"
+
+#define LANE_MASK 0xFFFF
+#define OUTPUT_START_CAPACITY 64
+
+/* Rows of the lanes state */
+#define CELL_ROW(batch, cell) ((batch)->cells + (unsigned long)(cell) * (batch)->width)
+#define STACK_ROW(batch, depth) ((batch)->stack + (unsigned long)(depth) * (batch)->width)
+#define SCRATCH_ROW(batch, row) ((batch)->scratch + (unsigned long)(row) * (batch)->width)
+
+/* Scratch rows */
+#define SOURCE_VALUES 0
+#define SOURCE_ADDRESSES 1
+#define DESTINATION_VALUES 2
+#define DESTINATION_ADDRESSES 3
+#define RESULTS 4
+#define TAKEN_MASK 5
+#define SCRATCH_ROWS 6
+
+/* Fills a row with a value */
+static void fill_row(unsigned short *row, unsigned short value, int width)
+{
+    int lane;
+
+    for (lane = 0; lane < width; lane++)
+        row[lane] = value;
+}
+
+/* Copies the values of the lanes under a mask into a row, the other lanes keep their values */
+static void blend_row(unsigned short *row, const unsigned short *values, const unsigned short *mask, int width)
+{
+    int lane;
+
+    for (lane = 0; lane < width; lane++)
+        row[lane] = (unsigned short)((row[lane] & ~mask[lane]) | (values[lane] & mask[lane]));
+}
+
+/* Computes the result of a data instruction in every lane, a zero flag of 1 or 0 for "cmp" */
+static void compute_row(int opcode, const unsigned short *source, const unsigned short *destination,
+                        unsigned short *result, int width)
+{
+    int lane;
+
+    switch (opcode)
+    {
+    case CMP_OPCODE:
+        for (lane = 0; lane < width; lane++)
+            result[lane] = (unsigned short)(((source[lane] - destination[lane]) & MASK_10_BITS) == 0);
+        break;
+    case ADD_OPCODE:
+        for (lane = 0; lane < width; lane++)
+            result[lane] = (unsigned short)((destination[lane] + source[lane]) & MASK_10_BITS);
+        break;
+    case SUB_OPCODE:
+        for (lane = 0; lane < width; lane++)
+            result[lane] = (unsigned short)((destination[lane] - source[lane]) & MASK_10_BITS);
+        break;
+    case CLR_OPCODE:
+        fill_row(result, 0, width);
+        break;
+    case NOT_OPCODE:
+        for (lane = 0; lane < width; lane++)
+            result[lane] = (unsigned short)(~destination[lane] & MASK_10_BITS);
+        break;
+    case INC_OPCODE:
+        for (lane = 0; lane < width; lane++)
+            result[lane] = (unsigned short)((destination[lane] + 1) & MASK_10_BITS);
+        break;
+    case DEC_OPCODE:
+        for (lane = 0; lane < width; lane++)
+            result[lane] = (unsigned short)((destination[lane] - 1) & MASK_10_BITS);
+        break;
+    default: /* "mov" and "lea" */
+        for (lane = 0; lane < width; lane++)
+            result[lane] = (unsigned short)(source[lane] & MASK_10_BITS);
+        break;
+    }
+}
+
+/* Removes a lane from the active group and from the mask of an operation */
+static void leave_group(Batch *batch, int lane, unsigned short *mask)
+{
+    mask[lane] = 0;
+    batch->mask[lane] = 0;
+    batch->executed[lane] += batch->pending_steps;
+    batch->departures++;
+}
+
+/* Stops a lane with a runtime error at the instruction at an address and reports it */
+static void fault_lane(Batch *batch, int lane, int pc, int error_code, unsigned short *mask)
+{
+    batch->status[lane] = MACHINE_FAULTED;
+    batch->fault[lane] = (unsigned short)error_code;
+    batch->pc[lane] = (unsigned short)pc;
+    batch->executed[lane]++; /* The faulting instruction is counted, as by the interpreter */
+    leave_group(batch, lane, mask);
+    printf(" Instance %d - Address %d", lane, pc);
+    log_system_error(error_code);
+}
+
+/* Appends characters to the output of a lane, returns 1 if memory allocation failed */
+static int append_output(Lane_Output *output, const char *text, unsigned long length)
+{
+    char *resized;
+    unsigned long capacity = output->capacity == 0 ? OUTPUT_START_CAPACITY : output->capacity;
+
+    while (output->length + length > capacity)
+        capacity *= 2;
+    if (capacity != output->capacity)
+    {
+        if ((resized = (char *)realloc(output->text, capacity)) == NULL)
+            return 1; /* Indicates failure */
+        output->text = resized;
+        output->capacity = capacity;
+    }
+    memcpy(output->text + output->length, text, length);
+    output->length += length;
+    return 0;
+}
+
+/* Reads the next input character of a lane, -1 at the end of its input */
+static int read_lane_character(Batch *batch, int lane)
+{
+    if (batch->input_positions[lane] == batch->input_sizes[lane])
+        return -1;
+    return batch->inputs[lane][batch->input_positions[lane]++];
+}
+
+/* Finishes a lane with the interpreter, starting from the instruction at an address */
+static void eject_lane(Batch *batch, int lane, int pc, unsigned short *mask)
+{
+    Machine *machine = batch->machine;
+    FILE *output = tmpfile();
+    unsigned long max_steps = batch->max_steps;
+    char buffer[INPUT_CHUNK_SIZE];
+    size_t length;
+    int i;
+
+    if (output == NULL)
+    {
+        fault_lane(batch, lane, pc, Error_104, mask);
+        return;
+    }
+    leave_group(batch, lane, mask);
+    batch->ejected_count++;
+    memcpy(machine, batch->program, sizeof(Machine));
+    for (i = 0; i < MACHINE_CELLS_COUNT; i++)
+        machine->cells[i] = CELL_ROW(batch, i)[lane];
+    machine->sp = batch->sp[lane];
+    for (i = 0; i < machine->sp; i++)
+        machine->stack[i] = STACK_ROW(batch, i)[lane];
+    machine->pc = pc;
+    machine->zero_flag = batch->zero_flag[lane];
+    machine->executed = batch->executed[lane];
+    machine->input = batch->inputs[lane];
+    machine->input_size = batch->input_sizes[lane];
+    machine->input_position = batch->input_positions[lane];
+    machine->output = output;
+
+    /* A lane already past the limit stops at the next control transfer, as it would in the batch */
+    if (max_steps > 0)
+        max_steps = machine->executed >= max_steps ? 1 : max_steps - machine->executed;
+    run_machine(machine, max_steps);
+    count_instruction_runs(machine, batch->instruction_runs);
+    batch->code_writes += machine->code_writes;
+
+    for (i = 0; i < MACHINE_CELLS_COUNT; i++)
+        CELL_ROW(batch, i)[lane] = machine->cells[i];
+    for (i = 0; i < machine->sp; i++)
+        STACK_ROW(batch, i)[lane] = machine->stack[i];
+    batch->sp[lane] = (unsigned short)machine->sp;
+    batch->pc[lane] = (unsigned short)machine->pc;
+    batch->zero_flag[lane] = (unsigned short)machine->zero_flag;
+    batch->status[lane] = (unsigned short)machine->status;
+    batch->fault[lane] = (unsigned short)machine->fault;
+    batch->executed[lane] = machine->executed;
+    batch->input_positions[lane] = machine->input_position;
+    rewind(output);
+    while ((length = fread(buffer, 1, sizeof(buffer), output)) > 0)
+    {
+        if (append_output(&batch->outputs[lane], buffer, length) != 0)
+        {
+            log_system_error(Error_101);
+            break;
+        }
+    }
+    fclose(output);
+}
+
+/* Computes the addresses of a matrix operand in the lanes under a mask, faulting the lanes outside of the memory */
+static void resolve_matrix(Batch *batch, Operand *operand, int pc, unsigned short *mask, unsigned short *addresses)
+{
+    unsigned short *rows = CELL_ROW(batch, REGISTER_CELL(operand->row));
+    unsigned short *columns = CELL_ROW(batch, REGISTER_CELL(operand->column));
+    int lane, address;
+
+    for (lane = 0; lane < batch->lanes_count; lane++)
+    {
+        if (!mask[lane])
+            continue;
+        address = operand->location + SIGN_EXTEND_10_BITS(rows[lane]) + SIGN_EXTEND_10_BITS(columns[lane]);
+        if (address < 0 || address >= MACHINE_MEMORY_SIZE)
+            fault_lane(batch, lane, pc, Error_401, mask);
+        else
+            addresses[lane] = (unsigned short)address;
+    }
+}
+
+/* Reads the words at the addresses of the active lanes */
+static void gather_row(Batch *batch, const unsigned short *addresses, unsigned short *values)
+{
+    int lane;
+
+    for (lane = 0; lane < batch->lanes_count; lane++)
+    {
+        if (batch->mask[lane])
+            values[lane] = CELL_ROW(batch, addresses[lane])[lane];
+    }
+}
+
+/* Returns the row of the values of an operand in the active lanes, filled or gathered into scratch rows if needed */
+static unsigned short *fetch_row(Batch *batch, Operand *operand, int pc, int values_row, int addresses_row)
+{
+    unsigned short *values = SCRATCH_ROW(batch, values_row), *addresses = SCRATCH_ROW(batch, addresses_row);
+
+    switch (operand->kind)
+    {
+    case OPERAND_IMMEDIATE:
+        fill_row(values, operand->value, batch->width);
+        return values;
+    case OPERAND_CELL:
+        return CELL_ROW(batch, operand->location);
+    default: /* OPERAND_MATRIX */
+        resolve_matrix(batch, operand, pc, batch->mask, addresses);
+        gather_row(batch, addresses, values);
+        return values;
+    }
+}
+
+/* Returns the row of the addresses "lea" loads in the active lanes, as computed by operand_address() */
+static unsigned short *address_row(Batch *batch, Operand *operand, int pc)
+{
+    unsigned short *addresses = SCRATCH_ROW(batch, SOURCE_ADDRESSES);
+
+    if (operand->kind == OPERAND_MATRIX)
+        resolve_matrix(batch, operand, pc, batch->mask, addresses);
+    else if (operand->location < MACHINE_MEMORY_SIZE)
+        fill_row(addresses, operand->location, batch->width);
+    else
+        return CELL_ROW(batch, operand->location); /* The register holds the address */
+    return addresses;
+}
+
+/* Resolves the destination of a write in the active lanes, the lanes that would write into a decoded instruction
+   leave the batch */
+static void resolve_destination(Batch *batch, Operand *operand, int pc)
+{
+    unsigned short *addresses = SCRATCH_ROW(batch, DESTINATION_ADDRESSES);
+    unsigned char *is_decoded_word = batch->program->is_decoded_word;
+    int lane;
+
+    if (operand->kind == OPERAND_CELL)
+    {
+        if (operand->location >= MACHINE_MEMORY_SIZE || !is_decoded_word[operand->location])
+            return;
+        for (lane = 0; lane < batch->lanes_count; lane++)
+        {
+            if (batch->mask[lane])
+                eject_lane(batch, lane, pc, batch->mask);
+        }
+        return;
+    }
+    resolve_matrix(batch, operand, pc, batch->mask, addresses);
+    for (lane = 0; lane < batch->lanes_count; lane++)
+    {
+        if (batch->mask[lane] && is_decoded_word[addresses[lane]])
+            eject_lane(batch, lane, pc, batch->mask);
+    }
+}
+
+/* Returns the row of the current values of a resolved destination */
+static unsigned short *destination_row(Batch *batch, Operand *operand)
+{
+    unsigned short *values = SCRATCH_ROW(batch, DESTINATION_VALUES);
+
+    if (operand->kind == OPERAND_CELL)
+        return CELL_ROW(batch, operand->location);
+    gather_row(batch, SCRATCH_ROW(batch, DESTINATION_ADDRESSES), values);
+    return values;
+}
+
+/* Writes the results of the active lanes into a resolved destination */
+static void store_row(Batch *batch, Operand *operand, const unsigned short *results)
+{
+    unsigned short *addresses = SCRATCH_ROW(batch, DESTINATION_ADDRESSES);
+    int lane;
+
+    if (operand->kind == OPERAND_CELL)
+    {
+        blend_row(CELL_ROW(batch, operand->location), results, batch->mask, batch->width);
+        return;
+    }
+    for (lane = 0; lane < batch->lanes_count; lane++)
+    {
+        if (batch->mask[lane])
+            CELL_ROW(batch, addresses[lane])[lane] = results[lane];
+    }
+}
+
+/* Computes the targets of a jump in the lanes under a mask, faulting the lanes whose target is outside of the memory */
+static void target_row(Batch *batch, Operand *operand, int pc, unsigned short *mask, unsigned short *targets)
+{
+    unsigned short *values = CELL_ROW(batch, operand->location);
+    int lane;
+
+    if (operand->kind == OPERAND_MATRIX)
+        resolve_matrix(batch, operand, pc, mask, targets);
+    else if (operand->location < MACHINE_MEMORY_SIZE)
+        fill_row(targets, operand->location, batch->width);
+    else
+    {
+        for (lane = 0; lane < batch->lanes_count; lane++)
+        {
+            if (!mask[lane])
+                continue;
+            if (values[lane] >= MACHINE_MEMORY_SIZE)
+                fault_lane(batch, lane, pc, Error_401, mask);
+            else
+                targets[lane] = values[lane];
+        }
+    }
+}
+
+/* Runs the instruction at the pc of the active group, returns 1 if it is a control transfer or "stop" */
+static int run_group(Batch *batch, Decoded_Instruction *instruction, int pc)
+{
+    unsigned short *mask = batch->mask, *results = SCRATCH_ROW(batch, RESULTS), *taken, *source, *destination;
+    int lane, width = batch->width, opcode = instruction->handler, length;
+    char text[INTEGER_STRING_BUFFER_SIZE];
+
+    switch (opcode)
+    {
+    case CMP_OPCODE:
+        source = fetch_row(batch, &instruction->source, pc, SOURCE_VALUES, SOURCE_ADDRESSES);
+        destination = fetch_row(batch, &instruction->destination, pc, DESTINATION_VALUES, DESTINATION_ADDRESSES);
+        compute_row(opcode, source, destination, results, width);
+        blend_row(batch->zero_flag, results, mask, width);
+        return 0;
+
+    case RED_OPCODE:
+        resolve_destination(batch, &instruction->destination, pc);
+        for (lane = 0; lane < batch->lanes_count; lane++)
+        {
+            if (mask[lane])
+                results[lane] = (unsigned short)(read_lane_character(batch, lane) & MASK_10_BITS);
+        }
+        store_row(batch, &instruction->destination, results);
+        return 0;
+
+    case PRN_OPCODE:
+        source = fetch_row(batch, &instruction->destination, pc, SOURCE_VALUES, SOURCE_ADDRESSES);
+        for (lane = 0; lane < batch->lanes_count; lane++)
+        {
+            if (!mask[lane])
+                continue;
+            length = sprintf(text, "%d\n", SIGN_EXTEND_10_BITS(source[lane]));
+            if (append_output(&batch->outputs[lane], text, length) != 0)
+                fault_lane(batch, lane, pc, Error_101, mask);
+        }
+        return 0;
+
+    case JMP_OPCODE:
+        target_row(batch, &instruction->destination, pc, mask, results);
+        blend_row(batch->pc, results, mask, width);
+        return 1;
+
+    case BNE_OPCODE:
+        taken = SCRATCH_ROW(batch, TAKEN_MASK);
+        for (lane = 0; lane < width; lane++)
+            taken[lane] = (unsigned short)(mask[lane] & (batch->zero_flag[lane] - 1));
+        fill_row(results, instruction->next, width);
+        blend_row(batch->pc, results, mask, width);
+        target_row(batch, &instruction->destination, pc, taken, results);
+        blend_row(batch->pc, results, taken, width);
+        return 1;
+
+    case JSR_OPCODE:
+        for (lane = 0; lane < batch->lanes_count; lane++)
+        {
+            if (mask[lane] && batch->sp[lane] == MACHINE_STACK_DEPTH)
+                fault_lane(batch, lane, pc, Error_402, mask);
+        }
+        target_row(batch, &instruction->destination, pc, mask, results);
+        for (lane = 0; lane < batch->lanes_count; lane++)
+        {
+            if (mask[lane])
+                STACK_ROW(batch, batch->sp[lane]++)[lane] = instruction->next;
+        }
+        blend_row(batch->pc, results, mask, width);
+        return 1;
+
+    case RTS_OPCODE:
+        for (lane = 0; lane < batch->lanes_count; lane++)
+        {
+            if (!mask[lane])
+                continue;
+            if (batch->sp[lane] == 0)
+                fault_lane(batch, lane, pc, Error_403, mask);
+            else
+                batch->pc[lane] = STACK_ROW(batch, --batch->sp[lane])[lane];
+        }
+        return 1;
+
+    case STOP_OPCODE:
+        for (lane = 0; lane < batch->lanes_count; lane++)
+        {
+            if (!mask[lane])
+                continue;
+            batch->status[lane] = MACHINE_HALTED;
+            batch->pc[lane] = (unsigned short)pc;
+            batch->executed[lane]++;
+            leave_group(batch, lane, mask);
+        }
+        return 1;
+
+    default: /* "mov", "add", "sub", "lea", "clr", "not", "inc" and "dec" */
+        source = NULL;
+        destination = NULL;
+        if (opcode == LEA_OPCODE)
+            source = address_row(batch, &instruction->source, pc);
+        else if (instruction->source.kind != OPERAND_NONE)
+            source = fetch_row(batch, &instruction->source, pc, SOURCE_VALUES, SOURCE_ADDRESSES);
+        resolve_destination(batch, &instruction->destination, pc);
+        if (opcode != MOV_OPCODE && opcode != LEA_OPCODE && opcode != CLR_OPCODE)
+            destination = destination_row(batch, &instruction->destination);
+        compute_row(opcode, source, destination, results, width);
+        store_row(batch, &instruction->destination, results);
+        return 0;
+    }
+}
+
+/* Returns the pc the lanes of the active group went to if it is the same in all of them, -1 otherwise */
+static int shared_pc(Batch *batch, int first_lane)
+{
+    unsigned short pc = batch->pc[first_lane], difference = 0;
+    int lane;
+
+    for (lane = 0; lane < batch->width; lane++)
+        difference |= (unsigned short)((batch->pc[lane] ^ pc) & batch->mask[lane]);
+    return difference == 0 ? pc : -1;
+}
+
+/* Selects the running lanes at the lowest pc as the active group, returns the pc or -1 if no lane is running */
+static int select_group(Batch *batch, int *active_count, int *running_count, int *first_lane)
+{
+    int lane, group_pc = MACHINE_MEMORY_SIZE + 1;
+
+    *active_count = 0;
+    *running_count = 0;
+    for (lane = 0; lane < batch->lanes_count; lane++)
+    {
+        if (batch->status[lane] == MACHINE_RUNNING)
+        {
+            (*running_count)++;
+            if (batch->pc[lane] < group_pc)
+            {
+                group_pc = batch->pc[lane];
+                *first_lane = lane;
+            }
+        }
+    }
+    if (*running_count == 0)
+        return -1;
+    for (lane = 0; lane < batch->width; lane++)
+    {
+        batch->mask[lane] = (unsigned short)(batch->status[lane] == MACHINE_RUNNING && batch->pc[lane] == group_pc ?
+                                             LANE_MASK : 0);
+        *active_count += batch->mask[lane] & 1;
+    }
+    return group_pc;
+}
+
+Batch *create_batch(Machine *program, int lanes_count)
+{
+    Batch *batch = (Batch *)calloc(1, sizeof(Batch));
+    int i, width = (lanes_count + BATCH_VECTOR_LANES - 1) / BATCH_VECTOR_LANES * BATCH_VECTOR_LANES;
+    unsigned long row_size = (unsigned long)width * sizeof(unsigned short);
+
+    if (batch == NULL)
+    {
+        log_system_error(Error_101);
+        return NULL;
+    }
+    batch->program = program;
+    batch->lanes_count = lanes_count;
+    batch->width = width;
+    batch->machine = (Machine *)malloc(sizeof(Machine));
+    batch->cells = (unsigned short *)malloc(MACHINE_CELLS_COUNT * row_size);
+    batch->stack = (unsigned short *)malloc(MACHINE_STACK_DEPTH * row_size);
+    batch->pc = (unsigned short *)malloc(row_size);
+    batch->zero_flag = (unsigned short *)malloc(row_size);
+    batch->sp = (unsigned short *)malloc(row_size);
+    batch->status = (unsigned short *)malloc(row_size);
+    batch->fault = (unsigned short *)calloc(width, sizeof(unsigned short));
+    batch->mask = (unsigned short *)calloc(width, sizeof(unsigned short));
+    batch->scratch = (unsigned short *)calloc(SCRATCH_ROWS * width, sizeof(unsigned short));
+    batch->executed = (unsigned long *)calloc(width, sizeof(unsigned long));
+    batch->inputs = (const unsigned char **)calloc(width, sizeof(const unsigned char *));
+    batch->input_sizes = (unsigned long *)calloc(width, sizeof(unsigned long));
+    batch->input_positions = (unsigned long *)calloc(width, sizeof(unsigned long));
+    batch->outputs = (Lane_Output *)calloc(width, sizeof(Lane_Output));
+    if (batch->machine == NULL || batch->cells == NULL || batch->stack == NULL || batch->pc == NULL ||
+        batch->zero_flag == NULL || batch->sp == NULL || batch->status == NULL || batch->fault == NULL ||
+        batch->mask == NULL || batch->scratch == NULL || batch->executed == NULL || batch->inputs == NULL ||
+        batch->input_sizes == NULL || batch->input_positions == NULL || batch->outputs == NULL)
+    {
+        log_system_error(Error_101);
+        free_batch(batch);
+        return NULL;
+    }
+
+    /* Every lane starts at the state of the loaded program, the padding lanes never run */
+    for (i = 0; i < MACHINE_CELLS_COUNT; i++)
+        fill_row(CELL_ROW(batch, i), program->cells[i], width);
+    for (i = 0; i < program->sp; i++)
+        fill_row(STACK_ROW(batch, i), program->stack[i], width);
+    fill_row(batch->pc, (unsigned short)program->pc, width);
+    fill_row(batch->zero_flag, (unsigned short)program->zero_flag, width);
+    fill_row(batch->sp, (unsigned short)program->sp, width);
+    for (i = 0; i < width; i++)
+        batch->status[i] = (unsigned short)(i < lanes_count ? program->status : MACHINE_HALTED);
+    return batch;
+}
+
+void set_lane_input(Batch *batch, int lane, const unsigned char *input, unsigned long size)
+{
+    batch->inputs[lane] = input;
+    batch->input_sizes[lane] = size;
+    batch->input_positions[lane] = 0;
+}
+
+int run_batch(Batch *batch, unsigned long max_steps)
+{
+    Decoded_Instruction *instruction;
+    unsigned short *mask = batch->mask;
+    unsigned long departures;
+    int lane, pc, active_count, running_count, first_lane = 0, is_transfer, halted_count = 0, ejected_count;
+
+    batch->max_steps = max_steps;
+    batch->pending_steps = 0;
+    pc = select_group(batch, &active_count, &running_count, &first_lane);
+    while (pc >= 0)
+    {
+        instruction = &batch->program->decoded[pc];
+        departures = batch->departures;
+        batch->steps++;
+        batch->lane_steps += active_count;
+        if (instruction->handler >= TOTAL_OPCODES)
+        { /* The word is invalid, or was not decoded at load time and the interpreter decodes it */
+            for (lane = 0; lane < batch->lanes_count; lane++)
+            {
+                if (mask[lane] && instruction->handler == HANDLER_INVALID)
+                    fault_lane(batch, lane, pc, pc >= MACHINE_MEMORY_SIZE ? Error_401 : Error_400, mask);
+                else if (mask[lane])
+                    eject_lane(batch, lane, pc, mask);
+            }
+            is_transfer = 1;
+        }
+        else
+        {
+            ejected_count = batch->ejected_count;
+            is_transfer = run_group(batch, instruction, pc);
+            /* The lanes that left the batch ran the instruction with the interpreter, which counted them */
+            batch->instruction_runs[pc] += active_count - (batch->ejected_count - ejected_count);
+        }
+        batch->pending_steps++;
+        if (departures == batch->departures && active_count == running_count)
+        { /* The whole batch runs together, the pc and the step count of the lanes are written when it splits */
+            if (!is_transfer)
+            {
+                pc = instruction->next;
+                continue;
+            }
+            if (max_steps == 0 && (pc = shared_pc(batch, first_lane)) >= 0)
+                continue;
+        }
+        for (lane = 0; lane < batch->width; lane++)
+            batch->executed[lane] += mask[lane] ? batch->pending_steps : 0;
+        batch->pending_steps = 0;
+
+        if (is_transfer)
+        { /* The step limit is checked on control transfers, as in the interpreter */
+            for (lane = 0; max_steps > 0 && lane < batch->lanes_count; lane++)
+            {
+                if (mask[lane] && batch->executed[lane] >= max_steps)
+                    batch->status[lane] = MACHINE_STEP_LIMIT;
+            }
+        }
+        else
+        {
+            fill_row(SCRATCH_ROW(batch, RESULTS), instruction->next, batch->width);
+            blend_row(batch->pc, SCRATCH_ROW(batch, RESULTS), mask, batch->width);
+        }
+        pc = select_group(batch, &active_count, &running_count, &first_lane);
+    }
+    for (lane = 0; lane < batch->lanes_count; lane++)
+        halted_count += batch->status[lane] == MACHINE_HALTED;
+    return halted_count;
+}
+
+void free_batch(Batch *batch)
+{
+    int lane;
+
+    if (batch->outputs != NULL)
+    {
+        for (lane = 0; lane < batch->width; lane++)
+            free(batch->outputs[lane].text);
+    }
+    free(batch->outputs);
+    free(batch->input_positions);
+    free(batch->input_sizes);
+    free(batch->inputs);
+    free(batch->executed);
+    free(batch->scratch);
+    free(batch->mask);
+    free(batch->fault);
+    free(batch->status);
+    free(batch->sp);
+    free(batch->zero_flag);
+    free(batch->pc);
+    free(batch->stack);
+    free(batch->cells);
+    free(batch->machine);
+    free(batch);
+}
@@ -0,0 +1,393 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "error_handler.h"
+#include "object_reader.h"
+#include "machine.h"
+#include "interpreter.h"
+#include "basic_blocks.h"
+#include "jit.h"
+#include "utils.h"
+#include "definitions.h"
+
+#define MAX_BENCHMARK_LINE_LENGTH 1024
+#define BENCHMARK_SEPARATORS " \t\r\n"
+#define MAX_ENGINE_NAME_LENGTH 16
+#define DEFAULT_RUNS 3
+#define DEFAULT_TOLERANCE 10.0     /* Percent of the baseline speed that a run may lose */
+#define MIN_SAMPLE_SECONDS 0.1     /* Time of the repeated runs that make up one timed sample */
+
+/* Execution engines of the emulator */
+enum {
+    ENGINE_PLAIN,
+    ENGINE_FUSED,
+    ENGINE_JIT,
+    TOTAL_ENGINES
+};
+
+static char *ENGINE_NAMES[] = {"plain", "fused", "jit"};
+
+/* Benchmark result struct definition - a line of a results file */
+typedef struct Benchmark_Result {
+    char program[MAX_BENCHMARK_LINE_LENGTH];
+    char engine[MAX_ENGINE_NAME_LENGTH];
+    double mips;
+} Benchmark_Result;
+
+/**
+ * Reads a results file, one "program engine MIPS" line per result, skipping empty lines and ';' comments.
+ * @file_name: The name of the results file.
+ * @results: Set to the results (allocated, freed by the caller).
+ * return The number of results, or -1 if an error was detected.
+ */
+static int read_results(char *file_name, Benchmark_Result **results)
+{
+    char line[MAX_BENCHMARK_LINE_LENGTH], *program, *engine, *mips;
+    FILE *file = fopen(file_name, "r");
+    Benchmark_Result *resized;
+    int count = 0, capacity = 0, line_number = 0;
+
+    *results = NULL;
+    if (file == NULL) {
+        printf(" File \"%s\"", file_name);
+        log_system_error(Error_103);
+        return -1;  /* Indicates faliure */
+    }
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        if ((program = strtok(line, BENCHMARK_SEPARATORS)) == NULL || *program == ';')
+            continue;
+        engine = strtok(NULL, BENCHMARK_SEPARATORS);
+        mips = strtok(NULL, BENCHMARK_SEPARATORS);
+        if (engine == NULL || mips == NULL || strlen(engine) >= MAX_ENGINE_NAME_LENGTH) {
+            printf(" WARNING | Line %d of \"%s\" is not a \"program engine MIPS\" result, it is skipped\n",
+                   line_number, file_name);
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity == 0 ? TOTAL_ENGINES * 4 : capacity * 2;
+            if ((resized = (Benchmark_Result *)realloc(*results, capacity * sizeof(Benchmark_Result))) == NULL) {
+                log_system_error(Error_101);
+                fclose(file);
+                return -1;  /* Indicates faliure */
+            }
+            *results = resized;
+        }
+        strcpy((*results)[count].program, program);
+        strcpy((*results)[count].engine, engine);
+        (*results)[count++].mips = atof(mips);
+    }
+    fclose(file);
+    return count;
+}
+
+/**
+ * Reads the list of benchmark programs, one program name per line, skipping empty lines and ';' comments.
+ * @list_name: The name of the list file.
+ * @programs: Set to the programs, as results without an engine (allocated, freed by the caller).
+ * return The number of programs, or -1 if an error was detected.
+ */
+static int read_program_list(char *list_name, Benchmark_Result **programs)
+{
+    char line[MAX_BENCHMARK_LINE_LENGTH], *name;
+    FILE *list = fopen(list_name, "r");
+    Benchmark_Result *resized;
+    int count = 0, capacity = 0;
+
+    *programs = NULL;
+    if (list == NULL) {
+        printf(" File \"%s\"", list_name);
+        log_system_error(Error_103);
+        return -1;  /* Indicates faliure */
+    }
+    while (fgets(line, sizeof(line), list) != NULL) {
+        if ((name = strtok(line, BENCHMARK_SEPARATORS)) == NULL || *name == ';')
+            continue;
+        if (count == capacity) {
+            capacity = capacity == 0 ? 8 : capacity * 2;
+            if ((resized = (Benchmark_Result *)realloc(*programs, capacity * sizeof(Benchmark_Result))) == NULL) {
+                log_system_error(Error_101);
+                fclose(list);
+                return -1;  /* Indicates faliure */
+            }
+            *programs = resized;
+        }
+        strcpy((*programs)[count].program, name);
+        (*programs)[count].engine[0] = STRING_TERMINATOR;
+        (*programs)[count++].mips = 0;
+    }
+    fclose(list);
+    return count;
+}
+
+/**
+ * Finds the result of a program on an engine.
+ * @results: The results.
+ * @count: The number of results.
+ * @program: The name of the program.
+ * @engine: The name of the engine.
+ * return Pointer to the result, or NULL if there is none.
+ */
+static Benchmark_Result *find_result(Benchmark_Result *results, int count, char *program, char *engine)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (strcmp(results[i].program, program) == 0 && strcmp(results[i].engine, engine) == 0)
+            return &results[i];
+    }
+    return NULL;
+}
+
+/**
+ * Runs a copy of a loaded machine to its end on an engine.
+ * @loaded: Pointer to the loaded machine.
+ * @machine: Pointer to the machine to run the copy in.
+ * @engine: The engine to run.
+ * @expected: The output to compare the output of the run with, or NULL to write it to a file.
+ * @expected_size: The number of characters of the expected output.
+ * @output: The file to write the output to when there is no expected output.
+ * return The time the run took, in seconds.
+ */
+static double time_run(Machine *loaded, Machine *machine, int engine, unsigned char *expected,
+                       unsigned long expected_size, FILE *output)
+{
+    clock_t start;
+
+    memcpy(machine, loaded, sizeof(Machine));
+    machine->input = (const unsigned char *)"";  /* Benchmarks do not read input */
+    machine->output = output;
+    machine->expected = expected;
+    machine->expected_size = expected_size;
+    start = clock();
+    if (engine == ENGINE_JIT)
+        run_jit(machine, 0);
+    else
+        run_machine(machine, 0);
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/**
+ * Runs a program on every engine and times it, the best of a number of samples (a sample repeats the run for at least
+ * MIN_SAMPLE_SECONDS). The output of the plain interpreter is recorded first, and the timed runs compare their output
+ * with it instead of writing it.
+ * @program_name: The name of the program, without an extension.
+ * @runs: The number of timed samples of every engine.
+ * @mips: Set to the speed of every engine, in millions of simulated instructions per second (0 if it did not run).
+ * @executed: Set to the number of instructions of the program.
+ * @seconds: Set to the best time of a run on every engine.
+ * return 0 if the program reached "stop" with the same output on every engine, 1 otherwise.
+ */
+static int run_benchmark(char *program_name, int runs, double *mips, unsigned long *executed, double *seconds)
+{
+    Object_Module *module = read_object_module(program_name);
+    Machine *loaded[TOTAL_ENGINES] = {NULL, NULL, NULL}, *machine = (Machine *)malloc(sizeof(Machine));
+    int engine, i, repeats, fused_counts[TOTAL_SUPERINSTRUCTIONS], result = 1;
+    unsigned char *expected = NULL;
+    unsigned long expected_size = 0;
+    FILE *output = tmpfile();
+    double time;
+
+    for (engine = 0; engine < TOTAL_ENGINES; engine++)
+        mips[engine] = seconds[engine] = 0;
+    *executed = 0;
+    if (machine == NULL || output == NULL) {
+        log_system_error(machine == NULL ? Error_101 : Error_104);
+        goto cleanup;
+    }
+    if (module == NULL)
+        goto cleanup;
+    for (engine = 0; engine < TOTAL_ENGINES; engine++) {
+        if ((loaded[engine] = (Machine *)malloc(sizeof(Machine))) == NULL) {
+            log_system_error(Error_101);
+            goto cleanup;
+        }
+        if (load_machine(loaded[engine], module) != 0)
+            goto cleanup;
+        if (engine == ENGINE_FUSED)
+            fuse_superinstructions(loaded[engine], fused_counts);
+    }
+    /* The reference run, its output is what every timed run must write */
+    time_run(loaded[ENGINE_PLAIN], machine, ENGINE_PLAIN, NULL, 0, output);
+    flush_output(machine);
+    if (machine->status != MACHINE_HALTED) {
+        printf(" WARNING | Benchmark \"%s\" did not reach stop (status %d at address %d)\n", program_name,
+               machine->status, machine->pc);
+        goto cleanup;
+    }
+    *executed = machine->executed;
+    rewind(output);
+    if ((expected = read_program_input(output, &expected_size)) == NULL)
+        goto cleanup;
+    result = 0;
+    for (engine = 0; engine < TOTAL_ENGINES; engine++) {
+        if (engine == ENGINE_JIT && !is_jit_supported())
+            continue;
+        for (i = 0; i < runs && result == 0; i++) {
+            /* Short runs repeat, so the clock measures enough of them */
+            for (time = 0, repeats = 0; result == 0 && (repeats == 0 || time < MIN_SAMPLE_SECONDS); repeats++) {
+                time += time_run(loaded[engine], machine, engine, expected, expected_size, output);
+                flush_output(machine);
+                if (machine->status != MACHINE_HALTED || machine->executed != *executed || machine->is_unexpected ||
+                    machine->expected_position != expected_size) {
+                    printf(" WARNING | Benchmark \"%s\" ran differently on the %s engine than on the plain "
+                           "interpreter\n", program_name, ENGINE_NAMES[engine]);
+                    result = 1;
+                }
+            }
+            if (i == 0 || time / repeats < seconds[engine])
+                seconds[engine] = time / repeats;
+        }
+        if (result == 0 && seconds[engine] > 0)
+            mips[engine] = *executed / seconds[engine] / 1e6;
+    }
+
+cleanup:
+    for (engine = 0; engine < TOTAL_ENGINES; engine++)
+        free(loaded[engine]);
+    free(machine);
+    free(expected);
+    if (output != NULL)
+        fclose(output);
+    if (module != NULL)
+        free_object_module(module);
+    return result;
+}
+
+/**
+ * Writes results to a file, in the layout that read_results reads.
+ * @file_name: The name of the results file.
+ * @results: The results.
+ * @count: The number of results.
+ * return 0 if successful, 1 if the file could not be written.
+ */
+static int write_results(char *file_name, Benchmark_Result *results, int count)
+{
+    FILE *file = fopen(file_name, "w");
+    int i;
+
+    if (file == NULL) {
+        printf(" File \"%s\"", file_name);
+        log_system_error(Error_104);
+        return 1;  /* Indicates faliure */
+    }
+    fprintf(file, "; Benchmark baseline: program, engine, millions of simulated instructions per second\n");
+    for (i = 0; i < count; i++)
+        fprintf(file, "%s %s %.2f\n", results[i].program, results[i].engine, results[i].mips);
+    fclose(file);
+    return 0;
+}
+
+/**
+ * This is the main function of the benchmark harness, it times the programs listed in a file on every engine of the
+ * emulator (the plain interpreter, superinstructions and the JIT, on hosts that support it) and reports their speed
+ * in millions of simulated instructions per second (MIPS).
+ * The list file names one assembled program per line, without an extension (see benchmarks/benchmarks.list).
+ * Every program runs to "stop" without input, and every engine must write the output of the plain interpreter.
+ * The option "-r runs" sets the number of timed samples of every engine, the best one counts (3 by default). A sample
+ * repeats the program for at least 0.1 seconds, so that the short runs of the JIT are measured too.
+ * The option "-b baseline" compares the speeds with a baseline file and fails if one of them is slower than its
+ * baseline by more than the tolerance.
+ * The option "-t percent" sets the tolerance of "-b" (10 by default).
+ * The option "-w baseline" writes the speeds to a baseline file.
+ * argc: The number of command-line arguments.
+ * argv: An array of strings containing the command-line arguments.
+ * return Returns 0 if every program ran the same on every engine and no speed regressed, 1 otherwise.
+ */
+
+int main(int argc, char *argv[]) {
+    int i, engine, count, runs = DEFAULT_RUNS, results_count = 0, baseline_count = 0, regressions = 0, result = 0;
+    char *list_name = NULL, *baseline_name = NULL, *write_name = NULL;
+    double tolerance = DEFAULT_TOLERANCE, mips[TOTAL_ENGINES], seconds[TOTAL_ENGINES], change;
+    Benchmark_Result *programs = NULL, *results = NULL, *baseline = NULL, *previous;
+    unsigned long executed;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "-t") == 0 ||
+            strcmp(argv[i], "-w") == 0) {
+            if (i + 1 == argc) {
+                log_system_error(Error_107);
+                return 1;  /* Indicates faliure */
+            }
+            switch (argv[i++][1]) {
+            case 'r':
+                runs = atoi(argv[i]) > 0 ? atoi(argv[i]) : 1;
+                break;
+            case 'b':
+                baseline_name = argv[i];
+                break;
+            case 't':
+                tolerance = atof(argv[i]);
+                break;
+            default:
+                write_name = argv[i];
+                break;
+            }
+        }
+        else if (argv[i][0] == MINUS_SIGN) {
+            printf(" Unrecognized option \"%s\"", argv[i]);
+            log_system_error(Error_106);
+            return 1;  /* Indicates faliure */
+        }
+        else
+            list_name = argv[i];
+    }
+    if (list_name == NULL) {  /* Checking if no list was entered */
+        log_system_error(Error_100);
+        return 1;  /* Indicates faliure */
+    }
+    if ((count = read_program_list(list_name, &programs)) < 0 ||
+        (baseline_name != NULL && (baseline_count = read_results(baseline_name, &baseline)) < 0) ||
+        (results = (Benchmark_Result *)malloc((count * TOTAL_ENGINES + 1) * sizeof(Benchmark_Result))) == NULL) {
+        if (count >= 0 && results == NULL && (baseline_name == NULL || baseline_count >= 0))
+            log_system_error(Error_101);
+        free(programs);
+        free(baseline);
+        return 1;  /* Indicates faliure */
+    }
+    if (!is_jit_supported())
+        printf(" WARNING | The JIT is not supported on this host, its speed is not measured\n");
+    printf("%-24s %-6s %12s %10s %9s %9s\n", "Program", "Engine", "Instructions", "Seconds", "MIPS",
+           baseline_name != NULL ? "Baseline" : "");
+    for (i = 0; i < count; i++) {
+        if (run_benchmark(programs[i].program, runs, mips, &executed, seconds) != 0)
+            result = 1;
+        for (engine = 0; engine < TOTAL_ENGINES; engine++) {
+            if (mips[engine] == 0)
+                continue;
+            strcpy(results[results_count].program, programs[i].program);
+            strcpy(results[results_count].engine, ENGINE_NAMES[engine]);
+            results[results_count++].mips = mips[engine];
+            printf("%-24s %-6s %12lu %10.6f %9.2f", programs[i].program, ENGINE_NAMES[engine], executed,
+                   seconds[engine], mips[engine]);
+            if (baseline_name != NULL &&
+                (previous = find_result(baseline, baseline_count, programs[i].program, ENGINE_NAMES[engine])) != NULL
+                && previous->mips > 0) {
+                change = (mips[engine] - previous->mips) / previous->mips * 100;
+                printf(" %9.2f %+6.1f%%", previous->mips, change);
+                if (change < -tolerance) {
+                    printf("  REGRESSION");
+                    regressions++;
+                }
+            }
+            else if (baseline_name != NULL)
+                printf(" %9s", "new");
+            printf("\n");
+        }
+    }
+    if (baseline_name != NULL) {
+        printf("%d of %d results are more than %.1f%% slower than \"%s\"\n", regressions, results_count, tolerance,
+               baseline_name);
+        if (regressions > 0)
+            result = 1;
+    }
+    if (write_name != NULL && write_results(write_name, results, results_count) != 0)
+        result = 1;
+    free(programs);
+    free(results);
+    free(baseline);
+    release_jit();
+    free_all_memory();
+    return result;
+}
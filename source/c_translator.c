@@ -0,0 +1,401 @@
+/**
+ * This file writes the C translation of a loaded program.
+ * The translation is a single main function: the memory is a static array initialized with the loaded words, the
+ * registers r0-r7 and the zero flag z are local variables, and every translated instruction starts with the label
+ * L_<address>. Each instruction counts itself as executed before its checks, like the interpreter, so a runtime
+ * error reports the same address and count. The step limit is checked on the control transfers, where the
+ * interpreter checks it.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "c_translator.h"
+#include "machine.h"
+#include "validator.h"
+#include "error_handler.h"
+#include "definitions.h"
+
+/* Format of the first line of a state file, the cells and the call stack follow on two more lines */
+#define STATE_HEADER_FORMAT "status %d fault %d pc %d executed %lu zero %d sp %d\n"
+#define STATE_VALUE_FORMAT " %d"
+
+/* Maximum length of the C expression of an operand */
+#define MAX_EXPRESSION_LENGTH 16
+
+/* Translation uses struct definition - the labels and variables that only some translations need */
+typedef struct Translation_Uses {
+    int is_dispatch_used;   /* An indirect jump, or a jump to an address that was not translated */
+    int is_finished_used;   /* A "stop" or a step limit check */
+    int is_limit_used;      /* A control transfer, which checks the step limit */
+    int is_a1_used;         /* A matrix source operand */
+    int is_a2_used;         /* A matrix destination operand */
+    int is_character_used;  /* A "red" */
+    int is_code_used;       /* A write into a matrix element, checked against the code at run time */
+} Translation_Uses;
+
+/* Lines of the translation before the memory contents */
+static const char *prologue[] = {
+    "#include <stdio.h>",
+    "",
+    "#define SX(value) ((int)(((value) & 0x3FF) ^ 0x200) - 0x200)",
+    "#define FAULT(address, code) do { pc = (address); fault = (code); goto faulted; } while (0)",
+    "",
+    NULL};
+
+/* Writes a string as the contents of a C string literal */
+static void write_escaped(char *text, FILE *file)
+{
+    for (; *text != '\0'; text++)
+    {
+        if (*text == '\n')
+            fputs("\\n", file);
+        else
+            fputc(*text, file);
+    }
+}
+
+/* Writes the C expression of an operand, matrix elements use the address variable */
+static char *operand_expression(Operand *operand, char *address_variable, char *expression)
+{
+    switch (operand->kind)
+    {
+    case OPERAND_IMMEDIATE:
+        sprintf(expression, "%uu", operand->value);
+        break;
+    case OPERAND_MATRIX:
+        sprintf(expression, "m[%s]", address_variable);
+        break;
+    default:
+        if (operand->location >= MACHINE_MEMORY_SIZE)
+            sprintf(expression, "r%d", operand->location - MACHINE_MEMORY_SIZE);
+        else
+            sprintf(expression, "m[%d]", operand->location);
+        break;
+    }
+    return expression;
+}
+
+/* Writes the computation of a matrix element address, with its bounds check */
+static void write_matrix_address(Operand *operand, char *address_variable, int address, FILE *file)
+{
+    if (operand->kind != OPERAND_MATRIX)
+        return;
+    fprintf(file, "    %s = %d + SX(r%d) + SX(r%d);\n", address_variable, operand->location, operand->row,
+            operand->column);
+    fprintf(file, "    if (%s < 0 || %s >= %d) FAULT(%d, %d);\n", address_variable, address_variable,
+            MACHINE_MEMORY_SIZE, address, Error_401);
+}
+
+/* Writes the check that stops the program when a memory destination is part of its code */
+static void write_code_check(Operand *operand, unsigned char *is_code, int address, FILE *file)
+{
+    if (operand->kind == OPERAND_MATRIX)
+        fprintf(file, "    if (is_code[a2]) FAULT(%d, %d);\n", address, Error_405);
+    else if (operand->location < MACHINE_MEMORY_SIZE && is_code[operand->location])
+        fprintf(file, "    FAULT(%d, %d);\n", address, Error_405);
+}
+
+/* Checks if a jump to an address goes straight to its label, returns 1 if it does */
+static int is_direct_jump(int target, unsigned char *is_translated)
+{
+    return target < MACHINE_MEMORY_SIZE && is_translated[target];
+}
+
+/* Writes a jump to an address, straight to its label when it was translated */
+static void write_jump(int target, unsigned char *is_translated, FILE *file)
+{
+    if (is_direct_jump(target, is_translated))
+        fprintf(file, "goto L_%d;\n", target);
+    else
+        fprintf(file, "{ pc = %d; goto dispatch; }\n", target);
+}
+
+/* Writes a jump to the target operand of a control transfer, after the check of the step limit */
+static void write_target_jump(Operand *operand, unsigned char *is_translated, int address, FILE *file)
+{
+    if (operand->kind == OPERAND_CELL && operand->location < MACHINE_MEMORY_SIZE)
+    {
+        fprintf(file, "    CHECK_LIMIT(%d);\n    ", operand->location);
+        write_jump(operand->location, is_translated, file);
+        return;
+    }
+    if (operand->kind == OPERAND_MATRIX)
+        fputs("    pc = a2;\n", file);
+    else
+    {
+        fprintf(file, "    pc = r%d;\n", operand->location - MACHINE_MEMORY_SIZE);
+        fprintf(file, "    if (pc >= %d) FAULT(%d, %d);\n", MACHINE_MEMORY_SIZE, address, Error_401);
+    }
+    fputs("    CHECK_LIMIT(pc);\n    goto dispatch;\n", file);
+}
+
+/* Writes the statements of one instruction */
+static void write_instruction(Decoded_Instruction *instruction, int address, unsigned char *is_code,
+                              unsigned char *is_translated, FILE *file)
+{
+    char source[MAX_EXPRESSION_LENGTH], destination[MAX_EXPRESSION_LENGTH];
+    Operand *first = &instruction->source, *second = &instruction->destination;
+
+    fprintf(file, "L_%d: /* %s */\n    executed++;\n", address,
+            retrieve_instruction_set()[instruction->handler].mnemonic);
+    operand_expression(first, "a1", source);
+    operand_expression(second, "a2", destination);
+    write_matrix_address(first, "a1", address, file);
+    if (instruction->handler != JSR_OPCODE && instruction->handler != BNE_OPCODE)
+        write_matrix_address(second, "a2", address, file);
+
+    switch (instruction->handler)
+    {
+    case MOV_OPCODE:
+        write_code_check(second, is_code, address, file);
+        fprintf(file, "    %s = %s;\n", destination, source);
+        break;
+    case CMP_OPCODE:
+        fprintf(file, "    z = ((%s - %s) & 0x3FF) == 0;\n", source, destination);
+        break;
+    case ADD_OPCODE:
+    case SUB_OPCODE:
+        write_code_check(second, is_code, address, file);
+        fprintf(file, "    %s = (%s %c %s) & 0x3FF;\n", destination, destination,
+                instruction->handler == ADD_OPCODE ? '+' : '-', source);
+        break;
+    case LEA_OPCODE:
+        write_code_check(second, is_code, address, file);
+        if (first->location < MACHINE_MEMORY_SIZE)
+            fprintf(file, "    %s = %d;\n", destination, first->location);
+        else
+            fprintf(file, "    %s = %s;\n", destination, source);
+        break;
+    case CLR_OPCODE:
+        write_code_check(second, is_code, address, file);
+        fprintf(file, "    %s = 0;\n", destination);
+        break;
+    case NOT_OPCODE:
+        write_code_check(second, is_code, address, file);
+        fprintf(file, "    %s = ~%s & 0x3FF;\n", destination, destination);
+        break;
+    case INC_OPCODE:
+    case DEC_OPCODE:
+        write_code_check(second, is_code, address, file);
+        fprintf(file, "    %s = (%s %c 1) & 0x3FF;\n", destination, destination,
+                instruction->handler == INC_OPCODE ? '+' : '-');
+        break;
+    case RED_OPCODE:
+        write_code_check(second, is_code, address, file);
+        fprintf(file, "    character = getchar();\n    %s = (character == EOF ? -1 : character) & 0x3FF;\n",
+                destination);
+        break;
+    case PRN_OPCODE:
+        fprintf(file, "    printf(\"%%d\\n\", SX(%s));\n", destination);
+        break;
+    case JMP_OPCODE:
+        write_target_jump(second, is_translated, address, file);
+        return;
+    case BNE_OPCODE:
+        fputs("    if (!z)\n    {\n", file);
+        write_matrix_address(second, "a2", address, file);
+        write_target_jump(second, is_translated, address, file);
+        fprintf(file, "    }\n    CHECK_LIMIT(%d);\n", instruction->next);
+        break;
+    case JSR_OPCODE:
+        fprintf(file, "    if (sp == %d) FAULT(%d, %d);\n", MACHINE_STACK_DEPTH, address, Error_402);
+        write_matrix_address(second, "a2", address, file);
+        fprintf(file, "    stack[sp++] = %d;\n", instruction->next);
+        write_target_jump(second, is_translated, address, file);
+        return;
+    case RTS_OPCODE:
+        fprintf(file, "    if (sp == 0) FAULT(%d, %d);\n", address, Error_403);
+        fputs("    pc = stack[--sp];\n    CHECK_LIMIT(pc);\n    goto dispatch;\n", file);
+        return;
+    default: /* STOP_OPCODE */
+        fprintf(file, "    pc = %d;\n    goto finished;\n", address);
+        return;
+    }
+    /* Falling through to the next instruction, unless another label comes first */
+    for (address++; address < instruction->next && !is_translated[address]; address++)
+        ;
+    if (address != instruction->next || !is_direct_jump(address, is_translated))
+    {
+        fputs("    ", file);
+        write_jump(instruction->next, is_translated, file);
+    }
+}
+
+/* Adds an address to the addresses to translate */
+static void add_pending(int address, unsigned char *is_pending, int *pending, int *pending_count)
+{
+    if (address < MACHINE_MEMORY_SIZE && !is_pending[address])
+    {
+        is_pending[address] = 1;
+        pending[(*pending_count)++] = address;
+    }
+}
+
+/**
+ * Finds the instructions to translate: the code section, and the instructions reachable from it by falling through,
+ * direct jumps and returns from "jsr".
+ */
+static void find_instructions(Machine *machine, unsigned char *is_translated, unsigned char *is_code)
+{
+    unsigned char is_pending[MACHINE_MEMORY_SIZE];
+    int pending[MACHINE_MEMORY_SIZE], pending_count = 0, address, i;
+    Decoded_Instruction *instruction;
+
+    memset(is_pending, 0, sizeof(is_pending));
+    for (address = machine->code_start; address < machine->code_end; address = machine->decoded[address].next)
+        add_pending(address, is_pending, pending, &pending_count);
+    while (pending_count > 0)
+    {
+        address = pending[--pending_count];
+        if (machine->decoded[address].handler == HANDLER_DECODE)
+            predecode_address(machine, address);
+        instruction = &machine->decoded[address];
+        if (instruction->handler >= TOTAL_OPCODES)
+            continue; /* Invalid, the dispatch reports it */
+        is_translated[address] = 1;
+        for (i = 0; i < instruction->length; i++)
+            is_code[address + i] = 1;
+        if (instruction->handler != JMP_OPCODE && instruction->handler != RTS_OPCODE &&
+            instruction->handler != STOP_OPCODE)
+            add_pending(instruction->next, is_pending, pending, &pending_count);
+        if ((instruction->handler == JMP_OPCODE || instruction->handler == BNE_OPCODE ||
+             instruction->handler == JSR_OPCODE) &&
+            instruction->destination.kind == OPERAND_CELL && instruction->destination.location < MACHINE_MEMORY_SIZE)
+            add_pending(instruction->destination.location, is_pending, pending, &pending_count);
+    }
+}
+
+/* Finds the labels and variables that the translated instructions use, so the translation declares only those */
+static void find_uses(Machine *machine, unsigned char *is_translated, Translation_Uses *uses)
+{
+    Decoded_Instruction *instruction;
+    int address, handler;
+
+    memset(uses, 0, sizeof(Translation_Uses));
+    for (address = 0; address < MACHINE_MEMORY_SIZE; address++)
+    {
+        if (!is_translated[address])
+            continue;
+        instruction = &machine->decoded[address];
+        handler = instruction->handler;
+        uses->is_a1_used |= instruction->source.kind == OPERAND_MATRIX;
+        uses->is_a2_used |= instruction->destination.kind == OPERAND_MATRIX;
+        /* The instructions that write their destination check it against the code */
+        if (instruction->destination.kind == OPERAND_MATRIX && handler != CMP_OPCODE && handler != PRN_OPCODE &&
+            handler != JMP_OPCODE && handler != BNE_OPCODE && handler != JSR_OPCODE)
+            uses->is_code_used = 1;
+        if (handler == RED_OPCODE)
+            uses->is_character_used = 1;
+        else if (handler == STOP_OPCODE)
+            uses->is_finished_used = 1;
+        else if (handler == RTS_OPCODE)
+            uses->is_dispatch_used = 1;
+        if (handler == JMP_OPCODE || handler == BNE_OPCODE || handler == JSR_OPCODE || handler == RTS_OPCODE)
+            uses->is_limit_used = uses->is_finished_used = 1;
+        if ((handler == JMP_OPCODE || handler == BNE_OPCODE || handler == JSR_OPCODE) &&
+            (instruction->destination.kind != OPERAND_CELL ||
+             !is_direct_jump(instruction->destination.location, is_translated)))
+            uses->is_dispatch_used = 1;
+        if (handler != JMP_OPCODE && handler != JSR_OPCODE && handler != RTS_OPCODE && handler != STOP_OPCODE &&
+            !is_direct_jump(instruction->next, is_translated))
+            uses->is_dispatch_used = 1;
+    }
+}
+
+/* Writes a static array of a C type with one value per memory word */
+static void write_array(char *declaration, unsigned short *words, unsigned char *flags, int count, FILE *file)
+{
+    int i;
+
+    fprintf(file, "%s = {", declaration);
+    for (i = 0; i < count; i++)
+        fprintf(file, "%s%s%d", i == 0 ? "" : ",", i % 16 == 0 ? "\n    " : " ", words != NULL ? words[i] : flags[i]);
+    fputs("};\n", file);
+}
+
+int translate_program(Machine *machine, char *program_name, FILE *file)
+{
+    unsigned char is_translated[MACHINE_MEMORY_SIZE], is_code[MACHINE_MEMORY_SIZE];
+    int i, address, translated_count = 0;
+    char declaration[MAX_EXPRESSION_LENGTH * 4];
+    Translation_Uses uses;
+
+    memset(is_translated, 0, sizeof(is_translated));
+    memset(is_code, 0, sizeof(is_code));
+    find_instructions(machine, is_translated, is_code);
+    find_uses(machine, is_translated, &uses);
+
+    fprintf(file, "/* C translation of the program \"%s\", written by the translator */\n", program_name);
+    for (i = 0; prologue[i] != NULL; i++)
+        fprintf(file, "%s\n", prologue[i]);
+    if (uses.is_limit_used)
+        fprintf(file, "#include <stdlib.h>\n#define CHECK_LIMIT(address) \\\n    do { if (executed >= limit) "
+                "{ pc = (address); status = %d; goto finished; } } while (0)\n\n", MACHINE_STEP_LIMIT);
+    sprintf(declaration, "static unsigned short m[%d]", MACHINE_CELLS_COUNT);
+    write_array(declaration, machine->cells, NULL, MACHINE_CELLS_COUNT, file);
+    if (uses.is_code_used)
+    {
+        sprintf(declaration, "static const unsigned char is_code[%d]", MACHINE_MEMORY_SIZE);
+        write_array(declaration, NULL, is_code, MACHINE_MEMORY_SIZE, file);
+    }
+    fprintf(file, "static unsigned short stack[%d];\n\n", MACHINE_STACK_DEPTH);
+
+    fputs("int main(int argc, char *argv[])\n{\n", file);
+    fputs("    unsigned r0 = 0, r1 = 0, r2 = 0, r3 = 0, r4 = 0, r5 = 0, r6 = 0, r7 = 0;\n", file);
+    fprintf(file, "    int pc = %d, sp = 0, z = 0, status = %d, fault = 0, %s%s%si;\n", machine->pc, MACHINE_HALTED,
+            uses.is_a1_used ? "a1 = 0, " : "", uses.is_a2_used ? "a2 = 0, " : "",
+            uses.is_character_used ? "character, " : "");
+    fprintf(file, "    unsigned long executed = 0%s;\n    FILE *state;\n", uses.is_limit_used ? ", limit" : "");
+    if (uses.is_limit_used)  /* The second argument is the step limit, 0 or none for no limit */
+        fputs("    limit = argc > 2 && strtoul(argv[2], NULL, 10) > 0 ? strtoul(argv[2], NULL, 10) : (unsigned long)-1;\n",
+              file);
+    fputs("\n", file);
+    fprintf(file, "%s    switch (pc)\n    {\n", uses.is_dispatch_used ? "dispatch:\n" : "");
+    for (address = 0; address < MACHINE_MEMORY_SIZE; address++)
+    {
+        if (is_translated[address])
+            fprintf(file, "    case %d: goto L_%d;\n", address, address);
+    }
+    fprintf(file, "    default:\n        executed++;\n        FAULT(pc, pc >= %d ? %d : %d);\n    }\n",
+            MACHINE_MEMORY_SIZE, Error_401, Error_400);
+
+    for (address = 0; address < MACHINE_MEMORY_SIZE; address++)
+    {
+        if (is_translated[address])
+        {
+            write_instruction(&machine->decoded[address], address, is_code, is_translated, file);
+            translated_count++;
+        }
+    }
+
+    fprintf(file, "faulted:\n    status = %d;\n    fflush(stdout);\n", MACHINE_FAULTED);
+    fputs("    fprintf(stderr, \" Address %d ERROR (CODE_%d)\\n\", pc, fault);\n", file);
+    if (uses.is_finished_used)
+        fputs("finished:\n", file);
+    for (i = 0; i < TOTAL_REGISTERS; i++)
+        fprintf(file, "    m[%d] = r%d;\n", REGISTER_CELL(i), i);
+    fputs("    if (argc > 1 && (state = fopen(argv[1], \"w\")) != NULL)\n    {\n        fprintf(state, \"", file);
+    write_escaped(STATE_HEADER_FORMAT, file);
+    fputs("\", status, fault, pc, executed, z, sp);\n        fputs(\"cells\", state);\n", file);
+    fprintf(file, "        for (i = 0; i < %d; i++)\n            fprintf(state, \"%s\", m[i]);\n",
+            MACHINE_CELLS_COUNT, STATE_VALUE_FORMAT);
+    fputs("        fputs(\"\\nstack\", state);\n        for (i = 0; i < sp; i++)\n", file);
+    fprintf(file, "            fprintf(state, \"%s\", stack[i]);\n", STATE_VALUE_FORMAT);
+    fputs("        fputs(\"\\n\", state);\n        fclose(state);\n    }\n", file);
+    fprintf(file, "    return status == %d ? 0 : 1;\n}\n", MACHINE_HALTED);
+    return translated_count;
+}
+
+void write_machine_state(Machine *machine, FILE *file)
+{
+    int i;
+
+    fprintf(file, STATE_HEADER_FORMAT, machine->status, machine->fault, machine->pc, machine->executed,
+            machine->zero_flag, machine->sp);
+    fputs("cells", file);
+    for (i = 0; i < MACHINE_CELLS_COUNT; i++)
+        fprintf(file, STATE_VALUE_FORMAT, machine->cells[i]);
+    fputs("\nstack", file);
+    for (i = 0; i < machine->sp; i++)
+        fprintf(file, STATE_VALUE_FORMAT, machine->stack[i]);
+    fputs("\n", file);
+}
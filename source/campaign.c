@@ -0,0 +1,461 @@
+/**
+ * This file runs the jobs of campaigns on a pool of workers that steal jobs from each other.
+ * The programs are loaded before the workers start, and the workers only read them.
+ */
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L /* POSIX threads are not part of ANSI C */
+#define CAMPAIGN_USE_THREADS
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "campaign.h"
+#include "object_reader.h"
+#include "machine.h"
+#include "interpreter.h"
+#include "error_handler.h"
+#include "utils.h"
+#include "definitions.h"
+
+#ifdef CAMPAIGN_USE_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#define LOCK_WORKER(worker) pthread_mutex_lock(&(worker)->lock)
+#define UNLOCK_WORKER(worker) pthread_mutex_unlock(&(worker)->lock)
+#else
+#define LOCK_WORKER(worker)
+#define UNLOCK_WORKER(worker)
+#endif
+
+#define MAX_MANIFEST_LINE_LENGTH 1024
+#define MANIFEST_SEPARATORS " \t\r\n"
+#define MAX_WORKERS 256
+#define WORKER_BUFFER_SIZE 65536 /* Output buffer of a worker, the output of most jobs never leaves it */
+
+/* Campaign job struct definition */
+typedef struct Campaign_Job {
+    char *program_name;
+    char *input_name;
+    char *expected_name;
+    Machine *program;      /* The loaded program, shared by the jobs that run it */
+    int status;            /* Status of the machine after the run, -1 if the job could not run */
+    int error;             /* Code of the runtime error, or of the file error that stopped the job */
+    int pc;
+    int is_passed;
+    unsigned long executed;
+} Campaign_Job;
+
+/* Campaign program struct definition */
+typedef struct Campaign_Program {
+    char *name;
+    Machine *machine;
+} Campaign_Program;
+
+/* Worker struct definition */
+typedef struct Worker {
+    struct Campaign *campaign;
+    int index;
+    int begin;             /* The jobs of the worker that were not taken yet are begin to end */
+    int end;
+    int jobs_run;
+    int jobs_stolen;
+    FILE *output;          /* Output of the running job */
+    char *buffer;          /* Buffer of the output file */
+    Machine machine;       /* Machine of the running job, a copy of its loaded program */
+#ifdef CAMPAIGN_USE_THREADS
+    pthread_t thread;
+    pthread_mutex_t lock;
+    int is_started;
+#endif
+} Worker;
+
+/* Campaign struct definition */
+typedef struct Campaign {
+    Campaign_Job *jobs;
+    int jobs_count;
+    Campaign_Program *programs;
+    int programs_count;
+    Worker *workers;
+    int workers_count;
+    unsigned long max_steps;
+} Campaign;
+
+/* Copies a string into tracked memory, returns NULL if memory allocation failed */
+static char *copy_string(char *string)
+{
+    char *copy = (char *)allocate_memory(strlen(string) + 1);
+
+    if (copy != NULL)
+        strcpy(copy, string);
+    return copy;
+}
+
+/* Returns the loaded machine of a program, loading it on its first use, or NULL if it could not be loaded */
+static Machine *find_program(Campaign *campaign, char *name)
+{
+    Campaign_Program *resized;
+    Object_Module *module;
+    Machine *machine;
+    int i;
+
+    for (i = 0; i < campaign->programs_count; i++)
+    {
+        if (strcmp(campaign->programs[i].name, name) == 0)
+            return campaign->programs[i].machine;
+    }
+    if ((module = read_object_module(name)) == NULL)
+        return NULL;
+    machine = (Machine *)malloc(sizeof(Machine));
+    resized = (Campaign_Program *)realloc(campaign->programs, (campaign->programs_count + 1) * sizeof(Campaign_Program));
+    if (machine == NULL || resized == NULL)
+    {
+        log_system_error(Error_101);
+        free(machine);
+        free_object_module(module);
+        return NULL;
+    }
+    campaign->programs = resized;
+    if (load_machine(machine, module) != 0)
+    {
+        free(machine);
+        free_object_module(module);
+        return NULL;
+    }
+    free_object_module(module);
+    machine->is_quiet = 1; /* The summary reports the runtime errors of the jobs */
+    campaign->programs[campaign->programs_count].name = name;
+    campaign->programs[campaign->programs_count++].machine = machine;
+    return machine;
+}
+
+/* Reads the jobs of a manifest and loads their programs, returns 1 if errors were detected */
+static int read_manifest(Campaign *campaign, char *manifest_name)
+{
+    char line[MAX_MANIFEST_LINE_LENGTH], *fields[3];
+    FILE *file = fopen(manifest_name, "r");
+    Campaign_Job *resized, *job;
+    int i, line_number = 0, capacity = 0;
+
+    if (file == NULL)
+    {
+        printf(" File \"%s\"", manifest_name);
+        log_system_error(Error_103);
+        return 1; /* Indicates failure */
+    }
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        line_number++;
+        if ((fields[0] = strtok(line, MANIFEST_SEPARATORS)) == NULL)
+            continue;
+        fields[1] = strtok(NULL, MANIFEST_SEPARATORS);
+        fields[2] = strtok(NULL, MANIFEST_SEPARATORS);
+        if (fields[2] == NULL || strtok(NULL, MANIFEST_SEPARATORS) != NULL)
+        {
+            log_syntax_error(Error_109, manifest_name, line_number);
+            fclose(file);
+            return 1; /* Indicates failure */
+        }
+        if (campaign->jobs_count == capacity)
+        {
+            capacity = capacity == 0 ? MAX_WORKERS : capacity * 2;
+            if ((resized = (Campaign_Job *)realloc(campaign->jobs, capacity * sizeof(Campaign_Job))) == NULL)
+            {
+                log_system_error(Error_101);
+                fclose(file);
+                return 1; /* Indicates failure */
+            }
+            campaign->jobs = resized;
+        }
+        job = &campaign->jobs[campaign->jobs_count];
+        memset(job, 0, sizeof(Campaign_Job));
+        for (i = 0; i < 3; i++)
+        {
+            if ((fields[i] = copy_string(fields[i])) == NULL)
+            {
+                fclose(file);
+                return 1; /* Indicates failure */
+            }
+        }
+        job->program_name = fields[0];
+        job->input_name = fields[1];
+        job->expected_name = fields[2];
+        if ((job->program = find_program(campaign, job->program_name)) == NULL)
+        {
+            printf(" Manifest \"%s\" - Line %d: program \"%s\" could not be loaded\n", manifest_name, line_number,
+                   job->program_name);
+            fclose(file);
+            return 1; /* Indicates failure */
+        }
+        campaign->jobs_count++;
+    }
+    fclose(file);
+    return 0; /* Indicates success */
+}
+
+/* Reads a whole file, returns NULL if it could not be read */
+static unsigned char *read_whole_file(char *file_name, unsigned long *size)
+{
+    FILE *file = fopen(file_name, "rb");
+    unsigned char *contents;
+
+    if (file == NULL)
+        return NULL;
+    contents = read_program_input(file, size);
+    fclose(file);
+    return contents;
+}
+
+/* Checks if the output a worker wrote for its job is the same as the expected output */
+static int is_expected_output(Worker *worker, unsigned char *expected, unsigned long expected_size)
+{
+    char chunk[INPUT_CHUNK_SIZE];
+    unsigned long size = (unsigned long)ftell(worker->output), offset = 0, length;
+
+    if (size != expected_size)
+        return 0;
+    fflush(worker->output);
+    rewind(worker->output);
+    while (offset < size)
+    {
+        length = size - offset < sizeof(chunk) ? size - offset : sizeof(chunk);
+        if (fread(chunk, 1, length, worker->output) != length || memcmp(chunk, expected + offset, length) != 0)
+            return 0;
+        offset += length;
+    }
+    return 1;
+}
+
+/* Runs a job on a worker and records its result */
+static void run_job(Worker *worker, Campaign_Job *job)
+{
+    unsigned long input_size, expected_size;
+    unsigned char *input = read_whole_file(job->input_name, &input_size);
+    unsigned char *expected = read_whole_file(job->expected_name, &expected_size);
+    Machine *machine = &worker->machine;
+
+    job->status = -1;
+    if (input == NULL || expected == NULL)
+        job->error = Error_103;
+    else
+    {
+        memcpy(machine, job->program, sizeof(Machine));
+        machine->input = input;
+        machine->input_size = input_size;
+        machine->output = worker->output;
+        rewind(worker->output);
+        job->status = run_machine(machine, worker->campaign->max_steps);
+        job->error = machine->fault;
+        job->pc = machine->pc;
+        job->executed = machine->executed;
+        job->is_passed = is_expected_output(worker, expected, expected_size) && job->status == MACHINE_HALTED;
+    }
+    worker->jobs_run++;
+    free(input);
+    free(expected);
+}
+
+/* Takes the next job of a worker, stealing half of the jobs left by another worker when it has none.
+   Returns the index of the job, or -1 when no job is left */
+static int take_job(Worker *worker)
+{
+    Campaign *campaign = worker->campaign;
+    Worker *victim;
+    int i, job = -1, count;
+
+    LOCK_WORKER(worker);
+    if (worker->begin < worker->end)
+        job = worker->begin++;
+    UNLOCK_WORKER(worker);
+    for (i = 1; job == -1 && i < campaign->workers_count; i++)
+    {
+        victim = &campaign->workers[(worker->index + i) % campaign->workers_count];
+        LOCK_WORKER(victim);
+        count = (victim->end - victim->begin + 1) / 2; /* Half of the jobs left, rounded up */
+        victim->end -= count;
+        job = count > 0 ? victim->end : -1;
+        UNLOCK_WORKER(victim);
+        if (count > 0)
+        { /* The first stolen job runs now, the others join the range of the worker */
+            LOCK_WORKER(worker);
+            worker->begin = job + 1;
+            worker->end = job + count;
+            UNLOCK_WORKER(worker);
+            worker->jobs_stolen += count;
+        }
+    }
+    return job;
+}
+
+/* Runs jobs on a worker until no job is left */
+static void *work(void *argument)
+{
+    Worker *worker = (Worker *)argument;
+    int job;
+
+    while ((job = take_job(worker)) != -1)
+        run_job(worker, &worker->campaign->jobs[job]);
+    return NULL;
+}
+
+/* Returns the number of online processors of the host, 1 if it is not known */
+static int processors_count(void)
+{
+#ifdef CAMPAIGN_USE_THREADS
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (count > 0)
+        return (int)count;
+#endif
+    return 1;
+}
+
+/* Returns the time in seconds, the wall clock time where it is available */
+static double current_time(void)
+{
+#ifdef CAMPAIGN_USE_THREADS
+    struct timespec now;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now) == 0)
+        return now.tv_sec + now.tv_nsec / 1e9;
+#endif
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+/* Creates the workers and divides the jobs between them, returns 1 if errors were detected */
+static int create_workers(Campaign *campaign, int workers_count)
+{
+    Worker *worker;
+    int i;
+
+    if (workers_count <= 0)
+        workers_count = processors_count();
+#ifndef CAMPAIGN_USE_THREADS
+    workers_count = 1;
+#endif
+    if (workers_count > MAX_WORKERS)
+        workers_count = MAX_WORKERS;
+    if (workers_count > campaign->jobs_count)
+        workers_count = campaign->jobs_count > 0 ? campaign->jobs_count : 1;
+    if ((campaign->workers = (Worker *)calloc(workers_count, sizeof(Worker))) == NULL)
+    {
+        log_system_error(Error_101);
+        return 1; /* Indicates failure */
+    }
+    for (i = 0; i < workers_count; i++)
+    {
+        worker = &campaign->workers[i];
+#ifdef CAMPAIGN_USE_THREADS
+        pthread_mutex_init(&worker->lock, NULL);
+#endif
+        campaign->workers_count++;
+        worker->campaign = campaign;
+        worker->index = i;
+        worker->begin = (int)((long)campaign->jobs_count * i / workers_count);
+        worker->end = (int)((long)campaign->jobs_count * (i + 1) / workers_count);
+        worker->buffer = (char *)malloc(WORKER_BUFFER_SIZE);
+        worker->output = tmpfile();
+        if (worker->buffer == NULL || worker->output == NULL)
+        {
+            log_system_error(worker->buffer == NULL ? Error_101 : Error_104);
+            return 1; /* Indicates failure */
+        }
+        setvbuf(worker->output, worker->buffer, _IOFBF, WORKER_BUFFER_SIZE);
+    }
+    return 0; /* Indicates success */
+}
+
+/* Runs all of the workers until the jobs are done */
+static void run_workers(Campaign *campaign)
+{
+    int i;
+
+#ifdef CAMPAIGN_USE_THREADS
+    /* The calling thread is the first worker, and runs the workers whose thread could not be created */
+    for (i = 1; i < campaign->workers_count; i++)
+        campaign->workers[i].is_started =
+            pthread_create(&campaign->workers[i].thread, NULL, work, &campaign->workers[i]) == 0;
+    work(&campaign->workers[0]);
+    for (i = 1; i < campaign->workers_count; i++)
+    {
+        if (campaign->workers[i].is_started)
+            pthread_join(campaign->workers[i].thread, NULL);
+        else
+            work(&campaign->workers[i]);
+    }
+#else
+    for (i = 0; i < campaign->workers_count; i++)
+        work(&campaign->workers[i]);
+#endif
+}
+
+/* Prints the failed jobs and the totals of a campaign, returns the number of failed jobs */
+static int report_campaign(Campaign *campaign, double seconds, int show_statistics)
+{
+    Campaign_Job *job;
+    unsigned long executed = 0;
+    int i, failed_count = 0;
+
+    for (i = 0; i < campaign->jobs_count; i++)
+    {
+        job = &campaign->jobs[i];
+        executed += job->executed;
+        if (job->is_passed)
+            continue;
+        failed_count++;
+        printf("FAIL %s %s: ", job->program_name, job->input_name);
+        if (job->status == -1)
+            printf("an input or expected output file could not be read\n");
+        else if (job->status == MACHINE_FAULTED)
+            printf("runtime error %d at address %d\n", job->error, job->pc);
+        else if (job->status == MACHINE_STEP_LIMIT)
+            printf("step limit reached at address %d\n", job->pc);
+        else
+            printf("output differs from \"%s\"\n", job->expected_name);
+    }
+    printf("Campaign: %d jobs, %d passed, %d failed, %d programs, %lu instructions in %.3f seconds with %d workers\n",
+           campaign->jobs_count, campaign->jobs_count - failed_count, failed_count, campaign->programs_count,
+           executed, seconds, campaign->workers_count);
+    for (i = 0; show_statistics && i < campaign->workers_count; i++)
+        printf("  Worker %d: %d jobs, %d stolen\n", i, campaign->workers[i].jobs_run, campaign->workers[i].jobs_stolen);
+    return failed_count;
+}
+
+/* Frees the memory of a campaign that is not tracked */
+static void free_campaign(Campaign *campaign)
+{
+    int i;
+
+    for (i = 0; campaign->workers != NULL && i < campaign->workers_count; i++)
+    {
+        if (campaign->workers[i].output != NULL)
+            fclose(campaign->workers[i].output);
+        free(campaign->workers[i].buffer);
+#ifdef CAMPAIGN_USE_THREADS
+        pthread_mutex_destroy(&campaign->workers[i].lock);
+#endif
+    }
+    for (i = 0; i < campaign->programs_count; i++)
+        free(campaign->programs[i].machine);
+    free(campaign->workers);
+    free(campaign->programs);
+    free(campaign->jobs);
+}
+
+int run_campaign(char *manifest_name, int workers_count, unsigned long max_steps, int show_statistics)
+{
+    Campaign campaign;
+    double start;
+    int result = 1;
+
+    memset(&campaign, 0, sizeof(Campaign));
+    campaign.max_steps = max_steps;
+    if (read_manifest(&campaign, manifest_name) == 0 && create_workers(&campaign, workers_count) == 0)
+    {
+        start = current_time();
+        run_workers(&campaign);
+        result = report_campaign(&campaign, current_time() - start, show_statistics) == 0 ? 0 : 1;
+    }
+    free_campaign(&campaign);
+    return result;
+}
@@ -0,0 +1,145 @@
+/**
+ * This file computes the coverage of the runs of a program and writes its report.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "coverage.h"
+#include "basic_blocks.h"
+#include "machine.h"
+#include "symbol_file.h"
+#include "error_handler.h"
+#include "utils.h"
+#include "definitions.h"
+
+/* Checks if the bit of a word is set */
+#define IS_COVERED(coverage, word) (((coverage)->words[(word) / 8] >> ((word) % 8)) & 1)
+
+void add_coverage(Coverage *coverage, Machine *machine, const unsigned long *runs)
+{
+    Decoded_Instruction instruction;
+    int address, word;
+
+    for (address = machine->code_start; address < machine->code_end; address = instruction.next)
+    {
+        decode_instruction(machine->cells, address, &instruction);
+        if (runs[address] == 0)
+            continue;
+        coverage->runs[address] += runs[address];
+        for (word = address; word < instruction.next && word < MACHINE_MEMORY_SIZE; word++)
+            coverage->words[word / 8] |= (unsigned char)(1 << (word % 8));
+    }
+}
+
+/* Writes the .am file with the runs of every instruction in front of its line */
+static int write_source_report(Coverage *coverage, int *lines, FILE *report, char *base_name)
+{
+    char line[MAX_SOURCE_LINE_LENGTH + 2], count[TEMP_CONVERSION_BUFFER_SIZE];
+    char *file_am_name = add_extension(base_name, ".am");
+    int address, line_num = 1, max_line = 0, *line_addresses, is_line_start = 1;
+    FILE *file_am = file_am_name == NULL ? NULL : fopen(file_am_name, "r");
+
+    if (file_am == NULL)
+    {
+        printf(" File \"%s\"", file_am_name == NULL ? base_name : file_am_name);
+        log_system_error(Error_103);
+        clean_memory(file_am_name);
+        return 1; /* Indicates failure */
+    }
+    for (address = 0; address < MACHINE_MEMORY_SIZE; address++)
+    {
+        if (lines[address] > max_line)
+            max_line = lines[address];
+    }
+    if ((line_addresses = (int *)malloc((max_line + 1) * sizeof(int))) == NULL)
+    {
+        log_system_error(Error_101);
+        fclose(file_am);
+        clean_memory(file_am_name);
+        return 1; /* Indicates failure */
+    }
+    for (address = 0; address <= max_line; address++)
+        line_addresses[address] = -1;
+    for (address = 0; address < MACHINE_MEMORY_SIZE; address++)
+    {
+        if (lines[address] > 0)
+            line_addresses[lines[address]] = address;
+    }
+    while (fgets(line, sizeof(line), file_am) != NULL)
+    {
+        if (is_line_start)
+        {
+            address = line_num <= max_line ? line_addresses[line_num] : -1;
+            if (address == -1)
+                strcpy(count, "-");
+            else if (coverage->runs[address] == 0)
+                strcpy(count, COVERAGE_NOT_RUN);
+            else
+                sprintf(count, "%lu", coverage->runs[address]);
+            fprintf(report, "%10s:%5d:", count, line_num);
+        }
+        fputs(line, report);
+        /* A line longer than the buffer is read in parts */
+        if ((is_line_start = strchr(line, '\n') != NULL))
+            line_num++;
+    }
+    if (!is_line_start)
+        fputc('\n', report);
+    free(line_addresses);
+    fclose(file_am);
+    clean_memory(file_am_name);
+    return 0; /* Indicates success */
+}
+
+int write_coverage(Coverage *coverage, Machine *machine, char *base_name)
+{
+    Basic_Block blocks[MACHINE_MEMORY_SIZE];
+    Decoded_Instruction instruction;
+    int lines[MACHINE_MEMORY_SIZE], address, words_run = 0, instructions_count = 0, instructions_run = 0;
+    int i, blocks_count = find_basic_blocks(machine, blocks), blocks_run = 0, lines_count, result = 0;
+    int code_words = machine->code_end - machine->code_start;
+    char *file_cov_name;
+    FILE *report;
+
+    for (address = machine->code_start; address < machine->code_end; address++)
+        words_run += IS_COVERED(coverage, address);
+    for (address = machine->code_start; address < machine->code_end; address = instruction.next)
+    {
+        decode_instruction(machine->cells, address, &instruction);
+        instructions_count++;
+        instructions_run += coverage->runs[address] > 0;
+    }
+    for (i = 0; i < blocks_count; i++)
+        blocks_run += coverage->runs[blocks[i].start] > 0;
+    printf("Coverage: %d of %d code words (%.2f%%), %d of %d instructions, %d of %d basic blocks\n", words_run,
+           code_words, code_words > 0 ? 100.0 * words_run / code_words : 0.0, instructions_run, instructions_count,
+           blocks_run, blocks_count);
+
+    if ((lines_count = read_line_map(base_name, lines, MACHINE_MEMORY_SIZE)) == -1)
+        return 1; /* Indicates failure */
+    if ((file_cov_name = add_extension(base_name, ".cov")) == NULL)
+        return 1; /* Indicates failure */
+    if ((report = fopen(file_cov_name, "w")) == NULL)
+    {
+        printf(" File \"%s\"", file_cov_name);
+        log_system_error(Error_104);
+        clean_memory(file_cov_name);
+        return 1; /* Indicates failure */
+    }
+    if (lines_count > 0)
+        result = write_source_report(coverage, lines, report, base_name);
+    else
+    { /* Without the line map, the instructions are listed by address */
+        for (address = machine->code_start; address < machine->code_end; address = instruction.next)
+        {
+            decode_instruction(machine->cells, address, &instruction);
+            if (coverage->runs[address] == 0)
+                fprintf(report, "%10s:%5d\n", COVERAGE_NOT_RUN, address);
+            else
+                fprintf(report, "%10lu:%5d\n", coverage->runs[address], address);
+        }
+    }
+    fclose(report);
+    clean_memory(file_cov_name);
+    return result;
+}
@@ -0,0 +1,90 @@
+/**
+ * This file removes the unused data blocks of the module.
+ * The uses of the data labels are the operand labels the first pass added for the second pass, so the data is
+ * removed before the second pass codes them.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "dead_data.h"
+#include "labels_handler.h"
+#include "definitions.h"
+
+/* 1 for each data word that starts a block whose label is used */
+static int is_used[MAX_ARRAY_CAPACITY];
+/* 1 for each data word that starts a block */
+static int is_block_start[MAX_ARRAY_CAPACITY];
+/* The position of each data word after the data is moved together, -1 for the removed words */
+static int positions[MAX_ARRAY_CAPACITY];
+
+/* Checks if an operand uses a label, directly or as the base of a matrix, returns 1 if it does */
+static int is_operand_of(char *operand, char *name)
+{
+    int length = strlen(name);
+
+    if (strncmp(operand, name, length) != 0)
+        return 0;
+    for (operand += length; isspace((unsigned char)*operand); operand++)
+        ;
+    return *operand == STRING_TERMINATOR || *operand == LEFT_BRACKET;
+}
+
+/* Checks if a data label is an ".entry" label or an operand of an instruction, returns 1 if it is */
+static int is_label_used(Label *label)
+{
+    Label *operand;
+
+    if (label->type == ENTRY)
+        return 1;
+    for (operand = point_label_head(); operand != NULL; operand = operand->next)
+    {
+        if (operand->type == OPERAND && is_operand_of(operand->name, label->name))
+            return 1;
+    }
+    return 0;
+}
+
+void remove_dead_data(unsigned short *data, int *DC)
+{
+    Label *label, *next;
+    int i, is_kept = 1, new_DC = 0, labels_count = 0;
+
+    for (i = 0; i < *DC; i++)
+    {
+        is_used[i] = 0;
+        is_block_start[i] = 0;
+    }
+    for (label = point_label_head(); label != NULL; label = label->next)
+    {
+        if (label->type != OPERAND && label->location == DATA && label->address >= 0 && label->address < *DC)
+        {
+            is_block_start[label->address] = 1;
+            is_used[label->address] |= is_label_used(label);
+        }
+    }
+    /* The unlabeled words belong to the block before them */
+    for (i = 0; i < *DC; i++)
+    {
+        if (is_block_start[i])
+            is_kept = is_used[i];
+        positions[i] = is_kept ? new_DC : -1;
+        if (is_kept)
+            data[new_DC++] = data[i];
+    }
+    for (label = point_label_head(); label != NULL; label = next)
+    {
+        next = label->next;
+        if (label->type == OPERAND || label->location != DATA || label->address < 0 || label->address >= *DC)
+            continue;
+        if (positions[label->address] == -1)
+        {
+            printf("Removed unused data label \"%s\"\n", label->name);
+            labels_count++;
+            remove_label(label);
+        }
+        else
+            label->address = positions[label->address];
+    }
+    printf("Dead data elimination removed %d labels and %d words\n", labels_count, *DC - new_DC);
+    *DC = new_DC;
+}
@@ -0,0 +1,187 @@
+/**
+ * This file runs programs on the reference interpreter and an engine under test in lockstep and reports where they
+ * diverge.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "differential.h"
+#include "interpreter.h"
+#include "jit.h"
+#include "machine.h"
+#include "validator.h"
+#include "error_handler.h"
+#include "definitions.h"
+
+/* Size of the chunks that the outputs are compared in */
+#define OUTPUT_CHUNK_SIZE 512
+
+/* Runs both machines through the next slice of the program, returns 1 if the program goes on after it */
+static int run_slice(Machine *reference, Machine *engine, int is_jit, unsigned long steps, unsigned long limit)
+{
+    unsigned long target;
+
+    if (limit > 0 && limit - engine->executed < steps)
+        steps = limit - engine->executed;
+    if (is_jit)
+        run_jit(engine, steps);
+    else
+        run_machine(engine, steps);
+    /* The reference stops at the first control transfer at or after the instruction count of the engine */
+    target = engine->executed > reference->executed ? engine->executed - reference->executed : 1;
+    run_machine(reference, target);
+    if (engine->status == MACHINE_STEP_LIMIT && (limit == 0 || engine->executed < limit))
+        engine->status = MACHINE_RUNNING;
+    if (reference->status == MACHINE_STEP_LIMIT && (limit == 0 || reference->executed < limit))
+        reference->status = MACHINE_RUNNING;
+    return engine->status == MACHINE_RUNNING && reference->status == MACHINE_RUNNING;
+}
+
+/* Compares the outputs that two files got from an offset on, returns 1 if they are the same */
+static int is_same_output_from(FILE *first, FILE *second, long offset)
+{
+    char first_chunk[OUTPUT_CHUNK_SIZE], second_chunk[OUTPUT_CHUNK_SIZE];
+    size_t first_length, second_length;
+    int is_same = 1;
+
+    fflush(first);
+    fflush(second);
+    fseek(first, offset, SEEK_SET);
+    fseek(second, offset, SEEK_SET);
+    do
+    {
+        first_length = fread(first_chunk, 1, OUTPUT_CHUNK_SIZE, first);
+        second_length = fread(second_chunk, 1, OUTPUT_CHUNK_SIZE, second);
+        is_same = first_length == second_length && memcmp(first_chunk, second_chunk, first_length) == 0;
+    } while (is_same && first_length == OUTPUT_CHUNK_SIZE);
+    fseek(first, 0, SEEK_END);
+    fseek(second, 0, SEEK_END);
+    return is_same;
+}
+
+/* Checks if two machines reached the same state, with the same output since an offset of their output files */
+static int is_same_checkpoint(Machine *reference, Machine *engine, long offset)
+{
+    return reference->status == engine->status && reference->pc == engine->pc &&
+           reference->executed == engine->executed && reference->zero_flag == engine->zero_flag &&
+           reference->sp == engine->sp &&
+           memcmp(reference->stack, engine->stack, reference->sp * sizeof(unsigned short)) == 0 &&
+           memcmp(reference->cells, engine->cells, sizeof(reference->cells)) == 0 &&
+           (reference->status != MACHINE_FAULTED || reference->fault == engine->fault) &&
+           is_same_output_from(reference->output, engine->output, offset);
+}
+
+/* Prints the registers, flags and call stack of a machine */
+static void print_state(char *name, Machine *machine)
+{
+    int i;
+
+    printf("  %-9s status %d", name, machine->status);
+    if (machine->status == MACHINE_FAULTED)
+        printf(" (error %d)", machine->fault);
+    printf(", pc %d, executed %lu, zero flag %d\n", machine->pc, machine->executed, machine->zero_flag);
+    printf("  %-9s", "");
+    for (i = 0; i < TOTAL_REGISTERS; i++)
+        printf(" r%d=%d", i, SIGN_EXTEND_10_BITS(machine->cells[REGISTER_CELL(i)]));
+    printf("\n  %-9s stack [", "");
+    for (i = 0; i < machine->sp; i++)
+        printf(i > 0 ? " %d" : "%d", machine->stack[i]);
+    printf("]\n");
+}
+
+/* Reports the first block whose states differ, from the state of the reference before the block */
+static void report_divergence(Machine *before, Machine *reference, Machine *engine, long offset)
+{
+    InstructionDefinition *opcodes = retrieve_instruction_set();
+    unsigned long count = reference->executed - before->executed;
+    int i, address = before->pc;
+
+    printf(" Engines diverge in the block at address %d, after %lu instructions\n", before->pc, before->executed);
+    printf("  Block:");
+    for (; count > 0 && address <= MACHINE_MEMORY_SIZE; count--)
+    {
+        if (before->decoded[address].handler < TOTAL_OPCODES)
+            printf(" %d:%s", address, opcodes[before->decoded[address].handler].mnemonic);
+        else
+            printf(" %d:?", address);
+        address = before->decoded[address].next;
+    }
+    printf("\n");
+    print_state("reference", reference);
+    print_state("engine", engine);
+    for (i = 0; i < MACHINE_MEMORY_SIZE; i++)
+    {
+        if (reference->cells[i] != engine->cells[i])
+            printf("  Memory word %d: %d/%d\n", i, reference->cells[i], engine->cells[i]);
+    }
+    if (!is_same_output_from(reference->output, engine->output, offset))
+        printf("  The block wrote different outputs\n");
+}
+
+/* Runs both machines from a checkpoint one basic block at a time, and reports the first block that differs */
+static void find_divergence(Machine *reference, Machine *engine, int is_jit, unsigned long limit)
+{
+    Machine *before = (Machine *)malloc(sizeof(Machine));
+    FILE *reference_output = tmpfile(), *engine_output = tmpfile();
+    long offset;
+    int is_running = 1, is_same;
+
+    if (before == NULL || reference_output == NULL || engine_output == NULL)
+        log_system_error(before == NULL ? Error_101 : Error_104);
+    else
+    {
+        /* The output of the replay is compared from the checkpoint on */
+        reference->output = reference_output;
+        engine->output = engine_output;
+        do
+        {
+            memcpy(before, reference, sizeof(Machine));
+            offset = ftell(reference_output);
+            is_running = run_slice(reference, engine, is_jit, 1, limit);
+        } while ((is_same = is_same_checkpoint(reference, engine, offset)) && is_running);
+        if (is_same)
+            printf(" Engines diverged, but not when the slice ran again one block at a time\n");
+        else
+            report_divergence(before, reference, engine, offset);
+    }
+    if (reference_output != NULL)
+        fclose(reference_output);
+    if (engine_output != NULL)
+        fclose(engine_output);
+    free(before);
+}
+
+long run_differential(Machine *reference, Machine *engine, int is_jit, unsigned long interval,
+                      unsigned long max_steps)
+{
+    Machine *saved_reference = (Machine *)malloc(sizeof(Machine)), *saved_engine = (Machine *)malloc(sizeof(Machine));
+    FILE *reference_output = reference->output;
+    long checkpoints = 0, offset;
+    int is_running = 1;
+
+    if (saved_reference == NULL || saved_engine == NULL)
+    {
+        log_system_error(Error_101);
+        checkpoints = -1;
+    }
+    while (checkpoints != -1 && is_running)
+    {
+        memcpy(saved_reference, reference, sizeof(Machine));
+        memcpy(saved_engine, engine, sizeof(Machine));
+        offset = ftell(reference_output);
+        is_running = run_slice(reference, engine, is_jit, interval, max_steps);
+        if (is_same_checkpoint(reference, engine, offset))
+            checkpoints++;
+        else
+        {
+            if (interval > 1) /* The machines go back to the checkpoint before the difference */
+                find_divergence(saved_reference, saved_engine, is_jit, max_steps);
+            else
+                report_divergence(saved_reference, reference, engine, offset);
+            checkpoints = -1;
+        }
+    }
+    free(saved_reference);
+    free(saved_engine);
+    return checkpoints;
+}
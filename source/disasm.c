@@ -0,0 +1,212 @@
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L /* POSIX threads are not part of ANSI C */
+#define DISASM_USE_THREADS
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "error_handler.h"
+#include "object_reader.h"
+#include "disassembler.h"
+#include "symbol_file.h"
+#include "utils.h"
+#include "definitions.h"
+
+#ifdef DISASM_USE_THREADS
+#include <pthread.h>
+#endif
+
+#define MAX_DISASM_THREADS 64
+#define COPY_CHUNK_SIZE 4096
+
+/* Disassembly job struct definition - a module, and the file its source is written to */
+typedef struct Disasm_Job {
+    Object_Module *module;
+    Program_Symbol *symbols;
+    int symbols_count;
+    FILE *output;
+    int invalid_count;   /* Code words that are not instructions, -1 if the disassembly failed */
+} Disasm_Job;
+
+/* Disassembly worker struct definition - a range of jobs */
+typedef struct Disasm_Worker {
+    Disasm_Job *jobs;
+    int begin;
+    int end;
+#ifdef DISASM_USE_THREADS
+    pthread_t thread;
+    int is_started;
+#endif
+} Disasm_Worker;
+
+/**
+ * Disassembles the modules of a range of jobs.
+ * @argument: Pointer to the worker of the range.
+ * return NULL.
+ */
+static void *disassemble_range(void *argument)
+{
+    Disasm_Worker *worker = (Disasm_Worker *)argument;
+    Disasm_Job *job;
+    int i;
+
+    for (i = worker->begin; i < worker->end; i++) {
+        job = &worker->jobs[i];
+        job->invalid_count = disassemble_module(job->module, job->symbols, job->symbols_count, job->output);
+    }
+    return NULL;
+}
+
+/**
+ * Divides the jobs into ranges and disassembles them, each range in a thread when there is more than one.
+ * @jobs: The jobs.
+ * @count: The number of jobs.
+ * @threads_count: The number of threads.
+ */
+static void run_jobs(Disasm_Job *jobs, int count, int threads_count)
+{
+    Disasm_Worker workers[MAX_DISASM_THREADS];
+    int i;
+
+#ifndef DISASM_USE_THREADS
+    threads_count = 1;
+#endif
+    if (threads_count > MAX_DISASM_THREADS)
+        threads_count = MAX_DISASM_THREADS;
+    if (threads_count > count)
+        threads_count = count;
+    if (threads_count == 0)
+        return;
+    for (i = 0; i < threads_count; i++) {
+        workers[i].jobs = jobs;
+        workers[i].begin = (int)((long)count * i / threads_count);
+        workers[i].end = (int)((long)count * (i + 1) / threads_count);
+    }
+#ifdef DISASM_USE_THREADS
+    /* The calling thread takes the first range, and the ranges whose thread could not be created */
+    for (i = 1; i < threads_count; i++)
+        workers[i].is_started = pthread_create(&workers[i].thread, NULL, disassemble_range, &workers[i]) == 0;
+    disassemble_range(&workers[0]);
+    for (i = 1; i < threads_count; i++) {
+        if (workers[i].is_started)
+            pthread_join(workers[i].thread, NULL);
+        else
+            disassemble_range(&workers[i]);
+    }
+#else
+    for (i = 0; i < threads_count; i++)
+        disassemble_range(&workers[i]);
+#endif
+}
+
+/**
+ * Copies the contents of a file to the standard output.
+ * @file: The file, read from its start.
+ */
+static void copy_to_output(FILE *file)
+{
+    char chunk[COPY_CHUNK_SIZE];
+    size_t length;
+
+    rewind(file);
+    while ((length = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        fwrite(chunk, 1, length, stdout);
+}
+
+/**
+ * This is the main function of the disassembler, it prints assembled modules back as source in the layout of the .am
+ * file. Each module is given by its name without an extension, and is loaded from its output files (.ob, .ent, .ext,
+ * and .sym when the module was assembled with "--symbols").
+ * Instructions are decoded with the field layout of the assembler, and the labels come from the entry, external and
+ * symbol files. The targets that have no name get a generated label ("L" and the address).
+ * The option "-t threads" divides the modules into ranges and disassembles each range in a thread (1 by default).
+ * The sources are printed in the order of the modules on the command line.
+ * argc: The number of command-line arguments.
+ * argv: An array of strings containing the command-line arguments.
+ * return Returns 0 if every module was loaded and all of its code words are instructions, 1 otherwise.
+ */
+
+int main(int argc, char *argv[]) {
+    int i, count = 0, loaded_count = 0, threads_count = 1, is_ready = 1, result = 0;
+    char **names;
+    Disasm_Job *jobs, *job;
+
+    names = (char **)calloc(argc, sizeof(char *));
+    jobs = (Disasm_Job *)calloc(argc, sizeof(Disasm_Job));
+    if (names == NULL || jobs == NULL) {
+        log_system_error(Error_101);
+        free(names);
+        free(jobs);
+        return 1;  /* Indicates faliure */
+    }
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0) {
+            if (++i == argc) {
+                log_system_error(Error_107);
+                free(names);
+                free(jobs);
+                return 1;  /* Indicates faliure */
+            }
+            threads_count = atoi(argv[i]) > 0 ? atoi(argv[i]) : 1;
+        }
+        else if (argv[i][0] == MINUS_SIGN) {
+            printf(" Unrecognized option \"%s\"", argv[i]);
+            log_system_error(Error_106);
+            free(names);
+            free(jobs);
+            return 1;  /* Indicates faliure */
+        }
+        else
+            names[count++] = argv[i];
+    }
+    if (count == 0) {  /* Checking if no module was entered */
+        log_system_error(Error_100);
+        free(names);
+        free(jobs);
+        return 1;  /* Indicates faliure */
+    }
+    /* The modules are loaded before the threads start, the threads only read them */
+    for (i = 0; i < count && is_ready; i++) {
+        job = &jobs[loaded_count];
+        if ((job->module = read_object_module(names[i])) == NULL ||
+            read_symbol_file(names[i], &job->symbols, &job->symbols_count) != 0) {
+            free_object_module(job->module);
+            result = 1;
+        }
+        else if ((job->output = tmpfile()) == NULL) {
+            log_system_error(Error_104);
+            loaded_count++;
+            is_ready = 0;
+        }
+        else
+            loaded_count++;
+    }
+    if (is_ready) {
+        run_jobs(jobs, loaded_count, threads_count);
+        for (i = 0; i < loaded_count; i++) {
+            if (jobs[i].invalid_count == -1) {
+                log_system_error(Error_101);
+                result = 1;
+                continue;
+            }
+            copy_to_output(jobs[i].output);
+            if (jobs[i].invalid_count > 0) {
+                printf(" WARNING | %d code words of \"%s\" are not instructions, they are written as \".data\"\n",
+                       jobs[i].invalid_count, jobs[i].module->name);
+                result = 1;
+            }
+        }
+    }
+    else
+        result = 1;
+    for (i = 0; i < loaded_count; i++) {
+        if (jobs[i].output != NULL)
+            fclose(jobs[i].output);
+        free(jobs[i].symbols);
+        free_object_module(jobs[i].module);
+    }
+    free(names);
+    free(jobs);
+    free_all_memory();
+    return result;
+}
@@ -0,0 +1,344 @@
+/**
+ * This file turns loaded modules back into source, in the layout of the .am file.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "disassembler.h"
+#include "object_reader.h"
+#include "validator.h"
+#include "machine.h"
+#include "definitions.h"
+
+/* Addresses that a module or an operand word can refer to */
+#define DISASSEMBLY_ADDRESSES (MEMORY_START_ADDRESS + MAX_ARRAY_CAPACITY)
+#define MAX_OPERAND_TEXT_LENGTH (MAX_LABEL_NAME_LENGTH + 9) /* "LABEL[r1][r2]" */
+#define MAX_OUTPUT_LINE_LENGTH (MAX_SOURCE_LINE_LENGTH - 1)
+
+/* Disassembly struct definition - the names of the addresses of a module */
+typedef struct Disassembly {
+    Object_Module *module;
+    char labels[DISASSEMBLY_ADDRESSES][MAX_LABEL_NAME_LENGTH + 1];  /* Empty for addresses without a label */
+    char externs[DISASSEMBLY_ADDRESSES][MAX_LABEL_NAME_LENGTH + 1]; /* External symbol used by each word */
+    unsigned char is_entry[DISASSEMBLY_ADDRESSES];
+} Disassembly;
+
+/* Checks if a name is the label of an address */
+static int is_label_used(Disassembly *disassembly, char *name)
+{
+    int i;
+
+    for (i = 0; i < DISASSEMBLY_ADDRESSES; i++)
+    {
+        if (strcmp(disassembly->labels[i], name) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+/* Gives a label to an address that has none, "L" and the address, with more "L"s while the name is taken */
+static void name_address(Disassembly *disassembly, int address)
+{
+    char name[MAX_LABEL_NAME_LENGTH + 1];
+    int prefix_length = 1;
+
+    if (disassembly->labels[address][0] != STRING_TERMINATOR)
+        return;
+    do
+    {
+        memset(name, 'L', prefix_length);
+        sprintf(name + prefix_length, "%d", address);
+        prefix_length++;
+    } while (is_label_used(disassembly, name));
+    strcpy(disassembly->labels[address], name);
+}
+
+/**
+ * Finds the operand methods and the length of the instruction at a word of the code.
+ * @module: The module.
+ * @index: The index of the word in the words of the module.
+ * @source_method: Set to the method of the source operand, -1 if the instruction has none.
+ * @destination_method: Set to the method of the destination operand, -1 if the instruction has none.
+ * return The number of words of the instruction, or 0 if the word does not start a valid instruction in the code.
+ */
+static int decode_instruction_word(Object_Module *module, int index, int *source_method, int *destination_method)
+{
+    InstructionDefinition *opcodes = retrieve_instruction_set();
+    unsigned short word = module->words[index];
+    int opcode = (word >> OPCODE_SHIFT_POSITION) & MASK_4_BITS, length = 1;
+    int source = (word >> SOURCE_OPERAND_SHIFT_POSITION) & ARE_PLACEHOLDER_SIGNAL;
+    int destination = (word >> DESTINATION_OPERAND_SHIFT_POSITION) & ARE_PLACEHOLDER_SIGNAL;
+    int operand_count = opcodes[opcode].operand_count;
+
+    *source_method = operand_count == 2 ? source : -1;
+    *destination_method = operand_count >= 1 ? destination : -1;
+    if ((word & ARE_PLACEHOLDER_SIGNAL) != ARE_ABSOLUTE)
+        return 0; /* Instruction words are always absolute */
+    /* Operands that the instruction does not have are encoded as 0 */
+    if ((operand_count < 2 && source != 0) || (operand_count < 1 && destination != 0))
+        return 0;
+    if ((operand_count == 2 && !is_addressing_mode_supported(opcodes[opcode].source_modes, source)) ||
+        (operand_count >= 1 && !is_addressing_mode_supported(opcodes[opcode].destination_modes, destination)))
+        return 0;
+    if (operand_count == 2 && source == DIRECT_REGISTER && destination == DIRECT_REGISTER)
+        length = 2; /* Both registers share a single word */
+    else
+    {
+        if (operand_count == 2)
+            length += source == MATRIX ? 2 : 1;
+        if (operand_count >= 1)
+            length += destination == MATRIX ? 2 : 1;
+    }
+    return index + length <= module->code_size ? length : 0;
+}
+
+/* Names the target of the address word of a direct or matrix operand, unless it uses an external symbol */
+static void name_operand_target(Disassembly *disassembly, int index, int method)
+{
+    unsigned short word = disassembly->module->words[index];
+    char *name = disassembly->externs[index + MEMORY_START_ADDRESS];
+
+    if ((method != DIRECT && method != MATRIX) || *name != STRING_TERMINATOR)
+        return;
+    if ((word & ARE_PLACEHOLDER_SIGNAL) == ARE_EXTERNAL) /* The external file does not name the symbol */
+        sprintf(name, "X%d", index + MEMORY_START_ADDRESS);
+    else
+        name_address(disassembly, (word >> IMMEDIATE_VALUE_SHIFT_POSITION) & MASK_8_BITS);
+}
+
+/**
+ * Writes an operand as source text.
+ * @disassembly: Pointer to the disassembly.
+ * @index: The index of the first word of the operand.
+ * @method: The addressing method of the operand.
+ * @register_shift: The position of the register number in a register word.
+ * @text: Set to the operand.
+ * return The number of words of the operand.
+ */
+static int format_operand(Disassembly *disassembly, int index, int method, int register_shift, char *text)
+{
+    unsigned short word = disassembly->module->words[index], registers;
+    char *name = disassembly->externs[index + MEMORY_START_ADDRESS];
+
+    switch (method)
+    {
+    case IMMEDIATE:
+        sprintf(text, "#%d", SIGN_EXTEND_8_BITS(word >> IMMEDIATE_VALUE_SHIFT_POSITION));
+        return 1;
+    case DIRECT:
+    case MATRIX:
+        if (*name == STRING_TERMINATOR)
+            name = disassembly->labels[(word >> IMMEDIATE_VALUE_SHIFT_POSITION) & MASK_8_BITS];
+        if (method == DIRECT)
+        {
+            strcpy(text, name);
+            return 1;
+        }
+        registers = disassembly->module->words[index + 1];
+        sprintf(text, "%s[r%d][r%d]", name, (registers >> MATRIX_ROW_REGISTER_SHIFT) & MASK_4_BITS,
+                (registers >> MATRIX_COLUMN_REGISTER_SHIFT) & MASK_4_BITS);
+        return 2;
+    default: /* DIRECT_REGISTER */
+        sprintf(text, "r%d", (word >> register_shift) & MASK_4_BITS);
+        return 1;
+    }
+}
+
+/* Writes the label of a line, when the address has one */
+static int write_label(Disassembly *disassembly, int address, FILE *output)
+{
+    if (disassembly->labels[address][0] == STRING_TERMINATOR)
+        return 0;
+    return fprintf(output, "%s: ", disassembly->labels[address]);
+}
+
+/* Writes the instructions of the code, and the words that do not start one as ".data", returns the count of those */
+static int write_code(Disassembly *disassembly, FILE *output)
+{
+    InstructionDefinition *opcodes = retrieve_instruction_set();
+    Object_Module *module = disassembly->module;
+    char source[MAX_OPERAND_TEXT_LENGTH + 1], destination[MAX_OPERAND_TEXT_LENGTH + 1];
+    int index = 0, length, source_method, destination_method, words, invalid_count = 0;
+
+    while (index < module->code_size)
+    {
+        write_label(disassembly, index + MEMORY_START_ADDRESS, output);
+        if ((length = decode_instruction_word(module, index, &source_method, &destination_method)) == 0)
+        {
+            fprintf(output, ".data %d\n", SIGN_EXTEND_10_BITS(module->words[index]));
+            invalid_count++;
+            index++;
+            continue;
+        }
+        fputs(opcodes[(module->words[index] >> OPCODE_SHIFT_POSITION) & MASK_4_BITS].mnemonic, output);
+        if (source_method == DIRECT_REGISTER && destination_method == DIRECT_REGISTER)
+        {
+            format_operand(disassembly, index + 1, DIRECT_REGISTER, SOURCE_REGISTER_SHIFT_POSITION, source);
+            format_operand(disassembly, index + 1, DIRECT_REGISTER, DESTINATION_REGISTER_SHIFT_POSITION, destination);
+            fprintf(output, " %s, %s\n", source, destination);
+        }
+        else if (source_method != -1)
+        {
+            words = format_operand(disassembly, index + 1, source_method, SOURCE_REGISTER_SHIFT_POSITION, source);
+            format_operand(disassembly, index + 1 + words, destination_method, DESTINATION_REGISTER_SHIFT_POSITION,
+                           destination);
+            fprintf(output, " %s, %s\n", source, destination);
+        }
+        else if (destination_method != -1)
+        {
+            format_operand(disassembly, index + 1, destination_method, DESTINATION_REGISTER_SHIFT_POSITION,
+                           destination);
+            fprintf(output, " %s\n", destination);
+        }
+        else
+            fputc('\n', output);
+        index += length;
+    }
+    return invalid_count;
+}
+
+/* Returns the length of the string that a part of the data holds (printable characters and 0), or -1 */
+static int string_length(Object_Module *module, int index, int end)
+{
+    int i;
+
+    for (i = index; i < end - 1; i++)
+    {
+        if (module->words[i] < ' ' || module->words[i] > '~' || module->words[i] == QUOTATION_MARK)
+            return -1;
+    }
+    return i > index && module->words[end - 1] == 0 ? end - 1 - index : -1;
+}
+
+/* Writes the data words from an index up to the next label, as a string when they hold one */
+static void write_data_part(Disassembly *disassembly, int index, int end, FILE *output)
+{
+    Object_Module *module = disassembly->module;
+    char value[INTEGER_STRING_BUFFER_SIZE];
+    int length = write_label(disassembly, index + MEMORY_START_ADDRESS, output), count = string_length(module, index, end);
+    int i;
+
+    if (count != -1 && length + count + (int)strlen(".string \"\"") <= MAX_OUTPUT_LINE_LENGTH)
+    {
+        fputs(".string \"", output);
+        for (i = index; i < end - 1; i++)
+            fputc(module->words[i], output);
+        fputs("\"\n", output);
+        return;
+    }
+    length += fprintf(output, ".data");
+    for (i = index; i < end; i++)
+    {
+        sprintf(value, i == index ? " %d" : ", %d", SIGN_EXTEND_10_BITS(module->words[i]));
+        if (i > index && length + (int)strlen(value) + 1 > MAX_OUTPUT_LINE_LENGTH)
+        { /* The values go on in another line without a label */
+            sprintf(value, " %d", SIGN_EXTEND_10_BITS(module->words[i]));
+            length = fprintf(output, "\n.data");
+        }
+        length += fprintf(output, "%s", value);
+    }
+    fputc('\n', output);
+}
+
+/* Writes the ".entry" and ".extern" lines, each name once */
+static void write_symbol_lines(Disassembly *disassembly, Program_Symbol *symbols, int symbols_count, FILE *output)
+{
+    int i, j, is_written;
+
+    for (i = 0; i < DISASSEMBLY_ADDRESSES; i++)
+    {
+        if (disassembly->is_entry[i])
+            fprintf(output, ".entry %s\n", disassembly->labels[i]);
+    }
+    for (i = 0; i < DISASSEMBLY_ADDRESSES; i++)
+    {
+        if (disassembly->externs[i][0] == STRING_TERMINATOR)
+            continue;
+        for (j = 0, is_written = 0; j < i && !is_written; j++)
+            is_written = strcmp(disassembly->externs[j], disassembly->externs[i]) == 0;
+        if (!is_written)
+            fprintf(output, ".extern %s\n", disassembly->externs[i]);
+    }
+    /* External symbols that the module declares without using them are only in the symbol file */
+    for (i = 0; i < symbols_count; i++)
+    {
+        for (j = 0, is_written = !symbols[i].is_extern; j < DISASSEMBLY_ADDRESSES && !is_written; j++)
+            is_written = strcmp(disassembly->externs[j], symbols[i].name) == 0;
+        if (!is_written)
+            fprintf(output, ".extern %s\n", symbols[i].name);
+    }
+}
+
+int disassemble_module(Object_Module *module, Program_Symbol *symbols, int symbols_count, FILE *output)
+{
+    Disassembly *disassembly = (Disassembly *)calloc(1, sizeof(Disassembly));
+    int i, index, end, length, source_method, destination_method, words, total, invalid_count;
+
+    if (disassembly == NULL)
+        return -1; /* Indicates failure */
+    disassembly->module = module;
+    total = module->code_size + module->data_size;
+    for (i = 0; i < module->entries_count; i++)
+    {
+        if (module->entries[i].address < DISASSEMBLY_ADDRESSES)
+        {
+            strcpy(disassembly->labels[module->entries[i].address], module->entries[i].name);
+            disassembly->is_entry[module->entries[i].address] = 1;
+        }
+    }
+    for (i = 0; i < symbols_count; i++)
+    {
+        if (!symbols[i].is_extern && symbols[i].address < DISASSEMBLY_ADDRESSES &&
+            disassembly->labels[symbols[i].address][0] == STRING_TERMINATOR)
+            strcpy(disassembly->labels[symbols[i].address], symbols[i].name);
+    }
+    for (i = 0; i < module->extern_uses_count; i++)
+    {
+        if (module->extern_uses[i].address < DISASSEMBLY_ADDRESSES)
+            strcpy(disassembly->externs[module->extern_uses[i].address], module->extern_uses[i].name);
+    }
+
+    /* Targets of the operands that have no name get one */
+    for (index = 0; index < module->code_size; index += length)
+    {
+        if ((length = decode_instruction_word(module, index, &source_method, &destination_method)) == 0)
+        {
+            length = 1;
+            continue;
+        }
+        if (source_method == DIRECT_REGISTER && destination_method == DIRECT_REGISTER)
+            continue;
+        words = 1;
+        if (source_method != -1)
+        {
+            name_operand_target(disassembly, index + words, source_method);
+            words += source_method == MATRIX ? 2 : 1;
+        }
+        if (destination_method != -1)
+            name_operand_target(disassembly, index + words, destination_method);
+    }
+
+    fprintf(output, "; file %s.ob\n", module->name);
+    write_symbol_lines(disassembly, symbols, symbols_count, output);
+    invalid_count = write_code(disassembly, output);
+    for (index = module->code_size; index < total; index = end)
+    {
+        for (end = index + 1;
+             end < total && disassembly->labels[end + MEMORY_START_ADDRESS][0] == STRING_TERMINATOR; end++)
+            ;
+        write_data_part(disassembly, index, end, output);
+    }
+    /* Labels past the end of the module cannot be defined in it */
+    for (i = total + MEMORY_START_ADDRESS; i < DISASSEMBLY_ADDRESSES; i++)
+    {
+        if (disassembly->labels[i][0] != STRING_TERMINATOR)
+            fprintf(output, "; %s is address %d, outside of the module\n", disassembly->labels[i], i);
+    }
+    for (i = 0; i < MEMORY_START_ADDRESS; i++)
+    {
+        if (disassembly->labels[i][0] != STRING_TERMINATOR)
+            fprintf(output, "; %s is address %d, outside of the module\n", disassembly->labels[i], i);
+    }
+    free(disassembly);
+    return invalid_count;
+}
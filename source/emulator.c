@@ -0,0 +1,851 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "error_handler.h"
+#include "object_reader.h"
+#include "machine.h"
+#include "interpreter.h"
+#include "basic_blocks.h"
+#include "jit.h"
+#include "batch.h"
+#include "campaign.h"
+#include "profiler.h"
+#include "coverage.h"
+#include "snapshot.h"
+#include "mapped_file.h"
+#include "differential.h"
+#include "trace.h"
+#include "utils.h"
+#include "definitions.h"
+
+/* Length of a line in the list of inputs of a batch */
+#define MAX_LIST_LINE_LENGTH 1024
+
+/* Emulator options struct definition */
+typedef struct Emulator_Options {
+    unsigned long max_steps;
+    int show_statistics;
+    int show_blocks;
+    int is_plain;     /* Runs without superinstructions */
+    int is_check;     /* Runs the plain interpreter and the selected engine and compares the results */
+    int is_jit;       /* Runs translated code */
+    char *batch_list; /* File listing the inputs of the instances of a batch run */
+    char *manifest;   /* File listing the jobs of a campaign */
+    int workers_count;
+    int is_profile;        /* Prints the profile of the run by label */
+    char *folded_stacks;   /* File to write the call stacks of the run to, for flame graphs */
+    int is_coverage;       /* Prints the coverage of the run and writes its report */
+    char *snapshot_label;  /* Label to take the snapshot of the program at */
+    int is_restore;        /* Starts from the snapshot of the program */
+    char *fork_list;       /* File listing the inputs of the tests of the fork server */
+    char *expected_output; /* File to compare the output of the run with, instead of printing it */
+    unsigned long check_interval; /* Instructions between the checkpoints of a differential run, 0 for none */
+    char *trace_file;      /* File to record the trace of the run to */
+} Emulator_Options;
+
+/**
+ * Creates a machine and loads a module into it.
+ * @module: The module to load.
+ * @is_fused: 1 to fuse superinstructions, 0 to run plain instructions.
+ * @show_statistics: 1 to print the number of superinstructions formed.
+ * return Pointer to the machine, or NULL if an error was detected.
+ */
+static Machine *create_machine(Object_Module *module, int is_fused, int show_statistics)
+{
+    int i, fused_counts[TOTAL_SUPERINSTRUCTIONS];
+    Machine *machine = (Machine *)malloc(sizeof(Machine));
+
+    if (machine == NULL) {
+        log_system_error(Error_101);
+        return NULL;  /* Indicates faliure */
+    }
+    if (load_machine(machine, module) != 0) {
+        free(machine);
+        return NULL;  /* Indicates faliure */
+    }
+    if (is_fused && fuse_superinstructions(machine, fused_counts) > 0 && show_statistics) {
+        printf("Superinstructions:");
+        for (i = 0; i < TOTAL_SUPERINSTRUCTIONS; i++)
+            printf(" %s %d", superinstruction_name(HANDLER_CMP_BNE + i), fused_counts[i]);
+        printf("\n");
+    }
+    return machine;
+}
+
+/**
+ * Runs a machine with the engine selected by the options.
+ * @machine: Pointer to the loaded machine.
+ * @options: The options of the emulator.
+ * return The status of the machine.
+ */
+static int run_engine(Machine *machine, Emulator_Options *options)
+{
+    unsigned long max_steps = options->max_steps;
+
+    /* The step limit counts the instructions executed before a snapshot too */
+    if (max_steps > 0)
+        max_steps = machine->executed >= max_steps ? 1 : max_steps - machine->executed;
+    return options->is_jit ? run_jit(machine, max_steps) : run_machine(machine, max_steps);
+}
+
+/**
+ * Prints the statistics of a run.
+ * @machine: Pointer to the machine after the run.
+ * @seconds: The time the run took.
+ * @is_jit: 1 to print the statistics of the JIT too.
+ */
+static void report_statistics(Machine *machine, double seconds, int is_jit)
+{
+    Jit_Statistics *statistics = retrieve_jit_statistics();
+
+    printf("Executed %lu instructions in %.6f seconds", machine->executed, seconds);
+    if (seconds > 0)
+        printf(" (%.2f MIPS)", machine->executed / seconds / 1e6);
+    printf("\n");
+    if (is_jit)
+        printf("JIT: %lu blocks (%lu bytes), %lu chained jumps, %lu interpreter fallbacks, %lu flushes\n",
+               statistics->blocks, statistics->code_size, statistics->chained, statistics->fallbacks,
+               statistics->flushes);
+}
+
+/**
+ * Prints the basic blocks of the program and their execution counts.
+ * @machine: Pointer to the machine after the run.
+ */
+static void report_blocks(Machine *machine)
+{
+    Basic_Block blocks[MACHINE_MEMORY_SIZE];
+    int i, count = find_basic_blocks(machine, blocks);
+
+    printf("Basic blocks:\n");
+    for (i = 0; i < count; i++)
+        printf("  %3d-%3d  %2d instructions  %10lu executions\n", blocks[i].start, blocks[i].end - 1,
+               blocks[i].instructions_count, blocks[i].executions);
+}
+
+/**
+ * Prints the coverage of a run and writes its report.
+ * The instructions are decoded from the memory after the run, so a run that wrote into its own code has no coverage.
+ * @module: The program that ran.
+ * @machine: Pointer to the machine of the program.
+ * @runs: Times the instruction at each address ran, NULL to count them from the basic blocks of the run.
+ * @code_writes: The number of writes into decoded instructions during the run.
+ * return 0 if successful, 1 if an error was detected.
+ */
+static int report_coverage(Object_Module *module, Machine *machine, const unsigned long *runs,
+                           unsigned long code_writes)
+{
+    unsigned long counted[MACHINE_MEMORY_SIZE + 1] = {0};
+    Coverage coverage;
+
+    if (code_writes > 0) {
+        printf(" Program \"%s\"", module->name);
+        log_system_error(Error_112);
+        return 1;  /* Indicates faliure */
+    }
+    memset(&coverage, 0, sizeof(Coverage));
+    if (runs == NULL) {
+        count_instruction_runs(machine, counted);
+        runs = counted;
+    }
+    add_coverage(&coverage, machine, runs);
+    return write_coverage(&coverage, machine, module->name);
+}
+
+/**
+ * Compares the state of two machines after their runs and prints the first difference.
+ * @plain: The machine that ran plain instructions.
+ * @fused: The machine that ran superinstructions.
+ * return 1 if the states are the same, 0 otherwise.
+ */
+static int is_same_state(Machine *plain, Machine *fused)
+{
+    int i;
+
+    if (plain->status != fused->status || plain->pc != fused->pc || plain->executed != fused->executed) {
+        printf(" Runs differ: status %d/%d, pc %d/%d, executed %lu/%lu\n", plain->status, fused->status,
+               plain->pc, fused->pc, plain->executed, fused->executed);
+        return 0;
+    }
+    if (plain->zero_flag != fused->zero_flag || plain->sp != fused->sp ||
+        memcmp(plain->stack, fused->stack, plain->sp * sizeof(unsigned short)) != 0) {
+        printf(" Runs differ in the flags or the call stack\n");
+        return 0;
+    }
+    for (i = 0; i < MACHINE_CELLS_COUNT; i++) {
+        if (plain->cells[i] != fused->cells[i]) {
+            printf(" Runs differ at cell %d: %d/%d\n", i, plain->cells[i], fused->cells[i]);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Runs a program with the plain interpreter and with the selected engine (superinstructions or the JIT), on the same
+ * input, and compares the results.
+ * The output of the run with the selected engine is printed.
+ * @module: The program to run.
+ * @options: The options of the emulator.
+ * return 0 if the runs agree and the program reached "stop", 1 otherwise.
+ */
+static int check_program(Object_Module *module, Emulator_Options *options)
+{
+    Mapped_File input;
+    int is_loaded = load_mapped_file(stdin, &input) == 0;
+    Machine *plain = create_machine(module, 0, 0);
+    Machine *fused = create_machine(module, !options->is_jit, options->show_statistics);
+    FILE *plain_output = tmpfile(), *fused_output = tmpfile();
+    int character, result = 1;
+
+    if (!is_loaded || plain == NULL || fused == NULL || plain_output == NULL || fused_output == NULL) {
+        if (plain_output == NULL || fused_output == NULL)
+            log_system_error(Error_104);
+    }
+    else {
+        plain->input = fused->input = input.data;
+        plain->input_size = fused->input_size = input.size;
+        plain->output = plain_output;
+        fused->output = fused_output;
+        run_machine(plain, options->max_steps);
+        run_engine(fused, options);
+        rewind(fused_output);
+        while ((character = fgetc(fused_output)) != EOF)
+            putchar(character);
+        if (is_same_state(plain, fused) && is_same_output(plain_output, fused_output)) {
+            printf("Check passed: %lu instructions, same state and output with the plain interpreter and %s\n",
+                   fused->executed, options->is_jit ? "the JIT" : "superinstructions");
+            result = fused->status == MACHINE_HALTED ? 0 : 1;
+        }
+        else
+            printf(" Check failed: %s changed the behavior of the program\n",
+                   options->is_jit ? "the JIT" : "superinstructions");
+    }
+    if (plain_output != NULL)
+        fclose(plain_output);
+    if (fused_output != NULL)
+        fclose(fused_output);
+    unmap_file(&input);
+    free(plain);
+    free(fused);
+    return result;
+}
+
+/**
+ * Runs a program with the plain interpreter and with the selected engine in lockstep, comparing their states at
+ * checkpoints. The output of the run with the selected engine is printed.
+ * @module: The program to run.
+ * @options: The options of the emulator.
+ * return 0 if the runs agree and the program reached "stop", 1 otherwise.
+ */
+static int run_differential_program(Object_Module *module, Emulator_Options *options)
+{
+    Mapped_File input;
+    int is_loaded = load_mapped_file(stdin, &input) == 0;
+    Machine *reference = create_machine(module, 0, 0);
+    Machine *engine = create_machine(module, !options->is_jit, options->show_statistics);
+    FILE *reference_output = tmpfile(), *engine_output = tmpfile();
+    long checkpoints;
+    int character, result = 1;
+
+    if (!is_loaded || reference == NULL || engine == NULL || reference_output == NULL || engine_output == NULL) {
+        if (reference_output == NULL || engine_output == NULL)
+            log_system_error(Error_104);
+    }
+    else {
+        reference->input = engine->input = input.data;
+        reference->input_size = engine->input_size = input.size;
+        reference->output = reference_output;
+        engine->output = engine_output;
+        checkpoints = run_differential(reference, engine, options->is_jit, options->check_interval,
+                                       options->max_steps);
+        rewind(engine_output);
+        while ((character = fgetc(engine_output)) != EOF)
+            putchar(character);
+        if (checkpoints >= 0) {
+            printf("Differential run passed: %lu instructions, %ld checkpoints agree with the plain interpreter"
+                   " and %s\n", engine->executed, checkpoints, options->is_jit ? "the JIT" : "superinstructions");
+            result = engine->status == MACHINE_HALTED ? 0 : 1;
+        }
+    }
+    if (reference_output != NULL)
+        fclose(reference_output);
+    if (engine_output != NULL)
+        fclose(engine_output);
+    unmap_file(&input);
+    free(reference);
+    free(engine);
+    return result;
+}
+
+/**
+ * Brings a machine to the label of the snapshot of its program: restores the snapshot (.snap) with "-R", or runs the
+ * program up to the label of "-S" and writes the snapshot there.
+ * @module: The program.
+ * @machine: Pointer to the loaded machine, running plain instructions with "-S".
+ * @options: The options of the emulator.
+ * @prefix: Set to the output that the program wrote before the label (allocated, freed by the caller).
+ * @prefix_length: Set to the number of characters of the output.
+ * return 0 if successful, 1 if an error was detected.
+ */
+static int warm_up_machine(Object_Module *module, Machine *machine, Emulator_Options *options, unsigned char **prefix,
+                           unsigned long *prefix_length)
+{
+    char *file_snap_name = add_extension(module->name, ".snap");
+    FILE *output = NULL, *program_output = machine->output;
+    int address, is_reached, result = 1;
+
+    *prefix = NULL;
+    *prefix_length = 0;
+    if (file_snap_name == NULL)
+        return 1;  /* Indicates faliure */
+    if (options->is_restore) {
+        result = restore_snapshot(machine, module, file_snap_name, prefix, prefix_length);
+        if (result == 0 && options->show_statistics)
+            printf("Snapshot \"%s\" restored after %lu instructions\n", file_snap_name, machine->executed);
+    }
+    else if ((address = find_code_label(module, options->snapshot_label)) != -1) {
+        if ((output = tmpfile()) == NULL)
+            log_system_error(Error_104);
+        else {
+            machine->output = output;
+            is_reached = run_to_address(machine, address, options->max_steps);
+            machine->output = program_output;
+            rewind(output);
+            if ((*prefix = read_program_input(output, prefix_length)) != NULL)
+                result = is_reached ? save_snapshot(machine, module, *prefix, *prefix_length, file_snap_name) : 0;
+            if (!is_reached)
+                printf(" WARNING | Label \"%s\" was not reached, no snapshot was written\n", options->snapshot_label);
+            else if (result == 0 && options->show_statistics)
+                printf("Snapshot at \"%s\" after %lu instructions written to \"%s\"\n", options->snapshot_label,
+                       machine->executed, file_snap_name);
+            fclose(output);
+        }
+    }
+    clean_memory(file_snap_name);
+    return result;
+}
+
+/**
+ * Loads the expected output of a run.
+ * @file_name: The name of the file of the expected output.
+ * @expected: Set to the contents of the file.
+ * return 0 if successful, 1 if an error was detected.
+ */
+static int load_expected_output(char *file_name, Mapped_File *expected)
+{
+    FILE *file = fopen(file_name, "rb");
+    int result;
+
+    if (file == NULL) {
+        printf(" File \"%s\"", file_name);
+        log_system_error(Error_103);
+        return 1;  /* Indicates faliure */
+    }
+    result = load_mapped_file(file, expected);
+    fclose(file);  /* A mapping outlives the file */
+    return result;
+}
+
+/**
+ * Runs a program.
+ * @module: The program to run.
+ * @options: The options of the emulator.
+ * return 0 if the program reached "stop", 1 otherwise.
+ */
+static int run_program(Object_Module *module, Emulator_Options *options)
+{
+    int status, is_snapshot = options->snapshot_label != NULL || options->is_restore;
+    unsigned long prefix_length = 0;
+    unsigned char *prefix = NULL;
+    Mapped_File input, expected = {NULL, 0, NULL, 0};
+    clock_t start;
+    Machine *machine = create_machine(module, !options->is_plain && !options->is_jit &&
+                                      (options->snapshot_label == NULL || options->is_restore), options->show_statistics);
+
+    if (machine == NULL)
+        return 1;  /* Indicates faliure */
+    if (options->expected_output != NULL && load_expected_output(options->expected_output, &expected) != 0) {
+        free(machine);
+        return 1;  /* Indicates faliure */
+    }
+    if (map_file(stdin, &input) == 0) {  /* The machine reads a regular file in place, through its cursor */
+        machine->input = input.data;
+        machine->input_size = input.size;
+    }
+    start = clock();
+    if (is_snapshot && warm_up_machine(module, machine, options, &prefix, &prefix_length) != 0) {
+        free(prefix);
+        free(machine);
+        unmap_file(&input);
+        unmap_file(&expected);
+        return 1;  /* Indicates faliure */
+    }
+    /* The output of the warm up was captured, so the comparison starts here */
+    if (expected.data != NULL) {
+        machine->expected = expected.data;
+        machine->expected_size = expected.size;
+    }
+    if (prefix != NULL)
+        write_output(machine, (char *)prefix, prefix_length);
+    free(prefix);
+    status = machine->status == MACHINE_RUNNING ? run_engine(machine, options) : machine->status;
+    if (status == MACHINE_STEP_LIMIT)
+        printf(" WARNING | Step limit of %lu instructions reached at address %d\n", options->max_steps, machine->pc);
+    if (options->show_statistics)
+        report_statistics(machine, (double)(clock() - start) / CLOCKS_PER_SEC, options->is_jit);
+    if (options->show_blocks)
+        report_blocks(machine);
+    if (options->is_coverage && report_coverage(module, machine, NULL, machine->code_writes) != 0)
+        status = MACHINE_FAULTED;
+    if (expected.data != NULL && (machine->is_unexpected || machine->expected_position != expected.size)) {
+        printf(" Output differs from \"%s\" at character %lu\n", options->expected_output,
+               machine->expected_position);
+        status = MACHINE_FAULTED;
+    }
+    else if (expected.data != NULL && options->show_statistics)
+        printf("Output matches \"%s\" (%lu characters)\n", options->expected_output, expected.size);
+    unmap_file(&input);
+    unmap_file(&expected);
+    free(machine);
+    return status == MACHINE_HALTED ? 0 : 1;
+}
+
+/**
+ * Runs a program with the profiler, on plain instructions.
+ * @module: The program to run.
+ * @options: The options of the emulator.
+ * return 0 if the program reached "stop", 1 otherwise.
+ */
+static int run_profiled_program(Object_Module *module, Emulator_Options *options)
+{
+    int status = MACHINE_FAULTED;
+    Machine *machine = create_machine(module, 0, 0);
+    Profile *profile;
+
+    if (machine == NULL)
+        return 1;  /* Indicates faliure */
+    if ((profile = create_profile(module, machine)) != NULL) {
+        status = run_profiled(machine, profile, options->max_steps);
+        if (status == MACHINE_STEP_LIMIT)
+            printf(" WARNING | Step limit of %lu instructions reached at address %d\n", options->max_steps,
+                   machine->pc);
+        if (options->is_profile)
+            print_profile(profile);
+        if (options->folded_stacks != NULL && write_folded_stacks(profile, options->folded_stacks) != 0)
+            status = MACHINE_FAULTED;
+        free_profile(profile);
+    }
+    free(machine);
+    return status == MACHINE_HALTED ? 0 : 1;
+}
+
+/**
+ * Runs a program on plain instructions and records its trace.
+ * @module: The program to run.
+ * @options: The options of the emulator.
+ * return 0 if the program reached "stop" and the trace was written, 1 otherwise.
+ */
+static int run_traced_program(Object_Module *module, Emulator_Options *options)
+{
+    int status = MACHINE_FAULTED;
+    unsigned long size;
+    Machine *machine = create_machine(module, 0, 0);
+    Trace_Recorder *trace;
+    clock_t start = clock();
+    double seconds;
+
+    if (machine == NULL)
+        return 1;  /* Indicates faliure */
+    if ((trace = create_trace(options->trace_file, machine, 0)) != NULL) {
+        status = run_traced(machine, trace, options->max_steps);
+        if (status == MACHINE_STEP_LIMIT)
+            printf(" WARNING | Step limit of %lu instructions reached at address %d\n", options->max_steps,
+                   machine->pc);
+        if (close_trace(trace, machine, &size) != 0)
+            status = MACHINE_FAULTED;
+        else if (options->show_statistics) {
+            seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+            printf("Traced %lu instructions in %.6f seconds into \"%s\": %lu bytes of records (%.2f per instruction)\n",
+                   machine->executed, seconds, options->trace_file, size,
+                   machine->executed > 0 ? (double)size / machine->executed : 0.0);
+        }
+    }
+    free(machine);
+    return status == MACHINE_HALTED ? 0 : 1;
+}
+
+/**
+ * Reads the inputs listed in a file, one file name per line.
+ * @list_name: The name of the list file.
+ * @names: Set to the names of the input files.
+ * @inputs: Set to the contents of the input files.
+ * @sizes: Set to the sizes of the input files.
+ * return The number of inputs, or -1 if an error was detected.
+ */
+static int read_input_list(char *list_name, char ***names, unsigned char ***inputs, unsigned long **sizes)
+{
+    char line[MAX_LIST_LINE_LENGTH], *name;
+    FILE *list = fopen(list_name, "r"), *file;
+    int count = 0, capacity = 0;
+
+    *names = NULL;
+    *inputs = NULL;
+    *sizes = NULL;
+    if (list == NULL) {
+        printf(" File \"%s\"", list_name);
+        log_system_error(Error_103);
+        return -1;  /* Indicates faliure */
+    }
+    while (fgets(line, sizeof(line), list) != NULL) {
+        name = trim_whitespace(line);
+        if (*name == STRING_TERMINATOR)
+            continue;
+        if (count == capacity) {
+            capacity = capacity == 0 ? BATCH_VECTOR_LANES : capacity * 2;
+            *names = (char **)realloc(*names, capacity * sizeof(char *));
+            *inputs = (unsigned char **)realloc(*inputs, capacity * sizeof(unsigned char *));
+            *sizes = (unsigned long *)realloc(*sizes, capacity * sizeof(unsigned long));
+            if (*names == NULL || *inputs == NULL || *sizes == NULL) {
+                log_system_error(Error_101);
+                fclose(list);
+                return -1;  /* Indicates faliure */
+            }
+        }
+        if ((file = fopen(name, "rb")) == NULL) {
+            printf(" File \"%s\"", name);
+            log_system_error(Error_103);
+            fclose(list);
+            return -1;  /* Indicates faliure */
+        }
+        if (((*names)[count] = (char *)allocate_memory(strlen(name) + 1)) != NULL)
+            strcpy((*names)[count], name);
+        (*inputs)[count] = read_program_input(file, &(*sizes)[count]);
+        fclose(file);
+        if ((*inputs)[count++] == NULL || (*names)[count - 1] == NULL) {
+            fclose(list);
+            return -1;  /* Indicates faliure */
+        }
+    }
+    fclose(list);
+    return count;
+}
+
+/**
+ * Runs a batch of instances of a program in lockstep, one instance for every input listed in a file.
+ * The output of each instance is written to the name of its input with the ".out" extension added.
+ * @module: The program to run.
+ * @options: The options of the emulator.
+ * return 0 if all of the instances reached "stop", 1 otherwise.
+ */
+static int run_batch_program(Object_Module *module, Emulator_Options *options)
+{
+    char **names;
+    unsigned char **inputs;
+    unsigned long *sizes, executed = 0;
+    int i, count = read_input_list(options->batch_list, &names, &inputs, &sizes), halted_count = 0, result = 1;
+    int faulted_count = 0, limit_count = 0;
+    Machine *program = NULL;
+    Batch *batch = NULL;
+    FILE *file;
+    char *output_name;
+    clock_t start;
+    double seconds;
+
+    if (count == 0)
+        printf(" WARNING | No inputs are listed in \"%s\"\n", options->batch_list);
+    if (count <= 0 || (program = create_machine(module, 0, 0)) == NULL || (batch = create_batch(program, count)) == NULL)
+        goto cleanup;
+    for (i = 0; i < count; i++)
+        set_lane_input(batch, i, inputs[i], sizes[i]);
+    start = clock();
+    halted_count = run_batch(batch, options->max_steps);
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    for (i = 0; i < count; i++) {
+        executed += batch->executed[i];
+        faulted_count += batch->status[i] == MACHINE_FAULTED;
+        limit_count += batch->status[i] == MACHINE_STEP_LIMIT;
+        if ((output_name = add_extension(names[i], ".out")) == NULL)
+            continue;
+        if ((file = fopen(output_name, "w")) == NULL) {
+            printf(" File \"%s\"", output_name);
+            log_system_error(Error_104);
+            continue;
+        }
+        fwrite(batch->outputs[i].text, 1, batch->outputs[i].length, file);
+        fclose(file);
+    }
+    printf("Batch of %d instances: %d reached stop, %d faulted, %d reached the step limit\n", count, halted_count,
+           faulted_count, limit_count);
+    if (options->show_statistics) {
+        printf("Executed %lu instructions in %.6f seconds", executed, seconds);
+        if (seconds > 0)
+            printf(" (%.2f million instances x instructions per second)", executed / seconds / 1e6);
+        printf("\n");
+        printf("Lockstep: %lu steps, %.1f instances per step, %d instances finished by the interpreter\n",
+               batch->steps, batch->steps > 0 ? (double)batch->lane_steps / batch->steps : 0.0,
+               batch->ejected_count);
+    }
+    result = halted_count == count ? 0 : 1;
+    if (options->is_coverage && report_coverage(module, program, batch->instruction_runs, batch->code_writes) != 0)
+        result = 1;
+
+cleanup:
+    if (batch != NULL)
+        free_batch(batch);
+    for (i = 0; inputs != NULL && i < count; i++)
+        free(inputs[i]);
+    free(inputs);
+    free(names);
+    free(sizes);
+    free(program);
+    return result;
+}
+
+/**
+ * Runs one test for every input listed in a file, each test in a clone of a process that warmed the program up to
+ * its snapshot label (with "-S" or "-R") or only loaded it. The output of each test is written to the name of its
+ * input with the ".out" extension added.
+ * @module: The program to run.
+ * @options: The options of the emulator.
+ * return 0 if all of the tests reached "stop", 1 otherwise.
+ */
+static int run_fork_server(Object_Module *module, Emulator_Options *options)
+{
+    char **names;
+    unsigned char **inputs, *prefix = NULL;
+    unsigned long *sizes, prefix_length = 0;
+    int i, count = read_input_list(options->fork_list, &names, &inputs, &sizes), halted_count = -1;
+    Machine *machine = NULL;
+
+    if (count == 0)
+        printf(" WARNING | No inputs are listed in \"%s\"\n", options->fork_list);
+    if (count > 0 && (machine = create_machine(module, !options->is_plain &&
+                                               (options->snapshot_label == NULL || options->is_restore), 0)) != NULL) {
+        machine->input = (const unsigned char *)"";  /* The warm up does not read input */
+        if ((options->snapshot_label == NULL && !options->is_restore) ||
+            warm_up_machine(module, machine, options, &prefix, &prefix_length) == 0) {
+            halted_count = run_forked_tests(machine, prefix, prefix_length, names, inputs, sizes, count,
+                                            options->max_steps);
+            if (halted_count >= 0)
+                printf("Fork server: %d tests from a warm up of %lu instructions, %d reached stop\n", count,
+                       machine->executed, halted_count);
+        }
+    }
+    free(prefix);
+    free(machine);
+    for (i = 0; inputs != NULL && i < count; i++)
+        free(inputs[i]);
+    free(inputs);
+    free(names);
+    free(sizes);
+    return halted_count == count ? 0 : 1;
+}
+
+/**
+ * Checks that the options select a single mode of the emulator, and an engine that the mode runs.
+ * Reports the first two options that can not be combined.
+ * @options: The options of the emulator.
+ * return 0 if the options can be combined, 1 otherwise.
+ */
+static int check_mode_options(Emulator_Options *options)
+{
+    char *modes[2];
+    int count = 0, mode;
+
+    if (options->manifest != NULL)
+        modes[count++] = "-m";
+    if (options->batch_list != NULL && count < 2)
+        modes[count++] = "-B";
+    if (options->fork_list != NULL && count < 2)
+        modes[count++] = "-f";
+    if ((options->is_profile || options->folded_stacks != NULL) && count < 2)
+        modes[count++] = options->is_profile ? "-P" : "-F";
+    if (options->trace_file != NULL && count < 2)
+        modes[count++] = "-T";
+    if (options->check_interval > 0 && count < 2)
+        modes[count++] = "-d";
+    if (options->is_check && count < 2)
+        modes[count++] = "-c";
+    mode = count == 1 ? modes[0][1] : 0;
+    if (count == 1 && options->is_jit && mode != 'c' && mode != 'd')
+        modes[1] = "-j";  /* The JIT runs a single program, on its own or against the plain interpreter */
+    else if (count < 2)
+        return 0;
+    printf(" Options \"%s\" and \"%s\"", modes[0], modes[1]);
+    log_system_error(Error_111);
+    return 1;  /* Indicates faliure */
+}
+
+/**
+ * This is the main function of the emulator, it runs an assembled (and linked) program.
+ * The program is given by its name without an extension, and is loaded from its output files (.ob, .ent, .ext).
+ * The option "-n steps" limits the number of executed instructions.
+ * The option "-s" prints the number of executed instructions and the speed of the run.
+ * The option "-b" prints the basic blocks of the program and their execution counts.
+ * The option "-p" runs plain instructions, without fusing superinstructions.
+ * The option "-j" runs the program with the JIT (x86-64 Linux only).
+ * The option "-c" runs the program with the plain interpreter and with superinstructions (or the JIT, with "-j")
+ * and checks that the results are the same.
+ * The option "-d interval" runs the plain interpreter and the selected engine in lockstep, compares their states every
+ * interval instructions (1 compares them after every basic block) and reports the first block where they diverge.
+ * The option "-B list" runs one instance of the program for every input file named in the list file, all of them in
+ * lockstep, and writes the output of each instance to its input file name with ".out" added.
+ * The option "-m manifest" runs the jobs listed in the manifest file instead of a program, on all of the cores, and
+ * checks their outputs. Each line of the manifest names a program, an input file and an expected output file.
+ * The option "-t workers" sets the number of workers of "-m" (one per core by default).
+ * The option "-P" runs the program with the profiler and prints the instructions and cycles of every label and the
+ * call graph. The labels come from the symbol file (.sym, see the "--symbols" option of the assembler) or the .ent file.
+ * The option "-F file" runs the program with the profiler and writes its call stacks to the file, folded for flame
+ * graph tools.
+ * The option "-C" prints the code words, instructions and basic blocks that ran (in all of the instances, with "-B")
+ * and writes the number of runs of every instruction to the program name with ".cov" added, next to the lines of the
+ * .am file when the program has a symbol file (.sym, see the "--symbols" option of the assembler). A run that writes
+ * into its own code has no coverage.
+ * The option "-S label" runs the program up to the code label, writes a snapshot of the machine there (.snap) and
+ * continues the run. The option "-R" starts the run from the snapshot of the program instead.
+ * The option "-f list" runs one test for every input file named in the list file, each in a clone of a process that
+ * warmed the program up to its snapshot label ("-S" or "-R"), and writes the output of each test to its input file
+ * name with ".out" added.
+ * The option "-e file" compares the output of the run with the expected output in the file instead of printing it.
+ * The option "-T file" runs the program on plain instructions and records its trace (every instruction, the word it
+ * wrote and the outcome of every branch) to the file, for the trace_reader tool.
+ * A regular file on the standard input (and the expected output) is mapped into memory instead of being read.
+ * Only one of the options "-m", "-B", "-f", "-P" (or "-F"), "-T", "-d" and "-c" can be given. "-j" applies to a
+ * single run, "-c" and "-d".
+ * argc: The number of command-line arguments.
+ * argv: An array of strings containing the command-line arguments.
+ * return Returns 0 if the program reached "stop", 1 otherwise.
+ */
+
+int main(int argc, char *argv[]) {
+    int i, result;
+    char *program_name = NULL;
+    Emulator_Options options = {0, 0, 0, 0, 0, 0, NULL, NULL, 0, 0, NULL, 0, NULL, 0, NULL, NULL, 0, NULL};
+    Object_Module *module;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0) {
+            if (++i == argc) {
+                log_system_error(Error_107);
+                return 1;  /* Indicates faliure */
+            }
+            options.max_steps = strtoul(argv[i], NULL, BASE_10);
+        }
+        else if (strcmp(argv[i], "-d") == 0) {
+            if (++i == argc) {
+                log_system_error(Error_107);
+                return 1;  /* Indicates faliure */
+            }
+            options.check_interval = strtoul(argv[i], NULL, BASE_10);
+            if (options.check_interval == 0)
+                options.check_interval = 1;
+        }
+        else if (strcmp(argv[i], "-s") == 0)
+            options.show_statistics = 1;
+        else if (strcmp(argv[i], "-b") == 0)
+            options.show_blocks = 1;
+        else if (strcmp(argv[i], "-p") == 0)
+            options.is_plain = 1;
+        else if (strcmp(argv[i], "-c") == 0)
+            options.is_check = 1;
+        else if (strcmp(argv[i], "-B") == 0) {
+            if (++i == argc) {
+                log_system_error(Error_107);
+                return 1;  /* Indicates faliure */
+            }
+            options.batch_list = argv[i];
+        }
+        else if (strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "-t") == 0) {
+            if (i + 1 == argc) {
+                log_system_error(Error_107);
+                return 1;  /* Indicates faliure */
+            }
+            if (argv[i++][1] == 'm')
+                options.manifest = argv[i];
+            else
+                options.workers_count = atoi(argv[i]);
+        }
+        else if (strcmp(argv[i], "-S") == 0 || strcmp(argv[i], "-f") == 0) {
+            if (i + 1 == argc) {
+                log_system_error(Error_107);
+                return 1;  /* Indicates faliure */
+            }
+            if (argv[i++][1] == 'S')
+                options.snapshot_label = argv[i];
+            else
+                options.fork_list = argv[i];
+        }
+        else if (strcmp(argv[i], "-R") == 0)
+            options.is_restore = 1;
+        else if (strcmp(argv[i], "-C") == 0)
+            options.is_coverage = 1;
+        else if (strcmp(argv[i], "-P") == 0)
+            options.is_profile = 1;
+        else if (strcmp(argv[i], "-F") == 0) {
+            if (++i == argc) {
+                log_system_error(Error_107);
+                return 1;  /* Indicates faliure */
+            }
+            options.folded_stacks = argv[i];
+        }
+        else if (strcmp(argv[i], "-e") == 0) {
+            if (++i == argc) {
+                log_system_error(Error_107);
+                return 1;  /* Indicates faliure */
+            }
+            options.expected_output = argv[i];
+        }
+        else if (strcmp(argv[i], "-T") == 0) {
+            if (++i == argc) {
+                log_system_error(Error_107);
+                return 1;  /* Indicates faliure */
+            }
+            options.trace_file = argv[i];
+        }
+        else if (strcmp(argv[i], "-j") == 0) {
+            if (!is_jit_supported())
+                printf(" WARNING | The JIT is not supported on this host, running the interpreter\n");
+            options.is_jit = 1;
+        }
+        else if (argv[i][0] == MINUS_SIGN) {
+            printf(" Unrecognized option \"%s\"", argv[i]);
+            log_system_error(Error_106);
+            return 1;  /* Indicates faliure */
+        }
+        else
+            program_name = argv[i];
+    }
+    if (check_mode_options(&options) != 0)
+        return 1;  /* Indicates faliure */
+    if (options.manifest != NULL) {
+        result = run_campaign(options.manifest, options.workers_count, options.max_steps, options.show_statistics);
+        free_all_memory();
+        return result;
+    }
+    if (program_name == NULL) {  /* Checking if no program was entered */
+        log_system_error(Error_100);
+        return 1;  /* Indicates faliure */
+    }
+    module = read_object_module(program_name);
+    if (module == NULL)
+        return 1;  /* Indicates faliure */
+    if (options.batch_list != NULL)
+        result = run_batch_program(module, &options);
+    else if (options.fork_list != NULL)
+        result = run_fork_server(module, &options);
+    else if (options.is_profile || options.folded_stacks != NULL)
+        result = run_profiled_program(module, &options);
+    else if (options.trace_file != NULL)
+        result = run_traced_program(module, &options);
+    else if (options.check_interval > 0)
+        result = run_differential_program(module, &options);
+    else
+        result = options.is_check ? check_program(module, &options) : run_program(module, &options);
+    free_object_module(module);
+    release_jit();
+    free_all_memory();
+    return result;
+}
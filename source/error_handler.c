@@ -13,6 +13,13 @@ Error errors[] = {
         {Error_103, "Unable to open existing file for read access"},
         {Error_104, "Unable to create output file for write access"},
         {Error_105, "Out of memory; continuing to scan lines"},
+        {Error_106, "Unrecognized command-line option"},
+        {Error_107, "Command-line option is missing its argument"},
+        {Error_108, "Host command failed"},
+        {Error_109, "Manifest line must name a program, an input file and an expected output file"},
+        {Error_110, "Label is not a code label of the program"},
+        {Error_111, "Command-line options can not be combined"},
+        {Error_112, "Coverage of a program that writes into its own code is not supported"},
 
         /* Syntax errors */
         {Error_200, "Source names must be provided without the .as"},
@@ -79,6 +86,29 @@ Error errors[] = {
         {Error_261, "operand Unrecognized, verify syntax"},
         {Error_262, "operand invalid, reserved words and macro names are not allowed"},
         {Error_263, "entry Symbol marked as .entry was never defined"},
+        {Error_264, "wrong number of values when using .zero or .fill; expected: .zero N or .fill N, value"},
+        {Error_265, "the count must be a positive number when using .zero or .fill"},
+        {Error_266, "numeric literal outside the permitted range when using .zero or .fill"},
+
+        /* Link errors */
+        {Error_300, "Object file is malformed"},
+        {Error_301, "Symbol is exported by more than one module"},
+        {Error_302, "Linked image exceeds the memory capacity"},
+        {Error_303, "External symbol is not exported by any linked module"},
+        {Error_304, "Relocated address does not fit in the 8-bit address field"},
+        {Error_305, "Archive file is malformed"},
+        {Error_306, "Snapshot file is malformed or was taken from another program"},
+        {Error_307, "Trace file is malformed"},
+        {Error_308, "Symbol file is malformed"},
+
+        /* Runtime errors */
+        {Error_400, "Invalid instruction word"},
+        {Error_401, "Memory access outside of the machine memory"},
+        {Error_402, "Call stack overflow"},
+        {Error_403, "Return with an empty call stack"},
+        {Error_404, "External symbol is not resolved, link the program before running it"},
+        {Error_405, "Write into the code of a translated program"},
+        {Error_406, "Program does not fit in the machine memory"},
 };
 
 static const char* look_up_error_message(int error_code) {
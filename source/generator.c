@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "error_handler.h"
+#include "program_generator.h"
+#include "utils.h"
+#include "definitions.h"
+
+/* Instructions of the main code when no "-n" option is given */
+#define DEFAULT_INSTRUCTIONS_COUNT 40
+
+/**
+ * This is the main function of the program generator, it writes a random program that assembles without errors.
+ * The program is written to name.as, it runs the same on every engine of the emulator (see the "-d" option of the
+ * emulator), which is what it is for.
+ * The option "-s seed" sets the seed of the random numbers (1 by default), the same seed writes the same program.
+ * The option "-n instructions" sets the number of instructions of the main code to aim for, the program stops
+ * growing earlier when it would not fit in the memory of the machine.
+ * The option "-w" lets the program write into its own code.
+ * argc: The number of command-line arguments.
+ * argv: An array of strings containing the command-line arguments.
+ * return Returns 0 if the program was written, 1 otherwise.
+ */
+
+int main(int argc, char *argv[]) {
+    int i, is_self_modifying = 0, instructions_count = DEFAULT_INSTRUCTIONS_COUNT, words;
+    unsigned long seed = 1;
+    char *program_name = NULL, *file_as_name;
+    FILE *file;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "-n") == 0) {
+            if (i + 1 == argc) {
+                log_system_error(Error_107);
+                return 1;  /* Indicates faliure */
+            }
+            if (argv[i++][1] == 's')
+                seed = strtoul(argv[i], NULL, BASE_10);
+            else
+                instructions_count = atoi(argv[i]);
+        }
+        else if (strcmp(argv[i], "-w") == 0)
+            is_self_modifying = 1;
+        else if (argv[i][0] == MINUS_SIGN) {
+            printf(" Unrecognized option \"%s\"", argv[i]);
+            log_system_error(Error_106);
+            return 1;  /* Indicates faliure */
+        }
+        else
+            program_name = argv[i];
+    }
+    if (program_name == NULL) {  /* Checking if no program was entered */
+        log_system_error(Error_100);
+        return 1;  /* Indicates faliure */
+    }
+    if ((file_as_name = add_extension(program_name, ".as")) == NULL)
+        return 1;  /* Indicates faliure */
+    if ((file = fopen(file_as_name, "w")) == NULL) {
+        printf(" File \"%s\"", file_as_name);
+        log_system_error(Error_104);
+        free_all_memory();
+        return 1;  /* Indicates faliure */
+    }
+    words = generate_program(file, seed, instructions_count, is_self_modifying);
+    fclose(file);
+    printf("Program \"%s\" written: seed %lu, %d memory words\n", file_as_name, seed, words);
+    free_all_memory();
+    return 0;
+}
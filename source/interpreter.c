@@ -0,0 +1,357 @@
+/**
+ * This file runs the predecoded instructions of a machine.
+ * Each handler executes one instruction (or one superinstruction) and dispatches the next one directly,
+ * there is no central loop when computed goto is available.
+ */
+#include <stdio.h>
+#include "interpreter.h"
+#include "machine.h"
+#include "error_handler.h"
+#include "definitions.h"
+
+#if defined(__GNUC__) && !defined(NO_COMPUTED_GOTO)
+#define USE_COMPUTED_GOTO
+#endif
+
+#ifdef USE_COMPUTED_GOTO
+#define HANDLER(label, handler) label:
+/* Labels as values are a GNU extension, marked as such so the rest of the file stays pedantic */
+#define LABEL_ADDRESS(label) __extension__ &&label
+#define DISPATCH() do { instruction = &decoded[pc]; executed++; \
+    _Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Wpedantic\"") \
+    goto *instruction->code; \
+    _Pragma("GCC diagnostic pop") } while (0)
+#else
+#define HANDLER(label, handler) case handler:
+#define DISPATCH() goto dispatch
+#endif
+
+/* Resolves the cell of a memory or register operand, leaving the handler if a matrix element is outside of the memory */
+#define RESOLVE(op, resolved) \
+    if ((op)->kind == OPERAND_CELL) \
+        resolved = (op)->location; \
+    else if ((resolved = operand_address(machine, op)) == -1) \
+        goto memory_fault;
+
+/* Reads the value of an operand */
+#define FETCH(op, fetched) \
+    if ((op)->kind == OPERAND_IMMEDIATE) \
+        fetched = (op)->value; \
+    else \
+    { \
+        RESOLVE(op, cell); \
+        fetched = cells[cell]; \
+    }
+
+/* Writes a cell, invalidating the decoded instructions that contain it and logging the write for a trace */
+#define STORE(stored, result) \
+    cells[stored] = (unsigned short)((result) & MASK_10_BITS); \
+    if ((stored) < MACHINE_MEMORY_SIZE && machine->is_decoded_word[stored]) \
+        invalidate_decoded(machine, stored); \
+    if (write_log != NULL) \
+    { \
+        write_log[machine->write_log_count].executed = executed; \
+        write_log[machine->write_log_count].cell = (unsigned short)(stored); \
+        write_log[machine->write_log_count++].value = cells[stored]; \
+    }
+
+/* Computes the target address of a jump, leaving the handler if it is outside of the memory */
+#define TARGET(op, address) \
+    if ((op)->kind == OPERAND_CELL && (op)->location < MACHINE_MEMORY_SIZE) \
+        address = (op)->location; \
+    else if ((address = operand_address(machine, op)) < 0 || address >= MACHINE_MEMORY_SIZE) \
+        goto memory_fault;
+
+/* Stops the machine on control transfers once the step limit was reached */
+#define CHECK_LIMIT() \
+    if (executed >= limit) \
+    { \
+        machine->status = MACHINE_STEP_LIMIT; \
+        goto leave; \
+    }
+
+/* Counts the entry into the target of a control transfer */
+#define COUNT_ENTRY() machine->block_entries[pc]++;
+
+/* Reads a register or an immediate operand of a superinstruction */
+#define REGISTER_VALUE(op) ((op)->kind == OPERAND_IMMEDIATE ? (op)->value : cells[(op)->location])
+
+/* Writes a register from a superinstruction, registers are never part of the decoded code */
+#define STORE_REGISTER(stored, result) \
+    cells[stored] = (unsigned short)((result) & MASK_10_BITS); \
+    if (write_log != NULL) \
+    { \
+        write_log[machine->write_log_count].executed = executed; \
+        write_log[machine->write_log_count].cell = (unsigned short)(stored); \
+        write_log[machine->write_log_count++].value = cells[stored]; \
+    }
+
+/* Ends a superinstruction with its "bne", the zero flag of its "cmp" is set */
+#define FUSED_BNE(bne) \
+    pc = zero_flag ? (bne)->next : (bne)->destination.location; \
+    COUNT_ENTRY(); \
+    CHECK_LIMIT();
+
+/* Writes a value the way "prn" prints it, in decimal and followed by a new line, returns the number of characters */
+static int format_value(char *text, int value)
+{
+    char digits[MAX_PRINTED_LENGTH];
+    int length = 0, count = 0;
+
+    if (value < 0)
+    {
+        text[length++] = MINUS_SIGN;
+        value = -value;
+    }
+    do
+    {
+        digits[count++] = (char)('0' + value % BASE_10);
+        value /= BASE_10;
+    } while (value > 0);
+    while (count > 0)
+        text[length++] = digits[--count];
+    text[length++] = '\n';
+    return length;
+}
+
+/* Reads the next input character of the machine, -1 at the end of the input */
+static int read_character(Machine *machine)
+{
+    int character;
+
+    if (machine->input == NULL)
+    {
+        if ((character = getchar()) == EOF)
+            return -1;
+        machine->input_position++; /* The characters read from the standard input are counted for snapshots */
+        return character;
+    }
+    if (machine->input_position >= machine->input_size)
+        return -1;
+    return machine->input[machine->input_position++];
+}
+
+int run_machine(Machine *machine, unsigned long max_steps)
+{
+    unsigned short *cells = machine->cells;
+    Decoded_Instruction *decoded = machine->decoded, *instruction = NULL, *second, *third;
+    Word_Write *write_log = machine->write_log;
+    unsigned long executed = machine->executed, limit = max_steps == 0 ? (unsigned long)-1 : executed + max_steps;
+    int pc = machine->pc, zero_flag = machine->zero_flag, cell, target, value, second_value, error_code = 0;
+#ifdef USE_COMPUTED_GOTO
+    static const void *const codes[TOTAL_HANDLERS] = {
+        LABEL_ADDRESS(op_mov), LABEL_ADDRESS(op_cmp), LABEL_ADDRESS(op_add), LABEL_ADDRESS(op_sub),
+        LABEL_ADDRESS(op_lea), LABEL_ADDRESS(op_clr), LABEL_ADDRESS(op_not), LABEL_ADDRESS(op_inc),
+        LABEL_ADDRESS(op_dec), LABEL_ADDRESS(op_jmp), LABEL_ADDRESS(op_bne), LABEL_ADDRESS(op_jsr),
+        LABEL_ADDRESS(op_red), LABEL_ADDRESS(op_prn), LABEL_ADDRESS(op_rts), LABEL_ADDRESS(op_stop),
+        LABEL_ADDRESS(op_decode), LABEL_ADDRESS(op_invalid), LABEL_ADDRESS(op_cmp_bne), LABEL_ADDRESS(op_inc_cmp_bne),
+        LABEL_ADDRESS(op_mov_add), LABEL_ADDRESS(op_break)};
+
+    /* Binding the handler addresses into the decoded records */
+    if (machine->handler_codes != codes)
+    {
+        machine->handler_codes = codes;
+        for (cell = 0; cell <= MACHINE_MEMORY_SIZE; cell++)
+            decoded[cell].code = codes[decoded[cell].handler];
+    }
+#endif
+    if (machine->status != MACHINE_RUNNING)
+        return machine->status;
+    COUNT_ENTRY();
+
+#ifdef USE_COMPUTED_GOTO
+    DISPATCH();
+#else
+dispatch:
+    instruction = &decoded[pc];
+    executed++;
+    switch (instruction->handler)
+    {
+#endif
+
+    HANDLER(op_mov, 0)
+        pc = instruction->next;
+        FETCH(&instruction->source, value);
+        RESOLVE(&instruction->destination, target);
+        STORE(target, value);
+        DISPATCH();
+
+    HANDLER(op_cmp, 1)
+        pc = instruction->next;
+        FETCH(&instruction->source, value);
+        FETCH(&instruction->destination, second_value);
+        zero_flag = ((value - second_value) & MASK_10_BITS) == 0;
+        DISPATCH();
+
+    HANDLER(op_add, 2)
+        pc = instruction->next;
+        FETCH(&instruction->source, value);
+        RESOLVE(&instruction->destination, target);
+        STORE(target, cells[target] + value);
+        DISPATCH();
+
+    HANDLER(op_sub, 3)
+        pc = instruction->next;
+        FETCH(&instruction->source, value);
+        RESOLVE(&instruction->destination, target);
+        STORE(target, cells[target] - value);
+        DISPATCH();
+
+    HANDLER(op_lea, 4)
+        pc = instruction->next;
+        if ((value = operand_address(machine, &instruction->source)) == -1)
+            goto memory_fault;
+        RESOLVE(&instruction->destination, target);
+        STORE(target, value);
+        DISPATCH();
+
+    HANDLER(op_clr, 5)
+        pc = instruction->next;
+        RESOLVE(&instruction->destination, target);
+        STORE(target, 0);
+        DISPATCH();
+
+    HANDLER(op_not, 6)
+        pc = instruction->next;
+        RESOLVE(&instruction->destination, target);
+        STORE(target, ~cells[target]);
+        DISPATCH();
+
+    HANDLER(op_inc, 7)
+        pc = instruction->next;
+        RESOLVE(&instruction->destination, target);
+        STORE(target, cells[target] + 1);
+        DISPATCH();
+
+    HANDLER(op_dec, 8)
+        pc = instruction->next;
+        RESOLVE(&instruction->destination, target);
+        STORE(target, cells[target] - 1);
+        DISPATCH();
+
+    HANDLER(op_jmp, 9)
+        TARGET(&instruction->destination, pc);
+        COUNT_ENTRY();
+        CHECK_LIMIT();
+        DISPATCH();
+
+    HANDLER(op_bne, 10)
+        if (zero_flag)
+            pc = instruction->next;
+        else
+        {
+            TARGET(&instruction->destination, pc);
+        }
+        COUNT_ENTRY();
+        CHECK_LIMIT();
+        DISPATCH();
+
+    HANDLER(op_jsr, 11)
+        if (machine->sp == MACHINE_STACK_DEPTH)
+        {
+            error_code = Error_402;
+            goto fault;
+        }
+        TARGET(&instruction->destination, target);
+        machine->stack[machine->sp++] = instruction->next;
+        pc = target;
+        COUNT_ENTRY();
+        CHECK_LIMIT();
+        DISPATCH();
+
+    HANDLER(op_red, 12)
+        pc = instruction->next;
+        RESOLVE(&instruction->destination, target);
+        STORE(target, read_character(machine));
+        DISPATCH();
+
+    HANDLER(op_prn, 13)
+        pc = instruction->next;
+        FETCH(&instruction->destination, value);
+        if (machine->output_length > MACHINE_OUTPUT_BUFFER_SIZE - MAX_PRINTED_LENGTH)
+            flush_output(machine);
+        machine->output_length += format_value(machine->output_buffer + machine->output_length,
+                                               SIGN_EXTEND_10_BITS(value));
+        DISPATCH();
+
+    HANDLER(op_rts, 14)
+        if (machine->sp == 0)
+        {
+            error_code = Error_403;
+            goto fault;
+        }
+        pc = machine->stack[--machine->sp];
+        COUNT_ENTRY();
+        CHECK_LIMIT();
+        DISPATCH();
+
+    HANDLER(op_stop, 15)
+        machine->status = MACHINE_HALTED;
+        goto leave;
+
+    HANDLER(op_decode, HANDLER_DECODE)
+        /* The instruction is decoded again and then executed, without counting this step */
+        predecode_address(machine, pc);
+        executed--;
+        DISPATCH();
+
+    HANDLER(op_invalid, HANDLER_INVALID)
+        error_code = pc >= MACHINE_MEMORY_SIZE ? Error_401 : Error_400;
+        goto fault;
+
+    /* The superinstructions only have register and immediate operands, see fuse_superinstructions() */
+    HANDLER(op_cmp_bne, HANDLER_CMP_BNE)
+        second = &decoded[instruction->next];
+        executed++;
+        zero_flag = ((REGISTER_VALUE(&instruction->source) - REGISTER_VALUE(&instruction->destination)) &
+                     MASK_10_BITS) == 0;
+        FUSED_BNE(second);
+        DISPATCH();
+
+    HANDLER(op_inc_cmp_bne, HANDLER_INC_CMP_BNE)
+        second = &decoded[instruction->next];
+        third = &decoded[second->next];
+        STORE_REGISTER(instruction->destination.location, cells[instruction->destination.location] + 1);
+        executed += 2;
+        zero_flag = ((REGISTER_VALUE(&second->source) - REGISTER_VALUE(&second->destination)) & MASK_10_BITS) == 0;
+        FUSED_BNE(third);
+        DISPATCH();
+
+    HANDLER(op_mov_add, HANDLER_MOV_ADD)
+        second = &decoded[instruction->next];
+        STORE_REGISTER(instruction->destination.location, REGISTER_VALUE(&instruction->source));
+        executed++;
+        STORE_REGISTER(second->destination.location,
+                       cells[second->destination.location] + REGISTER_VALUE(&second->source));
+        pc = second->next;
+        DISPATCH();
+
+    HANDLER(op_break, HANDLER_BREAK)
+        /* The instruction at the breakpoint is not executed */
+        executed--;
+        machine->status = MACHINE_BREAK;
+        goto leave;
+
+#ifndef USE_COMPUTED_GOTO
+    }
+#endif
+
+memory_fault:
+    error_code = Error_401;
+fault:
+    pc = (int)(instruction - decoded); /* The fault is reported at the faulting instruction */
+    if (machine->output_length > 0) /* The output comes before the report of the fault */
+        flush_output(machine);
+    machine->pc = pc;
+    machine->zero_flag = zero_flag;
+    machine->executed = executed;
+    fault_machine(machine, error_code);
+    return machine->status;
+leave:
+    if (machine->output_length > 0)
+        flush_output(machine);
+    machine->pc = pc;
+    machine->zero_flag = zero_flag;
+    machine->executed = executed;
+    return machine->status;
+}
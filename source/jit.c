@@ -0,0 +1,707 @@
+/**
+ * This file translates the basic blocks of a machine into x86-64 code and runs them.
+ * Register usage of the translated code:
+ *   - r8d-r15d hold the registers r0-r7, always as 10-bit values.
+ *   - rbp points to the machine, memory words, the call stack and the counters are addressed from it.
+ *   - rbx holds the difference computed by the last "cmp", the zero flag is set when it is 0.
+ *   - rdi holds the number of executed instructions and rsi the step limit.
+ *   - rax, rcx and rdx are scratch registers.
+ * The entry routine saves the host registers, loads the machine state and jumps to a block. The exit routine stores
+ * the state back and returns the reason for leaving, with the address to continue at in the pc of the machine.
+ * Every check that may fail (matrix bounds, call stack, writes into decoded instructions) is done before the
+ * instruction changes anything, so leaving to the interpreter at that instruction runs it from its start.
+ * This file defines static variables for the buffer and the translated blocks, since they outlive a single
+ * translation and the entry routine is shared by all of the runs.
+ */
+#ifdef __linux__
+#define _GNU_SOURCE /* mmap() of anonymous memory is not part of ANSI C */
+#endif
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "jit.h"
+#include "interpreter.h"
+#include "machine.h"
+#include "definitions.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+static Jit_Statistics statistics;
+
+#ifdef JIT_SUPPORTED
+
+/* Translation limits */
+#define JIT_BUFFER_SIZE (1L << 20)
+#define MAX_BLOCK_INSTRUCTIONS 64
+#define MAX_INSTRUCTION_CODE 320       /* Bytes of an instruction and its side exits, with room to spare */
+#define MAX_SIDE_EXITS (MAX_BLOCK_INSTRUCTIONS * 4 + 4)
+
+/* Host registers, the registers of the machine are GUEST_REGISTER(0) to GUEST_REGISTER(7) */
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI };
+#define GUEST_REGISTER(reg) (8 + (reg))
+#define SIGN_SHIFT 22                  /* Moves the sign bit of a 10-bit value to bit 31 */
+
+/* Condition codes of conditional jumps */
+#define CONDITION_ALWAYS -1
+#define CONDITION_ABOVE_OR_EQUAL 3
+#define CONDITION_EQUAL 4
+#define CONDITION_NOT_EQUAL 5
+
+/* Opcodes of the x86-64 instructions, the ones above 0xFF start with the 0x0F escape byte */
+#define X86_ADD 0x01
+#define X86_SUB 0x29
+#define X86_CMP 0x39
+#define X86_GROUP_IMMEDIATE_8 0x80     /* Byte operation with an 8-bit immediate, the operation is in the reg field */
+#define X86_GROUP_IMMEDIATE 0x81       /* Operation with a 32-bit immediate, the operation is in the reg field */
+#define X86_TEST 0x85
+#define X86_STORE 0x89
+#define X86_LOAD 0x8B
+#define X86_SHIFT 0xC1
+#define X86_GROUP_UNARY 0xF7
+#define X86_GROUP_INCREMENT 0xFF
+#define X86_LOAD_WORD 0x0FB7           /* movzx r32, word */
+#define X86_OPERAND_SIZE_16 0x66
+
+/* Operations in the reg field of the group opcodes */
+#define GROUP_ADD 0
+#define GROUP_NOT 2
+#define GROUP_AND 4
+#define GROUP_SHIFT_LEFT 4
+#define GROUP_SUB 5
+#define GROUP_SHIFT_RIGHT_ARITHMETIC 7
+#define GROUP_CMP 7
+
+/* Offsets of the machine state from rbp */
+#define FIELD_OFFSET(field) ((long)offsetof(Machine, field))
+#define CELL_OFFSET(cell) (FIELD_OFFSET(cells) + 2L * (cell))
+
+/* Reasons for leaving the translated code */
+typedef enum Exit_Reason {
+    EXIT_HALT,       /* Reached "stop" */
+    EXIT_LIMIT,      /* Reached the step limit */
+    EXIT_LOOKUP,     /* An indirect target was not translated */
+    EXIT_CHAIN,      /* A direct target was not translated, the jump is patched once it is */
+    EXIT_FALLBACK    /* The interpreter runs the instruction */
+} Exit_Reason;
+
+/* Side exit struct definition, the code of a side exit is placed after the code of its block */
+typedef struct Side_Exit {
+    long position;   /* Position of the displacement of the jump to the side exit */
+    int reason;
+    int pc;          /* Address to continue at, -1 when it was computed into ecx */
+    int count;       /* Number of instructions executed in the block before leaving */
+} Side_Exit;
+
+/* Entry routine: runs translated code with the machine, until it leaves, and returns the exit reason */
+typedef int (*Entry_Routine)(Machine *machine, const void *code, void *const *blocks, unsigned long limit,
+                             unsigned long *site);
+
+static unsigned char *buffer = NULL;
+static long used, runtime_size, exit_routine;
+static int is_writable;
+static void *blocks[MACHINE_MEMORY_SIZE + 1];   /* Translated code of the blocks by their first address */
+static unsigned long generation;                /* Number of times the translated code was discarded */
+static Side_Exit side_exits[MAX_SIDE_EXITS];
+static int side_exits_count;
+static int current_address, current_count;      /* The instruction being translated, for its side exits */
+
+static void emit_byte(int byte)
+{
+    buffer[used++] = (unsigned char)byte;
+}
+
+static void emit_int32(long value)
+{
+    unsigned long bits = (unsigned long)value;
+    int i;
+
+    for (i = 0; i < 4; i++)
+        emit_byte((int)((bits >> (8 * i)) & 0xFF));
+}
+
+static void emit_sequence(const char *bytes, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+        emit_byte((unsigned char)bytes[i]);
+}
+
+/* Emits the REX prefix when needed and the opcode */
+static void emit_opcode(int opcode, int is_wide, int reg, int index, int base)
+{
+    int rex = 0x40 | (is_wide ? 8 : 0) | ((reg & 8) >> 1) | ((index & 8) >> 2) | ((base & 8) >> 3);
+
+    if (rex != 0x40)
+        emit_byte(rex);
+    if (opcode > 0xFF)
+        emit_byte(opcode >> 8);
+    emit_byte(opcode & 0xFF);
+}
+
+/* Emits an instruction with two register operands, reg is the operation for the group opcodes */
+static void emit_register(int opcode, int is_wide, int reg, int rm)
+{
+    emit_opcode(opcode, is_wide, reg, 0, rm);
+    emit_byte(0xC0 | (reg & 7) << 3 | (rm & 7));
+}
+
+/* Emits an instruction with a memory operand at rbp + index * (1 << scale) + displacement, index is -1 for none */
+static void emit_memory(int opcode, int is_wide, int reg, int index, int scale, long displacement)
+{
+    emit_opcode(opcode, is_wide, reg, index < 0 ? 0 : index, RBP);
+    if (index < 0)
+        emit_byte(0x80 | (reg & 7) << 3 | RBP);
+    else
+    {
+        emit_byte(0x80 | (reg & 7) << 3 | RSP); /* A SIB byte follows */
+        emit_byte(scale << 6 | (index & 7) << 3 | RBP);
+    }
+    emit_int32(displacement);
+}
+
+static void emit_move_immediate(int reg, long value)
+{
+    emit_opcode(0xB8 + (reg & 7), 0, 0, 0, reg);
+    emit_int32(value);
+}
+
+static void emit_immediate(int operation, int reg, long value)
+{
+    emit_register(X86_GROUP_IMMEDIATE, 0, operation, reg);
+    emit_int32(value);
+}
+
+static void emit_sign_extension(int reg)
+{
+    emit_register(X86_SHIFT, 0, GROUP_SHIFT_LEFT, reg);
+    emit_byte(SIGN_SHIFT);
+    emit_register(X86_SHIFT, 0, GROUP_SHIFT_RIGHT_ARITHMETIC, reg);
+    emit_byte(SIGN_SHIFT);
+}
+
+/* Emits a jump with a 32-bit displacement to be patched, returns the position of the displacement */
+static long emit_jump(int condition)
+{
+    if (condition == CONDITION_ALWAYS)
+        emit_byte(0xE9);
+    else
+    {
+        emit_byte(0x0F);
+        emit_byte(0x80 | condition);
+    }
+    emit_int32(0);
+    return used - 4;
+}
+
+static void patch_jump(long position, long target)
+{
+    long saved = used;
+
+    used = position;
+    emit_int32(target - (position + 4));
+    used = saved;
+}
+
+/* Emits the code that leaves the translated code */
+static void emit_exit(int reason, int pc, int count, long site)
+{
+    if (count > 0)
+    {
+        emit_register(X86_GROUP_IMMEDIATE, 1, GROUP_ADD, RDI);
+        emit_int32(count);
+    }
+    if (pc >= 0)
+        emit_move_immediate(RCX, pc);
+    if (reason == EXIT_CHAIN)
+        emit_move_immediate(RDX, site);
+    emit_move_immediate(RAX, reason);
+    patch_jump(emit_jump(CONDITION_ALWAYS), exit_routine);
+}
+
+static void add_side_exit(long position, int reason, int pc, int count)
+{
+    side_exits[side_exits_count].position = position;
+    side_exits[side_exits_count].reason = reason;
+    side_exits[side_exits_count].pc = pc;
+    side_exits[side_exits_count].count = count;
+    side_exits_count++;
+}
+
+/* Leaves to the interpreter at the start of the current instruction when the condition holds */
+static void emit_fallback_check(int condition)
+{
+    add_side_exit(emit_jump(condition), EXIT_FALLBACK, current_address, current_count);
+}
+
+/* Emits the entry and exit routines at the start of the buffer */
+static void emit_runtime(void)
+{
+    int i;
+
+    /* Saving the callee-saved registers, then the site pointer (r8), the blocks (rdx) and the limit (rcx) */
+    emit_sequence("\x53\x55\x41\x54\x41\x55\x41\x56\x41\x57\x41\x50\x52\x51", 14);
+    emit_sequence("\x48\x89\xFD\x48\x89\xF0", 6); /* mov rbp, rdi; mov rax, rsi */
+    for (i = 0; i < TOTAL_REGISTERS; i++)
+        emit_memory(X86_LOAD_WORD, 0, GUEST_REGISTER(i), -1, 0, CELL_OFFSET(REGISTER_CELL(i)));
+    emit_memory(X86_LOAD, 0, RCX, -1, 0, FIELD_OFFSET(zero_flag));
+    emit_sequence("\x31\xDB\x85\xC9\x0F\x94\xC3", 7); /* xor ebx, ebx; test ecx, ecx; sete bl */
+    emit_memory(X86_LOAD, 1, RDI, -1, 0, FIELD_OFFSET(executed));
+    emit_sequence("\x48\x8B\x34\x24\xFF\xE0", 6); /* mov rsi, [rsp]; jmp rax */
+
+    exit_routine = used;
+    emit_memory(X86_STORE, 0, RCX, -1, 0, FIELD_OFFSET(pc));
+    emit_memory(X86_STORE, 1, RDI, -1, 0, FIELD_OFFSET(executed));
+    emit_sequence("\x85\xDB\x0F\x94\xC1\x0F\xB6\xC9", 8); /* test ebx, ebx; sete cl; movzx ecx, cl */
+    emit_memory(X86_STORE, 0, RCX, -1, 0, FIELD_OFFSET(zero_flag));
+    for (i = 0; i < TOTAL_REGISTERS; i++)
+    {
+        emit_byte(X86_OPERAND_SIZE_16);
+        emit_memory(X86_STORE, 0, GUEST_REGISTER(i), -1, 0, CELL_OFFSET(REGISTER_CELL(i)));
+    }
+    /* Storing the chain site (rdx) through the site pointer, then restoring the host registers */
+    emit_sequence("\x48\x8B\x4C\x24\x10\x48\x89\x11\x48\x83\xC4\x18", 12);
+    emit_sequence("\x41\x5F\x41\x5E\x41\x5D\x41\x5C\x5D\x5B\xC3", 11);
+    runtime_size = used;
+}
+
+/* Computes the address of a matrix element into eax, leaving to the interpreter if it is outside of the memory */
+static void emit_matrix_address(Operand *operand)
+{
+    emit_register(X86_STORE, 0, GUEST_REGISTER(operand->row), RAX);
+    emit_register(X86_STORE, 0, GUEST_REGISTER(operand->column), RDX);
+    emit_sign_extension(RAX);
+    emit_sign_extension(RDX);
+    emit_register(X86_ADD, 0, RDX, RAX);
+    emit_immediate(GROUP_ADD, RAX, operand->location);
+    emit_immediate(GROUP_CMP, RAX, MACHINE_MEMORY_SIZE);
+    emit_fallback_check(CONDITION_ABOVE_OR_EQUAL);
+}
+
+/* Loads the value of an operand, returns the host register holding it (a register of the machine is not copied) */
+static int emit_fetch(Operand *operand, int scratch)
+{
+    switch (operand->kind)
+    {
+    case OPERAND_IMMEDIATE:
+        emit_move_immediate(scratch, operand->value);
+        return scratch;
+    case OPERAND_MATRIX:
+        emit_matrix_address(operand);
+        emit_memory(X86_LOAD_WORD, 0, scratch, RAX, 1, CELL_OFFSET(0));
+        return scratch;
+    default:
+        if (operand->location >= MACHINE_MEMORY_SIZE)
+            return GUEST_REGISTER(operand->location - MACHINE_MEMORY_SIZE);
+        emit_memory(X86_LOAD_WORD, 0, scratch, -1, 0, CELL_OFFSET(operand->location));
+        return scratch;
+    }
+}
+
+/**
+ * Prepares the destination of an instruction, returns the host register its new value is computed in.
+ * A register of the machine is computed in place. A memory word is computed in edx, after checking that it does not
+ * belong to a decoded instruction, and the address of a matrix element is left in eax for the store.
+ */
+static int emit_destination(Operand *operand, int is_read)
+{
+    if (operand->kind == OPERAND_CELL && operand->location >= MACHINE_MEMORY_SIZE)
+        return GUEST_REGISTER(operand->location - MACHINE_MEMORY_SIZE);
+    if (operand->kind == OPERAND_MATRIX)
+    {
+        emit_matrix_address(operand);
+        emit_memory(X86_GROUP_IMMEDIATE_8, 0, GROUP_CMP, RAX, 0, FIELD_OFFSET(is_decoded_word));
+        emit_byte(0);
+        emit_fallback_check(CONDITION_NOT_EQUAL);
+        if (is_read)
+            emit_memory(X86_LOAD_WORD, 0, RDX, RAX, 1, CELL_OFFSET(0));
+    }
+    else
+    {
+        emit_memory(X86_GROUP_IMMEDIATE_8, 0, GROUP_CMP, -1, 0, FIELD_OFFSET(is_decoded_word) + operand->location);
+        emit_byte(0);
+        emit_fallback_check(CONDITION_NOT_EQUAL);
+        if (is_read)
+            emit_memory(X86_LOAD_WORD, 0, RDX, -1, 0, CELL_OFFSET(operand->location));
+    }
+    return RDX;
+}
+
+static void emit_store(Operand *operand, int reg)
+{
+    if (reg != RDX)
+        return; /* Computed in place */
+    emit_byte(X86_OPERAND_SIZE_16);
+    if (operand->kind == OPERAND_MATRIX)
+        emit_memory(X86_STORE, 0, RDX, RAX, 1, CELL_OFFSET(0));
+    else
+        emit_memory(X86_STORE, 0, RDX, -1, 0, CELL_OFFSET(operand->location));
+}
+
+/* Translates the instructions that compute a value ("mov" to "dec", except "cmp") */
+static void emit_operation(Decoded_Instruction *instruction)
+{
+    int opcode = instruction->handler, source = RCX, target;
+
+    if (opcode == MOV_OPCODE || opcode == ADD_OPCODE || opcode == SUB_OPCODE)
+        source = emit_fetch(&instruction->source, RCX);
+    else if (opcode == LEA_OPCODE)
+    { /* The address of a memory word, or the value of a register */
+        if (instruction->source.location < MACHINE_MEMORY_SIZE)
+            emit_move_immediate(RCX, instruction->source.location);
+        else
+            source = GUEST_REGISTER(instruction->source.location - MACHINE_MEMORY_SIZE);
+    }
+    target = emit_destination(&instruction->destination, opcode != MOV_OPCODE && opcode != LEA_OPCODE &&
+                                                             opcode != CLR_OPCODE);
+    switch (opcode)
+    {
+    case MOV_OPCODE:
+    case LEA_OPCODE:
+        if (source != target)
+            emit_register(X86_STORE, 0, source, target);
+        break;
+    case ADD_OPCODE:
+        emit_register(X86_ADD, 0, source, target);
+        break;
+    case SUB_OPCODE:
+        emit_register(X86_SUB, 0, source, target);
+        break;
+    case CLR_OPCODE:
+        emit_move_immediate(target, 0);
+        break;
+    case NOT_OPCODE:
+        emit_register(X86_GROUP_UNARY, 0, GROUP_NOT, target);
+        break;
+    case INC_OPCODE:
+        emit_immediate(GROUP_ADD, target, 1);
+        break;
+    default: /* DEC_OPCODE */
+        emit_immediate(GROUP_SUB, target, 1);
+        break;
+    }
+    if (opcode != MOV_OPCODE && opcode != LEA_OPCODE && opcode != CLR_OPCODE)
+        emit_immediate(GROUP_AND, target, MASK_10_BITS);
+    emit_store(&instruction->destination, target);
+}
+
+static void emit_compare(Decoded_Instruction *instruction)
+{
+    int first = emit_fetch(&instruction->source, RCX), second = emit_fetch(&instruction->destination, RDX);
+
+    emit_register(X86_STORE, 0, first, RBX);
+    emit_register(X86_SUB, 0, second, RBX);
+    emit_immediate(GROUP_AND, RBX, MASK_10_BITS);
+}
+
+/* Computes the target of a jump, returns a direct target or -1 when the target is computed into ecx */
+static int emit_target(Operand *operand)
+{
+    if (operand->kind == OPERAND_CELL && operand->location < MACHINE_MEMORY_SIZE)
+        return operand->location;
+    if (operand->kind == OPERAND_MATRIX)
+    {
+        emit_matrix_address(operand);
+        emit_register(X86_STORE, 0, RAX, RCX);
+    }
+    else
+    {
+        emit_register(X86_STORE, 0, GUEST_REGISTER(operand->location - MACHINE_MEMORY_SIZE), RCX);
+        emit_immediate(GROUP_CMP, RCX, MACHINE_MEMORY_SIZE);
+        emit_fallback_check(CONDITION_ABOVE_OR_EQUAL);
+    }
+    return -1;
+}
+
+static void emit_executed(int count)
+{
+    emit_register(X86_GROUP_IMMEDIATE, 1, GROUP_ADD, RDI);
+    emit_int32(count);
+}
+
+/* Jumps to the block at a direct target, through a side exit until the block is translated */
+static void emit_chain(int target)
+{
+    long position = emit_jump(CONDITION_ALWAYS);
+
+    if (blocks[target] != NULL)
+        patch_jump(position, (unsigned char *)blocks[target] - buffer);
+    else
+        add_side_exit(position, EXIT_CHAIN, target, 0);
+}
+
+/* Emits a control transfer: counts the entry into the target, checks the step limit and jumps to the target */
+static void emit_transfer(int target)
+{
+    if (target >= 0)
+        emit_memory(X86_GROUP_INCREMENT, 1, GROUP_ADD, -1, 0, FIELD_OFFSET(block_entries) + 8L * target);
+    else
+        emit_memory(X86_GROUP_INCREMENT, 1, GROUP_ADD, RCX, 3, FIELD_OFFSET(block_entries));
+    emit_register(X86_CMP, 1, RSI, RDI);
+    add_side_exit(emit_jump(CONDITION_ABOVE_OR_EQUAL), EXIT_LIMIT, target, 0);
+    if (target >= 0)
+    {
+        emit_chain(target);
+        return;
+    }
+    /* mov rax, [rsp + 8]; mov rax, [rax + rcx * 8]; test rax, rax */
+    emit_sequence("\x48\x8B\x44\x24\x08\x48\x8B\x04\xC8\x48\x85\xC0", 12);
+    add_side_exit(emit_jump(CONDITION_EQUAL), EXIT_LOOKUP, -1, 0);
+    emit_sequence("\xFF\xE0", 2); /* jmp rax */
+}
+
+/* Translates the block that starts at an address, returns its code */
+static void *translate_block(Machine *machine, int start)
+{
+    Decoded_Instruction instruction;
+    int i, address = start, count = 0, is_open = 1, target;
+    long entry, taken;
+
+    entry = used;
+    side_exits_count = 0;
+    while (is_open)
+    {
+        current_address = address;
+        current_count = count;
+        if (address < MACHINE_MEMORY_SIZE && machine->decoded[address].handler == HANDLER_DECODE)
+            predecode_address(machine, address); /* Marks the words of the instruction as decoded */
+        if (address < MACHINE_MEMORY_SIZE)
+            decode_instruction(machine->cells, address, &instruction);
+        else
+            instruction.handler = HANDLER_INVALID;
+
+        switch (instruction.handler)
+        {
+        case MOV_OPCODE:
+        case ADD_OPCODE:
+        case SUB_OPCODE:
+        case LEA_OPCODE:
+        case CLR_OPCODE:
+        case NOT_OPCODE:
+        case INC_OPCODE:
+        case DEC_OPCODE:
+        case CMP_OPCODE:
+            if (instruction.handler == CMP_OPCODE)
+                emit_compare(&instruction);
+            else
+                emit_operation(&instruction);
+            count++;
+            address = instruction.next;
+            if (count == MAX_BLOCK_INSTRUCTIONS)
+            { /* Continuing in the next block, without a control transfer */
+                emit_executed(count);
+                emit_chain(address);
+                is_open = 0;
+            }
+            break;
+        case JMP_OPCODE:
+            target = emit_target(&instruction.destination);
+            emit_executed(count + 1);
+            emit_transfer(target);
+            is_open = 0;
+            break;
+        case BNE_OPCODE:
+            target = emit_target(&instruction.destination);
+            emit_executed(count + 1);
+            emit_sequence("\x85\xDB", 2); /* test ebx, ebx */
+            taken = emit_jump(CONDITION_NOT_EQUAL);
+            emit_transfer(instruction.next);
+            patch_jump(taken, used);
+            emit_transfer(target);
+            is_open = 0;
+            break;
+        case JSR_OPCODE:
+            target = emit_target(&instruction.destination);
+            emit_memory(X86_LOAD, 0, RAX, -1, 0, FIELD_OFFSET(sp));
+            emit_immediate(GROUP_CMP, RAX, MACHINE_STACK_DEPTH);
+            emit_fallback_check(CONDITION_ABOVE_OR_EQUAL);
+            emit_move_immediate(RDX, instruction.next);
+            emit_byte(X86_OPERAND_SIZE_16);
+            emit_memory(X86_STORE, 0, RDX, RAX, 1, FIELD_OFFSET(stack));
+            emit_immediate(GROUP_ADD, RAX, 1);
+            emit_memory(X86_STORE, 0, RAX, -1, 0, FIELD_OFFSET(sp));
+            emit_executed(count + 1);
+            emit_transfer(target);
+            is_open = 0;
+            break;
+        case RTS_OPCODE:
+            emit_memory(X86_LOAD, 0, RAX, -1, 0, FIELD_OFFSET(sp));
+            emit_register(X86_TEST, 0, RAX, RAX);
+            emit_fallback_check(CONDITION_EQUAL);
+            emit_immediate(GROUP_SUB, RAX, 1);
+            emit_memory(X86_STORE, 0, RAX, -1, 0, FIELD_OFFSET(sp));
+            emit_memory(X86_LOAD_WORD, 0, RCX, RAX, 1, FIELD_OFFSET(stack));
+            emit_executed(count + 1);
+            emit_transfer(-1);
+            is_open = 0;
+            break;
+        case STOP_OPCODE:
+            emit_exit(EXIT_HALT, address, count + 1, 0);
+            is_open = 0;
+            break;
+        default: /* "red", "prn" and invalid instructions */
+            emit_exit(EXIT_FALLBACK, address, count, 0);
+            is_open = 0;
+            break;
+        }
+    }
+    for (i = 0; i < side_exits_count; i++)
+    {
+        patch_jump(side_exits[i].position, used);
+        emit_exit(side_exits[i].reason, side_exits[i].pc, side_exits[i].count, side_exits[i].position);
+    }
+    blocks[start] = buffer + entry;
+    statistics.blocks++;
+    statistics.code_size += used - entry;
+    return blocks[start];
+}
+
+/* Discards all of the translated blocks */
+static void flush_translations(void)
+{
+    used = runtime_size;
+    memset(blocks, 0, sizeof(blocks));
+    generation++;
+}
+
+static int set_writable(int is_write)
+{
+    if (is_writable != is_write)
+    {
+        if (mprotect(buffer, JIT_BUFFER_SIZE, is_write ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) != 0)
+            return 1; /* Indicates failure */
+        is_writable = is_write;
+    }
+    return 0; /* Indicates success */
+}
+
+/* Finds the translated block at an address, translating it if needed */
+static void *find_block(Machine *machine, int address)
+{
+    if (blocks[address] != NULL)
+        return blocks[address];
+    if (used + MAX_BLOCK_INSTRUCTIONS * MAX_INSTRUCTION_CODE > JIT_BUFFER_SIZE)
+    {
+        flush_translations();
+        statistics.flushes++;
+    }
+    return translate_block(machine, address);
+}
+
+int is_jit_supported(void)
+{
+    return 1;
+}
+
+int run_jit(Machine *machine, unsigned long max_steps)
+{
+    unsigned long limit = max_steps == 0 ? (unsigned long)-1 : machine->executed + max_steps, site, seen_writes;
+    unsigned long seen_generation;
+    Entry_Routine enter;
+    void *code, *entry_routine;
+    int reason;
+
+    if (machine->status != MACHINE_RUNNING)
+        return machine->status;
+    if (buffer == NULL)
+    {
+        buffer = mmap(NULL, JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buffer == MAP_FAILED)
+        {
+            buffer = NULL;
+            printf(" WARNING | Could not map the JIT buffer, running the interpreter\n");
+            return run_machine(machine, max_steps);
+        }
+        is_writable = 1;
+        used = 0;
+        emit_runtime();
+    }
+    entry_routine = buffer;
+    memcpy(&enter, &entry_routine, sizeof(enter)); /* ISO C has no cast from a data pointer to a function pointer */
+    /* Blocks translated for another run may be stale */
+    flush_translations();
+    seen_writes = machine->code_writes;
+    machine->block_entries[machine->pc]++;
+
+    while (machine->status == MACHINE_RUNNING)
+    {
+        if (set_writable(1) != 0)
+            break;
+        code = find_block(machine, machine->pc);
+        if (set_writable(0) != 0)
+            break;
+        reason = enter(machine, code, blocks, limit, &site);
+        switch (reason)
+        {
+        case EXIT_HALT:
+            machine->status = MACHINE_HALTED;
+            break;
+        case EXIT_LIMIT:
+            machine->status = MACHINE_STEP_LIMIT;
+            break;
+        case EXIT_CHAIN:
+            set_writable(1);
+            seen_generation = generation;
+            code = find_block(machine, machine->pc);
+            if (generation == seen_generation)
+            { /* The jump to the side exit now goes straight to the block */
+                patch_jump((long)site, (unsigned char *)code - buffer);
+                statistics.chained++;
+            }
+            break;
+        case EXIT_FALLBACK:
+            statistics.fallbacks++;
+            machine->block_entries[machine->pc]--; /* The interpreter counts its start as an entry, it is not one */
+            if (run_machine(machine, 1) == MACHINE_STEP_LIMIT && machine->executed < limit)
+                machine->status = MACHINE_RUNNING;
+            if (machine->code_writes != seen_writes)
+            {
+                seen_writes = machine->code_writes;
+                flush_translations();
+                statistics.flushes++;
+            }
+            break;
+        default: /* EXIT_LOOKUP, the block is translated on the next iteration */
+            break;
+        }
+    }
+    if (machine->status == MACHINE_RUNNING)
+    {
+        printf(" WARNING | Could not change the protection of the JIT buffer, running the interpreter\n");
+        return run_machine(machine, limit == (unsigned long)-1 ? 0 : limit - machine->executed);
+    }
+    return machine->status;
+}
+
+void release_jit(void)
+{
+    if (buffer != NULL)
+        munmap(buffer, JIT_BUFFER_SIZE);
+    buffer = NULL;
+}
+
+#else
+
+int is_jit_supported(void)
+{
+    return 0;
+}
+
+int run_jit(Machine *machine, unsigned long max_steps)
+{
+    return run_machine(machine, max_steps);
+}
+
+void release_jit(void)
+{
+}
+
+#endif
+
+Jit_Statistics *retrieve_jit_statistics(void)
+{
+    return &statistics;
+}
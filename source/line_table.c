@@ -0,0 +1,101 @@
+/**
+ * This file handles the map from the instructions of the assembled module to their source lines.
+ * A module has at most one instruction per word, so the lines are kept in a fixed size table.
+ * The lines are written, together with every label of the module, to the symbol file.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "line_table.h"
+#include "symbol_file.h"
+#include "error_handler.h"
+#include "labels_handler.h"
+#include "utils.h"
+#include "definitions.h"
+
+static Source_Line source_lines[MAX_ARRAY_CAPACITY];
+static int source_lines_count = 0;
+
+int add_source_line(int address, int line_num)
+{
+    if (source_lines_count == MAX_ARRAY_CAPACITY)
+        return 1; /* Indicates the table is full */
+    source_lines[source_lines_count].address = address;
+    source_lines[source_lines_count].line_num = line_num;
+    source_lines_count++;
+    return 0; /* Indicates success */
+}
+
+Source_Line *retrieve_source_lines(int *count)
+{
+    *count = source_lines_count;
+    return source_lines;
+}
+
+void create_sym_file(char *file_sym_name)
+{
+    Symbol_Record *symbols;
+    Line_Record lines[MAX_ARRAY_CAPACITY];
+    Label *current;
+    int i, symbols_count = 0;
+
+    for (current = point_label_head(); current != NULL; current = current->next)
+        symbols_count += current->type != OPERAND; /* Operand labels are uses of labels, not definitions */
+    symbols = (Symbol_Record *)calloc(symbols_count > 0 ? symbols_count : 1, sizeof(Symbol_Record));
+    if (symbols == NULL)
+    {
+        log_system_error(Error_101);
+        free_labels();
+        free_all_memory();
+        exit(1); /* Exiting program */
+    }
+    symbols_count = 0;
+    for (current = point_label_head(); current != NULL; current = current->next)
+    {
+        if (current->type == OPERAND)
+            continue;
+        strncpy(symbols[symbols_count].name, current->name, MAX_LABEL_NAME_LENGTH);
+        if (current->type == EXTERN)
+            symbols[symbols_count].flags = SYMBOL_IS_EXTERN;
+        else
+        {
+            symbols[symbols_count].address = current->address;
+            symbols[symbols_count].flags = (current->location == DATA ? SYMBOL_IS_DATA : 0) |
+                                           (current->type == ENTRY ? SYMBOL_IS_ENTRY : 0);
+        }
+        symbols_count++;
+    }
+    for (i = 0; i < source_lines_count; i++)
+    {
+        lines[i].address = source_lines[i].address;
+        lines[i].line_num = source_lines[i].line_num;
+    }
+    if (create_symbol_file(file_sym_name, symbols, symbols_count, lines, source_lines_count) != 0)
+    {
+        free(symbols);
+        free_labels();
+        free_all_memory();
+        exit(1); /* Exiting program */
+    }
+    free(symbols);
+}
+
+void move_source_lines(int *positions)
+{
+    int i, count = 0, position;
+
+    for (i = 0; i < source_lines_count; i++)
+    {
+        position = positions[source_lines[i].address - MEMORY_START_ADDRESS];
+        if (position == -1)
+            continue; /* The instruction was removed */
+        source_lines[count].address = position + MEMORY_START_ADDRESS;
+        source_lines[count++].line_num = source_lines[i].line_num;
+    }
+    source_lines_count = count;
+}
+
+void reset_source_lines()
+{
+    source_lines_count = 0;
+}
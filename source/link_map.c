@@ -0,0 +1,205 @@
+/**
+ * This file handles the link map of a linked image.
+ * The map is written after every successful link and read back by an incremental relink.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "link_map.h"
+#include "error_handler.h"
+#include "utils.h"
+#include "definitions.h"
+
+/* Checksums are kept to 32 bits so maps are portable between hosts */
+#define CHECKSUM_MASK 0xFFFFFFFFUL
+
+/* Adds a number to a checksum (djb2 step) */
+static unsigned long checksum_add(unsigned long checksum, unsigned long value)
+{
+    return ((checksum << 5) + checksum + value) & CHECKSUM_MASK;
+}
+
+/* Adds the names and addresses of a symbol table to a checksum */
+static unsigned long checksum_symbols(unsigned long checksum, Symbol *symbols, int count)
+{
+    int i;
+    char *c;
+
+    for (i = 0; i < count; i++)
+    {
+        for (c = symbols[i].name; *c != STRING_TERMINATOR; c++)
+            checksum = checksum_add(checksum, (unsigned char)*c);
+        checksum = checksum_add(checksum, (unsigned long)symbols[i].address);
+    }
+    return checksum;
+}
+
+unsigned long module_checksum(Object_Module *module)
+{
+    int i;
+    unsigned long checksum = 5381;
+
+    for (i = 0; i < module->code_size + module->data_size; i++)
+        checksum = checksum_add(checksum, module->words[i]);
+    checksum = checksum_symbols(checksum, module->entries, module->entries_count);
+    /* External words are all zero until they are resolved, so their addresses must be part of the checksum */
+    return checksum_symbols(checksum, module->extern_uses, module->extern_uses_count);
+}
+
+int write_link_map(char *output_name, Object_Module **modules, int modules_count, Link_Layout *layout)
+{
+    int i, j;
+    char *file_name = add_extension(output_name, ".map");
+    Object_Module *module;
+    FILE *file_map;
+
+    if (file_name == NULL)
+        return 1; /* Indicates failure */
+    file_map = fopen(file_name, "w");
+    clean_memory(file_name);
+    if (file_map == NULL)
+    { /* Failed to open file for writing */
+        log_system_error(Error_104);
+        return 1; /* Indicates failure */
+    }
+    fprintf(file_map, "%d %d %d\n", modules_count, layout->code_size, layout->data_size);
+    for (i = 0; i < modules_count; i++)
+    {
+        module = modules[i];
+        fprintf(file_map, "M %s %d %d %d %d %lu %d %d %d\n", module->name, layout->code_bases[i],
+                layout->data_bases[i], module->code_size, module->data_size, module_checksum(module),
+                module->entries_count, module->relocations_count, module->extern_uses_count);
+        for (j = 0; j < module->entries_count; j++)
+            fprintf(file_map, "E %s %d\n", module->entries[j].name,
+                    relocate_address(module, layout, i, module->entries[j].address));
+        for (j = 0; j < module->relocations_count; j++)
+            fprintf(file_map, "R %d\n", module->relocations[j] + layout->code_bases[i]);
+        for (j = 0; j < module->extern_uses_count; j++)
+            fprintf(file_map, "X %s %d\n", module->extern_uses[j].name,
+                    module->extern_uses[j].address + layout->code_bases[i]);
+    }
+    fclose(file_map);
+    return 0; /* Indicates success */
+}
+
+/* Allocates an array for a table of the map, an empty table gets a single element */
+static void *allocate_table(int count, size_t size)
+{
+    return count < 0 ? NULL : calloc(count > 0 ? count : 1, size);
+}
+
+/* Reads the symbol records of a table of the map */
+static int read_map_symbols(FILE *file_map, char *tag, Symbol *symbols, int count)
+{
+    char record[MAX_SOURCE_LINE_LENGTH + 1], name[MAX_SOURCE_LINE_LENGTH + 1];
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (fscanf(file_map, "%81s %81s %d", record, name, &symbols[i].address) != 3 ||
+            strcmp(record, tag) != 0 || strlen(name) > MAX_LABEL_NAME_LENGTH)
+            return 1; /* Indicates a malformed record */
+        strcpy(symbols[i].name, name);
+    }
+    return 0; /* Indicates success */
+}
+
+/* Reads the record of a module and its tables */
+static int read_map_module(FILE *file_map, Map_Module *module)
+{
+    char record[MAX_SOURCE_LINE_LENGTH + 1], name[MAX_SOURCE_LINE_LENGTH + 1];
+    int i;
+
+    if (fscanf(file_map, "%81s %81s %d %d %d %d %lu %d %d %d", record, name, &module->code_base, &module->data_base,
+               &module->code_size, &module->data_size, &module->checksum, &module->entries_count,
+               &module->relocations_count, &module->extern_uses_count) != 10 || strcmp(record, "M") != 0)
+        return 1; /* Indicates a malformed record */
+    module->name = (char *)malloc(strlen(name) + 1); /* +1 to accommodate '\0' */
+    module->entries = (Symbol *)allocate_table(module->entries_count, sizeof(Symbol));
+    module->relocations = (int *)allocate_table(module->relocations_count, sizeof(int));
+    module->extern_uses = (Symbol *)allocate_table(module->extern_uses_count, sizeof(Symbol));
+    if (module->name == NULL || module->entries == NULL || module->relocations == NULL || module->extern_uses == NULL)
+        return 1; /* Indicates failure */
+    strcpy(module->name, name);
+    if (read_map_symbols(file_map, "E", module->entries, module->entries_count) != 0)
+        return 1; /* Indicates a malformed record */
+    for (i = 0; i < module->relocations_count; i++)
+        if (fscanf(file_map, "%81s %d", record, &module->relocations[i]) != 2 || strcmp(record, "R") != 0)
+            return 1; /* Indicates a malformed record */
+    return read_map_symbols(file_map, "X", module->extern_uses, module->extern_uses_count);
+}
+
+/**
+ * Checks that the modules of a map fit in its image and that their external uses are words of their own code.
+ * The checksums only cover the modules, so the addresses of the map are checked before a relink writes to them.
+ * return 1 if the map is consistent, 0 otherwise.
+ */
+static int is_map_consistent(Link_Map *map)
+{
+    Map_Module *module;
+    int i, j, address;
+
+    if (map->code_size < 0 || map->data_size < 0 || map->code_size + map->data_size > MAX_ARRAY_CAPACITY)
+        return 0;
+    for (i = 0; i < map->modules_count; i++)
+    {
+        module = &map->modules[i];
+        if (module->code_base < 0 || module->code_size < 0 || module->code_base + module->code_size > map->code_size ||
+            module->data_base < 0 || module->data_size < 0 || module->data_base + module->data_size > map->data_size)
+            return 0;
+        for (j = 0; j < module->extern_uses_count; j++)
+        {
+            address = module->extern_uses[j].address - MEMORY_START_ADDRESS;
+            if (address < module->code_base || address >= module->code_base + module->code_size)
+                return 0;
+        }
+    }
+    return 1;
+}
+
+Link_Map *read_link_map(char *output_name)
+{
+    int i, errors_found = 0;
+    char *file_name = add_extension(output_name, ".map");
+    Link_Map *map;
+    FILE *file_map;
+
+    if (file_name == NULL)
+        return NULL; /* Indicates failure */
+    file_map = fopen(file_name, "r");
+    clean_memory(file_name);
+    if (file_map == NULL)
+        return NULL; /* The image was not linked before */
+    map = (Link_Map *)calloc(1, sizeof(Link_Map));
+    if (map == NULL || fscanf(file_map, "%d %d %d", &map->modules_count, &map->code_size, &map->data_size) != 3 ||
+        (map->modules = (Map_Module *)allocate_table(map->modules_count, sizeof(Map_Module))) == NULL)
+        errors_found = 1;
+    for (i = 0; errors_found == 0 && i < map->modules_count; i++)
+        errors_found = read_map_module(file_map, &map->modules[i]);
+    fclose(file_map);
+    if (errors_found == 0 && !is_map_consistent(map))
+        errors_found = 1;
+    if (errors_found)
+    {
+        free_link_map(map);
+        return NULL; /* Indicates a malformed map */
+    }
+    return map;
+}
+
+void free_link_map(Link_Map *map)
+{
+    int i;
+
+    if (map == NULL)
+        return;
+    for (i = 0; map->modules != NULL && i < map->modules_count; i++)
+    {
+        free(map->modules[i].name);
+        free(map->modules[i].entries);
+        free(map->modules[i].relocations);
+        free(map->modules[i].extern_uses);
+    }
+    free(map->modules);
+    free(map);
+}
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "error_handler.h"
+#include "object_reader.h"
+#include "archive.h"
+#include "module_linker.h"
+#include "utils.h"
+#include "definitions.h"
+
+/* Name of the linked output files when no "-o" option is given */
+#define DEFAULT_OUTPUT_NAME "linked"
+
+/**
+ * This is the main function of the linker, it receives the names of assembled modules (without an extension)
+ * and links their output files (.ob, .ent, .ext) into a single image.
+ * The option "-o name" sets the name of the linked output files (name.ob, name.ent).
+ * The option "-i" relinks incrementally, patching the previous image through its link map (name.map).
+ * The option "-l library.lib" adds an archive, only its members that define symbols still undefined are linked.
+ * argc: The number of command-line arguments.
+ * argv: An array of strings containing the command-line arguments.
+ * return Returns 0 if the image was linked, 1 otherwise.
+ */
+
+int main(int argc, char *argv[]) {
+    int i, modules_count = 0, archives_count = 0, is_incremental = 0, errors_found = 0;
+    char *output_name = DEFAULT_OUTPUT_NAME;
+    Object_Module **modules = (Object_Module **)calloc(argc, sizeof(Object_Module *));
+    Archive **archives = (Archive **)calloc(argc, sizeof(Archive *));
+
+    if (modules == NULL || archives == NULL) {
+        log_system_error(Error_101);
+        return 1;  /* Indicates faliure */
+    }
+    /* Scanning options and modules */
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0) {
+            if (++i == argc) {
+                log_system_error(Error_107);
+                errors_found = 1;
+                break;
+            }
+            output_name = argv[i];
+            continue;  /* Next argument */
+        }
+        if (strcmp(argv[i], "-i") == 0) {
+            is_incremental = 1;
+            continue;  /* Next argument */
+        }
+        if (strcmp(argv[i], "-l") == 0) {
+            if (++i == argc) {
+                log_system_error(Error_107);
+                errors_found = 1;
+                break;
+            }
+            archives[archives_count] = open_archive(argv[i]);
+            if (archives[archives_count] == NULL)
+                errors_found = 1;
+            else
+                archives_count++;
+            continue;  /* Next argument */
+        }
+        modules[modules_count] = read_object_module(argv[i]);
+        if (modules[modules_count] == NULL) {
+            errors_found = 1;
+            continue;  /* Next module, so all of the unreadable modules are reported */
+        }
+        modules_count++;
+    }
+    if (errors_found == 0 && modules_count == 0) {  /* Checking if no modules were entered */
+        log_system_error(Error_100);
+        errors_found = 1;
+    }
+    if (errors_found == 0 && archives_count > 0)
+        errors_found = add_archive_members(&modules, &modules_count, archives, archives_count);
+    if (errors_found == 0) {
+        printf("Linking %d modules into \"%s\"\n", modules_count, output_name);
+        if (is_incremental)
+            errors_found = relink_modules(modules, modules_count, output_name);
+        else
+            errors_found = link_modules(modules, modules_count, output_name);
+        printf(errors_found == 0 ? "Linking completed successfully\n" : "Linking aborted\n");
+    }
+    for (i = 0; i < modules_count; i++)
+        free_object_module(modules[i]);
+    for (i = 0; i < archives_count; i++)
+        close_archive(archives[i]);
+    free(modules);
+    free(archives);
+    free_all_memory();
+    return errors_found;
+}
@@ -0,0 +1,250 @@
+/**
+ * This file handles the state of the machine: loading a program, decoding its instructions and tracking the
+ * memory words that belong to decoded instructions.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "machine.h"
+#include "validator.h"
+#include "error_handler.h"
+#include "definitions.h"
+
+/* Decodes the words of an operand, returns the number of words or -1 if they are invalid */
+static int decode_operand(unsigned short *cells, int address, int method, int is_source, Operand *operand)
+{
+    unsigned short word = cells[address];
+
+    if (method != DIRECT_REGISTER && (word & ARE_PLACEHOLDER_SIGNAL) == ARE_EXTERNAL)
+        return -1; /* Unresolved external address */
+    switch (method)
+    {
+    case IMMEDIATE:
+        operand->kind = OPERAND_IMMEDIATE;
+        operand->value = (unsigned short)(SIGN_EXTEND_8_BITS(word >> IMMEDIATE_VALUE_SHIFT_POSITION) & MASK_10_BITS);
+        return 1;
+    case DIRECT:
+        operand->kind = OPERAND_CELL;
+        operand->location = (word >> IMMEDIATE_VALUE_SHIFT_POSITION) & MASK_8_BITS;
+        return 1;
+    case MATRIX:
+        if (address + 1 >= MACHINE_MEMORY_SIZE)
+            return -1;
+        operand->kind = OPERAND_MATRIX;
+        operand->location = (word >> IMMEDIATE_VALUE_SHIFT_POSITION) & MASK_8_BITS;
+        operand->row = (cells[address + 1] >> MATRIX_ROW_REGISTER_SHIFT) & MASK_4_BITS;
+        operand->column = (cells[address + 1] >> MATRIX_COLUMN_REGISTER_SHIFT) & MASK_4_BITS;
+        if (operand->row > MAX_REGISTER_NUMBER || operand->column > MAX_REGISTER_NUMBER)
+            return -1;
+        return 2;
+    default: /* DIRECT_REGISTER */
+        operand->kind = OPERAND_CELL;
+        operand->location = (word >> (is_source ? SOURCE_REGISTER_SHIFT_POSITION : DESTINATION_REGISTER_SHIFT_POSITION)) & MASK_4_BITS;
+        if (operand->location > MAX_REGISTER_NUMBER)
+            return -1;
+        operand->location = REGISTER_CELL(operand->location);
+        return 1;
+    }
+}
+
+void decode_instruction(unsigned short *cells, int address, Decoded_Instruction *instruction)
+{
+    InstructionDefinition *opcodes = retrieve_instruction_set();
+    unsigned short word = cells[address];
+    int opcode = (word >> OPCODE_SHIFT_POSITION) & MASK_4_BITS;
+    int source_method = (word >> SOURCE_OPERAND_SHIFT_POSITION) & ARE_PLACEHOLDER_SIGNAL;
+    int destination_method = (word >> DESTINATION_OPERAND_SHIFT_POSITION) & ARE_PLACEHOLDER_SIGNAL;
+    int operand_count = opcodes[opcode].operand_count, length = 1, words;
+
+    memset(instruction, 0, sizeof(Decoded_Instruction));
+    instruction->handler = HANDLER_INVALID;
+    instruction->length = 1;
+    instruction->span = 1;
+    instruction->next = (unsigned short)(address + 1);
+    if ((word & ARE_PLACEHOLDER_SIGNAL) != ARE_ABSOLUTE)
+        return; /* Instruction words are always absolute */
+    /* Operands that the instruction does not have must be encoded as 0 */
+    if ((operand_count < 2 && source_method != 0) || (operand_count < 1 && destination_method != 0))
+        return;
+    if (operand_count == 2 && !is_addressing_mode_supported(opcodes[opcode].source_modes, source_method))
+        return;
+    if (operand_count >= 1 && !is_addressing_mode_supported(opcodes[opcode].destination_modes, destination_method))
+        return;
+
+    if (operand_count == 2 && source_method == DIRECT_REGISTER && destination_method == DIRECT_REGISTER)
+    { /* Both registers share a single word */
+        if (address + 1 >= MACHINE_MEMORY_SIZE ||
+            decode_operand(cells, address + 1, DIRECT_REGISTER, 1, &instruction->source) == -1 ||
+            decode_operand(cells, address + 1, DIRECT_REGISTER, 0, &instruction->destination) == -1)
+            return;
+        length = 2;
+    }
+    else
+    {
+        if (operand_count == 2)
+        {
+            if (address + length >= MACHINE_MEMORY_SIZE ||
+                (words = decode_operand(cells, address + length, source_method, 1, &instruction->source)) == -1)
+                return;
+            length += words;
+        }
+        if (operand_count >= 1)
+        {
+            if (address + length >= MACHINE_MEMORY_SIZE ||
+                (words = decode_operand(cells, address + length, destination_method, 0, &instruction->destination)) == -1)
+                return;
+            length += words;
+        }
+    }
+    instruction->handler = (unsigned char)opcode;
+    instruction->length = (unsigned char)length;
+    instruction->span = (unsigned char)length;
+    instruction->next = (unsigned short)(address + length);
+}
+
+void predecode_address(Machine *machine, int address)
+{
+    int i;
+    Decoded_Instruction *instruction = &machine->decoded[address];
+
+    decode_instruction(machine->cells, address, instruction);
+    for (i = 0; i < instruction->length; i++)
+        machine->is_decoded_word[address + i] = 1;
+    if (machine->handler_codes != NULL)
+        instruction->code = machine->handler_codes[instruction->handler];
+}
+
+int load_machine(Machine *machine, Object_Module *module)
+{
+    int i, address;
+
+    if (module->extern_uses_count > 0)
+    {
+        printf(" Module \"%s\" - Label \"%s\"", module->name, module->extern_uses[0].name);
+        log_system_error(Error_404);
+        return 1; /* Indicates failure */
+    }
+    if (MEMORY_START_ADDRESS + module->code_size + module->data_size > MACHINE_MEMORY_SIZE)
+    {
+        printf(" Module \"%s\" - %d words", module->name, module->code_size + module->data_size);
+        log_system_error(Error_406);
+        return 1; /* Indicates failure */
+    }
+    memset(machine, 0, sizeof(Machine));
+    for (i = 0; i < module->code_size + module->data_size; i++)
+        machine->cells[MEMORY_START_ADDRESS + i] = module->words[i];
+    for (i = 0; i <= MACHINE_MEMORY_SIZE; i++)
+    {
+        machine->decoded[i].handler = i < MACHINE_MEMORY_SIZE ? HANDLER_DECODE : HANDLER_INVALID;
+        machine->decoded[i].length = 1;
+        machine->decoded[i].span = 1;
+        machine->decoded[i].next = (unsigned short)(i + 1);
+    }
+    machine->code_start = MEMORY_START_ADDRESS;
+    machine->code_end = MEMORY_START_ADDRESS + module->code_size;
+    machine->pc = MEMORY_START_ADDRESS;
+    machine->status = MACHINE_RUNNING;
+    machine->output = stdout;
+
+    /* The code section is a sequence of instructions, so each one starts where the previous one ends */
+    for (address = machine->code_start; address < machine->code_end && address < MACHINE_MEMORY_SIZE;
+         address = machine->decoded[address].next)
+        predecode_address(machine, address);
+    return 0; /* Indicates success */
+}
+
+void invalidate_decoded(Machine *machine, int address)
+{
+    int i, first = address - MAX_RECORD_SPAN + 1;
+
+    machine->code_writes++;
+    for (i = first < 0 ? 0 : first; i <= address; i++)
+    {
+        if (machine->decoded[i].handler != HANDLER_DECODE && i + machine->decoded[i].span > address)
+        {
+            machine->decoded[i].handler = HANDLER_DECODE;
+            if (machine->handler_codes != NULL)
+                machine->decoded[i].code = machine->handler_codes[HANDLER_DECODE];
+        }
+    }
+}
+
+int operand_address(Machine *machine, Operand *operand)
+{
+    int address;
+
+    if (operand->kind != OPERAND_MATRIX)
+        return operand->location < MACHINE_MEMORY_SIZE ? operand->location : machine->cells[operand->location];
+    address = operand->location + SIGN_EXTEND_10_BITS(machine->cells[REGISTER_CELL(operand->row)]) +
+              SIGN_EXTEND_10_BITS(machine->cells[REGISTER_CELL(operand->column)]);
+    return address < 0 || address >= MACHINE_MEMORY_SIZE ? -1 : address;
+}
+
+unsigned char *read_program_input(FILE *file, unsigned long *size)
+{
+    unsigned long capacity = INPUT_CHUNK_SIZE;
+    unsigned char *input = (unsigned char *)malloc(capacity), *resized;
+
+    *size = 0;
+    while (input != NULL && (*size += fread(input + *size, 1, capacity - *size, file)) == capacity)
+    {
+        capacity *= 2;
+        resized = (unsigned char *)realloc(input, capacity);
+        if (resized == NULL)
+            free(input);
+        input = resized;
+    }
+    if (input == NULL)
+        log_system_error(Error_101);
+    return input;
+}
+
+int is_same_output(FILE *first, FILE *second)
+{
+    int character;
+
+    rewind(first);
+    rewind(second);
+    while ((character = fgetc(first)) != EOF)
+    {
+        if (fgetc(second) != character)
+            return 0;
+    }
+    return fgetc(second) == EOF;
+}
+
+void write_output(Machine *machine, const char *text, unsigned long length)
+{
+    unsigned long i;
+
+    if (machine->expected == NULL)
+    {
+        fwrite(text, 1, length, machine->output);
+        return;
+    }
+    /* The position stops at the first character that differs */
+    for (i = 0; i < length && !machine->is_unexpected; i++)
+    {
+        if (machine->expected_position < machine->expected_size &&
+            machine->expected[machine->expected_position] == (unsigned char)text[i])
+            machine->expected_position++;
+        else
+            machine->is_unexpected = 1;
+    }
+}
+
+void flush_output(Machine *machine)
+{
+    write_output(machine, machine->output_buffer, machine->output_length);
+    machine->output_length = 0;
+}
+
+void fault_machine(Machine *machine, int error_code)
+{
+    machine->status = MACHINE_FAULTED;
+    machine->fault = error_code;
+    if (machine->is_quiet)
+        return;
+    printf(" Address %d", machine->pc);
+    log_system_error(error_code);
+}
@@ -0,0 +1,79 @@
+/**
+ * This file maps the contents of files into memory.
+ */
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L /* mmap is not part of ANSI C */
+#define MAPPED_FILE_USE_MMAP
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include "mapped_file.h"
+#include "machine.h"
+
+#ifdef MAPPED_FILE_USE_MMAP
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Contents of empty files, which cannot be mapped */
+static unsigned char empty_contents[1];
+
+int map_file(FILE *file, Mapped_File *mapped)
+{
+#ifdef MAPPED_FILE_USE_MMAP
+    struct stat status;
+    long position = ftell(file);
+    unsigned long offset;
+    int descriptor = fileno(file);
+    void *mapping;
+#endif
+
+    mapped->data = NULL;
+    mapped->size = 0;
+    mapped->mapping = NULL;
+    mapped->mapping_size = 0;
+#ifdef MAPPED_FILE_USE_MMAP
+    if (position < 0 || fstat(descriptor, &status) != 0 || !S_ISREG(status.st_mode))
+        return 1; /* Indicates failure */
+    if ((unsigned long)position >= (unsigned long)status.st_size)
+    {
+        mapped->data = empty_contents;
+        return 0; /* Indicates success */
+    }
+    /* The mapping starts at a page boundary, the contents at the position of the file */
+    offset = (unsigned long)position - (unsigned long)position % (unsigned long)sysconf(_SC_PAGESIZE);
+    mapping = mmap(NULL, (size_t)(status.st_size - offset), PROT_READ, MAP_PRIVATE, descriptor, (off_t)offset);
+    if (mapping == MAP_FAILED)
+        return 1; /* Indicates failure */
+    mapped->mapping = mapping;
+    mapped->mapping_size = (unsigned long)status.st_size - offset;
+    mapped->data = (unsigned char *)mapping + ((unsigned long)position - offset);
+    mapped->size = (unsigned long)status.st_size - (unsigned long)position;
+    return 0; /* Indicates success */
+#else
+    return 1; /* Indicates failure, the host cannot map files */
+#endif
+}
+
+int load_mapped_file(FILE *file, Mapped_File *mapped)
+{
+    if (map_file(file, mapped) == 0)
+        return 0; /* Indicates success */
+    mapped->data = read_program_input(file, &mapped->size);
+    return mapped->data == NULL;
+}
+
+void unmap_file(Mapped_File *mapped)
+{
+#ifdef MAPPED_FILE_USE_MMAP
+    if (mapped->mapping != NULL)
+        munmap(mapped->mapping, (size_t)mapped->mapping_size);
+#endif
+    if (mapped->mapping == NULL && mapped->data != empty_contents)
+        free(mapped->data);
+    mapped->data = NULL;
+    mapped->size = 0;
+    mapped->mapping = NULL;
+}
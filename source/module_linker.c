@@ -0,0 +1,444 @@
+/**
+ * This file links assembled modules into a single image.
+ * It places the modules in memory, builds the global symbol table from their entry tables,
+ * relocates their relocatable words, resolves their external uses and creates the output files.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "module_linker.h"
+#include "link_map.h"
+#include "symbol_table.h"
+#include "error_handler.h"
+#include "utils.h"
+#include "definitions.h"
+
+int relocate_address(Object_Module *module, Link_Layout *layout, int index, int address)
+{
+    int offset = address - MEMORY_START_ADDRESS;
+
+    if (offset < 0 || offset >= module->code_size + module->data_size)
+        return -1; /* Indicates address is outside of the module */
+    if (offset < module->code_size) /* Address of an instruction word */
+        return MEMORY_START_ADDRESS + layout->code_bases[index] + offset;
+    /* Address of a data word, data words are placed after all of the instruction words */
+    return MEMORY_START_ADDRESS + layout->code_size + layout->data_bases[index] + offset - module->code_size;
+}
+
+/* Encodes a relocatable address word, reporting addresses that do not fit in the address field */
+static unsigned short encode_address(int address, Object_Module *module, int *errors_found)
+{
+    if (address > MASK_8_BITS)
+    {
+        printf(" Module \"%s\" - Address %d", module->name, address);
+        log_system_error(Error_304);
+        *errors_found = 1;
+    }
+    return (unsigned short)(((address & MASK_8_BITS) << IMMEDIATE_VALUE_SHIFT_POSITION) | ARE_RELOCATABLE);
+}
+
+/* Computes the offsets of the modules in the linked image */
+static int compute_layout(Object_Module **modules, int modules_count, Link_Layout *layout)
+{
+    int i;
+
+    layout->code_bases = (int *)malloc(modules_count * sizeof(int));
+    layout->data_bases = (int *)malloc(modules_count * sizeof(int));
+    if (layout->code_bases == NULL || layout->data_bases == NULL)
+    {
+        log_system_error(Error_101);
+        return 1; /* Indicates failure */
+    }
+    layout->code_size = 0;
+    layout->data_size = 0;
+    for (i = 0; i < modules_count; i++)
+    {
+        layout->code_bases[i] = layout->code_size;
+        layout->data_bases[i] = layout->data_size;
+        layout->code_size += modules[i]->code_size;
+        layout->data_size += modules[i]->data_size;
+    }
+    if (layout->code_size + layout->data_size > MAX_ARRAY_CAPACITY)
+    {
+        printf(" Linked image of %d words", layout->code_size + layout->data_size);
+        log_system_error(Error_302);
+        return 1; /* Indicates failure */
+    }
+    return 0; /* Indicates success */
+}
+
+/* Inserts the entries of all of the modules, with their final addresses, into the global symbol table */
+static int collect_entries(Object_Module **modules, int modules_count, Link_Layout *layout, Symbol_Table *table)
+{
+    int i, j, address, is_duplicate, errors_found = 0;
+    Global_Symbol *symbol;
+
+    for (i = 0; i < modules_count; i++)
+    {
+        for (j = 0; j < modules[i]->entries_count; j++)
+        {
+            address = relocate_address(modules[i], layout, i, modules[i]->entries[j].address);
+            if (address == -1)
+            {
+                printf(" Module \"%s\" - Label \"%s\"", modules[i]->name, modules[i]->entries[j].name);
+                log_system_error(Error_300);
+                errors_found = 1;
+                continue;
+            }
+            symbol = insert_symbol(table, modules[i]->entries[j].name, address, i, &is_duplicate);
+            if (symbol == NULL)
+                return 1; /* Indicates memory allocation failed */
+            if (is_duplicate)
+            {
+                printf(" Modules \"%s\" and \"%s\" - Label \"%s\"",
+                       modules[symbol->module]->name, modules[i]->name, symbol->name);
+                log_system_error(Error_301);
+                errors_found = 1;
+            }
+        }
+    }
+    return errors_found;
+}
+
+/* Copies the words of a module into the image and relocates the words listed in its relocation table */
+static int place_module(Object_Module *module, Link_Layout *layout, int index, unsigned short *code, unsigned short *data)
+{
+    int i, offset, address, errors_found = 0;
+
+    memcpy(code + layout->code_bases[index], module->words, module->code_size * sizeof(unsigned short));
+    memcpy(data + layout->data_bases[index], module->words + module->code_size, module->data_size * sizeof(unsigned short));
+    for (i = 0; i < module->relocations_count; i++)
+    {
+        offset = module->relocations[i] - MEMORY_START_ADDRESS;
+        address = relocate_address(module, layout, index, (module->words[offset] >> IMMEDIATE_VALUE_SHIFT_POSITION) & MASK_8_BITS);
+        if (address == -1)
+        {
+            printf(" Module \"%s\" - Word %d", module->name, module->relocations[i]);
+            log_system_error(Error_300);
+            errors_found = 1;
+            continue;
+        }
+        code[layout->code_bases[index] + offset] = encode_address(address, module, &errors_found);
+    }
+    return errors_found;
+}
+
+/* Resolves the external uses of a module through the global symbol table */
+static int resolve_externals(Object_Module *module, Link_Layout *layout, int index, Symbol_Table *table, unsigned short *code)
+{
+    int i, offset, errors_found = 0;
+    Symbol *use;
+    Global_Symbol *symbol;
+
+    for (i = 0; i < module->extern_uses_count; i++)
+    {
+        use = &module->extern_uses[i];
+        offset = use->address - MEMORY_START_ADDRESS;
+        if (offset < 0 || offset >= module->code_size ||
+            (module->words[offset] & ARE_PLACEHOLDER_SIGNAL) != ARE_EXTERNAL)
+        {
+            printf(" Module \"%s\" - Label \"%s\"", module->name, use->name);
+            log_system_error(Error_300);
+            errors_found = 1;
+            continue;
+        }
+        symbol = find_symbol(table, use->name);
+        if (symbol == NULL)
+        {
+            printf(" Undefined reference detected in Module \"%s\" - Label \"%s\"", module->name, use->name);
+            log_system_error(Error_303);
+            errors_found = 1;
+            continue;
+        }
+        code[layout->code_bases[index] + offset] = encode_address(symbol->address, module, &errors_found);
+    }
+    return errors_found;
+}
+
+/* Creates the object file and the entry file of the linked image */
+static void write_linked_image(char *output_name, Object_Module **modules, int modules_count, Link_Layout *layout,
+                               Symbol_Table *table, unsigned short *code, unsigned short *data)
+{
+    char base4_addr[TEMP_CONVERSION_BUFFER_SIZE]; /* Buffer for base 4 address */
+    char *file_name;
+    int i, j;
+    Global_Symbol *symbol;
+    FILE *file_ent;
+
+    file_name = add_extension(output_name, ".ob");
+    create_ob_file(file_name, code, data, &layout->code_size, &layout->data_size);
+    clean_memory(file_name);
+
+    if (table->count == 0)
+        return; /* No module exports symbols */
+    file_name = add_extension(output_name, ".ent");
+    file_ent = fopen(file_name, "w");
+    clean_memory(file_name);
+    if (file_ent == NULL)
+    { /* Failed to open file for writing */
+        log_system_error(Error_104);
+        return;
+    }
+    /* The entry file lists the exported symbols in the load order of their modules */
+    for (i = 0; i < modules_count; i++)
+    {
+        for (j = 0; j < modules[i]->entries_count; j++)
+        {
+            symbol = find_symbol(table, modules[i]->entries[j].name);
+            convert_to_base4(symbol->address, base4_addr);
+            fprintf(file_ent, "%s %s\n", symbol->name, base4_addr);
+        }
+    }
+    fclose(file_ent);
+}
+
+/* Marks the entries of a module as defined and queues its external uses that were not queued yet */
+static int queue_module_symbols(Object_Module *module, Symbol_Table *defined, Symbol_Table *queued,
+                                char ***pending, int *pending_count, int *pending_capacity)
+{
+    int i, is_duplicate;
+    char **resized;
+
+    for (i = 0; i < module->entries_count; i++)
+    {
+        if (insert_symbol(defined, module->entries[i].name, 0, 0, &is_duplicate) == NULL)
+            return 1; /* Indicates memory allocation failed */
+    }
+    for (i = 0; i < module->extern_uses_count; i++)
+    {
+        if (insert_symbol(queued, module->extern_uses[i].name, 0, 0, &is_duplicate) == NULL)
+            return 1; /* Indicates memory allocation failed */
+        if (is_duplicate)
+            continue; /* Symbol was already queued */
+        if (*pending_count == *pending_capacity)
+        {
+            *pending_capacity = *pending_capacity == 0 ? MAX_ARRAY_CAPACITY : *pending_capacity * 2;
+            resized = (char **)realloc(*pending, *pending_capacity * sizeof(char *));
+            if (resized == NULL)
+            {
+                log_system_error(Error_101);
+                return 1; /* Indicates memory allocation failed */
+            }
+            *pending = resized;
+        }
+        (*pending)[(*pending_count)++] = module->extern_uses[i].name;
+    }
+    return 0; /* Indicates success */
+}
+
+int add_archive_members(Object_Module ***modules, int *modules_count, Archive **archives, int archives_count)
+{
+    int i, member, pending_count = 0, pending_capacity = 0, errors_found = 0;
+    char **pending = NULL, *name;
+    Symbol_Table *defined = create_symbol_table(MAX_ARRAY_CAPACITY), *queued = create_symbol_table(MAX_ARRAY_CAPACITY);
+    Object_Module *extracted, **resized;
+
+    if (defined == NULL || queued == NULL)
+        errors_found = 1;
+    for (i = 0; i < *modules_count && errors_found == 0; i++)
+        errors_found = queue_module_symbols((*modules)[i], defined, queued, &pending, &pending_count, &pending_capacity);
+
+    while (pending_count > 0 && errors_found == 0)
+    {
+        name = pending[--pending_count];
+        if (find_symbol(defined, name) != NULL)
+            continue; /* Symbol is defined by a module that is already linked */
+        for (i = 0; i < archives_count; i++)
+        {
+            member = find_archive_symbol(archives[i], name);
+            if (member == -1 || archives[i]->is_extracted[member])
+                continue;
+            if ((extracted = extract_archive_member(archives[i], member)) == NULL)
+            {
+                errors_found = 1;
+                break;
+            }
+            resized = (Object_Module **)realloc(*modules, (*modules_count + 1) * sizeof(Object_Module *));
+            if (resized == NULL)
+            {
+                log_system_error(Error_101);
+                free_object_module(extracted);
+                errors_found = 1;
+                break;
+            }
+            *modules = resized;
+            (*modules)[(*modules_count)++] = extracted;
+            printf("Extracted member \"%s\" of \"%s\" for label \"%s\"\n", extracted->name, archives[i]->name, name);
+            errors_found = queue_module_symbols(extracted, defined, queued, &pending, &pending_count, &pending_capacity);
+            break;
+        }
+    }
+    free(pending);
+    free_symbol_table(defined);
+    free_symbol_table(queued);
+    return errors_found;
+}
+
+int link_modules(Object_Module **modules, int modules_count, char *output_name)
+{
+    unsigned short code[MAX_ARRAY_CAPACITY] = {0}, data[MAX_ARRAY_CAPACITY] = {0}; /* Linked machine code arrays */
+    int i, expected_symbols = 0, errors_found = 0;
+    Link_Layout layout = {NULL, NULL, 0, 0};
+    Symbol_Table *table = NULL;
+
+    if (compute_layout(modules, modules_count, &layout) != 0)
+        errors_found = 1;
+
+    if (errors_found == 0)
+    {
+        for (i = 0; i < modules_count; i++)
+            expected_symbols += modules[i]->entries_count;
+        table = create_symbol_table(expected_symbols);
+        if (table == NULL || collect_entries(modules, modules_count, &layout, table) != 0)
+            errors_found = 1;
+    }
+    if (errors_found == 0)
+    {
+        for (i = 0; i < modules_count; i++)
+        {
+            if (place_module(modules[i], &layout, i, code, data) != 0)
+                errors_found = 1;
+            if (resolve_externals(modules[i], &layout, i, table, code) != 0)
+                errors_found = 1;
+        }
+    }
+    if (errors_found == 0)
+    {
+        write_linked_image(output_name, modules, modules_count, &layout, table, code, data);
+        write_link_map(output_name, modules, modules_count, &layout);
+    }
+
+    free_symbol_table(table);
+    free(layout.code_bases);
+    free(layout.data_bases);
+    return errors_found;
+}
+
+/* Checks that every module keeps its size and exported symbols, so the layout of the map can be reused */
+static int is_layout_kept(Object_Module **modules, int modules_count, Link_Map *map, Object_Module *image)
+{
+    int i, j;
+
+    if (map->modules_count != modules_count || image->code_size != map->code_size || image->data_size != map->data_size)
+        return 0;
+    for (i = 0; i < modules_count; i++)
+    {
+        if (strcmp(modules[i]->name, map->modules[i].name) != 0 ||
+            modules[i]->code_size != map->modules[i].code_size || modules[i]->data_size != map->modules[i].data_size ||
+            modules[i]->entries_count != map->modules[i].entries_count)
+            return 0;
+        for (j = 0; j < modules[i]->entries_count; j++)
+            if (strcmp(modules[i]->entries[j].name, map->modules[i].entries[j].name) != 0)
+                return 0;
+    }
+    return 1;
+}
+
+/* Patches the external uses of an unchanged module that refer to symbols whose address changed */
+static int patch_moved_symbols(Map_Module *map_module, Object_Module *module, Symbol_Table *table,
+                               Symbol_Table *old_table, unsigned short *code, int *patched_words)
+{
+    int i, errors_found = 0;
+    Global_Symbol *symbol, *old_symbol;
+
+    for (i = 0; i < map_module->extern_uses_count; i++)
+    {
+        symbol = find_symbol(table, map_module->extern_uses[i].name);
+        old_symbol = find_symbol(old_table, map_module->extern_uses[i].name);
+        if (symbol == NULL || old_symbol == NULL)
+        {
+            printf(" Undefined reference detected in Module \"%s\" - Label \"%s\"", module->name,
+                   map_module->extern_uses[i].name);
+            log_system_error(Error_303);
+            errors_found = 1;
+            continue;
+        }
+        if (symbol->address == old_symbol->address)
+            continue; /* The word already holds the right address */
+        code[map_module->extern_uses[i].address - MEMORY_START_ADDRESS] = encode_address(symbol->address, module, &errors_found);
+        (*patched_words)++;
+    }
+    return errors_found;
+}
+
+/* Patches the previous image in place, the layout of the map must have been kept */
+static int patch_image(Object_Module **modules, int modules_count, Link_Map *map, Object_Module *image, char *output_name)
+{
+    unsigned short code[MAX_ARRAY_CAPACITY] = {0}, data[MAX_ARRAY_CAPACITY] = {0}; /* Linked machine code arrays */
+    int i, j, is_duplicate, changed_modules = 0, patched_words = 0, expected_symbols = 0, errors_found = 0;
+    int *is_changed = (int *)calloc(modules_count, sizeof(int));
+    Link_Layout layout = {NULL, NULL, 0, 0};
+    Symbol_Table *table = NULL, *old_table = NULL;
+
+    if (is_changed == NULL || compute_layout(modules, modules_count, &layout) != 0)
+        errors_found = 1;
+    if (errors_found == 0)
+    {
+        for (i = 0; i < modules_count; i++)
+            expected_symbols += modules[i]->entries_count;
+        table = create_symbol_table(expected_symbols);
+        old_table = create_symbol_table(expected_symbols);
+        if (table == NULL || old_table == NULL || collect_entries(modules, modules_count, &layout, table) != 0)
+            errors_found = 1;
+        for (i = 0; errors_found == 0 && i < modules_count; i++)
+            for (j = 0; j < map->modules[i].entries_count; j++)
+                if (insert_symbol(old_table, map->modules[i].entries[j].name, map->modules[i].entries[j].address, i, &is_duplicate) == NULL)
+                    errors_found = 1;
+    }
+    if (errors_found == 0)
+    {
+        memcpy(code, image->words, layout.code_size * sizeof(unsigned short));
+        memcpy(data, image->words + layout.code_size, layout.data_size * sizeof(unsigned short));
+        /* The changed modules are placed again, so their own relocations and external uses are redone */
+        for (i = 0; i < modules_count; i++)
+        {
+            if (module_checksum(modules[i]) == map->modules[i].checksum)
+                continue;
+            is_changed[i] = 1;
+            changed_modules++;
+            patched_words += modules[i]->code_size + modules[i]->data_size;
+            if (place_module(modules[i], &layout, i, code, data) != 0 ||
+                resolve_externals(modules[i], &layout, i, table, code) != 0)
+                errors_found = 1;
+        }
+        /* The unchanged modules only need the words that refer to symbols which moved */
+        for (i = 0; i < modules_count; i++)
+            if (is_changed[i] == 0 && patch_moved_symbols(&map->modules[i], modules[i], table, old_table, code, &patched_words) != 0)
+                errors_found = 1;
+    }
+    if (errors_found == 0)
+    {
+        printf("Relinking %d of %d modules, %d words patched\n", changed_modules, modules_count, patched_words);
+        if (changed_modules > 0)
+        {
+            write_linked_image(output_name, modules, modules_count, &layout, table, code, data);
+            write_link_map(output_name, modules, modules_count, &layout);
+        }
+    }
+    free(is_changed);
+    free_symbol_table(table);
+    free_symbol_table(old_table);
+    free(layout.code_bases);
+    free(layout.data_bases);
+    return errors_found;
+}
+
+int relink_modules(Object_Module **modules, int modules_count, char *output_name)
+{
+    int errors_found;
+    Link_Map *map = read_link_map(output_name);
+    Object_Module *image = NULL;
+
+    if (map != NULL)
+        image = read_object_module(output_name);
+    if (map == NULL || image == NULL || is_layout_kept(modules, modules_count, map, image) == 0)
+    {
+        printf(" WARNING | No reusable link map for \"%s\", linking all modules\n", output_name);
+        errors_found = link_modules(modules, modules_count, output_name);
+    }
+    else
+        errors_found = patch_image(modules, modules_count, map, image, output_name);
+    free_object_module(image);
+    free_link_map(map);
+    return errors_found;
+}
@@ -0,0 +1,374 @@
+/**
+ * This file handles the loading of assembled modules from the assembler output files.
+ * The object file is read into a single words array (instruction words followed by data words),
+ * the entry and external files are read into symbol tables and the relocation file into a relocation table.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "object_reader.h"
+#include "relocation_table.h"
+#include "error_handler.h"
+#include "utils.h"
+#include "definitions.h"
+
+/* Initial capacity of a symbol table, doubled whenever it is full */
+#define INITIAL_SYMBOLS_CAPACITY 16
+
+int base4_to_decimal(char *digits)
+{
+    int value = 0;
+
+    if (*digits == STRING_TERMINATOR)
+        return -1; /* Indicates an empty string */
+    for (; *digits != STRING_TERMINATOR; digits++)
+    {
+        if (*digits < 'a' || *digits > 'd')
+            return -1; /* Indicates an invalid letter */
+        value = value * 4 + (*digits - 'a');
+    }
+    return value;
+}
+
+/* Reads the "name address" lines of an .ent or .ext file, a missing file is an empty table */
+static int read_symbols(char *file_name, Symbol **symbols, int *count)
+{
+    char name[MAX_SOURCE_LINE_LENGTH + 1], address[MAX_SOURCE_LINE_LENGTH + 1];
+    int capacity = 0;
+    Symbol *resized;
+    FILE *file = fopen(file_name, "r");
+
+    *symbols = NULL;
+    *count = 0;
+    if (file == NULL)
+        return 0; /* The module has no such symbols */
+
+    while (fscanf(file, "%81s %81s", name, address) == 2)
+    {
+        if (strlen(name) > MAX_LABEL_NAME_LENGTH || base4_to_decimal(address) == -1)
+        {
+            printf(" Malformed symbol \"%s\" in File \"%s\"", name, file_name);
+            log_system_error(Error_300);
+            fclose(file);
+            return 1; /* Indicates failure */
+        }
+        if (*count == capacity)
+        {
+            capacity = capacity == 0 ? INITIAL_SYMBOLS_CAPACITY : capacity * 2;
+            resized = (Symbol *)realloc(*symbols, capacity * sizeof(Symbol));
+            if (resized == NULL)
+            {
+                log_system_error(Error_101);
+                fclose(file);
+                return 1; /* Indicates failure */
+            }
+            *symbols = resized;
+        }
+        strcpy((*symbols)[*count].name, name);
+        (*symbols)[*count].address = base4_to_decimal(address);
+        (*count)++;
+    }
+    fclose(file);
+    return 0; /* Indicates success */
+}
+
+/* Values of the pairs of base 4 letters, indexed by the 7-bit codes of both letters, -1 for other pairs */
+static signed char letter_pairs[1 << 14];
+static int is_letter_pairs_ready = 0;
+
+/* Fills the table of letter pairs */
+static void fill_letter_pairs(void)
+{
+    int first, second;
+
+    memset(letter_pairs, -1, sizeof(letter_pairs));
+    for (first = 0; first < 4; first++)
+    {
+        for (second = 0; second < 4; second++)
+            letter_pairs[(('a' + first) << 7) | ('a' + second)] = (signed char)(first * 4 + second);
+    }
+    is_letter_pairs_ready = 1;
+}
+
+/* Converts a base 4 token two letters at a time, returns -1 if it is empty, longer than 15 letters or not base 4 */
+static int decode_base4_token(const unsigned char *token, int length)
+{
+    int value = 0, pair, i = 0;
+
+    if (length == 0 || length > 15)
+        return -1; /* Indicates an invalid token */
+    if (length % 2 == 1) /* An odd token starts with one letter, read as the pair "a" and the letter */
+    {
+        if (token[0] > 0x7F || (value = letter_pairs[('a' << 7) | token[0]]) == -1)
+            return -1; /* Indicates an invalid letter */
+        i = 1;
+    }
+    for (; i < length; i += 2)
+    {
+        if (token[i] > 0x7F || token[i + 1] > 0x7F || (pair = letter_pairs[(token[i] << 7) | token[i + 1]]) == -1)
+            return -1; /* Indicates an invalid letter */
+        value = value * 16 + pair;
+    }
+    return value;
+}
+
+/* Reads the next whitespace separated token of a text, returns its length (0 at the end of the text) */
+static int next_token(const unsigned char *text, unsigned long size, unsigned long *position,
+                      const unsigned char **token)
+{
+    unsigned long start;
+
+    while (*position < size && (text[*position] == ' ' || (text[*position] >= '\t' && text[*position] <= '\r')))
+        (*position)++;
+    start = *position;
+    while (*position < size && text[*position] != ' ' && (text[*position] < '\t' || text[*position] > '\r'))
+        (*position)++;
+    *token = text + start;
+    return (int)(*position - start);
+}
+
+/* Reads the whole contents of a file, returns them (allocated, freed by the caller) or NULL on failure */
+static unsigned char *read_whole_file(FILE *file, unsigned long *size)
+{
+    unsigned char *text = NULL, *resized;
+    unsigned long capacity = 0, count;
+
+    *size = 0;
+    do
+    {
+        if (*size == capacity)
+        {
+            capacity = capacity == 0 ? BUFSIZ : capacity * 2;
+            if ((resized = (unsigned char *)realloc(text, capacity)) == NULL)
+            {
+                free(text);
+                return NULL; /* Indicates failure */
+            }
+            text = resized;
+        }
+        count = fread(text + *size, 1, capacity - *size, file);
+        *size += count;
+    } while (count > 0);
+    return text;
+}
+
+/* Reads the header and the words of an object file into the module, the base 4 letters are decoded in pairs */
+static int read_object_words(char *file_ob_name, Object_Module *module)
+{
+    const unsigned char *address, *value, *run_token;
+    unsigned char *text;
+    unsigned long size, position = 0, run_position;
+    int i, j, line, run, total, address_length, value_length, run_length;
+    FILE *file_ob = fopen(file_ob_name, "rb");
+
+    if (file_ob == NULL)
+    {
+        printf(" File \"%s\"", file_ob_name);
+        log_system_error(Error_103);
+        return 1; /* Indicates failure */
+    }
+    text = read_whole_file(file_ob, &size);
+    fclose(file_ob);
+    if (text == NULL)
+    {
+        log_system_error(Error_101);
+        return 1; /* Indicates failure */
+    }
+    if (!is_letter_pairs_ready)
+        fill_letter_pairs();
+    /* Header line: instruction count and data count in base 4 */
+    address_length = next_token(text, size, &position, &address);
+    value_length = next_token(text, size, &position, &value);
+    if ((module->code_size = decode_base4_token(address, address_length)) == -1 ||
+        (module->data_size = decode_base4_token(value, value_length)) == -1 ||
+        module->code_size + module->data_size > MAX_ARRAY_CAPACITY)
+    {
+        printf(" Invalid header in File \"%s\"", file_ob_name);
+        log_system_error(Error_300);
+        free(text);
+        return 1; /* Indicates failure */
+    }
+    total = module->code_size + module->data_size;
+    module->words = (unsigned short *)calloc(total > 0 ? total : 1, sizeof(unsigned short));
+    if (module->words == NULL)
+    {
+        log_system_error(Error_101);
+        free(text);
+        return 1; /* Indicates failure */
+    }
+    /* Word lines: consecutive base 4 addresses starting at the memory start address, a line may end with '*' and the
+       length of a run of equal words (see create_run_length_ob_file) */
+    for (i = 0, line = 2; i < total; i += run, line++)
+    {
+        address_length = next_token(text, size, &position, &address);
+        value_length = next_token(text, size, &position, &value);
+        run = 1;
+        run_position = position;
+        run_length = next_token(text, size, &run_position, &run_token);
+        if (run_length > 0 && run_token[0] == ASTERISK_SIGN)
+        {
+            run = decode_base4_token(run_token + 1, run_length - 1);
+            position = run_position;
+        }
+        if (decode_base4_token(address, address_length) != i + MEMORY_START_ADDRESS ||
+            value_length != BASE4_DIGIT_COUNT || decode_base4_token(value, value_length) == -1 || run < 1 ||
+            run > total - i)
+        {
+            printf(" Invalid word at line %d in File \"%s\"", line, file_ob_name);
+            log_system_error(Error_300);
+            free(text);
+            return 1; /* Indicates failure */
+        }
+        for (j = i; j < i + run; j++)
+            module->words[j] = (unsigned short)(decode_base4_token(value, value_length) & MASK_10_BITS);
+    }
+    free(text);
+    return 0; /* Indicates success */
+}
+
+int derive_relocations(Object_Module *module)
+{
+    int i;
+
+    module->relocations = (int *)malloc((module->code_size > 0 ? module->code_size : 1) * sizeof(int));
+    if (module->relocations == NULL)
+    {
+        log_system_error(Error_101);
+        return 1; /* Indicates failure */
+    }
+    module->relocations_count = 0;
+    for (i = 0; i < module->code_size; i++)
+    {
+        /* Data words may have any value, so only instruction words carry meaningful ARE bits */
+        if ((module->words[i] & ARE_PLACEHOLDER_SIGNAL) == ARE_RELOCATABLE)
+            module->relocations[module->relocations_count++] = i + MEMORY_START_ADDRESS;
+    }
+    return 0; /* Indicates success */
+}
+
+/* Checks that a relocation record points to an instruction word with the matching ARE bits */
+static int is_relocation_valid(Object_Module *module, int address, char kind)
+{
+    int offset = address - MEMORY_START_ADDRESS;
+
+    if (offset < 0 || offset >= module->code_size)
+        return 0;
+    if (kind == RELOCATION_KIND_RELOCATABLE)
+        return (module->words[offset] & ARE_PLACEHOLDER_SIGNAL) == ARE_RELOCATABLE;
+    return kind == RELOCATION_KIND_EXTERNAL && (module->words[offset] & ARE_PLACEHOLDER_SIGNAL) == ARE_EXTERNAL;
+}
+
+/* Reads the relocatable records of a relocation file, a missing file means the ARE bits are used instead */
+static int read_relocations(char *file_rel_name, Object_Module *module)
+{
+    char address[MAX_SOURCE_LINE_LENGTH + 1], kind[MAX_SOURCE_LINE_LENGTH + 1], symbol[MAX_SOURCE_LINE_LENGTH + 1];
+    int i, records_count, symbols_count;
+    FILE *file_rel = fopen(file_rel_name, "r");
+
+    if (file_rel == NULL)
+        return derive_relocations(module);
+    if (fscanf(file_rel, "%81s %81s", address, symbol) != 2 || (records_count = base4_to_decimal(address)) == -1 ||
+        (symbols_count = base4_to_decimal(symbol)) == -1 || records_count > module->code_size)
+    {
+        printf(" Invalid header in File \"%s\"", file_rel_name);
+        log_system_error(Error_300);
+        fclose(file_rel);
+        return 1; /* Indicates failure */
+    }
+    for (i = 0; i < symbols_count; i++)
+    {
+        if (fscanf(file_rel, "%81s", symbol) != 1)
+            break;
+    }
+    module->relocations = (int *)malloc((records_count > 0 ? records_count : 1) * sizeof(int));
+    if (module->relocations == NULL)
+    {
+        log_system_error(Error_101);
+        fclose(file_rel);
+        return 1; /* Indicates failure */
+    }
+    for (i = 0; i < records_count; i++)
+    {
+        if (fscanf(file_rel, "%81s %81s %81s", address, kind, symbol) != 3 || strlen(kind) != 1 ||
+            base4_to_decimal(symbol) == -1 || base4_to_decimal(symbol) >= symbols_count ||
+            !is_relocation_valid(module, base4_to_decimal(address), kind[0]))
+        {
+            printf(" Invalid record at line %d in File \"%s\"", symbols_count + i + 2, file_rel_name);
+            log_system_error(Error_300);
+            fclose(file_rel);
+            return 1; /* Indicates failure */
+        }
+        /* External uses are taken from the external file, which also names their symbols */
+        if (kind[0] == RELOCATION_KIND_RELOCATABLE)
+            module->relocations[module->relocations_count++] = base4_to_decimal(address);
+    }
+    fclose(file_rel);
+    return 0; /* Indicates success */
+}
+
+Object_Module *read_object_module(char *base_name)
+{
+    char *file_name;
+    int result;
+    Object_Module *module = (Object_Module *)calloc(1, sizeof(Object_Module));
+
+    if (module == NULL)
+    {
+        log_system_error(Error_101);
+        return NULL; /* Indicates failure */
+    }
+    module->name = (char *)malloc(strlen(base_name) + 1); /* +1 to accommodate '\0' */
+    if (module->name == NULL)
+    {
+        log_system_error(Error_101);
+        free(module);
+        return NULL; /* Indicates failure */
+    }
+    strcpy(module->name, base_name);
+
+    file_name = add_extension(base_name, ".ob");
+    if (file_name == NULL)
+    {
+        free_object_module(module);
+        return NULL; /* Indicates failure */
+    }
+    result = read_object_words(file_name, module);
+    clean_memory(file_name);
+
+    if (result == 0)
+    {
+        file_name = add_extension(base_name, ".ent");
+        result = read_symbols(file_name, &module->entries, &module->entries_count);
+        clean_memory(file_name);
+    }
+    if (result == 0)
+    {
+        file_name = add_extension(base_name, ".ext");
+        result = read_symbols(file_name, &module->extern_uses, &module->extern_uses_count);
+        clean_memory(file_name);
+    }
+    if (result == 0)
+    {
+        file_name = add_extension(base_name, ".rel");
+        result = read_relocations(file_name, module);
+        clean_memory(file_name);
+    }
+    if (result != 0)
+    {
+        free_object_module(module);
+        return NULL; /* Indicates failure */
+    }
+    return module; /* Indicates success */
+}
+
+void free_object_module(Object_Module *module)
+{
+    if (module == NULL)
+        return;
+    free(module->name);
+    free(module->words);
+    free(module->entries);
+    free(module->extern_uses);
+    free(module->relocations);
+    free(module);
+}
@@ -0,0 +1,66 @@
+/**
+ * This file handles the command-line options of the assembler.
+ * The options are kept in a static struct, so every phase of the assembler can query them
+ * without passing them as a parameter through all of the functions.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "options.h"
+#include "error_handler.h"
+#include "definitions.h"
+
+/* Defining the options, all of them are disabled by default */
+static Options options = {0};
+
+int is_option(char *argument)
+{
+    return argument[0] == MINUS_SIGN;
+}
+
+int parse_option(char *argument)
+{
+    if (strcmp(argument, "--hwcounters") == 0)
+    {
+        options.hw_counters = 1;
+        return 0; /* Indicates option was recognized */
+    }
+    /* The source lines are part of the symbol file, "--lines" is kept for the scripts that still pass it */
+    if (strcmp(argument, "--symbols") == 0 || strcmp(argument, "--lines") == 0)
+    {
+        options.symbols = 1;
+        return 0; /* Indicates option was recognized */
+    }
+    if (strcmp(argument, "-Os") == 0)
+    {
+        options.optimize_size = 1;
+        return 0; /* Indicates option was recognized */
+    }
+    if (strcmp(argument, "-O") == 0)
+    {
+        options.optimize = 1;
+        return 0; /* Indicates option was recognized */
+    }
+    if (strcmp(argument, "--dead-data") == 0)
+    {
+        options.dead_data = 1;
+        return 0; /* Indicates option was recognized */
+    }
+    if (strcmp(argument, "--size-report") == 0)
+    {
+        options.size_report = 1;
+        return 0; /* Indicates option was recognized */
+    }
+    if (strcmp(argument, "--rle") == 0)
+    {
+        options.run_length = 1;
+        return 0; /* Indicates option was recognized */
+    }
+    printf(" Unrecognized option \"%s\"", argument);
+    log_system_error(Error_106);
+    return 1; /* Indicates option was not recognized */
+}
+
+Options *retrieve_options()
+{
+    return &options;
+}
@@ -0,0 +1,282 @@
+/**
+ * This file outlines the macros that are called several times into subroutines.
+ * The calls are counted before the pre-processor expands the file, and every macro is measured at its first call,
+ * so the pre-processor knows whether to write its expansion or a "jsr" from the first call on.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "outliner.h"
+#include "error_handler.h"
+#include "validator.h"
+#include "machine.h"
+#include "utils.h"
+#include "definitions.h"
+
+/* Words of a call of an outlined macro: "jsr" and the address of its copy */
+#define CALL_WORDS 2
+
+/* Defining the head of the outlined macros linked list */
+static Outlined_Macro *head = NULL;
+
+/* Prefix of the labels of the copies, it is not a part of any line of the source file */
+#define MAX_PREFIX_LENGTH (MAX_LABEL_NAME_LENGTH - 3)
+static char label_prefix[MAX_PREFIX_LENGTH + 1];
+static int is_prefix_found = 0;
+static int labels_count = 0;
+
+/* The copies are added after the last line of the code: it must not run on into them ("stop", "jmp" or "rts") */
+static int is_code_closed = 0;
+/* A "jsr" of the file itself, so a call of a copy could take the last stack entry that the program needs */
+static int is_calling = 0;
+
+/* Returns the opcode of an instruction line, after its label, or -1 for any other line */
+static int find_line_opcode(char *line)
+{
+    char copy[MAX_SOURCE_LINE_LENGTH + 2], *colon, *space;
+
+    strcpy(copy, line);
+    colon = strchr(copy, ':');
+    space = strpbrk(copy, " \t");
+    if (colon != NULL && (space == NULL || colon < space))
+        line = colon + 1; /* Skipping the label */
+    else
+        line = copy;
+    return lookup_instruction_opcode(strtok(line, " \t"));
+}
+
+/* Adds a macro declared in the source file, returns 1 if memory allocation failed */
+static int add_outlined_macro(char *name)
+{
+    Outlined_Macro *macro = (Outlined_Macro *)calloc(1, sizeof(Outlined_Macro));
+
+    if (macro == NULL || (macro->name = (char *)malloc(strlen(name) + 1)) == NULL)
+    {
+        log_system_error(Error_101);
+        free(macro);
+        return 1; /* Indicates failure */
+    }
+    strcpy(macro->name, name);
+    macro->next = head;
+    head = macro;
+    return 0; /* Indicates success */
+}
+
+int count_macro_calls(char *file_name)
+{
+    char line[MAX_SOURCE_LINE_LENGTH + 2], *trimmed_line, *name;
+    int is_declaration = 0, opcode;
+    Outlined_Macro *macro;
+    FILE *file = fopen(file_name, "r");
+
+    if (file == NULL)
+    {
+        log_system_error(Error_103);
+        return 1; /* Indicates failure */
+    }
+    strcpy(label_prefix, "OUTLINED");
+    is_prefix_found = 1;
+    labels_count = 0;
+    is_code_closed = 0;
+    is_calling = 0;
+    /* The same checks as the pre-processor, in the same order */
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        /* A line that holds the prefix holds every longer prefix that starts with it as well */
+        while (is_prefix_found && strstr(line, label_prefix) != NULL)
+        {
+            if (strlen(label_prefix) == MAX_PREFIX_LENGTH)
+                is_prefix_found = 0;
+            else
+                strcat(label_prefix, "X");
+        }
+        if (*line == SEMICOLON)
+            continue;
+        trimmed_line = trim_whitespace(line);
+        opcode = find_line_opcode(trimmed_line);
+        if (opcode == JSR_OPCODE)
+            is_calling = 1; /* In the code or in a macro, which may be expanded */
+        if (is_declaration)
+        {
+            is_declaration = is_only_word(trimmed_line, "endmcro") == 0;
+            continue;
+        }
+        if ((macro = find_outlined_macro(trimmed_line)) != NULL)
+        {
+            macro->calls++;
+            is_code_closed = 0; /* The expansion may end the code */
+            continue;
+        }
+        if (opcode != -1)
+            is_code_closed = opcode == STOP_OPCODE || opcode == JMP_OPCODE || opcode == RTS_OPCODE;
+        if (is_only_word(trimmed_line, "mcro") == 0)
+            continue;
+        is_declaration = 1;
+        if (strncmp(trimmed_line, "mcro", MACRO_START_LENGTH) == 0 && isspace(trimmed_line[MACRO_START_LENGTH]))
+        {
+            name = trim_whitespace(trimmed_line + MACRO_START_LENGTH);
+            if (find_outlined_macro(name) == NULL && add_outlined_macro(name) != 0)
+            {
+                fclose(file);
+                return 1; /* Indicates failure */
+            }
+        }
+    }
+    fclose(file);
+    return 0; /* Indicates success */
+}
+
+Outlined_Macro *find_outlined_macro(char *name)
+{
+    Outlined_Macro *macro;
+
+    for (macro = head; macro != NULL; macro = macro->next)
+    {
+        if (strcmp(macro->name, name) == 0)
+            return macro;
+    }
+    return NULL;
+}
+
+/* Returns the words of an instruction line of an expansion, or -1 if the line can not be a part of a copy */
+static int count_instruction_words(char *line)
+{
+    char copy[MAX_SOURCE_LINE_LENGTH + 2], *mnemonic, *operand;
+    int opcode, operands_count = 0, registers_count = 0, words = 1;
+
+    strcpy(copy, line);
+    mnemonic = strtok(copy, " \t");
+    if ((opcode = lookup_instruction_opcode(mnemonic)) == -1 || opcode == JMP_OPCODE || opcode == BNE_OPCODE ||
+        opcode == JSR_OPCODE || opcode == RTS_OPCODE)
+        return -1; /* A label, a directive or an instruction that transfers control */
+    for (operand = strtok(NULL, ","); operand != NULL; operand = strtok(NULL, ","))
+    {
+        operand = trim_whitespace(operand);
+        operands_count++;
+        if (*operand == STRING_TERMINATOR)
+            return -1; /* Left for the first pass to report */
+        if (parse_register_operand(operand) != -1)
+            registers_count++;
+        else
+            words += strchr(operand, LEFT_BRACKET) != NULL ? 2 : 1;
+    }
+    if (operands_count != retrieve_instruction_set()[opcode].operand_count)
+        return -1; /* Left for the first pass to report */
+    return words + (registers_count > 0); /* Two register operands share one word */
+}
+
+int decide_outline(Outlined_Macro *macro, FILE *expansion)
+{
+    char line[MAX_SOURCE_LINE_LENGTH + 2], *trimmed_line;
+    long size;
+    int words, first_length = 0;
+
+    macro->is_decided = 1;
+    while (fgets(line, sizeof(line), expansion) != NULL)
+    {
+        trimmed_line = trim_whitespace(line);
+        if (*trimmed_line == STRING_TERMINATOR || *trimmed_line == SEMICOLON)
+            continue;
+        if ((words = count_instruction_words(trimmed_line)) == -1)
+        {
+            macro->words = 0;
+            return 0; /* Indicates success, the macro is expanded */
+        }
+        if (macro->words == 0)
+            first_length = strlen(trimmed_line);
+        macro->words += words;
+    }
+    /* The label (the prefix and at most 3 digits) and ": " are written before the first instruction */
+    if (macro->words == 0 || !is_prefix_found || !is_code_closed || is_calling ||
+        MAX_LABEL_NAME_LENGTH + 2 + first_length > MAX_SOURCE_LINE_LENGTH - 1 ||
+        macro->calls * macro->words <= macro->calls * CALL_WORDS + macro->words + 1)
+        return 0; /* Indicates success, the macro is expanded */
+
+    /* Keeping the expansion for the copy */
+    fseek(expansion, 0, SEEK_END);
+    size = ftell(expansion);
+    rewind(expansion);
+    if ((macro->body = (char *)malloc(size + 1)) == NULL)
+    {
+        log_system_error(Error_101);
+        return 1; /* Indicates failure */
+    }
+    macro->body[fread(macro->body, 1, size, expansion)] = STRING_TERMINATOR;
+    /* Every copy takes a word of the module at least, so the number of a copy has 3 digits at most */
+    strcpy(macro->label, label_prefix);
+    sprintf(macro->label + strlen(label_prefix), "%d", ++labels_count);
+    macro->is_outlined = 1;
+    return 0; /* Indicates success */
+}
+
+/* Writes the copies in the order of the declarations, the list holds them in reverse */
+static void write_copies(FILE *file_am, Outlined_Macro *macro)
+{
+    char *line, *next_line, *trimmed_line;
+    int is_labeled = 0;
+
+    if (macro == NULL)
+        return;
+    write_copies(file_am, macro->next);
+    if (!macro->is_outlined)
+        return;
+    fprintf(file_am, "\n; macro %s\n", macro->name);
+    for (line = macro->body; *line != STRING_TERMINATOR; line = next_line)
+    {
+        if ((next_line = strchr(line, '\n')) != NULL)
+            *next_line++ = STRING_TERMINATOR;
+        else
+            next_line = line + strlen(line);
+        trimmed_line = trim_whitespace(line);
+        /* The label goes on the first instruction */
+        if (!is_labeled && *trimmed_line != STRING_TERMINATOR && *trimmed_line != SEMICOLON)
+        {
+            fprintf(file_am, "%s: ", macro->label);
+            is_labeled = 1;
+        }
+        fprintf(file_am, "%s\n", trimmed_line);
+    }
+    fprintf(file_am, "rts\n");
+}
+
+void write_outlined_macros(FILE *file_am)
+{
+    write_copies(file_am, head);
+}
+
+/* Prints the outlined macros in the order of their declarations, returns the words they saved */
+static int report_copies(Outlined_Macro *macro)
+{
+    int saved, previous_saved;
+
+    if (macro == NULL)
+        return 0;
+    previous_saved = report_copies(macro->next);
+    if (!macro->is_outlined)
+        return previous_saved;
+    /* The expansions are replaced by the calls, the copy and its "rts" */
+    saved = macro->calls * macro->words - (macro->calls * CALL_WORDS + macro->words + 1);
+    printf("Outlined macro \"%s\" into \"%s\": %d calls of %d words, %d words saved\n", macro->name, macro->label,
+           macro->calls, macro->words, saved);
+    return previous_saved + saved;
+}
+
+void report_outlined_macros()
+{
+    printf("Outlining saved %d words\n", report_copies(head));
+}
+
+void free_outlined_macros()
+{
+    Outlined_Macro *next;
+
+    while (head != NULL)
+    {
+        next = head->next;
+        free(head->name);
+        free(head->body);
+        free(head);
+        head = next;
+    }
+}
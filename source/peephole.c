@@ -0,0 +1,296 @@
+/**
+ * This file is the peephole optimizer of the assembler.
+ * The instructions are decoded from the code words of the first pass, the rules mark the instructions they remove or
+ * change the operand labels of the jumps they thread, and the words are moved together once no rule matches.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "peephole.h"
+#include "error_handler.h"
+#include "validator.h"
+#include "labels_handler.h"
+#include "line_table.h"
+#include "machine.h"
+#include "definitions.h"
+
+/* Peephole rule enum definition */
+typedef enum Peephole_Rule {
+    RULE_SELF_MOVE,
+    RULE_JUMP_TO_NEXT,
+    RULE_JUMP_THREADING,
+    RULE_UNREACHABLE,
+    TOTAL_PEEPHOLE_RULES
+} Peephole_Rule;
+
+/* Names of the rules, for the report */
+static const char *rule_names[TOTAL_PEEPHOLE_RULES] = {
+    "mov rX, rX", "jmp to the next instruction", "jump to jmp", "unreachable after stop/rts/jmp"
+};
+
+/* Peephole instruction struct definition - an instruction decoded from the code words */
+typedef struct Peephole_Instruction {
+    int address;            /* Position of the first word in the code array */
+    int length;             /* Number of words */
+    int opcode;
+    int source_mode;
+    int destination_mode;
+    Label *target;          /* Operand label of a jump to a label, NULL otherwise */
+    int is_labeled;         /* 1 if a code label is defined on the instruction */
+    int is_removed;
+} Peephole_Instruction;
+
+static Peephole_Instruction instructions[MAX_ARRAY_CAPACITY];
+static int instructions_count;
+/* The instruction that starts at each word, -1 for the operand words */
+static int instruction_at[MAX_ARRAY_CAPACITY];
+/* The operand label that the second pass codes into each word, NULL for the other words */
+static Label *operands[MAX_ARRAY_CAPACITY];
+/* The position of each word after the words are moved together, -1 for the removed words */
+static int positions[MAX_ARRAY_CAPACITY];
+static int hits[TOTAL_PEEPHOLE_RULES];
+
+/* Returns the number of words of an operand */
+static int count_operand_words(int mode)
+{
+    return mode == MATRIX ? 2 : 1;
+}
+
+/* Decodes the code words into instructions, and finds the operand labels and the labeled instructions */
+static void decode_instructions(unsigned short *code, int IC)
+{
+    InstructionDefinition *opcodes = retrieve_instruction_set();
+    Peephole_Instruction *instruction;
+    Label *label;
+    int i, operand_count;
+
+    for (i = 0; i < IC; i++)
+    {
+        instruction_at[i] = -1;
+        operands[i] = NULL;
+    }
+    for (label = point_label_head(); label != NULL; label = label->next)
+    {
+        if (label->type == OPERAND && label->address >= 0 && label->address < IC)
+            operands[label->address] = label;
+    }
+    instructions_count = 0;
+    for (i = 0; i < IC; i += instruction->length)
+    {
+        instruction = &instructions[instructions_count];
+        instruction_at[i] = instructions_count++;
+        instruction->address = i;
+        instruction->opcode = (code[i] >> OPCODE_SHIFT_POSITION) & MASK_4_BITS;
+        instruction->source_mode = (code[i] >> SOURCE_OPERAND_SHIFT_POSITION) & 3;
+        instruction->destination_mode = (code[i] >> DESTINATION_OPERAND_SHIFT_POSITION) & 3;
+        instruction->target = NULL;
+        instruction->is_labeled = 0;
+        instruction->is_removed = 0;
+        operand_count = opcodes[instruction->opcode].operand_count;
+        if (operand_count == 0)
+            instruction->length = 1;
+        else if (operand_count == 1)
+            instruction->length = 1 + count_operand_words(instruction->destination_mode);
+        else if (instruction->source_mode == DIRECT_REGISTER && instruction->destination_mode == DIRECT_REGISTER)
+            instruction->length = 2; /* Two register operands share one word */
+        else
+            instruction->length = 1 + count_operand_words(instruction->source_mode) +
+                                  count_operand_words(instruction->destination_mode);
+        if (operand_count == 1 && instruction->destination_mode == DIRECT && i + 1 < IC)
+            instruction->target = operands[i + 1];
+    }
+    for (label = point_label_head(); label != NULL; label = label->next)
+    {
+        i = label->address - MEMORY_START_ADDRESS;
+        if (label->type != OPERAND && label->location == CODE && i >= 0 && i < IC && instruction_at[i] != -1)
+            instructions[instruction_at[i]].is_labeled = 1;
+    }
+}
+
+/* Returns the first instruction that was not removed from a given instruction on, instructions_count if none */
+static int find_instruction(int index)
+{
+    while (index < instructions_count && instructions[index].is_removed)
+        index++;
+    return index;
+}
+
+/* Returns the instruction a jump reaches, or -1 if it does not jump to a code label of the module */
+static int find_target(Peephole_Instruction *instruction)
+{
+    Label *label;
+    int address;
+
+    if (instruction->target == NULL)
+        return -1;
+    label = is_label_name_exist(instruction->target->name);
+    if (label == NULL || label->type == EXTERN || label->location != CODE)
+        return -1;
+    address = label->address - MEMORY_START_ADDRESS;
+    if (address < 0 || address >= MAX_ARRAY_CAPACITY || instruction_at[address] == -1)
+        return -1;
+    return find_instruction(instruction_at[address]);
+}
+
+/* Marks an instruction as removed and counts the hit of its rule */
+static void remove_instruction(Peephole_Instruction *instruction, Peephole_Rule rule)
+{
+    instruction->is_removed = 1;
+    hits[rule]++;
+}
+
+/* Removes "mov rX, rX", it changes neither the registers nor the flag, returns 1 if it matched */
+static int apply_self_move(unsigned short *code, int index)
+{
+    Peephole_Instruction *instruction = &instructions[index];
+    unsigned short word;
+
+    if (instruction->opcode != MOV_OPCODE || instruction->source_mode != DIRECT_REGISTER ||
+        instruction->destination_mode != DIRECT_REGISTER)
+        return 0;
+    word = code[instruction->address + 1];
+    if (((word >> SOURCE_REGISTER_SHIFT_POSITION) & MASK_4_BITS) !=
+        ((word >> DESTINATION_REGISTER_SHIFT_POSITION) & MASK_4_BITS))
+        return 0;
+    remove_instruction(instruction, RULE_SELF_MOVE);
+    return 1;
+}
+
+/* Removes a "jmp" to the instruction that follows it, returns 1 if it matched */
+static int apply_jump_to_next(int index)
+{
+    Peephole_Instruction *instruction = &instructions[index];
+
+    if (instruction->opcode != JMP_OPCODE || find_target(instruction) != find_instruction(index + 1))
+        return 0;
+    remove_instruction(instruction, RULE_JUMP_TO_NEXT);
+    return 1;
+}
+
+/**
+ * Gives a jump to a "jmp" the last target of the chain of "jmp" it starts, the chains that loop are left alone.
+ * return 1 if it matched, 0 if it did not, -1 if memory allocation failed.
+ */
+static int apply_jump_threading(int index)
+{
+    Peephole_Instruction *instruction = &instructions[index];
+    Label *destination = NULL;
+    char *name;
+    int target, steps;
+
+    if (instruction->opcode != JMP_OPCODE && instruction->opcode != BNE_OPCODE && instruction->opcode != JSR_OPCODE)
+        return 0;
+    target = find_target(instruction);
+    for (steps = 0; target != -1 && target != index && target < instructions_count &&
+                    instructions[target].opcode == JMP_OPCODE && instructions[target].target != NULL;
+         steps++)
+    {
+        if (steps == instructions_count)
+            return 0; /* The chain loops without reaching this jump */
+        destination = instructions[target].target;
+        target = find_target(&instructions[target]);
+    }
+    if (target == index)
+        return 0; /* The chain loops back to this jump */
+    if (destination == NULL || strcmp(destination->name, instruction->target->name) == 0)
+        return 0;
+    name = (char *)malloc(strlen(destination->name) + 1);
+    if (name == NULL)
+    {
+        log_system_error(Error_101);
+        return -1; /* Indicates failure */
+    }
+    strcpy(name, destination->name);
+    free(instruction->target->name);
+    instruction->target->name = name;
+    hits[RULE_JUMP_THREADING]++;
+    return 1;
+}
+
+/* Removes the instructions after "stop", "rts" or "jmp" up to the next label, returns 1 if it matched */
+static int apply_unreachable(int index)
+{
+    int opcode = instructions[index].opcode, is_matched = 0;
+
+    if (opcode != STOP_OPCODE && opcode != RTS_OPCODE && opcode != JMP_OPCODE)
+        return 0;
+    for (index++; index < instructions_count && !instructions[index].is_labeled; index++)
+    {
+        if (!instructions[index].is_removed)
+        {
+            remove_instruction(&instructions[index], RULE_UNREACHABLE);
+            is_matched = 1;
+        }
+    }
+    return is_matched;
+}
+
+/* Moves the remaining words together, with the labels and the source lines, returns the new instruction counter */
+static int move_words(unsigned short *code)
+{
+    Peephole_Instruction *instruction;
+    Label *label, *next;
+    int i, j, target, new_IC = 0;
+
+    for (i = 0; i < instructions_count; i++)
+    {
+        instruction = &instructions[i];
+        for (j = instruction->address; j < instruction->address + instruction->length; j++)
+        {
+            positions[j] = instruction->is_removed ? -1 : new_IC;
+            if (!instruction->is_removed)
+                code[new_IC++] = code[j];
+        }
+    }
+    for (label = point_label_head(); label != NULL; label = next)
+    {
+        next = label->next;
+        if (label->type == OPERAND)
+        {
+            if (positions[label->address] == -1)
+                remove_label(label); /* The word that held it was removed */
+            else
+                label->address = positions[label->address];
+        }
+        else if (label->location == CODE && instruction_at[label->address - MEMORY_START_ADDRESS] != -1)
+        {
+            /* A label of a removed instruction moves to the next instruction that remains */
+            target = find_instruction(instruction_at[label->address - MEMORY_START_ADDRESS]);
+            label->address = (target == instructions_count ? new_IC : positions[instructions[target].address]) +
+                             MEMORY_START_ADDRESS;
+        }
+    }
+    move_source_lines(positions);
+    return new_IC;
+}
+
+int optimize_code(unsigned short *code, int *IC)
+{
+    int i, result, is_changed = 1, new_IC;
+
+    memset(hits, 0, sizeof(hits));
+    decode_instructions(code, *IC);
+    while (is_changed)
+    {
+        is_changed = 0;
+        for (i = 0; i < instructions_count; i++)
+        {
+            if (instructions[i].is_removed)
+                continue;
+            if ((result = apply_jump_threading(i)) == -1)
+                return 1; /* Indicates failure */
+            is_changed |= result;
+            is_changed |= apply_self_move(code, i);
+            if (!instructions[i].is_removed)
+                is_changed |= apply_jump_to_next(i);
+            if (!instructions[i].is_removed)
+                is_changed |= apply_unreachable(i);
+        }
+    }
+    new_IC = move_words(code);
+    for (i = 0; i < TOTAL_PEEPHOLE_RULES; i++)
+        printf("Peephole rule \"%s\": %d hits\n", rule_names[i], hits[i]);
+    printf("Peephole optimizer saved %d words\n", *IC - new_IC);
+    *IC = new_IC;
+    return 0; /* Indicates success */
+}
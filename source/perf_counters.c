@@ -0,0 +1,201 @@
+/**
+ * This file handles the measurement of the assembler phases with performance counters.
+ * The counters are opened once as a single perf_event_open group, so all of them are read with one system call.
+ * Every phase takes a snapshot of the counters when it begins and accumulates the difference when it ends.
+ * This file defines static variables for the counters state, since the phases are spread across several files
+ * and passing the state as a parameter to all of them would change their interfaces for an optional feature.
+ */
+#ifdef __linux__
+#define _GNU_SOURCE /* syscall() and clock_gettime() are not part of ANSI C */
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "perf_counters.h"
+#include "options.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/* Number of events opened in each counters group */
+#define TOTAL_EVENTS 4
+
+/* Events and their names for each mode */
+#ifdef __linux__
+static unsigned int event_types[] = {PERF_TYPE_HARDWARE, PERF_TYPE_SOFTWARE};
+static unsigned long event_configs[][TOTAL_EVENTS] = {
+    {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_COUNT_SW_TASK_CLOCK, PERF_COUNT_SW_PAGE_FAULTS, PERF_COUNT_SW_CONTEXT_SWITCHES, PERF_COUNT_SW_CPU_MIGRATIONS}};
+#endif
+static char *event_names[][TOTAL_EVENTS] = {
+    {"cycles", "instructions", "cache-misses", "branch-misses"},
+    {"task-clock(ns)", "page-faults", "ctx-switches", "migrations"}};
+static char *phase_names[] = {"pre-processing", "first pass", "second pass"};
+static char *mode_names[] = {"hardware counters", "software counters", "elapsed time only"};
+
+/* Counters state */
+static Counter_Mode mode = CLOCK_ONLY;
+static int group_fds[TOTAL_EVENTS] = {-1, -1, -1, -1};
+static double start_values[TOTAL_PHASES][TOTAL_EVENTS + 1];  /* +1 for the elapsed time */
+static double phase_values[TOTAL_PHASES][TOTAL_EVENTS + 1];
+static int measured_lines = 0;
+
+/* Returns the elapsed time in microseconds */
+static double read_clock()
+{
+#ifdef __linux__
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+#else
+    return (double)clock() * 1e6 / CLOCKS_PER_SEC;
+#endif
+}
+
+#ifdef __linux__
+/* Opens a whole group of events for the given mode, returns 0 on success */
+static int open_group(Counter_Mode group_mode)
+{
+    struct perf_event_attr attr;
+    int i;
+
+    for (i = 0; i < TOTAL_EVENTS; i++)
+    {
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = event_types[group_mode];
+        attr.config = event_configs[group_mode][i];
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        group_fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : group_fds[0], 0);
+        if (group_fds[i] == -1)
+        {
+            close_perf_counters();
+            return 1; /* Indicates failure */
+        }
+    }
+    ioctl(group_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    mode = group_mode;
+    return 0; /* Indicates success */
+}
+#endif
+
+/* Reads the current values of the group into values, the last slot is the elapsed time */
+static void read_values(double *values)
+{
+#ifdef __linux__
+    __u64 buffer[TOTAL_EVENTS + 1]; /* Number of events followed by their values */
+    int i;
+
+    if (mode != CLOCK_ONLY && read(group_fds[0], buffer, sizeof(buffer)) == sizeof(buffer))
+    {
+        for (i = 0; i < TOTAL_EVENTS; i++)
+            values[i] = (double)buffer[i + 1];
+    }
+#endif
+    values[TOTAL_EVENTS] = read_clock();
+}
+
+void open_perf_counters()
+{
+    if (retrieve_options()->hw_counters == 0)
+        return;
+    memset(phase_values, 0, sizeof(phase_values));
+#ifdef __linux__
+    if (open_group(HARDWARE_COUNTERS) == 0)
+        return;
+    printf(" WARNING | Hardware performance counters are unavailable, using software counters\n");
+    if (open_group(SOFTWARE_COUNTERS) == 0)
+        return;
+#endif
+    printf(" WARNING | Performance counters are unavailable, measuring elapsed time only\n");
+    mode = CLOCK_ONLY;
+}
+
+void begin_phase(Phase phase)
+{
+    if (retrieve_options()->hw_counters == 0)
+        return;
+    read_values(start_values[phase]);
+}
+
+void end_phase(Phase phase)
+{
+    double values[TOTAL_EVENTS + 1] = {0};
+    int i;
+
+    if (retrieve_options()->hw_counters == 0)
+        return;
+    read_values(values);
+    for (i = 0; i <= TOTAL_EVENTS; i++)
+        phase_values[phase][i] += values[i] - start_values[phase][i];
+}
+
+void set_measured_lines(int line_count)
+{
+    measured_lines = line_count;
+}
+
+void report_perf_counters(char *file_name)
+{
+    int phase, i, names = mode == HARDWARE_COUNTERS ? 0 : 1;
+    double lines = measured_lines > 0 ? measured_lines : 1;  /* Avoiding a division by zero */
+    double *values;
+
+    if (retrieve_options()->hw_counters == 0)
+        return;
+    printf("Performance of \"%s\" (%s, %d lines):\n", file_name, mode_names[mode], measured_lines);
+    printf("  %-15s %12s", "phase", "time(us)");
+    if (mode != CLOCK_ONLY)
+    {
+        for (i = 0; i < TOTAL_EVENTS; i++)
+            printf(" %14s", event_names[names][i]);
+        if (mode == HARDWARE_COUNTERS)
+            printf(" %6s %13s %13s", "IPC", "cmiss/line", "bmiss/line");
+        else
+            printf(" %13s %13s", "faults/line", "ns/line");
+    }
+    printf("\n");
+
+    for (phase = 0; phase < TOTAL_PHASES; phase++)
+    {
+        values = phase_values[phase];
+        printf("  %-15s %12.1f", phase_names[phase], values[TOTAL_EVENTS]);
+        if (mode == HARDWARE_COUNTERS)
+        {
+            for (i = 0; i < TOTAL_EVENTS; i++)
+                printf(" %14.0f", values[i]);
+            printf(" %6.2f %13.3f %13.3f", values[0] > 0 ? values[1] / values[0] : 0.0,
+                   values[2] / lines, values[3] / lines);
+        }
+        else if (mode == SOFTWARE_COUNTERS)
+        {
+            for (i = 0; i < TOTAL_EVENTS; i++)
+                printf(" %14.0f", values[i]);
+            printf(" %13.3f %13.1f", values[1] / lines, values[0] / lines);
+        }
+        printf("\n");
+    }
+    memset(phase_values, 0, sizeof(phase_values));
+    measured_lines = 0;
+}
+
+void close_perf_counters()
+{
+    int i;
+
+    for (i = TOTAL_EVENTS - 1; i >= 0; i--)
+    {
+#ifdef __linux__
+        if (group_fds[i] != -1)
+            close(group_fds[i]);
+#endif
+        group_fds[i] = -1;
+    }
+    mode = CLOCK_ONLY;
+}
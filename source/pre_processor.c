@@ -13,6 +13,8 @@
 #include "validator.h"
 #include "utils.h"
 #include "macro_handler.h"
+#include "outliner.h"
+#include "options.h"
 #include "definitions.h"
 
 /*
@@ -62,17 +64,51 @@ static void write_expanded_content(FILE *file_am, char *content) {
     free(buffer);
 }
 
+/*
+ * Checks if a call of a macro is replaced by a "jsr" to its copy ("-Os"), measuring the macro at its first call.
+ * @param macro The called macro
+ * @return 1 if the call is outlined, 0 if the macro is expanded, -1 if memory allocation failed
+ */
+static int is_outlined_call(Macro *macro) {
+    Outlined_Macro *outlined = find_outlined_macro(macro->name);
+    FILE *expansion;
+    int result = 0;
+
+    if (!retrieve_options()->optimize_size || outlined == NULL)
+        return 0;  /* The macro is expanded */
+    if (!outlined->is_decided) {
+        outlined->is_decided = 1;
+        if ((expansion = tmpfile()) == NULL)
+            return 0;  /* The macro is expanded */
+        write_expanded_content(expansion, macro->content);
+        rewind(expansion);
+        result = decide_outline(outlined, expansion);
+        fclose(expansion);
+    }
+    return result != 0 ? -1 : outlined->is_outlined;
+}
+
 int run_pre_processing(char *file_name) {
     /* Getting the new file name */
     char *file_am_name = change_extension(file_name,".am");
 
+    /* Counting the macro calls that "-Os" may outline */
+    if (retrieve_options()->optimize_size && count_macro_calls(file_name) != 0) {
+        free_outlined_macros();
+        free_all_memory();
+        return 1;  /*failure */
+    }
     /* Handling all macro calls and declarations */
     if (handle_macros(file_name,file_am_name) != 0) {
+        free_outlined_macros();
         free_macros();
         free_all_memory();
         return 1;  /*failure */
     }
     clean_memory(file_am_name);
+    if (retrieve_options()->optimize_size)
+        report_outlined_macros();
+    free_outlined_macros();
     printf("Macro expansion stage completed successfully \n");
     return 0;  /* success */
 }
@@ -80,7 +116,7 @@ int run_pre_processing(char *file_name) {
 int handle_macros(char *file_name, char *file_am_name) {
     char *macro_name, *trimmed_line;
     char line[MAX_SOURCE_LINE_LENGTH+1], copy[MAX_SOURCE_LINE_LENGTH+1];  /* +1 to accommodate '\0' */
-    int errors_found = 0 , macro_found = 0, line_count = 0, name_is_valid = 0, decl_line, line_length, ch;
+    int errors_found = 0 , macro_found = 0, line_count = 0, name_is_valid = 0, decl_line, line_length, ch, outlined;
     FILE *file, *file_am;
     Macro *macro_ptr;
     int last_line_blank = 1; /* Track whether the last written output line was blank */
@@ -130,7 +166,18 @@ int handle_macros(char *file_name, char *file_am_name) {
 
         /* Writing the macro content into "file.am" if a macro call was detected (only outside a declaration) */
         if (macro_found == 0 && (macro_ptr = find_macro_by_name(trimmed_line)) != NULL) {
-            if (errors_found == 0) {
+            if (errors_found == 0 && (outlined = is_outlined_call(macro_ptr)) != 0) {
+                if (outlined == -1) {  /* Indicates memory allocation failed */
+                    fclose(file);
+                    fclose(file_am);
+                    delete_file(file_am_name);
+                    free_macros();
+                    free_all_memory();
+                    exit(1);  /* Exiting program */
+                }
+                fprintf(file_am, "jsr %s\n", find_outlined_macro(macro_ptr->name)->label);
+                last_line_blank = 0;
+            } else if (errors_found == 0) {
                 /* Ensure a blank line BEFORE the expanded macro content if previous line wasn't blank */
                 if (!last_line_blank) {
                     fputs("\n", file_am);
@@ -221,6 +268,9 @@ int handle_macros(char *file_name, char *file_am_name) {
         }
         name_is_valid = 1;
     }
+    /* Adding the copies of the outlined macros after the code */
+    if (errors_found == 0)
+        write_outlined_macros(file_am);
     fclose(file);
     fclose(file_am);
     if (errors_found != 0)
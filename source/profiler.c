@@ -0,0 +1,294 @@
+/**
+ * This file profiles the runs of programs by label, by call stack and by call graph edge.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "profiler.h"
+#include "interpreter.h"
+#include "machine.h"
+#include "object_reader.h"
+#include "symbol_file.h"
+#include "error_handler.h"
+#include "definitions.h"
+
+#define INITIAL_NODES_CAPACITY 64
+
+/* Compares two profile labels by address, for sorting the labels of the profile */
+static int compare_labels(const void *first, const void *second)
+{
+    return ((Profile_Label *)first)->address - ((Profile_Label *)second)->address;
+}
+
+/* Adds a label to the profile */
+static void add_profile_label(Profile *profile, char *name, int address)
+{
+    Profile_Label *label = &profile->labels[profile->labels_count++];
+
+    strcpy(label->name, name);
+    label->address = address;
+}
+
+/* Returns the index of the label an address belongs to: the last label at or before it */
+static int label_at(Profile *profile, int address)
+{
+    int low = 0, high = profile->labels_count - 1, middle;
+
+    while (low < high)
+    {
+        middle = (low + high + 1) / 2;
+        if (profile->labels[middle].address <= address)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+    return low;
+}
+
+/* Adds a call node under a parent, returns its index or -1 if the nodes ran out */
+static int add_call_node(Profile *profile, int label, int parent)
+{
+    Call_Node *resized, *node;
+    int capacity;
+
+    if (profile->nodes_count == MAX_CALL_NODES)
+        return -1;
+    if (profile->nodes_count == profile->nodes_capacity)
+    {
+        capacity = profile->nodes_capacity == 0 ? INITIAL_NODES_CAPACITY : profile->nodes_capacity * 2;
+        if ((resized = (Call_Node *)realloc(profile->nodes, capacity * sizeof(Call_Node))) == NULL)
+            return -1;
+        profile->nodes = resized;
+        profile->nodes_capacity = capacity;
+    }
+    node = &profile->nodes[profile->nodes_count];
+    memset(node, 0, sizeof(Call_Node));
+    node->label = label;
+    node->parent = parent;
+    node->first_child = -1;
+    node->next_sibling = -1;
+    if (parent != -1)
+    {
+        node->next_sibling = profile->nodes[parent].first_child;
+        profile->nodes[parent].first_child = profile->nodes_count;
+    }
+    return profile->nodes_count++;
+}
+
+/* Enters the label at the target of a "jsr" from the running call stack */
+static void enter_call(Profile *profile, int label)
+{
+    int node = profile->nodes[profile->current].first_child;
+
+    profile->labels[label].calls++;
+    if (profile->untracked_depth > 0)
+    {
+        profile->untracked_depth++;
+        return;
+    }
+    while (node != -1 && profile->nodes[node].label != label)
+        node = profile->nodes[node].next_sibling;
+    if (node == -1 && (node = add_call_node(profile, label, profile->current)) == -1)
+    {
+        profile->untracked_depth = 1;
+        return;
+    }
+    profile->nodes[node].calls++;
+    profile->current = node;
+}
+
+/* Returns from the running call stack to its caller */
+static void return_call(Profile *profile)
+{
+    if (profile->untracked_depth > 0)
+        profile->untracked_depth--;
+    else if (profile->nodes[profile->current].parent != -1)
+        profile->current = profile->nodes[profile->current].parent;
+}
+
+/* Attributes the instructions and cycles of the blocks that ran to their labels */
+static void attribute_blocks(Profile *profile, Machine *machine)
+{
+    Decoded_Instruction *instruction;
+    Profile_Label *label;
+    unsigned long runs, length, remainder;
+    int i, start, address;
+
+    for (i = 0; i < profile->labels_count; i++)
+        profile->labels[i].instructions = profile->labels[i].cycles = 0;
+    for (start = 0; start <= MACHINE_MEMORY_SIZE; start++)
+    {
+        if ((runs = profile->block_runs[start]) == 0)
+            continue;
+        /* Every run of a block runs the same instructions, unless it stopped early or its code was written */
+        length = profile->block_instructions[start] / runs;
+        remainder = profile->block_instructions[start] - length * runs;
+        for (address = start; length > 0 && address <= MACHINE_MEMORY_SIZE; length--)
+        {
+            instruction = &machine->decoded[address];
+            label = &profile->labels[label_at(profile, address)];
+            label->instructions += runs;
+            label->cycles += runs * instruction->length;
+            address = instruction->next;
+        }
+        label = &profile->labels[label_at(profile, start)];
+        label->instructions += remainder;
+        label->cycles += remainder;
+    }
+}
+
+Profile *create_profile(Object_Module *module, Machine *machine)
+{
+    Profile *profile = (Profile *)calloc(1, sizeof(Profile));
+    Program_Symbol *symbols;
+    int i, symbols_count, address;
+
+    if (profile == NULL)
+    {
+        log_system_error(Error_101);
+        return NULL;
+    }
+    if (read_symbol_file(module->name, &symbols, &symbols_count) != 0)
+    {
+        free(profile);
+        return NULL;
+    }
+    /* The code labels of the symbol file, or the entries when the program has no symbol file */
+    for (i = 0; i < symbols_count; i++)
+    {
+        if (!symbols[i].is_data && !symbols[i].is_extern && symbols[i].address >= machine->code_start &&
+            symbols[i].address < machine->code_end)
+            add_profile_label(profile, symbols[i].name, symbols[i].address);
+    }
+    for (i = 0; symbols_count == 0 && i < module->entries_count; i++)
+    {
+        address = module->entries[i].address;
+        if (address >= machine->code_start && address < machine->code_end)
+            add_profile_label(profile, module->entries[i].name, address);
+    }
+    free(symbols);
+    qsort(profile->labels, profile->labels_count, sizeof(Profile_Label), compare_labels);
+    if (profile->labels_count == 0 || profile->labels[0].address != machine->code_start)
+    {
+        add_profile_label(profile, "(start)", machine->code_start);
+        qsort(profile->labels, profile->labels_count, sizeof(Profile_Label), compare_labels);
+    }
+    add_profile_label(profile, "(outside code)", machine->code_end);
+
+    if (add_call_node(profile, label_at(profile, machine->pc), -1) == -1)
+    {
+        log_system_error(Error_101);
+        free_profile(profile);
+        return NULL;
+    }
+    return profile;
+}
+
+int run_profiled(Machine *machine, Profile *profile, unsigned long max_steps)
+{
+    unsigned long limit = max_steps == 0 ? (unsigned long)-1 : machine->executed + max_steps, executed;
+    int start, sp;
+
+    while (machine->status == MACHINE_RUNNING)
+    {
+        start = machine->pc;
+        sp = machine->sp;
+        executed = machine->executed;
+        run_machine(machine, 1); /* Runs up to and including the next control transfer */
+        profile->block_runs[start]++;
+        profile->block_instructions[start] += machine->executed - executed;
+        profile->nodes[profile->current].instructions += machine->executed - executed;
+        if (machine->sp > sp)
+            enter_call(profile, label_at(profile, machine->pc));
+        else if (machine->sp < sp)
+            return_call(profile);
+        if (machine->status == MACHINE_STEP_LIMIT && machine->executed < limit)
+            machine->status = MACHINE_RUNNING;
+    }
+    attribute_blocks(profile, machine);
+    return machine->status;
+}
+
+void print_profile(Profile *profile)
+{
+    unsigned long total = 0, *edges;
+    int i, j, best, order[MAX_PROFILE_LABELS], labels_count = profile->labels_count;
+    Call_Node *node;
+
+    /* Flat profile, the labels with the most instructions first */
+    for (i = 0; i < labels_count; i++)
+    {
+        order[i] = i;
+        total += profile->labels[i].instructions;
+    }
+    printf("Flat profile (cycles are instruction words fetched):\n");
+    printf("  %-31s %14s %8s %14s %10s\n", "Label", "Instructions", "%", "Cycles", "Calls");
+    for (i = 0; i < labels_count; i++)
+    {
+        for (best = i, j = i + 1; j < labels_count; j++)
+        {
+            if (profile->labels[order[j]].instructions > profile->labels[order[best]].instructions)
+                best = j;
+        }
+        j = order[i];
+        order[i] = order[best];
+        order[best] = j;
+        if (profile->labels[order[i]].instructions == 0 && profile->labels[order[i]].calls == 0)
+            continue;
+        printf("  %-31s %14lu %7.2f%% %14lu %10lu\n", profile->labels[order[i]].name,
+               profile->labels[order[i]].instructions,
+               total > 0 ? 100.0 * profile->labels[order[i]].instructions / total : 0.0,
+               profile->labels[order[i]].cycles, profile->labels[order[i]].calls);
+    }
+
+    /* Call graph, the calls of all of the call stacks summed by caller and callee */
+    if ((edges = (unsigned long *)calloc(labels_count * labels_count, sizeof(unsigned long))) == NULL)
+    {
+        log_system_error(Error_101);
+        return;
+    }
+    for (i = 1; i < profile->nodes_count; i++)
+    {
+        node = &profile->nodes[i];
+        edges[profile->nodes[node->parent].label * labels_count + node->label] += node->calls;
+    }
+    printf("Call graph:\n");
+    for (i = 0; i < labels_count * labels_count; i++)
+    {
+        if (edges[i] > 0)
+            printf("  %s -> %s  %lu calls\n", profile->labels[i / labels_count].name,
+                   profile->labels[i % labels_count].name, edges[i]);
+    }
+    free(edges);
+}
+
+int write_folded_stacks(Profile *profile, char *file_name)
+{
+    int i, depth, node, stack[MACHINE_STACK_DEPTH + 1];
+    FILE *file = fopen(file_name, "w");
+
+    if (file == NULL)
+    {
+        printf(" File \"%s\"", file_name);
+        log_system_error(Error_104);
+        return 1; /* Indicates failure */
+    }
+    for (i = 0; i < profile->nodes_count; i++)
+    {
+        if (profile->nodes[i].instructions == 0)
+            continue;
+        for (depth = 0, node = i; node != -1 && depth <= MACHINE_STACK_DEPTH; node = profile->nodes[node].parent)
+            stack[depth++] = profile->nodes[node].label;
+        while (depth-- > 0)
+            fprintf(file, "%s%c", profile->labels[stack[depth]].name, depth > 0 ? ';' : ' ');
+        fprintf(file, "%lu\n", profile->nodes[i].instructions);
+    }
+    fclose(file);
+    return 0; /* Indicates success */
+}
+
+void free_profile(Profile *profile)
+{
+    free(profile->nodes);
+    free(profile);
+}
@@ -0,0 +1,247 @@
+/**
+ * This file writes random assembly programs that follow the instruction table.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "program_generator.h"
+#include "validator.h"
+#include "machine.h"
+#include "definitions.h"
+
+#define SUBROUTINES_COUNT 2
+#define MAX_SUBROUTINE_INSTRUCTIONS 3
+#define MAX_STRAIGHT_INSTRUCTIONS 4
+#define MAX_LOOP_BODY_INSTRUCTIONS 3
+#define MAX_LOOP_ITERATIONS 16
+#define MAX_JUMP_DISTANCE 3          /* Segments that a forward jump may skip */
+#define MAX_IMMEDIATE 127
+#define MAX_OPERAND_LENGTH 16        /* "MAT[r6][r7]", "#-127" or a label of the generator */
+#define WRITABLE_REGISTERS 5         /* r0-r4, the generator keeps r5-r7 for itself */
+#define LOOP_REGISTER 5
+#define FIRST_INDEX_REGISTER 6       /* r6 and r7 index the matrix */
+
+/* Words of the data: DATA (3 values), MAT (2x2) and TEXT (3 characters and the terminator) */
+#define DATA_WORDS 11
+#define TEXT_LENGTH 3
+
+/* Words of the longest instruction, with two matrix operands */
+#define MAX_INSTRUCTION_WORDS 5
+
+/* Largest segment of the main code (a loop), and the words of the labels its jumps may leave undefined and "stop" */
+#define MAX_SEGMENT_WORDS (MAX_INSTRUCTION_WORDS * MAX_LOOP_BODY_INSTRUCTIONS + 10)
+#define RESERVED_WORDS (2 * MAX_JUMP_DISTANCE + 1)
+#define SUBROUTINE_WORDS (MAX_INSTRUCTION_WORDS * MAX_SUBROUTINE_INSTRUCTIONS + 1)
+
+/* Segment kinds of the main code */
+enum {
+    SEGMENT_STRAIGHT,
+    SEGMENT_LOOP,
+    SEGMENT_BRANCH,
+    SEGMENT_JUMP,
+    SEGMENT_CALL,
+    TOTAL_SEGMENT_KINDS
+};
+
+/* Generator struct definition */
+typedef struct Generator {
+    FILE *file;
+    unsigned long state;             /* State of the random numbers */
+    int is_self_modifying;
+    int segments_count;              /* Labels L1, L2... of the main code written so far */
+    int last_target;                 /* Highest label that a jump of the main code targets */
+    int loops_count;
+    int words;                       /* Memory words written so far */
+    int instructions;                /* Instructions of the main code written so far */
+} Generator;
+
+static char *DATA_LABELS[] = {"DATA", "MAT", "TEXT"};
+
+/* Returns a random number below a count, from a linear congruential generator that is the same on every host */
+static int random_below(Generator *generator, int count)
+{
+    generator->state = (generator->state * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+    return (int)((generator->state >> 16) % (unsigned long)count);
+}
+
+/* Writes a random operand with a legal addressing method, returns the method */
+static int write_operand(Generator *generator, char *text, SupportedAddressingModes modes, int is_written)
+{
+    int method;
+
+    do
+        method = random_below(generator, 4);
+    while (!is_addressing_mode_supported(modes, method));
+    switch (method)
+    {
+    case IMMEDIATE:
+        sprintf(text, "#%d", random_below(generator, 2 * MAX_IMMEDIATE + 1) - MAX_IMMEDIATE);
+        break;
+    case DIRECT:
+        if (is_written && generator->is_self_modifying && generator->segments_count > 0 &&
+            random_below(generator, 8) == 0)
+            sprintf(text, "L%d", 1 + random_below(generator, generator->segments_count));
+        else if (is_written || generator->segments_count == 0 || random_below(generator, 4) > 0)
+            strcpy(text, DATA_LABELS[random_below(generator, 3)]);
+        else
+            sprintf(text, "L%d", 1 + random_below(generator, generator->segments_count));
+        break;
+    case MATRIX:
+        sprintf(text, "MAT[r%d][r%d]", FIRST_INDEX_REGISTER + random_below(generator, 2),
+                FIRST_INDEX_REGISTER + random_below(generator, 2));
+        break;
+    default: /* DIRECT_REGISTER */
+        sprintf(text, "r%d", random_below(generator, is_written ? WRITABLE_REGISTERS : TOTAL_REGISTERS));
+        break;
+    }
+    return method;
+}
+
+/* Writes an instruction, with the label of its line when it is not NULL */
+static void write_instruction(Generator *generator, char *label, char *mnemonic, char *operands, int words)
+{
+    if (label != NULL)
+        fprintf(generator->file, "%s: ", label);
+    fprintf(generator->file, operands[0] == STRING_TERMINATOR ? "%s\n" : "%s %s\n", mnemonic, operands);
+    generator->words += words;
+}
+
+/* Writes a random instruction that does not transfer control */
+static void write_random_instruction(Generator *generator, char *label)
+{
+    InstructionDefinition *opcodes = retrieve_instruction_set();
+    char operands[MAX_SOURCE_LINE_LENGTH], source[MAX_OPERAND_LENGTH], destination[MAX_OPERAND_LENGTH];
+    int opcode, source_method = -1, destination_method, words;
+
+    do
+        opcode = random_below(generator, TOTAL_OPCODES);
+    while (opcode >= JMP_OPCODE && opcode != RED_OPCODE && opcode != PRN_OPCODE);
+    if (opcodes[opcode].operand_count == 2)
+        source_method = write_operand(generator, source, opcodes[opcode].source_modes, 0);
+    destination_method = write_operand(generator, destination, opcodes[opcode].destination_modes,
+                                       opcode != CMP_OPCODE && opcode != PRN_OPCODE);
+    if (source_method == -1)
+    {
+        strcpy(operands, destination);
+        words = 1 + (destination_method == MATRIX ? 2 : 1);
+    }
+    else
+    {
+        sprintf(operands, "%s, %s", source, destination);
+        if (source_method == DIRECT_REGISTER && destination_method == DIRECT_REGISTER)
+            words = 2; /* Both registers share a word */
+        else
+            words = 1 + (source_method == MATRIX ? 2 : 1) + (destination_method == MATRIX ? 2 : 1);
+    }
+    write_instruction(generator, label, opcodes[opcode].mnemonic, operands, words);
+    generator->instructions++;
+}
+
+/* Writes a jump to a label of the main code that comes after the current segment */
+static void write_forward_jump(Generator *generator, char *mnemonic)
+{
+    char operands[MAX_OPERAND_LENGTH];
+    int target = generator->segments_count + 1 + random_below(generator, MAX_JUMP_DISTANCE);
+
+    sprintf(operands, "L%d", target);
+    if (target > generator->last_target)
+        generator->last_target = target;
+    write_instruction(generator, NULL, mnemonic, operands, 2);
+    generator->instructions++;
+}
+
+/* Writes a segment of the main code, that starts with a new label */
+static void write_segment(Generator *generator)
+{
+    char label[MAX_LABEL_NAME_LENGTH + 1], loop_label[MAX_LABEL_NAME_LENGTH + 1], operands[MAX_SOURCE_LINE_LENGTH];
+    int i, count;
+
+    sprintf(label, "L%d", ++generator->segments_count);
+    switch (random_below(generator, TOTAL_SEGMENT_KINDS))
+    {
+    case SEGMENT_LOOP: /* r5 counts down to 0 */
+        sprintf(operands, "#%d, r%d", 1 + random_below(generator, MAX_LOOP_ITERATIONS), LOOP_REGISTER);
+        write_instruction(generator, label, "mov", operands, 3);
+        sprintf(loop_label, "K%d", ++generator->loops_count);
+        count = 1 + random_below(generator, MAX_LOOP_BODY_INSTRUCTIONS);
+        for (i = 0; i < count; i++)
+            write_random_instruction(generator, i == 0 ? loop_label : NULL);
+        sprintf(operands, "r%d", LOOP_REGISTER);
+        write_instruction(generator, NULL, "dec", operands, 2);
+        sprintf(operands, random_below(generator, 2) ? "r%d, #0" : "#0, r%d", LOOP_REGISTER);
+        write_instruction(generator, NULL, "cmp", operands, 3);
+        write_instruction(generator, NULL, "bne", loop_label, 2);
+        generator->instructions += 4;
+        break;
+    case SEGMENT_BRANCH:
+        write_random_instruction(generator, label);
+        write_forward_jump(generator, "bne");
+        break;
+    case SEGMENT_JUMP:
+        write_random_instruction(generator, label);
+        write_forward_jump(generator, "jmp");
+        break;
+    case SEGMENT_CALL:
+        sprintf(operands, "S%d", 1 + random_below(generator, SUBROUTINES_COUNT));
+        write_instruction(generator, label, "jsr", operands, 2);
+        generator->instructions++;
+        break;
+    default: /* SEGMENT_STRAIGHT */
+        count = 1 + random_below(generator, MAX_STRAIGHT_INSTRUCTIONS);
+        for (i = 0; i < count; i++)
+            write_random_instruction(generator, i == 0 ? label : NULL);
+        break;
+    }
+}
+
+int generate_program(FILE *file, unsigned long seed, int instructions_count, int is_self_modifying)
+{
+    Generator generator;
+    char label[MAX_LABEL_NAME_LENGTH + 1], operands[MAX_SOURCE_LINE_LENGTH];
+    int i, j, count, segments_count;
+
+    memset(&generator, 0, sizeof(Generator));
+    generator.file = file;
+    generator.state = seed & 0xFFFFFFFFUL;
+    generator.is_self_modifying = is_self_modifying;
+    fprintf(file, "; Random program, seed %lu\n", seed);
+
+    sprintf(operands, "#0, r%d", FIRST_INDEX_REGISTER);
+    write_instruction(&generator, "MAIN", "mov", operands, 3);
+    sprintf(operands, "#1, r%d", FIRST_INDEX_REGISTER + 1);
+    write_instruction(&generator, NULL, "mov", operands, 3);
+    while (generator.instructions < instructions_count &&
+           generator.words + MAX_SEGMENT_WORDS + RESERVED_WORDS + SUBROUTINES_COUNT * SUBROUTINE_WORDS + DATA_WORDS <=
+           MACHINE_MEMORY_SIZE - MEMORY_START_ADDRESS)
+        write_segment(&generator);
+    /* The labels that jumps target past the last segment */
+    for (i = generator.segments_count + 1; i <= generator.last_target; i++)
+    {
+        sprintf(label, "L%d", i);
+        write_instruction(&generator, label, "prn", "r0", 2);
+    }
+    write_instruction(&generator, NULL, "stop", "", 1);
+
+    /* Subroutines only use the data labels, so their writes stay out of the code */
+    segments_count = generator.segments_count;
+    generator.segments_count = 0;
+    for (i = 1; i <= SUBROUTINES_COUNT; i++)
+    {
+        sprintf(label, "S%d", i);
+        count = 1 + random_below(&generator, MAX_SUBROUTINE_INSTRUCTIONS);
+        for (j = 0; j < count; j++)
+            write_random_instruction(&generator, j == 0 ? label : NULL);
+        write_instruction(&generator, NULL, "rts", "", 1);
+    }
+    generator.segments_count = segments_count;
+
+    fprintf(file, "DATA: .data %d, %d, %d\n", random_below(&generator, 1024) - 512,
+            random_below(&generator, 1024) - 512, random_below(&generator, 1024) - 512);
+    fprintf(file, "MAT: .mat [2][2] %d, %d, %d, %d\n", random_below(&generator, 16), random_below(&generator, 16),
+            random_below(&generator, 16), random_below(&generator, 16));
+    fprintf(file, "TEXT: .string \"");
+    for (i = 0; i < TEXT_LENGTH; i++)
+        fputc('a' + random_below(&generator, 26), file);
+    fprintf(file, "\"\n");
+    return generator.words + DATA_WORDS;
+}
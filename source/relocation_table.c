@@ -0,0 +1,103 @@
+/**
+ * This file handles the relocation records of the assembled module.
+ * A module has at most one record per instruction word, so the records are kept in fixed size tables.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "relocation_table.h"
+#include "error_handler.h"
+#include "labels_handler.h"
+#include "utils.h"
+#include "definitions.h"
+
+static Relocation relocations[MAX_ARRAY_CAPACITY];
+static int relocations_count = 0;
+static char symbols[MAX_ARRAY_CAPACITY][MAX_LABEL_NAME_LENGTH + 1];
+static int symbols_count = 0;
+
+/* Returns the index of a symbol, adding it to the symbols if it is not there yet */
+static int symbol_index(char *symbol_name)
+{
+    int i;
+
+    for (i = 0; i < symbols_count; i++)
+    {
+        if (strcmp(symbols[i], symbol_name) == 0)
+            return i;
+    }
+    strncpy(symbols[symbols_count], symbol_name, MAX_LABEL_NAME_LENGTH);
+    symbols[symbols_count][MAX_LABEL_NAME_LENGTH] = STRING_TERMINATOR;
+    return symbols_count++;
+}
+
+int add_relocation(int address, Relocation_Kind kind, char *symbol_name)
+{
+    if (relocations_count == MAX_ARRAY_CAPACITY)
+        return 1; /* Indicates the table is full */
+    relocations[relocations_count].address = address;
+    relocations[relocations_count].kind = kind;
+    relocations[relocations_count].symbol = symbol_index(symbol_name);
+    relocations_count++;
+    return 0; /* Indicates success */
+}
+
+/* Compares two relocation records by address */
+static int compare_relocations(const void *first, const void *second)
+{
+    return ((const Relocation *)first)->address - ((const Relocation *)second)->address;
+}
+
+void sort_relocations()
+{
+    qsort(relocations, relocations_count, sizeof(Relocation), compare_relocations);
+}
+
+Relocation *retrieve_relocations(int *count)
+{
+    *count = relocations_count;
+    return relocations;
+}
+
+char *retrieve_relocation_symbol(int symbol)
+{
+    return symbols[symbol];
+}
+
+void create_rel_file(char *file_rel_name)
+{
+    FILE *file_rel = fopen(file_rel_name, "w");
+    char base4_value[TEMP_CONVERSION_BUFFER_SIZE]; /* Buffer for base 4 value */
+    char base4_addr[TEMP_CONVERSION_BUFFER_SIZE]; /* Buffer for base 4 address */
+    int i;
+
+    if (file_rel == NULL) {  /* Failed to open file for writing */
+        log_system_error(Error_104);
+        free_labels();
+        free_all_memory();
+        exit(1);  /* Exiting program */
+    }
+
+    /* Write header line: records count and symbols count in base 4 */
+    convert_to_base4(relocations_count, base4_addr);
+    convert_to_base4(symbols_count, base4_value);
+    fprintf(file_rel, "%s %s\n", base4_addr, base4_value);
+
+    for (i = 0; i < symbols_count; i++)
+        fprintf(file_rel, "%s\n", symbols[i]);
+
+    for (i = 0; i < relocations_count; i++) {
+        convert_to_base4(relocations[i].address, base4_addr);
+        convert_to_base4(relocations[i].symbol, base4_value);
+        fprintf(file_rel, "%s %c %s\n", base4_addr,
+                relocations[i].kind == RELOCATABLE ? RELOCATION_KIND_RELOCATABLE : RELOCATION_KIND_EXTERNAL,
+                base4_value);
+    }
+    fclose(file_rel);
+}
+
+void reset_relocations()
+{
+    relocations_count = 0;
+    symbols_count = 0;
+}
@@ -0,0 +1,141 @@
+/**
+ * This file handles the size report of the assembled module.
+ * The regions are measured while the first pass codes the lines, from the words it added, and are kept in fixed size
+ * tables since every region holds a word at least.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "size_report.h"
+#include "error_handler.h"
+#include "validator.h"
+#include "utils.h"
+#include "definitions.h"
+
+static Code_Region code_regions[MAX_ARRAY_CAPACITY];
+static int code_regions_count = 0;
+static Data_Region data_regions[MAX_ARRAY_CAPACITY];
+static int data_regions_count = 0;
+
+/* Counts an operand of an instruction by its addressing method */
+static void count_operand(Code_Region *region, int method)
+{
+    if (method == IMMEDIATE)
+        region->immediate_operands++;
+    else if (method == DIRECT)
+        region->direct_operands++;
+    else if (method == MATRIX)
+        region->matrix_operands++;
+    else
+        region->register_operands++;
+}
+
+void add_code_size(Label *label, unsigned short *code, int address, int words)
+{
+    Code_Region *region;
+    int opcode = (code[0] >> OPCODE_SHIFT_POSITION) & MASK_4_BITS;
+    int source_method = (code[0] >> SOURCE_OPERAND_SHIFT_POSITION) & 3;
+    int destination_method = (code[0] >> DESTINATION_OPERAND_SHIFT_POSITION) & 3;
+    int operand_count = retrieve_instruction_set()[opcode].operand_count;
+
+    /* A label starts a new region, the instructions before the first label have a region without one */
+    if (label != NULL || code_regions_count == 0)
+    {
+        if (code_regions_count == MAX_ARRAY_CAPACITY)
+            return; /* The first pass reports the module as too large */
+        region = &code_regions[code_regions_count++];
+        memset(region, 0, sizeof(Code_Region));
+        if (label != NULL)
+            strcpy(region->label, label->name);
+        region->address = address;
+    }
+    region = &code_regions[code_regions_count - 1];
+    region->words += words;
+    region->instructions++;
+    if (operand_count == 2)
+        count_operand(region, source_method);
+    if (operand_count >= 1)
+        count_operand(region, destination_method);
+    if (operand_count == 2 && source_method == DIRECT_REGISTER && destination_method == DIRECT_REGISTER)
+        region->register_pairs++;
+}
+
+void add_data_size(Label *label, int words)
+{
+    Data_Region *region;
+
+    if (label != NULL || data_regions_count == 0)
+    {
+        if (data_regions_count == MAX_ARRAY_CAPACITY)
+            return; /* The first pass reports the module as too large */
+        region = &data_regions[data_regions_count++];
+        memset(region, 0, sizeof(Data_Region));
+        if (label != NULL)
+            strcpy(region->label, label->name);
+    }
+    data_regions[data_regions_count - 1].words += words;
+}
+
+/* Writes a label name as a JSON value, null for the region without a label */
+static void write_label_value(FILE *file, char *label)
+{
+    if (*label == STRING_TERMINATOR)
+        fprintf(file, "null");
+    else
+        fprintf(file, "\"%s\"", label); /* Label names hold only letters and digits */
+}
+
+void create_size_file(char *file_size_name, int IC, int DC)
+{
+    FILE *file = fopen(file_size_name, "w");
+    Code_Region *region;
+    Label *label;
+    int i, address, code_words = 0, data_words = 0;
+
+    if (file == NULL)
+    { /* Failed to open file for writing */
+        log_system_error(Error_104);
+        free_labels();
+        free_all_memory();
+        exit(1); /* Exiting program */
+    }
+    for (i = 0; i < code_regions_count; i++)
+        code_words += code_regions[i].words;
+    for (i = 0; i < data_regions_count; i++)
+        data_words += data_regions[i].words;
+    fprintf(file, "{\n  \"source_code_words\": %d,\n  \"source_data_words\": %d,\n", code_words, data_words);
+    fprintf(file, "  \"object_code_words\": %d,\n  \"object_data_words\": %d,\n", IC, DC);
+    fprintf(file, "  \"capacity\": %d,\n  \"code\": [", MAX_ARRAY_CAPACITY);
+    for (i = 0; i < code_regions_count; i++)
+    {
+        region = &code_regions[i];
+        fprintf(file, "%s\n    {\"label\": ", i == 0 ? "" : ",");
+        write_label_value(file, region->label);
+        /* The code labels hold their addresses in the object file, the region without a label starts the code */
+        label = region->label[0] == STRING_TERMINATOR ? NULL : is_label_name_exist(region->label);
+        address = label != NULL && label->location == CODE ? label->address : MEMORY_START_ADDRESS;
+        fprintf(file, ", \"address\": %d, \"source_address\": %d, \"words\": %d, \"instructions\": %d, ", address,
+                region->address, region->words, region->instructions);
+        fprintf(file, "\"operands\": {\"immediate\": %d, \"direct\": %d, \"matrix\": %d, \"register\": %d}, ",
+                region->immediate_operands, region->direct_operands, region->matrix_operands,
+                region->register_operands);
+        /* A matrix operand takes the word of its base address and the word of its registers */
+        fprintf(file, "\"register_pairs\": %d, \"matrix_words\": %d}", region->register_pairs,
+                region->matrix_operands * 2);
+    }
+    fprintf(file, "%s],\n  \"data\": [", code_regions_count > 0 ? "\n  " : "");
+    for (i = 0; i < data_regions_count; i++)
+    {
+        fprintf(file, "%s\n    {\"label\": ", i == 0 ? "" : ",");
+        write_label_value(file, data_regions[i].label);
+        fprintf(file, ", \"words\": %d}", data_regions[i].words);
+    }
+    fprintf(file, "%s]\n}\n", data_regions_count > 0 ? "\n  " : "");
+    fclose(file);
+}
+
+void reset_size_report()
+{
+    code_regions_count = 0;
+    data_regions_count = 0;
+}
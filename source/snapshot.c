@@ -0,0 +1,289 @@
+/**
+ * This file takes and restores snapshots of machines, and runs tests from a warmed-up machine in clones of the process.
+ */
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L /* fork is not part of ANSI C */
+#define SNAPSHOT_USE_FORK
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "snapshot.h"
+#include "interpreter.h"
+#include "machine.h"
+#include "object_reader.h"
+#include "symbol_file.h"
+#include "error_handler.h"
+#include "utils.h"
+#include "definitions.h"
+
+#ifdef SNAPSHOT_USE_FORK
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/* FNV-1a hash of the object code of a program */
+#define FNV_OFFSET_BASIS 2166136261UL
+#define FNV_PRIME 16777619UL
+#define HASH_MASK 0xFFFFFFFFUL
+
+/* Returns the hash of the object code of a program */
+static unsigned long hash_program(Object_Module *module)
+{
+    unsigned long hash = FNV_OFFSET_BASIS;
+    int i;
+
+    for (i = 0; i < module->code_size + module->data_size; i++)
+        hash = ((hash ^ module->words[i]) * FNV_PRIME) & HASH_MASK;
+    return ((hash ^ (unsigned long)module->code_size) * FNV_PRIME) & HASH_MASK;
+}
+
+int find_code_label(Object_Module *module, char *label)
+{
+    Symbol_File *symbol_file;
+    Symbol_Record *symbol;
+    int i, address = -1;
+
+    if (open_symbol_file(module->name, &symbol_file) != 0)
+        return -1;
+    if (symbol_file != NULL && (symbol = find_symbol_record(symbol_file, label)) != NULL &&
+        !(symbol->flags & SYMBOL_IS_EXTERN))
+        address = (int)symbol->address;
+    for (i = 0; symbol_file == NULL && i < module->entries_count; i++)
+    {
+        if (strcmp(module->entries[i].name, label) == 0)
+            address = module->entries[i].address;
+    }
+    close_symbol_file(symbol_file);
+    if (address < MEMORY_START_ADDRESS || address >= MEMORY_START_ADDRESS + module->code_size)
+    {
+        printf(" Label \"%s\"", label);
+        log_system_error(Error_110);
+        return -1;
+    }
+    return address;
+}
+
+int run_to_address(Machine *machine, int address, unsigned long max_steps)
+{
+    Decoded_Instruction *record = &machine->decoded[address], saved = *record;
+
+    record->handler = HANDLER_BREAK;
+    if (machine->handler_codes != NULL)
+        record->code = machine->handler_codes[HANDLER_BREAK];
+    run_machine(machine, max_steps);
+    if (record->handler == HANDLER_BREAK) /* Unless a write into the instruction turned it into HANDLER_DECODE */
+    {
+        *record = saved;
+        if (machine->handler_codes != NULL)
+            record->code = machine->handler_codes[record->handler];
+    }
+    if (machine->status != MACHINE_BREAK)
+        return 0;
+    machine->status = MACHINE_RUNNING;
+    return 1;
+}
+
+int save_snapshot(Machine *machine, Object_Module *module, const unsigned char *output, unsigned long output_length,
+                  char *file_name)
+{
+    Snapshot_Header header;
+    FILE *file = fopen(file_name, "wb");
+    int is_written;
+
+    if (file == NULL)
+    {
+        printf(" File \"%s\"", file_name);
+        log_system_error(Error_104);
+        return 1; /* Indicates failure */
+    }
+    memset(&header, 0, sizeof(Snapshot_Header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LENGTH);
+    header.program_hash = hash_program(module);
+    header.pc = machine->pc;
+    header.zero_flag = machine->zero_flag;
+    header.sp = machine->sp;
+    header.executed = machine->executed;
+    header.input_position = machine->input_position;
+    header.output_length = output_length;
+    is_written = fwrite(&header, sizeof(Snapshot_Header), 1, file) == 1 &&
+                 fwrite(machine->cells, sizeof(unsigned short), MACHINE_CELLS_COUNT, file) == MACHINE_CELLS_COUNT &&
+                 fwrite(machine->stack, sizeof(unsigned short), machine->sp, file) == (size_t)machine->sp &&
+                 fwrite(output, 1, output_length, file) == output_length;
+    if (fclose(file) != 0 || !is_written)
+    {
+        printf(" File \"%s\"", file_name);
+        log_system_error(Error_104);
+        return 1; /* Indicates failure */
+    }
+    return 0; /* Indicates success */
+}
+
+/* Reads the parts of a snapshot file, returns 0 if they were read and are valid */
+static int read_snapshot(FILE *file, Object_Module *module, Snapshot_Header *header, unsigned short *cells,
+                         unsigned short *stack, unsigned char **output)
+{
+    int i;
+
+    if (fread(header, sizeof(Snapshot_Header), 1, file) != 1 ||
+        memcmp(header->magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LENGTH) != 0 ||
+        header->program_hash != hash_program(module) || header->pc < 0 || header->pc > MACHINE_MEMORY_SIZE ||
+        header->sp < 0 || header->sp > MACHINE_STACK_DEPTH || (header->zero_flag != 0 && header->zero_flag != 1))
+        return 1; /* Indicates failure */
+    if (fread(cells, sizeof(unsigned short), MACHINE_CELLS_COUNT, file) != MACHINE_CELLS_COUNT ||
+        fread(stack, sizeof(unsigned short), header->sp, file) != (size_t)header->sp)
+        return 1; /* Indicates failure */
+    for (i = 0; i < MACHINE_CELLS_COUNT; i++)
+    {
+        if (cells[i] > MASK_10_BITS)
+            return 1; /* Indicates failure */
+    }
+    if ((*output = (unsigned char *)malloc(header->output_length + 1)) == NULL)
+        return 1; /* Indicates failure */
+    return fread(*output, 1, header->output_length, file) == header->output_length ? 0 : 1;
+}
+
+int restore_snapshot(Machine *machine, Object_Module *module, char *file_name, unsigned char **output,
+                     unsigned long *output_length)
+{
+    Snapshot_Header header;
+    unsigned short cells[MACHINE_CELLS_COUNT], stack[MACHINE_STACK_DEPTH];
+    unsigned long position;
+    FILE *file = fopen(file_name, "rb");
+    int i;
+
+    *output = NULL;
+    *output_length = 0;
+    if (file == NULL)
+    {
+        printf(" File \"%s\"", file_name);
+        log_system_error(Error_103);
+        return 1; /* Indicates failure */
+    }
+    if (read_snapshot(file, module, &header, cells, stack, output) != 0)
+    {
+        fclose(file);
+        free(*output);
+        *output = NULL;
+        printf(" File \"%s\"", file_name);
+        log_system_error(Error_306);
+        return 1; /* Indicates failure */
+    }
+    fclose(file);
+
+    /* Only the words that the program wrote before the snapshot are decoded again */
+    for (i = 0; i < MACHINE_CELLS_COUNT; i++)
+    {
+        if (cells[i] == machine->cells[i])
+            continue;
+        machine->cells[i] = cells[i];
+        if (i < MACHINE_MEMORY_SIZE && machine->is_decoded_word[i])
+            invalidate_decoded(machine, i);
+    }
+    memcpy(machine->stack, stack, header.sp * sizeof(unsigned short));
+    machine->sp = header.sp;
+    machine->pc = header.pc;
+    machine->zero_flag = header.zero_flag;
+    machine->executed = header.executed;
+    machine->input_position = header.input_position;
+    for (position = 0; machine->input == NULL && position < header.input_position; position++)
+    {
+        if (getchar() == EOF)
+            break;
+    }
+    *output_length = header.output_length;
+    return 0; /* Indicates success */
+}
+
+/* Runs a test on a machine and writes its output, returns the status of the machine or -1 if the test could not run */
+static int run_test(Machine *machine, const unsigned char *prefix, unsigned long prefix_length, char *name,
+                    unsigned char *input, unsigned long size, unsigned long max_steps)
+{
+    char *output_name = add_extension(name, ".out");
+    FILE *output;
+
+    if (output_name == NULL)
+        return -1;
+    if ((output = fopen(output_name, "w")) == NULL)
+    {
+        printf(" File \"%s\"", output_name);
+        log_system_error(Error_104);
+        clean_memory(output_name);
+        return -1;
+    }
+    fwrite(prefix, 1, prefix_length, output);
+    machine->output = output;
+    machine->input = input;
+    machine->input_size = size;
+    machine->is_quiet = 1;
+    /* The step limit counts the instructions of the warm up */
+    if (max_steps > 0)
+        max_steps = machine->executed >= max_steps ? 1 : max_steps - machine->executed;
+    run_machine(machine, max_steps);
+    if (machine->status == MACHINE_FAULTED)
+    {
+        printf(" Test \"%s\" - Address %d", name, machine->pc);
+        log_system_error(machine->fault);
+    }
+    fclose(output);
+    clean_memory(output_name);
+    return machine->status;
+}
+
+int run_forked_tests(Machine *machine, const unsigned char *prefix, unsigned long prefix_length, char **names,
+                     unsigned char **inputs, unsigned long *sizes, int count, unsigned long max_steps)
+{
+    int i, halted_count = 0;
+#ifdef SNAPSHOT_USE_FORK
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    int running = 0, status;
+    pid_t pid;
+
+    fflush(stdout); /* The clones would write the buffered output again */
+    for (i = 0; i < count; i++)
+    {
+        if (running > 0 && running >= processors)
+        {
+            if (wait(&status) != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0)
+                halted_count++;
+            running--;
+        }
+        if ((pid = fork()) == -1)
+        {
+            printf(" Test \"%s\" - fork", names[i]);
+            log_system_error(Error_108);
+            break;
+        }
+        if (pid == 0)
+        { /* The clone runs the test on its copy of the warmed-up machine */
+            status = run_test(machine, prefix, prefix_length, names[i], inputs[i], sizes[i], max_steps);
+            fflush(stdout);
+            _exit(status == MACHINE_HALTED ? 0 : 1);
+        }
+        running++;
+    }
+    for (; running > 0; running--)
+    {
+        if (wait(&status) != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0)
+            halted_count++;
+    }
+    return i == count ? halted_count : -1;
+#else
+    Machine *test = (Machine *)malloc(sizeof(Machine));
+
+    if (test == NULL)
+    {
+        log_system_error(Error_101);
+        return -1;
+    }
+    for (i = 0; i < count; i++)
+    {
+        memcpy(test, machine, sizeof(Machine));
+        halted_count += run_test(test, prefix, prefix_length, names[i], inputs[i], sizes[i], max_steps) ==
+                        MACHINE_HALTED;
+    }
+    free(test);
+    return halted_count;
+#endif
+}
@@ -0,0 +1,302 @@
+/**
+ * This file handles symbol files.
+ * It creates the symbol file with its name index and line map, and opens existing symbol files by mapping them into
+ * memory, so labels are found and lines are read without parsing the file.
+ */
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L /* mmap() is not part of ANSI C */
+#define SYMBOL_FILE_USE_MMAP
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symbol_file.h"
+#include "error_handler.h"
+#include "utils.h"
+#include "definitions.h"
+
+#ifdef SYMBOL_FILE_USE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* Compares two symbol records by address, for sorting the symbols */
+static int compare_addresses(const void *first, const void *second)
+{
+    unsigned int first_address = ((Symbol_Record *)first)->address;
+    unsigned int second_address = ((Symbol_Record *)second)->address;
+
+    if (first_address != second_address)
+        return first_address < second_address ? -1 : 1;
+    return strcmp(((Symbol_Record *)first)->name, ((Symbol_Record *)second)->name);
+}
+
+/* Compares the names of two symbols given by pointers to them, for sorting the name index */
+static int compare_names(const void *first, const void *second)
+{
+    return strcmp((*(Symbol_Record **)first)->name, (*(Symbol_Record **)second)->name);
+}
+
+int create_symbol_file(char *file_sym_name, Symbol_Record *symbols, int symbols_count, Line_Record *lines,
+                       int lines_count)
+{
+    Symbol_File_Header header;
+    Symbol_Record **order;
+    unsigned int *names;
+    int i;
+    FILE *file;
+
+    names = (unsigned int *)malloc((symbols_count > 0 ? symbols_count : 1) * sizeof(unsigned int));
+    order = (Symbol_Record **)malloc((symbols_count > 0 ? symbols_count : 1) * sizeof(Symbol_Record *));
+    if (names == NULL || order == NULL)
+    {
+        log_system_error(Error_101);
+        free(names);
+        free(order);
+        return 1; /* Indicates failure */
+    }
+    qsort(symbols, symbols_count, sizeof(Symbol_Record), compare_addresses);
+    /* The name index is sorted through pointers to the records, which give back their positions */
+    for (i = 0; i < symbols_count; i++)
+        order[i] = &symbols[i];
+    qsort(order, symbols_count, sizeof(Symbol_Record *), compare_names);
+    for (i = 0; i < symbols_count; i++)
+        names[i] = (unsigned int)(order[i] - symbols);
+    free(order);
+
+    file = fopen(file_sym_name, "wb");
+    if (file == NULL)
+    {
+        printf(" File \"%s\"", file_sym_name);
+        log_system_error(Error_104);
+        free(names);
+        return 1; /* Indicates failure */
+    }
+    memset(&header, 0, sizeof(header));
+    strcpy(header.magic, SYMBOL_FILE_MAGIC);
+    header.symbols_count = symbols_count;
+    header.lines_count = lines_count;
+    header.symbols_offset = sizeof(Symbol_File_Header);
+    header.names_offset = header.symbols_offset + symbols_count * sizeof(Symbol_Record);
+    header.lines_offset = header.names_offset + symbols_count * sizeof(unsigned int);
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(symbols, sizeof(Symbol_Record), symbols_count, file);
+    fwrite(names, sizeof(unsigned int), symbols_count, file);
+    fwrite(lines, sizeof(Line_Record), lines_count, file);
+    free(names);
+    if (ferror(file))
+    {
+        printf(" File \"%s\"", file_sym_name);
+        log_system_error(Error_104);
+        fclose(file);
+        return 1; /* Indicates failure */
+    }
+    fclose(file);
+    return 0; /* Indicates success */
+}
+
+/* Loads the contents of an open symbol file, mapping them into memory where possible */
+static int load_contents(Symbol_File *symbol_file, FILE *file)
+{
+    long size;
+
+#ifdef SYMBOL_FILE_USE_MMAP
+    struct stat status;
+    void *mapped;
+
+    if (fstat(fileno(file), &status) == 0 && status.st_size > 0)
+    {
+        mapped = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+        if (mapped != MAP_FAILED)
+        {
+            symbol_file->contents = (unsigned char *)mapped;
+            symbol_file->size = status.st_size;
+            symbol_file->is_mapped = 1;
+            return 0; /* Indicates success */
+        }
+    }
+#endif
+    /* Reading the whole file when it can not be mapped */
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    symbol_file->contents = (unsigned char *)malloc(size > 0 ? size : 1);
+    if (symbol_file->contents == NULL)
+    {
+        log_system_error(Error_101);
+        return 1; /* Indicates failure */
+    }
+    symbol_file->size = fread(symbol_file->contents, 1, size > 0 ? size : 0, file);
+    return 0; /* Indicates success */
+}
+
+/* Checks that the tables of an open symbol file are inside the file and sorted, returns 1 if they are */
+static int is_valid_symbol_file(Symbol_File *symbol_file)
+{
+    Symbol_File_Header *header = (Symbol_File_Header *)symbol_file->contents;
+    unsigned int i;
+
+    if (symbol_file->size < sizeof(Symbol_File_Header) ||
+        memcmp(header->magic, SYMBOL_FILE_MAGIC, SYMBOL_FILE_MAGIC_LENGTH) != 0 ||
+        header->symbols_offset % 4 != 0 || header->names_offset % 4 != 0 || header->lines_offset % 4 != 0 ||
+        header->symbols_offset + (unsigned long)header->symbols_count * sizeof(Symbol_Record) > symbol_file->size ||
+        header->names_offset + (unsigned long)header->symbols_count * sizeof(unsigned int) > symbol_file->size ||
+        header->lines_offset + (unsigned long)header->lines_count * sizeof(Line_Record) > symbol_file->size)
+        return 0;
+    symbol_file->header = header;
+    symbol_file->symbols = (Symbol_Record *)(symbol_file->contents + header->symbols_offset);
+    symbol_file->names = (unsigned int *)(symbol_file->contents + header->names_offset);
+    symbol_file->lines = (Line_Record *)(symbol_file->contents + header->lines_offset);
+    /* The binary searches rely on the order of the tables */
+    for (i = 0; i < header->symbols_count; i++)
+    {
+        if (memchr(symbol_file->symbols[i].name, STRING_TERMINATOR, MAX_LABEL_NAME_LENGTH + 1) == NULL ||
+            symbol_file->names[i] >= header->symbols_count ||
+            (i > 0 && symbol_file->symbols[i - 1].address > symbol_file->symbols[i].address))
+            return 0;
+    }
+    for (i = 1; i < header->symbols_count; i++)
+    {
+        if (strcmp(symbol_file->symbols[symbol_file->names[i - 1]].name,
+                   symbol_file->symbols[symbol_file->names[i]].name) >= 0)
+            return 0;
+    }
+    for (i = 1; i < header->lines_count; i++)
+    {
+        if (symbol_file->lines[i - 1].address >= symbol_file->lines[i].address)
+            return 0;
+    }
+    return 1;
+}
+
+int open_symbol_file(char *base_name, Symbol_File **symbol_file)
+{
+    char *file_name = add_extension(base_name, ".sym");
+    FILE *file = file_name == NULL ? NULL : fopen(file_name, "rb");
+
+    *symbol_file = NULL;
+    if (file == NULL)
+    {
+        clean_memory(file_name);
+        return file_name == NULL ? 1 : 0; /* A module assembled without "--symbols" has no symbol file */
+    }
+    if ((*symbol_file = (Symbol_File *)calloc(1, sizeof(Symbol_File))) == NULL)
+    {
+        log_system_error(Error_101);
+        fclose(file);
+        clean_memory(file_name);
+        return 1; /* Indicates failure */
+    }
+    (*symbol_file)->name = file_name;
+    if (load_contents(*symbol_file, file) != 0 || !is_valid_symbol_file(*symbol_file))
+    {
+        if ((*symbol_file)->contents != NULL)
+        {
+            printf(" File \"%s\"", file_name);
+            log_system_error(Error_308);
+        }
+        fclose(file);
+        close_symbol_file(*symbol_file);
+        *symbol_file = NULL;
+        return 1; /* Indicates failure */
+    }
+    fclose(file);
+    return 0; /* Indicates success */
+}
+
+Symbol_Record *find_symbol_record(Symbol_File *symbol_file, char *name)
+{
+    unsigned int low = 0, high = symbol_file->header->symbols_count, middle;
+    Symbol_Record *symbol;
+    int comparison;
+
+    /* A binary search of the name index, which holds positions in the symbols and not the names themselves */
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+        symbol = &symbol_file->symbols[symbol_file->names[middle]];
+        comparison = strcmp(name, symbol->name);
+        if (comparison == 0)
+            return symbol;
+        if (comparison < 0)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    return NULL;
+}
+
+void close_symbol_file(Symbol_File *symbol_file)
+{
+    if (symbol_file == NULL)
+        return;
+    if (symbol_file->contents != NULL)
+    {
+#ifdef SYMBOL_FILE_USE_MMAP
+        if (symbol_file->is_mapped)
+            munmap(symbol_file->contents, symbol_file->size);
+        else
+#endif
+            free(symbol_file->contents);
+    }
+    clean_memory(symbol_file->name);
+    free(symbol_file);
+}
+
+int read_symbol_file(char *base_name, Program_Symbol **symbols, int *count)
+{
+    Symbol_File *symbol_file;
+    Symbol_Record *record;
+    int i;
+
+    *symbols = NULL;
+    *count = 0;
+    if (open_symbol_file(base_name, &symbol_file) != 0)
+        return 1; /* Indicates failure */
+    if (symbol_file == NULL || symbol_file->header->symbols_count == 0)
+    {
+        close_symbol_file(symbol_file);
+        return 0; /* Indicates success */
+    }
+    *symbols = (Program_Symbol *)malloc(symbol_file->header->symbols_count * sizeof(Program_Symbol));
+    if (*symbols == NULL)
+    {
+        log_system_error(Error_101);
+        close_symbol_file(symbol_file);
+        return 1; /* Indicates failure */
+    }
+    for (i = 0; i < (int)symbol_file->header->symbols_count; i++)
+    {
+        record = &symbol_file->symbols[i];
+        strcpy((*symbols)[i].name, record->name);
+        (*symbols)[i].address = (int)record->address;
+        (*symbols)[i].is_data = (record->flags & SYMBOL_IS_DATA) != 0;
+        (*symbols)[i].is_entry = (record->flags & SYMBOL_IS_ENTRY) != 0;
+        (*symbols)[i].is_extern = (record->flags & SYMBOL_IS_EXTERN) != 0;
+    }
+    *count = i;
+    close_symbol_file(symbol_file);
+    return 0; /* Indicates success */
+}
+
+int read_line_map(char *base_name, int *lines, int addresses_count)
+{
+    Symbol_File *symbol_file;
+    int i, count = 0;
+
+    memset(lines, 0, addresses_count * sizeof(int));
+    if (open_symbol_file(base_name, &symbol_file) != 0)
+        return -1; /* Indicates failure */
+    for (i = 0; symbol_file != NULL && i < (int)symbol_file->header->lines_count; i++)
+    {
+        if (symbol_file->lines[i].address < (unsigned int)addresses_count && symbol_file->lines[i].line_num > 0)
+        {
+            lines[symbol_file->lines[i].address] = (int)symbol_file->lines[i].line_num;
+            count++;
+        }
+    }
+    close_symbol_file(symbol_file);
+    return count;
+}
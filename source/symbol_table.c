@@ -0,0 +1,124 @@
+/**
+ * This file handles the global symbol table that the linker uses to resolve external symbols.
+ * The table uses open addressing with linear probing and is kept at most half full,
+ * so both inserting and finding a symbol take a constant expected time.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symbol_table.h"
+#include "error_handler.h"
+#include "definitions.h"
+
+/* Minimal number of slots in a table */
+#define MIN_TABLE_CAPACITY 16
+
+/* Hashes a symbol name (djb2) */
+static unsigned long hash_name(char *name)
+{
+    unsigned long hash = 5381;
+
+    while (*name != STRING_TERMINATOR)
+        hash = hash * 33 + (unsigned char)*name++;
+    return hash;
+}
+
+/* Returns the slot of the name, or the free slot where it should be inserted */
+static Global_Symbol *probe(Symbol_Table *table, char *name)
+{
+    unsigned long mask = table->capacity - 1;
+    unsigned long i = hash_name(name) & mask;
+
+    while (table->slots[i].name[0] != STRING_TERMINATOR && strcmp(table->slots[i].name, name) != 0)
+        i = (i + 1) & mask;
+    return &table->slots[i];
+}
+
+/* Allocates the slots of a table with a capacity for at least twice the given count */
+static int allocate_slots(Symbol_Table *table, int count)
+{
+    int capacity = MIN_TABLE_CAPACITY;
+
+    while (capacity < count * 2)
+        capacity *= 2;
+    table->slots = (Global_Symbol *)calloc(capacity, sizeof(Global_Symbol));
+    if (table->slots == NULL)
+    {
+        log_system_error(Error_101);
+        return 1; /* Indicates failure */
+    }
+    table->capacity = capacity;
+    return 0; /* Indicates success */
+}
+
+Symbol_Table *create_symbol_table(int expected_count)
+{
+    Symbol_Table *table = (Symbol_Table *)malloc(sizeof(Symbol_Table));
+
+    if (table == NULL)
+    {
+        log_system_error(Error_101);
+        return NULL; /* Indicates failure */
+    }
+    table->count = 0;
+    if (allocate_slots(table, expected_count) != 0)
+    {
+        free(table);
+        return NULL; /* Indicates failure */
+    }
+    return table;
+}
+
+Global_Symbol *insert_symbol(Symbol_Table *table, char *name, int address, int module, int *is_duplicate)
+{
+    Global_Symbol *slot, *old_slots = table->slots;
+    int i, old_capacity = table->capacity;
+
+    slot = probe(table, name);
+    if (slot->name[0] != STRING_TERMINATOR)
+    {
+        *is_duplicate = 1;
+        return slot; /* Indicates the symbol already exists */
+    }
+    *is_duplicate = 0;
+
+    /* Growing the table when it becomes half full */
+    if ((table->count + 1) * 2 > table->capacity)
+    {
+        if (allocate_slots(table, table->count + 1) != 0)
+        {
+            table->slots = old_slots;
+            return NULL; /* Indicates failure */
+        }
+        for (i = 0; i < old_capacity; i++)
+        {
+            if (old_slots[i].name[0] != STRING_TERMINATOR)
+                *probe(table, old_slots[i].name) = old_slots[i];
+        }
+        free(old_slots);
+        slot = probe(table, name);
+    }
+    strncpy(slot->name, name, MAX_LABEL_NAME_LENGTH);
+    slot->name[MAX_LABEL_NAME_LENGTH] = STRING_TERMINATOR;
+    slot->address = address;
+    slot->module = module;
+    table->count++;
+    return slot;
+}
+
+Global_Symbol *find_symbol(Symbol_Table *table, char *name)
+{
+    Global_Symbol *slot = probe(table, name);
+
+    if (slot->name[0] == STRING_TERMINATOR)
+        return NULL; /* Indicates the symbol was not found */
+    return slot;
+}
+
+void free_symbol_table(Symbol_Table *table)
+{
+    if (table == NULL)
+        return;
+    free(table->slots);
+    free(table);
+}
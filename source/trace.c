@@ -0,0 +1,540 @@
+/**
+ * This file records the traces of runs, with a background writer, and reads them back.
+ */
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L /* POSIX threads are not part of ANSI C */
+#define TRACE_USE_THREADS
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+#include "interpreter.h"
+#include "machine.h"
+#include "error_handler.h"
+#include "definitions.h"
+
+#ifdef TRACE_USE_THREADS
+#include <pthread.h>
+#endif
+
+#define MAX_VARINT_LENGTH 10          /* Bytes of a 64-bit varint */
+#define MAX_BLOCK_WRITES (MACHINE_MEMORY_SIZE + 1) /* A block runs every instruction record at most once */
+#define MAX_RECORD_SIZE ((3 + 3 * MAX_BLOCK_WRITES) * MAX_VARINT_LENGTH)
+#define INITIAL_POINTS_CAPACITY 64
+
+/* Zigzag encoding of a signed difference, and its decoding */
+#define ZIGZAG(difference) ((difference) < 0 ? ((unsigned long)-(difference) << 1) - 1 : (unsigned long)(difference) << 1)
+#define UNZIGZAG(value) ((value) & 1 ? -(long)(((value) + 1) >> 1) : (long)((value) >> 1))
+
+/* Trace recorder struct definition */
+struct Trace_Recorder {
+    FILE *file;
+    char *file_name;
+    unsigned char *buffers[2];
+    int current;                      /* The buffer that records are encoded into */
+    unsigned long length;             /* Bytes of the current buffer */
+    unsigned long written;            /* Bytes of the records handed to the writer */
+    unsigned long interval;
+    unsigned long next_point;         /* Instruction count of the next index point */
+    Trace_Index_Point *points;
+    unsigned long points_count;
+    unsigned long points_capacity;
+    int previous_pc;
+    int previous_cell;
+    unsigned short cells[MACHINE_CELLS_COUNT]; /* The cells as the records so far leave them */
+    Word_Write writes[MAX_BLOCK_WRITES];
+    int is_failed;                    /* A write failed, the writer sets it under the lock */
+#ifdef TRACE_USE_THREADS
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int is_started;
+    int is_closing;
+    unsigned char *pending;           /* Full buffer waiting for the writer, or NULL */
+    unsigned long pending_length;
+#endif
+};
+
+/* Trace block struct definition - a record read back */
+typedef struct Trace_Block {
+    int start;
+    unsigned long count;              /* 0 past the last record */
+    int writes_count;
+    unsigned long instructions[MAX_BLOCK_WRITES]; /* Instruction of the block that made each write */
+    int cells[MAX_BLOCK_WRITES];
+    long differences[MAX_BLOCK_WRITES];
+} Trace_Block;
+
+/* Trace reader struct definition */
+struct Trace_Reader {
+    FILE *file;
+    Trace_Header header;
+    Trace_Footer footer;
+    unsigned short initial_cells[MACHINE_CELLS_COUNT];
+    Trace_Index_Point *points;
+    unsigned long next_point;         /* The index point that the next record to read may be at */
+    unsigned long offset;             /* Offset of the next record to read */
+    int previous_pc;
+    int previous_cell;
+    unsigned short cells[MACHINE_CELLS_COUNT];
+    unsigned long executed;
+    int pc;
+    Trace_Block blocks[2];            /* The block being read and the one after it */
+    int current;
+    unsigned long position;           /* Instruction of the current block to read next */
+    int write_index;
+};
+
+/* Writes a varint, returns the position after it */
+static unsigned char *put_varint(unsigned char *out, unsigned long value)
+{
+    while (value >= 0x80)
+    {
+        *out++ = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (unsigned char)value;
+    return out;
+}
+
+#ifdef TRACE_USE_THREADS
+/* Writes the full buffers that the recorder hands over, until it closes */
+static void *write_buffers(void *argument)
+{
+    Trace_Recorder *trace = (Trace_Recorder *)argument;
+    unsigned char *data;
+    unsigned long length;
+    int is_written;
+
+    pthread_mutex_lock(&trace->lock);
+    for (;;)
+    {
+        while (trace->pending == NULL && !trace->is_closing)
+            pthread_cond_wait(&trace->changed, &trace->lock);
+        if (trace->pending == NULL)
+            break;
+        data = trace->pending;
+        length = trace->pending_length;
+        pthread_mutex_unlock(&trace->lock);
+        is_written = fwrite(data, 1, length, trace->file) == length;
+        pthread_mutex_lock(&trace->lock);
+        if (!is_written)
+            trace->is_failed = 1;
+        trace->pending = NULL;
+        pthread_cond_signal(&trace->changed);
+    }
+    pthread_mutex_unlock(&trace->lock);
+    return NULL;
+}
+#endif
+
+/* Hands the current buffer to the writer and moves to the other buffer */
+static void submit_buffer(Trace_Recorder *trace)
+{
+#ifdef TRACE_USE_THREADS
+    if (trace->is_started)
+    {
+        pthread_mutex_lock(&trace->lock);
+        while (trace->pending != NULL) /* The writer is still busy with the other buffer */
+            pthread_cond_wait(&trace->changed, &trace->lock);
+        trace->pending = trace->buffers[trace->current];
+        trace->pending_length = trace->length;
+        pthread_cond_signal(&trace->changed);
+        pthread_mutex_unlock(&trace->lock);
+    }
+    else if (fwrite(trace->buffers[trace->current], 1, trace->length, trace->file) != trace->length)
+        trace->is_failed = 1;
+#else
+    if (fwrite(trace->buffers[trace->current], 1, trace->length, trace->file) != trace->length)
+        trace->is_failed = 1;
+#endif
+    trace->written += trace->length;
+    trace->length = 0;
+    trace->current = 1 - trace->current;
+}
+
+/* Encodes the record of a block */
+static void record_block(Trace_Recorder *trace, int start, unsigned long start_executed, unsigned long count,
+                         int writes_count)
+{
+    unsigned char *out;
+    unsigned long instruction, previous_instruction = 0;
+    long difference;
+    int i, cell;
+
+    if (TRACE_BUFFER_SIZE - trace->length < MAX_RECORD_SIZE)
+        submit_buffer(trace);
+    out = trace->buffers[trace->current] + trace->length;
+    out = put_varint(out, count);
+    out = put_varint(out, (unsigned long)writes_count);
+    out = put_varint(out, ZIGZAG(start - trace->previous_pc));
+    trace->previous_pc = start;
+    for (i = 0; i < writes_count; i++)
+    {
+        instruction = trace->writes[i].executed - start_executed - 1;
+        cell = trace->writes[i].cell;
+        difference = SIGN_EXTEND_10_BITS(trace->writes[i].value - trace->cells[cell]);
+        out = put_varint(out, instruction - previous_instruction);
+        out = put_varint(out, ZIGZAG(cell - trace->previous_cell));
+        out = put_varint(out, ZIGZAG(difference));
+        previous_instruction = instruction;
+        trace->previous_cell = cell;
+        trace->cells[cell] = trace->writes[i].value;
+    }
+    trace->length = out - trace->buffers[trace->current];
+}
+
+/* Adds an index point at the state of a machine, the differences start again from it */
+static int add_index_point(Trace_Recorder *trace, Machine *machine)
+{
+    Trace_Index_Point *resized, *point;
+    unsigned long capacity;
+
+    if (trace->points_count == trace->points_capacity)
+    {
+        capacity = trace->points_capacity == 0 ? INITIAL_POINTS_CAPACITY : trace->points_capacity * 2;
+        resized = (Trace_Index_Point *)realloc(trace->points, capacity * sizeof(Trace_Index_Point));
+        if (resized == NULL)
+            return 1; /* Indicates failure */
+        trace->points = resized;
+        trace->points_capacity = capacity;
+    }
+    point = &trace->points[trace->points_count++];
+    point->executed = machine->executed;
+    point->offset = trace->written + trace->length;
+    point->pc = machine->pc;
+    memcpy(point->cells, trace->cells, sizeof(point->cells));
+    trace->previous_pc = 0;
+    trace->previous_cell = 0;
+    trace->next_point = machine->executed - machine->executed % trace->interval + trace->interval;
+    return 0; /* Indicates success */
+}
+
+Trace_Recorder *create_trace(char *file_name, Machine *machine, unsigned long interval)
+{
+    Trace_Recorder *trace = (Trace_Recorder *)calloc(1, sizeof(Trace_Recorder));
+    Trace_Header header;
+
+    if (trace == NULL || (trace->buffers[0] = (unsigned char *)malloc(TRACE_BUFFER_SIZE)) == NULL ||
+        (trace->buffers[1] = (unsigned char *)malloc(TRACE_BUFFER_SIZE)) == NULL)
+    {
+        log_system_error(Error_101);
+        if (trace != NULL)
+            free(trace->buffers[0]);
+        free(trace);
+        return NULL;
+    }
+    if ((trace->file = fopen(file_name, "wb")) == NULL)
+    {
+        printf(" File \"%s\"", file_name);
+        log_system_error(Error_104);
+        free(trace->buffers[0]);
+        free(trace->buffers[1]);
+        free(trace);
+        return NULL;
+    }
+    trace->file_name = file_name;
+    trace->interval = interval == 0 ? TRACE_INDEX_INTERVAL : interval;
+    trace->next_point = machine->executed + trace->interval;
+    memcpy(trace->cells, machine->cells, sizeof(trace->cells));
+    memset(&header, 0, sizeof(Trace_Header));
+    memcpy(header.magic, TRACE_MAGIC, TRACE_MAGIC_LENGTH);
+    header.interval = trace->interval;
+    header.executed = machine->executed;
+    header.pc = machine->pc;
+    if (fwrite(&header, sizeof(Trace_Header), 1, trace->file) != 1 ||
+        fwrite(trace->cells, sizeof(unsigned short), MACHINE_CELLS_COUNT, trace->file) != MACHINE_CELLS_COUNT)
+        trace->is_failed = 1;
+#ifdef TRACE_USE_THREADS
+    pthread_mutex_init(&trace->lock, NULL);
+    pthread_cond_init(&trace->changed, NULL);
+    /* Without the thread, the buffers are written by the run */
+    trace->is_started = pthread_create(&trace->thread, NULL, write_buffers, trace) == 0;
+#endif
+    return trace;
+}
+
+int run_traced(Machine *machine, Trace_Recorder *trace, unsigned long max_steps)
+{
+    unsigned long limit = max_steps == 0 ? (unsigned long)-1 : machine->executed + max_steps, executed;
+    int start;
+
+    while (machine->status == MACHINE_RUNNING)
+    {
+        start = machine->pc;
+        executed = machine->executed;
+        machine->write_log = trace->writes;
+        machine->write_log_count = 0;
+        run_machine(machine, 1); /* Runs up to and including the next control transfer */
+        if (machine->executed > executed)
+            record_block(trace, start, executed, machine->executed - executed, machine->write_log_count);
+        if (machine->status == MACHINE_STEP_LIMIT && machine->executed < limit)
+            machine->status = MACHINE_RUNNING;
+        if (machine->executed >= trace->next_point && machine->status == MACHINE_RUNNING &&
+            add_index_point(trace, machine) != 0)
+        {
+            log_system_error(Error_101);
+            break;
+        }
+    }
+    machine->write_log = NULL;
+    return machine->status;
+}
+
+int close_trace(Trace_Recorder *trace, Machine *machine, unsigned long *size)
+{
+    Trace_Footer footer;
+    int is_failed;
+
+    if (trace->length > 0)
+        submit_buffer(trace);
+#ifdef TRACE_USE_THREADS
+    if (trace->is_started)
+    {
+        pthread_mutex_lock(&trace->lock);
+        trace->is_closing = 1;
+        pthread_cond_signal(&trace->changed);
+        pthread_mutex_unlock(&trace->lock);
+        pthread_join(trace->thread, NULL);
+    }
+    pthread_mutex_lock(&trace->lock); /* Takes the failure of the writer with the lock it was set under */
+    is_failed = trace->is_failed;
+    pthread_mutex_unlock(&trace->lock);
+    pthread_cond_destroy(&trace->changed);
+    pthread_mutex_destroy(&trace->lock);
+#else
+    is_failed = trace->is_failed;
+#endif
+    memset(&footer, 0, sizeof(Trace_Footer));
+    footer.records_size = trace->written;
+    footer.points_count = trace->points_count;
+    footer.executed = machine->executed;
+    footer.status = machine->status;
+    footer.pc = machine->pc;
+    footer.fault = machine->fault;
+    memcpy(footer.magic, TRACE_MAGIC, TRACE_MAGIC_LENGTH);
+    if (fwrite(trace->points, sizeof(Trace_Index_Point), trace->points_count, trace->file) != trace->points_count ||
+        fwrite(&footer, sizeof(Trace_Footer), 1, trace->file) != 1)
+        is_failed = 1;
+    if (fclose(trace->file) != 0)
+        is_failed = 1;
+    if (is_failed)
+    {
+        printf(" File \"%s\"", trace->file_name);
+        log_system_error(Error_104);
+    }
+    *size = trace->written;
+    free(trace->points);
+    free(trace->buffers[0]);
+    free(trace->buffers[1]);
+    free(trace);
+    return is_failed;
+}
+
+/* Reads a varint, returns 0 if it was read and 1 at the end of the file or past 64 bits */
+static int get_varint(FILE *file, unsigned long *value)
+{
+    int byte, shift = 0;
+
+    *value = 0;
+    do
+    {
+        if ((byte = getc(file)) == EOF || shift >= 64)
+            return 1; /* Indicates failure */
+        *value |= (unsigned long)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return 0; /* Indicates success */
+}
+
+/* Reads the next record into a block, returns 0 if successful and 1 if the trace is malformed */
+static int read_block(Trace_Reader *reader, Trace_Block *block)
+{
+    unsigned long writes_count, value, instruction = 0;
+    int i;
+
+    block->count = 0;
+    if (reader->offset >= reader->footer.records_size)
+        return 0; /* Past the last record */
+    if (reader->next_point < reader->footer.points_count &&
+        reader->points[reader->next_point].offset == reader->offset)
+    { /* The differences start again at an index point */
+        reader->previous_pc = 0;
+        reader->previous_cell = 0;
+        reader->next_point++;
+    }
+    if (get_varint(reader->file, &block->count) != 0 || get_varint(reader->file, &writes_count) != 0 ||
+        writes_count > MAX_BLOCK_WRITES || get_varint(reader->file, &value) != 0)
+        return 1; /* Indicates failure */
+    block->start = reader->previous_pc + (int)UNZIGZAG(value);
+    reader->previous_pc = block->start;
+    block->writes_count = (int)writes_count;
+    for (i = 0; i < block->writes_count; i++)
+    {
+        if (get_varint(reader->file, &value) != 0)
+            return 1; /* Indicates failure */
+        instruction += value;
+        block->instructions[i] = instruction;
+        if (get_varint(reader->file, &value) != 0)
+            return 1; /* Indicates failure */
+        block->cells[i] = reader->previous_cell + (int)UNZIGZAG(value);
+        reader->previous_cell = block->cells[i];
+        if (get_varint(reader->file, &value) != 0)
+            return 1; /* Indicates failure */
+        block->differences[i] = UNZIGZAG(value);
+        if (block->cells[i] < 0 || block->cells[i] >= MACHINE_CELLS_COUNT || instruction >= block->count)
+            return 1; /* Indicates failure */
+    }
+    if (block->start < 0 || block->start > MACHINE_MEMORY_SIZE || block->count == 0)
+        return 1; /* Indicates failure */
+    reader->offset = (unsigned long)ftell(reader->file) - sizeof(Trace_Header) - sizeof(reader->initial_cells);
+    return 0; /* Indicates success */
+}
+
+/* Reads the block at the position of a reader and the one after it */
+static int read_blocks(Trace_Reader *reader)
+{
+    reader->current = 0;
+    reader->position = 0;
+    reader->write_index = 0;
+    if (read_block(reader, &reader->blocks[0]) != 0 || read_block(reader, &reader->blocks[1]) != 0)
+        return 1; /* Indicates failure */
+    if (reader->blocks[0].count > 0)
+        reader->pc = reader->blocks[0].start;
+    return 0; /* Indicates success */
+}
+
+Trace_Reader *open_trace(char *file_name, Trace_Footer *footer)
+{
+    Trace_Reader *reader = (Trace_Reader *)calloc(1, sizeof(Trace_Reader));
+    long records_start = sizeof(Trace_Header) + sizeof(reader->initial_cells);
+    int is_valid;
+
+    if (reader == NULL)
+    {
+        log_system_error(Error_101);
+        return NULL;
+    }
+    if ((reader->file = fopen(file_name, "rb")) == NULL)
+    {
+        printf(" File \"%s\"", file_name);
+        log_system_error(Error_103);
+        free(reader);
+        return NULL;
+    }
+    is_valid = fread(&reader->header, sizeof(Trace_Header), 1, reader->file) == 1 &&
+               memcmp(reader->header.magic, TRACE_MAGIC, TRACE_MAGIC_LENGTH) == 0 &&
+               fread(reader->initial_cells, sizeof(unsigned short), MACHINE_CELLS_COUNT, reader->file) ==
+               MACHINE_CELLS_COUNT &&
+               fseek(reader->file, -(long)sizeof(Trace_Footer), SEEK_END) == 0 &&
+               fread(&reader->footer, sizeof(Trace_Footer), 1, reader->file) == 1 &&
+               memcmp(reader->footer.magic, TRACE_MAGIC, TRACE_MAGIC_LENGTH) == 0 &&
+               ftell(reader->file) == records_start + (long)reader->footer.records_size +
+               (long)(reader->footer.points_count * sizeof(Trace_Index_Point) + sizeof(Trace_Footer));
+    if (is_valid && reader->footer.points_count > 0)
+    {
+        reader->points = (Trace_Index_Point *)malloc(reader->footer.points_count * sizeof(Trace_Index_Point));
+        is_valid = reader->points != NULL &&
+                   fseek(reader->file, records_start + (long)reader->footer.records_size, SEEK_SET) == 0 &&
+                   fread(reader->points, sizeof(Trace_Index_Point), reader->footer.points_count, reader->file) ==
+                   reader->footer.points_count;
+    }
+    if (!is_valid || seek_trace(reader, reader->header.executed) != 0)
+    {
+        printf(" File \"%s\"", file_name);
+        log_system_error(Error_307);
+        close_trace_reader(reader);
+        return NULL;
+    }
+    *footer = reader->footer;
+    return reader;
+}
+
+int seek_trace(Trace_Reader *reader, unsigned long executed)
+{
+    Trace_Entry entry;
+    long low = 0, high = (long)reader->footer.points_count - 1, middle, found = -1;
+    int result = 1;
+
+    /* The last index point at or before the instruction */
+    while (low <= high)
+    {
+        middle = (low + high) / 2;
+        if (reader->points[middle].executed <= executed)
+        {
+            found = middle;
+            low = middle + 1;
+        }
+        else
+            high = middle - 1;
+    }
+    if (found == -1)
+    {
+        memcpy(reader->cells, reader->initial_cells, sizeof(reader->cells));
+        reader->executed = reader->header.executed;
+        reader->offset = 0;
+        reader->next_point = 0;
+    }
+    else
+    {
+        memcpy(reader->cells, reader->points[found].cells, sizeof(reader->cells));
+        reader->executed = reader->points[found].executed;
+        reader->offset = reader->points[found].offset;
+        reader->next_point = (unsigned long)found;
+    }
+    reader->previous_pc = 0;
+    reader->previous_cell = 0;
+    if (fseek(reader->file, (long)(sizeof(Trace_Header) + sizeof(reader->initial_cells) + reader->offset),
+              SEEK_SET) != 0 || read_blocks(reader) != 0)
+        return 1; /* Indicates failure */
+    while (reader->executed < executed && (result = read_trace_entry(reader, &entry)) == 1)
+        ;
+    return result == -1 ? 1 : 0;
+}
+
+int read_trace_entry(Trace_Reader *reader, Trace_Entry *entry)
+{
+    Trace_Block *block = &reader->blocks[reader->current], *following;
+    Decoded_Instruction instruction;
+    int cell;
+
+    if (block->count == 0)
+        return 0; /* End of the trace */
+    decode_instruction(reader->cells, reader->pc, &instruction);
+    entry->executed = reader->executed++;
+    entry->pc = reader->pc;
+    entry->handler = instruction.handler;
+    entry->length = instruction.length;
+    entry->cell = -1;
+    if (reader->write_index < block->writes_count && block->instructions[reader->write_index] == reader->position)
+    {
+        cell = block->cells[reader->write_index];
+        reader->cells[cell] = (unsigned short)((reader->cells[cell] + block->differences[reader->write_index++]) &
+                                               MASK_10_BITS);
+        entry->cell = cell;
+        entry->value = reader->cells[cell];
+    }
+    entry->is_last = ++reader->position == block->count;
+    if (!entry->is_last)
+    {
+        reader->pc = instruction.next;
+        entry->next_pc = reader->pc;
+        return 1;
+    }
+    /* The next block comes in, and the one after it is read */
+    following = &reader->blocks[1 - reader->current];
+    entry->next_pc = following->count > 0 ? following->start : -1;
+    reader->pc = following->start;
+    reader->position = 0;
+    reader->write_index = 0;
+    reader->current = 1 - reader->current;
+    return read_block(reader, block) == 0 ? 1 : -1;
+}
+
+void close_trace_reader(Trace_Reader *reader)
+{
+    fclose(reader->file);
+    free(reader->points);
+    free(reader);
+}
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "error_handler.h"
+#include "machine.h"
+#include "validator.h"
+#include "trace.h"
+#include "utils.h"
+#include "definitions.h"
+
+/**
+ * Prints an instruction of a trace: its instruction count, address and mnemonic, the word or register it wrote, and
+ * where control went after it when it ended a basic block.
+ * @entry: Pointer to the instruction.
+ */
+static void print_entry(Trace_Entry *entry)
+{
+    InstructionDefinition *opcodes = retrieve_instruction_set();
+
+    printf("%10lu %4d %-4s", entry->executed, entry->pc,
+           entry->handler < TOTAL_OPCODES ? opcodes[entry->handler].mnemonic : "?");
+    if (entry->cell >= MACHINE_MEMORY_SIZE)
+        printf(" r%d = %d", entry->cell - REGISTER_CELL(0), SIGN_EXTEND_10_BITS(entry->value));
+    else if (entry->cell != -1)
+        printf(" word %d = %d", entry->cell, SIGN_EXTEND_10_BITS(entry->value));
+    if (entry->handler == BNE_OPCODE && entry->next_pc != -1)
+        printf(entry->next_pc == entry->pc + entry->length ? " not taken" : " taken -> %d", entry->next_pc);
+    else if (entry->is_last && entry->next_pc != -1 && entry->next_pc != entry->pc + entry->length)
+        printf(" -> %d", entry->next_pc);
+    printf("\n");
+}
+
+/**
+ * This is the main function of the trace reader, it prints the instructions of a trace that the emulator recorded
+ * (see the "-T" option of the emulator), one per line, followed by the end of the run.
+ * The option "-a start" starts at the instruction after start instructions, seeking from the index point before it.
+ * The option "-c count" prints count instructions at most.
+ * argc: The number of command-line arguments.
+ * argv: An array of strings containing the command-line arguments.
+ * return Returns 0 if the trace was read, 1 otherwise.
+ */
+
+int main(int argc, char *argv[]) {
+    int i, result = 1;
+    unsigned long start = 0, count = (unsigned long)-1, printed = 0;
+    char *trace_name = NULL;
+    Trace_Reader *reader;
+    Trace_Footer footer;
+    Trace_Entry entry;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "-c") == 0) {
+            if (i + 1 == argc) {
+                log_system_error(Error_107);
+                return 1;  /* Indicates faliure */
+            }
+            if (argv[i++][1] == 'a')
+                start = strtoul(argv[i], NULL, BASE_10);
+            else
+                count = strtoul(argv[i], NULL, BASE_10);
+        }
+        else if (argv[i][0] == MINUS_SIGN) {
+            printf(" Unrecognized option \"%s\"", argv[i]);
+            log_system_error(Error_106);
+            return 1;  /* Indicates faliure */
+        }
+        else
+            trace_name = argv[i];
+    }
+    if (trace_name == NULL) {  /* Checking if no trace was entered */
+        log_system_error(Error_100);
+        return 1;  /* Indicates faliure */
+    }
+    if ((reader = open_trace(trace_name, &footer)) == NULL)
+        return 1;  /* Indicates faliure */
+    if (seek_trace(reader, start) == 0) {
+        while (printed < count && (result = read_trace_entry(reader, &entry)) == 1) {
+            print_entry(&entry);
+            printed++;
+        }
+    }
+    else
+        result = -1;
+    if (result == -1) {
+        printf(" File \"%s\"", trace_name);
+        log_system_error(Error_307);
+        result = 1;
+    }
+    else {
+        printf("Trace of %lu instructions, ", footer.executed);
+        if (footer.status == MACHINE_HALTED)
+            printf("reached stop at address %d\n", footer.pc);
+        else if (footer.status == MACHINE_FAULTED)
+            printf("faulted with error %d at address %d\n", footer.fault, footer.pc);
+        else
+            printf("stopped at the step limit at address %d\n", footer.pc);
+        result = 0;
+    }
+    close_trace_reader(reader);
+    free_all_memory();
+    return result;
+}
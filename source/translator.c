@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "error_handler.h"
+#include "object_reader.h"
+#include "machine.h"
+#include "interpreter.h"
+#include "c_translator.h"
+#include "utils.h"
+#include "definitions.h"
+
+/* Host compiler used by the check when the CC environment variable is not set */
+#define DEFAULT_COMPILER "cc"
+#define COMPILER_FLAGS "-O2"
+#define MAX_COMMAND_LENGTH 1024
+/* Step limit of the check when no "-n" option is given, so a program that does not stop can not hang it */
+#define DEFAULT_CHECK_STEPS 1000000000UL
+
+/* Suffix of the translation name when no "-o" option is given */
+#define DEFAULT_OUTPUT_SUFFIX "_native"
+
+/**
+ * Runs a command of the host, reporting it if it fails.
+ * @command: The command to run.
+ * return 0 if the command succeeded, 1 otherwise.
+ */
+static int run_command(char *command)
+{
+    if (system(command) != 0) {
+        printf(" Command \"%s\"", command);
+        log_system_error(Error_108);
+        return 1;  /* Indicates faliure */
+    }
+    return 0;
+}
+
+/**
+ * Appends an argument to a command of the host, in single quotes so the shell takes all of its characters as they are.
+ * @command: The command, with room for MAX_COMMAND_LENGTH characters.
+ * @separator: Text to put before the argument outside the quotes (" ", or a redirection such as " <").
+ * @prefix: Text to put before the argument inside the quotes.
+ * @argument: The argument.
+ * return 0 if the argument fits in the command, 1 otherwise.
+ */
+static int append_argument(char *command, char *separator, char *prefix, char *argument)
+{
+    size_t length = strlen(command);
+
+    /* A quote inside the argument takes 4 characters: it closes the quotes, adds an escaped quote and opens them */
+    if (length + strlen(separator) + strlen(prefix) + 4 * strlen(argument) + 3 > MAX_COMMAND_LENGTH)
+        return 1;  /* Indicates faliure */
+    for (; *separator != '\0'; separator++)
+        command[length++] = *separator;
+    command[length++] = '\'';
+    for (; *prefix != '\0'; prefix++)
+        command[length++] = *prefix;
+    for (; *argument != '\0'; argument++) {
+        if (*argument == '\'') {
+            memcpy(command + length, "'\\''", 4);
+            length += 4;
+        }
+        else
+            command[length++] = *argument;
+    }
+    command[length++] = '\'';
+    command[length] = '\0';
+    return 0;
+}
+
+/**
+ * Compiles a translation, runs it and the interpreter on the same input, and compares their outputs and final states.
+ * The input is read from the standard input, the output of the translated program is printed.
+ * @module: The translated program.
+ * @output_name: The name of the translation without an extension, also the name of the compiled program.
+ * @max_steps: The step limit of both runs.
+ * return 0 if the runs agree and the program reached "stop", 1 otherwise.
+ */
+static int check_translation(Object_Module *module, char *output_name, unsigned long max_steps)
+{
+    char command[MAX_COMMAND_LENGTH], *compiler = getenv("CC");
+    char *input_name = add_extension(output_name, ".in"), *output_file_name = add_extension(output_name, ".out");
+    char *state_name = add_extension(output_name, ".state"), *source_name = add_extension(output_name, ".c");
+    char steps[32];
+    unsigned long input_size;
+    unsigned char *input = read_program_input(stdin, &input_size);
+    FILE *input_file, *translated_output = NULL, *translated_state = NULL, *output = tmpfile(), *state = tmpfile();
+    Machine *machine = (Machine *)malloc(sizeof(Machine));
+    int character, result = 1;
+
+    if (compiler == NULL)
+        compiler = DEFAULT_COMPILER;
+    if (input == NULL || machine == NULL || output == NULL || state == NULL) {
+        log_system_error(input == NULL || machine == NULL ? Error_101 : Error_104);
+        goto cleanup;
+    }
+    if ((input_file = fopen(input_name, "wb")) == NULL) {
+        printf(" File \"%s\"", input_name);
+        log_system_error(Error_104);
+        goto cleanup;
+    }
+    fwrite(input, 1, input_size, input_file);
+    fclose(input_file);
+
+    /* The translated program, the file names are quoted but the compiler is not, it may hold options of its own */
+    if (strlen(compiler) + strlen(COMPILER_FLAGS) + 4 >= MAX_COMMAND_LENGTH ||
+        (sprintf(command, "%s %s -o", compiler, COMPILER_FLAGS), append_argument(command, " ", "", output_name)) != 0 ||
+        append_argument(command, " ", "", source_name) != 0) {
+        printf(" Compiling \"%s\"", source_name);
+        log_system_error(Error_108);
+        goto cleanup;
+    }
+    if (run_command(command) != 0)
+        goto cleanup;
+    sprintf(steps, "%lu", max_steps);
+    command[0] = '\0';
+    if (append_argument(command, "", strchr(output_name, '/') == NULL ? "./" : "", output_name) != 0 ||
+        append_argument(command, " ", "", state_name) != 0 || append_argument(command, " ", "", steps) != 0 ||
+        append_argument(command, " < ", "", input_name) != 0 ||
+        append_argument(command, " > ", "", output_file_name) != 0) {
+        printf(" Running \"%s\"", output_name);
+        log_system_error(Error_108);
+        goto cleanup;
+    }
+    system(command);  /* A program that did not reach "stop" exits with 1, its state tells how it ended */
+    translated_output = fopen(output_file_name, "r");
+    translated_state = fopen(state_name, "r");
+    if (translated_output == NULL || translated_state == NULL) {
+        printf(" File \"%s\"", translated_output == NULL ? output_file_name : state_name);
+        log_system_error(Error_103);
+        goto cleanup;
+    }
+
+    /* The interpreter */
+    if (load_machine(machine, module) != 0)
+        goto cleanup;
+    machine->input = input;
+    machine->input_size = input_size;
+    machine->output = output;
+    run_machine(machine, max_steps);
+    write_machine_state(machine, state);
+
+    while ((character = fgetc(translated_output)) != EOF)
+        putchar(character);
+    if (!is_same_output(translated_output, output))
+        printf(" Check failed: the translated program and the interpreter wrote different outputs\n");
+    else if (!is_same_output(translated_state, state))  /* Both states are written in the same text format */
+        printf(" Check failed: the translated program and the interpreter ended in different states\n");
+    else {
+        printf("Check passed: %lu instructions, same state and output with the interpreter\n", machine->executed);
+        result = machine->status == MACHINE_HALTED ? 0 : 1;
+    }
+
+cleanup:
+    if (translated_output != NULL)
+        fclose(translated_output);
+    if (translated_state != NULL)
+        fclose(translated_state);
+    if (output != NULL)
+        fclose(output);
+    if (state != NULL)
+        fclose(state);
+    remove(input_name);
+    remove(output_file_name);
+    remove(state_name);
+    free(input);
+    free(machine);
+    return result;
+}
+
+/**
+ * Writes the C translation of a program.
+ * @module: The program to translate.
+ * @output_name: The name of the translation without an extension.
+ * return 0 if successful, 1 if errors were detected.
+ */
+static int write_translation(Object_Module *module, char *output_name)
+{
+    char *file_name = add_extension(output_name, ".c");
+    Machine *machine = (Machine *)malloc(sizeof(Machine));
+    FILE *file;
+    int count;
+
+    if (machine == NULL) {
+        log_system_error(Error_101);
+        return 1;  /* Indicates faliure */
+    }
+    if (load_machine(machine, module) != 0) {
+        free(machine);
+        return 1;  /* Indicates faliure */
+    }
+    if ((file = fopen(file_name, "w")) == NULL) {
+        printf(" File \"%s\"", file_name);
+        log_system_error(Error_104);
+        free(machine);
+        return 1;  /* Indicates faliure */
+    }
+    count = translate_program(machine, module->name, file);
+    fclose(file);
+    free(machine);
+    printf("Translated %d instructions of \"%s\" into \"%s\"\n", count, module->name, file_name);
+    return 0;
+}
+
+/**
+ * This is the main function of the translator, it translates an assembled (and linked) program into C.
+ * The program is given by its name without an extension, and is loaded from its output files (.ob, .ent, .ext).
+ * The translation is written to name_native.c, it compiles into a program that runs the same as the emulator.
+ * The option "-o name" sets the name of the translation (name.c).
+ * The option "-c" also compiles the translation with the host compiler ($CC, or cc), runs it and the interpreter on
+ * the standard input, and checks that their outputs and final states are the same.
+ * The option "-n steps" sets the step limit of both runs of "-c" (DEFAULT_CHECK_STEPS by default), a run that reaches
+ * it stops with the step limit status and fails the check.
+ * argc: The number of command-line arguments.
+ * argv: An array of strings containing the command-line arguments.
+ * return Returns 0 if the translation was written (and the check passed), 1 otherwise.
+ */
+
+int main(int argc, char *argv[]) {
+    int i, result, is_check = 0;
+    unsigned long max_steps = DEFAULT_CHECK_STEPS;
+    char *program_name = NULL, *output_name = NULL;
+    Object_Module *module;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0) {
+            if (++i == argc) {
+                log_system_error(Error_107);
+                return 1;  /* Indicates faliure */
+            }
+            output_name = argv[i];
+        }
+        else if (strcmp(argv[i], "-n") == 0) {
+            if (++i == argc) {
+                log_system_error(Error_107);
+                return 1;  /* Indicates faliure */
+            }
+            max_steps = strtoul(argv[i], NULL, BASE_10);
+        }
+        else if (strcmp(argv[i], "-c") == 0)
+            is_check = 1;
+        else if (argv[i][0] == MINUS_SIGN) {
+            printf(" Unrecognized option \"%s\"", argv[i]);
+            log_system_error(Error_106);
+            return 1;  /* Indicates faliure */
+        }
+        else
+            program_name = argv[i];
+    }
+    if (program_name == NULL) {  /* Checking if no program was entered */
+        log_system_error(Error_100);
+        return 1;  /* Indicates faliure */
+    }
+    if (output_name == NULL)
+        output_name = add_extension(program_name, DEFAULT_OUTPUT_SUFFIX);
+    module = read_object_module(program_name);
+    if (module == NULL)
+        return 1;  /* Indicates faliure */
+    result = write_translation(module, output_name);
+    if (result == 0 && is_check)
+        result = check_translation(module, output_name, max_steps);
+    free_object_module(module);
+    free_all_memory();
+    return result;
+}
@@ -13,6 +13,7 @@
 #include "error_handler.h"
 #include "macro_handler.h"
 #include "labels_handler.h"
+#include "relocation_table.h"
 #include "definitions.h"
 
 /* Defining the head of the memory-nodes linked list */
@@ -174,7 +175,7 @@ int contains_whitespace(char *str) {
     return 0;  /* Indicates no whitespace character found */
 }
 
-int *get_numbers(Line *line, char *ptr, int *num_count, int *errors_found) {
+int *get_numbers(Line *line, char *ptr, int *num_count, int *errors_found, int range_error) {
     int *result;
     char buffer[INTEGER_STRING_BUFFER_SIZE];
     int numbers[MAX_DATA_VALUES_PER_LINE];
@@ -218,7 +219,7 @@ int *get_numbers(Line *line, char *ptr, int *num_count, int *errors_found) {
 
             /* Checking if the number is in range */
             if (num < MIN_10_BIT_SIGNED_VALUE || num > MAX_10_BIT_SIGNED_VALUE) {
-                log_syntax_error(Error_230,line->file_am_name,line->line_num);
+                log_syntax_error(range_error,line->file_am_name,line->line_num);
                 *errors_found = 1;
                 return NULL;
             }
@@ -411,11 +412,47 @@ void convert_to_base4_5digits(int decimal_num, char *output) {
     }
 }
 
-void create_ob_file(char *file_ob_name, unsigned short *code, unsigned short *data, int *IC, int *DC) {
-    FILE *file_ob = fopen(file_ob_name, "w");
+/**
+ * Writes words of the object file, one line per word, or one line per run of equal words.
+ * @file_ob: The object file.
+ * @words: The words to write.
+ * @count: The number of words.
+ * @address: The address of the first word.
+ * @is_run_length: 1 to write a run of equal words as its first line followed by '*' and the length of the run.
+ */
+static void write_ob_words(FILE *file_ob, unsigned short *words, int count, int address, int is_run_length) {
     char base4_value[TEMP_CONVERSION_BUFFER_SIZE]; /* Buffer for base 4 value */
     char base4_addr[TEMP_CONVERSION_BUFFER_SIZE]; /* Buffer for base 4 address */
-    int i = 0, j = 0;
+    char base4_run[TEMP_CONVERSION_BUFFER_SIZE]; /* Buffer for base 4 run length */
+    int i, run;
+
+    for (i = 0; i < count; i += run) {
+        run = 1;
+        while (is_run_length && i + run < count && words[i + run] == words[i])
+            run++;
+        convert_to_base4(i + address, base4_addr);
+        convert_to_base4_5digits(words[i] & MASK_10_BITS, base4_value);
+        if (run > 1) {
+            convert_to_base4(run, base4_run);
+            fprintf(file_ob, "%s %s %c%s\n", base4_addr, base4_value, ASTERISK_SIGN, base4_run);
+        } else {
+            fprintf(file_ob, "%s %s\n", base4_addr, base4_value);
+        }
+    }
+}
+
+/**
+ * Writes an object file, word by word or with the runs of equal words as single lines.
+ * @file_ob_name: The name of the object file to create.
+ * @code: Array containing the instruction code.
+ * @data: Array containing the data code.
+ * @ic: Pointer to the instruction counter.
+ * @dc: Pointer to the data counter.
+ * @is_run_length: 1 to write the runs of equal words as single lines.
+ */
+static void write_ob_file(char *file_ob_name, unsigned short *code, unsigned short *data, int *IC, int *DC, int is_run_length) {
+    FILE *file_ob = fopen(file_ob_name, "w");
+    char base4_addr[TEMP_CONVERSION_BUFFER_SIZE]; /* Buffer for base 4 address */
 
     if (file_ob == NULL) {  /* Failed to open file for writing */
         log_system_error(Error_104);
@@ -430,23 +467,21 @@ void create_ob_file(char *file_ob_name, unsigned short *code, unsigned short *da
     convert_to_base4(*DC, base4_addr);
     fprintf(file_ob, "%s\n", base4_addr);
 
-    /* Write code section in base 4 with base 4 addresses */
-    for (i = 0; i < *IC; i++) {
-        convert_to_base4(i + MEMORY_START_ADDRESS, base4_addr);
-        convert_to_base4_5digits(code[i] & MASK_10_BITS, base4_value);
-        fprintf(file_ob, "%s %s\n", base4_addr, base4_value);
-    }
-
-    /* Write data section in base 4 with base 4 addresses */
-    for (j = 0; j < *DC; j++) {
-        convert_to_base4(j + i + MEMORY_START_ADDRESS, base4_addr);
-        convert_to_base4_5digits(data[j] & MASK_10_BITS, base4_value);
-        fprintf(file_ob, "%s %s\n", base4_addr, base4_value);
-    }
+    /* Write code section and then data section in base 4 with base 4 addresses */
+    write_ob_words(file_ob, code, *IC, MEMORY_START_ADDRESS, is_run_length);
+    write_ob_words(file_ob, data, *DC, *IC + MEMORY_START_ADDRESS, is_run_length);
 
     fclose(file_ob);
 }
 
+void create_ob_file(char *file_ob_name, unsigned short *code, unsigned short *data, int *IC, int *DC) {
+    write_ob_file(file_ob_name, code, data, IC, DC, 0);
+}
+
+void create_run_length_ob_file(char *file_ob_name, unsigned short *code, unsigned short *data, int *IC, int *DC) {
+    write_ob_file(file_ob_name, code, data, IC, DC, 1);
+}
+
 
 void create_ent_file(char *file_ent_name) {
     FILE *file_ent = fopen(file_ent_name,"w");
@@ -473,7 +508,8 @@ void create_ent_file(char *file_ent_name) {
 
 void create_ext_file(char *file_ext_name) {
     FILE *file_ext = fopen(file_ext_name,"w");
-    Label *current;
+    Relocation *relocations;
+    int i, relocations_count;
     char base4_addr[TEMP_CONVERSION_BUFFER_SIZE]; /* Buffer for base 4 address */
 
     if (file_ext == NULL) {  /* Failed to open file for writing */
@@ -483,13 +519,13 @@ void create_ext_file(char *file_ext_name) {
         exit(1);  /* Exiting program */
     }
 
-    current = point_label_head();
-    while (current != NULL) {
-        if (current->type == EXTERN && current->location == CODE) {
-            convert_to_base4(current->address, base4_addr);
-            fprintf(file_ext,"%s %s\n",current->name,base4_addr);
+    /* The external records of the sorted relocation table are the external uses, in address order */
+    relocations = retrieve_relocations(&relocations_count);
+    for (i = 0; i < relocations_count; i++) {
+        if (relocations[i].kind == EXTERNAL) {
+            convert_to_base4(relocations[i].address, base4_addr);
+            fprintf(file_ext,"%s %s\n",retrieve_relocation_symbol(relocations[i].symbol),base4_addr);
         }
-        current = current->next;
     }
     fclose(file_ext);
 }
@@ -41,13 +41,30 @@ InstructionDefinition OPCODES[] = {
 char *REGISTERS[] = {"r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7"};
 
 /* Defining the instructions */
-char *INSTRUCTIONS[] = {".data", ".string", ".entry", ".extern", ".mat"};
+char *INSTRUCTIONS[] = {".data", ".string", ".entry", ".extern", ".mat", ".zero", ".fill"};
 
 InstructionDefinition *retrieve_instruction_set()
 {
     return OPCODES;
 }
 
+int is_addressing_mode_supported(SupportedAddressingModes modes, int method)
+{
+    switch (modes)
+    {
+    case ALL_MODES:
+        return 1;
+    case DIRECT_ONLY:
+        return method == DIRECT;
+    case DIRECT_AND_REGISTER:
+        return method == DIRECT || method == DIRECT_REGISTER;
+    case ALL_EXCEPT_IMMEDIATE:
+        return method != IMMEDIATE;
+    default:
+        return 0; /* NO_MODES */
+    }
+}
+
 /*
  * Internal helpers for tolerant operand parsing
  * - Allow spaces inside matrix brackets and around commas
@@ -540,6 +557,14 @@ int parse_assembler_directive(unsigned short *data_segment, int *memory_usage, i
         parse_position += curr_word_len;
         process_matrix_directive(data_segment, memory_usage, data_counter, context, parse_position, error_counter);
         return 1;
+    case 5:
+        parse_position += curr_word_len; /* Skipping the first word ".zero" */
+        process_fill_directive(data_segment, memory_usage, data_counter, context, parse_position, 1, error_counter);
+        return 1; /* Scanning line finished */
+    case 6:
+        parse_position += curr_word_len; /* Skipping the first word ".fill" */
+        process_fill_directive(data_segment, memory_usage, data_counter, context, parse_position, 2, error_counter);
+        return 1; /* Scanning line finished */
     default:
         return 0; /* Indicates line is not an "instruction" line, continue scanning */
     }
@@ -1080,12 +1105,69 @@ void generate_instruction_machine_code(unsigned short *instruction_segment, int
     }
 }
 
+void process_fill_directive(unsigned short *data_segment, int *memory_usage, int *data_counter, Line *context, char *fill_definition, int values_count, int *error_counter)
+{
+    int *num_array;
+    int num_count = 0, i, value;
+
+    /* Checking if there are no parameters */
+    if (*fill_definition == STRING_TERMINATOR)
+    {
+        if (context->label != NULL)
+            remove_last_label();
+        log_syntax_error(Error_264, context->file_am_name, context->line_num);
+        *error_counter = 1;
+        return;
+    }
+    num_array = get_numbers(context, fill_definition, &num_count, error_counter, Error_266);
+    if (num_array == NULL)
+    {
+        if (context->label != NULL)
+            remove_last_label();
+        return;
+    }
+    /* ".zero N" takes the count only, ".fill N, value" takes the count and the value */
+    if (num_count != values_count || num_array[0] <= 0)
+    {
+        if (context->label != NULL)
+            remove_last_label();
+        log_syntax_error(num_count != values_count ? Error_264 : Error_265, context->file_am_name, context->line_num);
+        *error_counter = 1;
+        clean_memory(num_array);
+        return;
+    }
+    value = values_count == 2 ? num_array[1] : 0;
+
+    /* Updating label properties */
+    if (context->label != NULL)
+    {
+        context->label->address = *data_counter;
+        context->label->location = DATA;
+    }
+    /* Adding the value as many times as the count */
+    for (i = 0; i < num_array[0]; i++)
+    {
+        if (*memory_usage == MAX_ARRAY_CAPACITY)
+        { /* Checking if memory limit was reached */
+            log_system_error(Error_105);
+            *error_counter = 1;
+            (*memory_usage)++; /* Incrementing usage count so the next iteration will not print another error message */
+            break;
+        }
+        if (*memory_usage > MAX_ARRAY_CAPACITY)
+            break; /* Checking if memory limit was exceeded */
+        add_data(data_segment, data_counter, value);
+        (*memory_usage)++; /* Incrementing usage count */
+    }
+    clean_memory(num_array);
+}
+
 void parse_and_encode_numeric_data(unsigned short *data_segment, int *memory_usage, int *data_counter, Line *context, char *numeric_list, int *error_counter)
 {
     int *num_array;
     int num_count = 0, i = 0;
 
-    num_array = get_numbers(context, numeric_list, &num_count, error_counter);
+    num_array = get_numbers(context, numeric_list, &num_count, error_counter, Error_230);
     if (num_array == NULL)
     {
         if (context->label != NULL)